@@ -0,0 +1,403 @@
+///////////////////////////////////////////////////////////////////////////////
+// ambientocclusion.cpp
+// ============
+// darken the creases where objects meet with screen-space ambient occlusion
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AmbientOcclusion.h"
+#include "ProgramBuilder.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// shader files of the passes, which share one vertex shader
+	const char* g_FullScreenVertexFile = "shaders/fullScreenVertexShader.glsl";
+	const char* g_OcclusionFragmentFile = "shaders/ssaoFragmentShader.glsl";
+	const char* g_BlurFragmentFile = "shaders/ssaoBlurFragmentShader.glsl";
+	const char* g_CompositeFragmentFile = "shaders/ssaoCompositeFragmentShader.glsl";
+	// frames to wait after a resolution change before the timings of
+	// the new targets are trusted
+	const int g_DivisorSettleFrames = 16;
+	// the half resolution is picked again once four times the quarter
+	// resolution time fits in this share of the budget
+	const float g_HalfResolutionShare = 0.8f;
+}
+
+/***********************************************************
+ *  AmbientOcclusion()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AmbientOcclusion::AmbientOcclusion(GpuResourceManager* pResources)
+{
+	m_pResources = pResources;
+	m_pOcclusionShader = NULL;
+	m_pBlurShader = NULL;
+	m_pCompositeShader = NULL;
+	m_vao = GPU_HANDLE();
+	m_sceneFramebuffer = GPU_HANDLE();
+	m_sceneColor = GPU_HANDLE();
+	m_sceneDepth = GPU_HANDLE();
+	for (int i = 0; i < 2; i++)
+	{
+		m_occlusionFramebuffers[i] = GPU_HANDLE();
+		m_occlusionTextures[i] = GPU_HANDLE();
+	}
+	m_width = 0;
+	m_height = 0;
+	m_divisor = 2;
+	m_firstTextureUnit = 0;
+	m_budgetMilliseconds = 1.0f;
+	m_framesAtDivisor = 0;
+	m_savedViewport[0] = 0;
+	m_savedViewport[1] = 0;
+	m_savedViewport[2] = 0;
+	m_savedViewport[3] = 0;
+	m_savedFramebuffer = 0;
+	m_halfFrames = 0;
+	m_quarterFrames = 0;
+}
+
+/***********************************************************
+ *  ~AmbientOcclusion()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AmbientOcclusion::~AmbientOcclusion()
+{
+	DestroyTargets();
+	m_pResources->Release(m_vao);
+	delete m_pOcclusionShader;
+	m_pOcclusionShader = NULL;
+	delete m_pBlurShader;
+	m_pBlurShader = NULL;
+	delete m_pCompositeShader;
+	m_pCompositeShader = NULL;
+	m_pResources = NULL;
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for building the programs of the
+ *  passes.  The programs are small and only built when the
+ *  ambient occlusion is switched on, so the build waits for
+ *  the driver.  The targets are created on the first frame,
+ *  once the window size is known.
+ ***********************************************************/
+bool AmbientOcclusion::Create(int firstTextureUnit, float budgetMilliseconds)
+{
+	m_firstTextureUnit = firstTextureUnit;
+	m_budgetMilliseconds = budgetMilliseconds;
+
+	m_pOcclusionShader = BuildPass(g_OcclusionFragmentFile);
+	m_pBlurShader = BuildPass(g_BlurFragmentFile);
+	m_pCompositeShader = BuildPass(g_CompositeFragmentFile);
+	if ((NULL == m_pOcclusionShader) || (NULL == m_pBlurShader) || (NULL == m_pCompositeShader))
+	{
+		return(false);
+	}
+
+	// the full screen triangles are made from gl_VertexID alone
+	m_vao = m_pResources->CreateVertexArray("ambient occlusion");
+	return(true);
+}
+
+/***********************************************************
+ *  BuildPass()
+ *
+ *  This method is used for building the program of a pass
+ *  from the shared full screen vertex shader.
+ ***********************************************************/
+ShaderManager* AmbientOcclusion::BuildPass(const char* fragmentFile)
+{
+	ProgramBuilder::PENDING_PROGRAM pending;
+	if (ProgramBuilder::LoadProgramSources(g_FullScreenVertexFile, fragmentFile, "", pending) == false)
+	{
+		return(NULL);
+	}
+	ProgramBuilder::CompileProgram(pending);
+
+	ShaderManager* pShader = new ShaderManager();
+	if (ProgramBuilder::FinishProgram(pending, pShader) == false)
+	{
+		delete pShader;
+		return(NULL);
+	}
+	return(pShader);
+}
+
+/***********************************************************
+ *  CreateTargetTexture()
+ *
+ *  This method is used for creating a texture that a pass
+ *  renders into.
+ ***********************************************************/
+GPU_HANDLE AmbientOcclusion::CreateTargetTexture(int width, int height, GLenum internalFormat, GLenum format,
+	GLenum type, GLenum filter, const char* label)
+{
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return(m_pResources->AdoptObject(GpuResourceManager::RESOURCE_TEXTURE, texture, (size_t)width * height * 4, label));
+}
+
+/***********************************************************
+ *  CreateTargets()
+ *
+ *  This method is used for creating the full resolution
+ *  scene target and the reduced resolution occlusion
+ *  targets.  The occlusion targets keep the linear depth
+ *  next to the occlusion, so the blur and the upsample do
+ *  not have to read the full depth buffer again.
+ ***********************************************************/
+bool AmbientOcclusion::CreateTargets(int width, int height, int divisor)
+{
+	DestroyTargets();
+	m_width = width;
+	m_height = height;
+	m_divisor = divisor;
+	m_framesAtDivisor = 0;
+
+	m_sceneColor = CreateTargetTexture(width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_NEAREST,
+		"ambient occlusion scene color");
+	m_sceneDepth = CreateTargetTexture(width, height, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, GL_NEAREST,
+		"ambient occlusion scene depth");
+	m_sceneFramebuffer = m_pResources->CreateFramebuffer("ambient occlusion scene");
+	glBindFramebuffer(GL_FRAMEBUFFER, m_pResources->GetName(m_sceneFramebuffer));
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_pResources->GetName(m_sceneColor), 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_pResources->GetName(m_sceneDepth), 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	int occlusionWidth = (width + divisor - 1) / divisor;
+	int occlusionHeight = (height + divisor - 1) / divisor;
+	for (int i = 0; (i < 2) && (status == GL_FRAMEBUFFER_COMPLETE); i++)
+	{
+		m_occlusionTextures[i] = CreateTargetTexture(occlusionWidth, occlusionHeight, GL_RG16F, GL_RG, GL_HALF_FLOAT,
+			GL_NEAREST, "ambient occlusion");
+		m_occlusionFramebuffers[i] = m_pResources->CreateFramebuffer("ambient occlusion");
+		glBindFramebuffer(GL_FRAMEBUFFER, m_pResources->GetName(m_occlusionFramebuffers[i]));
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+			m_pResources->GetName(m_occlusionTextures[i]), 0);
+		// a recycled framebuffer may still have a depth attachment
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+		status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Ambient occlusion framebuffer is incomplete, status:" << status << std::endl;
+		DestroyTargets();
+		// only try again when the window size changes
+		m_width = width;
+		m_height = height;
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTargets()
+ *
+ *  This method is used for releasing the targets, once the
+ *  GPU has finished with them.
+ ***********************************************************/
+void AmbientOcclusion::DestroyTargets()
+{
+	m_pResources->Release(m_sceneFramebuffer);
+	m_pResources->Release(m_sceneColor);
+	m_pResources->Release(m_sceneDepth);
+	for (int i = 0; i < 2; i++)
+	{
+		m_pResources->Release(m_occlusionFramebuffers[i]);
+		m_pResources->Release(m_occlusionTextures[i]);
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  BeginScene()
+ *
+ *  This method is used for switching to the offscreen scene
+ *  target, which is created again when the window size or
+ *  the resolution divisor changed.
+ ***********************************************************/
+void AmbientOcclusion::BeginScene()
+{
+	glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+
+	int width = m_savedViewport[2];
+	int height = m_savedViewport[3];
+	if ((width != m_width) || (height != m_height))
+	{
+		CreateTargets(width, height, m_divisor);
+	}
+	if (m_pResources->IsValid(m_sceneFramebuffer) == false)
+	{
+		return;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_pResources->GetName(m_sceneFramebuffer));
+	glViewport(0, 0, width, height);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+/***********************************************************
+ *  EndScene()
+ *
+ *  This method is used for running the passes on the drawn
+ *  scene.  The occlusion is worked out from the depth, then
+ *  blurred across and down, and the composite upsamples it
+ *  and darkens the scene color with it into the render
+ *  target that was bound before the scene.
+ ***********************************************************/
+void AmbientOcclusion::EndScene(const glm::mat4& projection)
+{
+	if (m_pResources->IsValid(m_sceneFramebuffer) == false)
+	{
+		return;
+	}
+
+	int occlusionWidth = (m_width + m_divisor - 1) / m_divisor;
+	int occlusionHeight = (m_height + m_divisor - 1) / m_divisor;
+	glm::vec2 fullTexelSize(1.0f / (float)m_width, 1.0f / (float)m_height);
+	glm::vec2 occlusionTexelSize(1.0f / (float)occlusionWidth, 1.0f / (float)occlusionHeight);
+	GLint depthUnit = m_firstTextureUnit;
+	GLint occlusionUnit = m_firstTextureUnit + 1;
+	GLint colorUnit = m_firstTextureUnit + 2;
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glBindVertexArray(m_pResources->GetName(m_vao));
+	glActiveTexture(GL_TEXTURE0 + depthUnit);
+	glBindTexture(GL_TEXTURE_2D, m_pResources->GetName(m_sceneDepth));
+
+	// occlusion from the depth buffer at the reduced resolution
+	m_timers[PASS_OCCLUSION].Begin();
+	glBindFramebuffer(GL_FRAMEBUFFER, m_pResources->GetName(m_occlusionFramebuffers[0]));
+	glViewport(0, 0, occlusionWidth, occlusionHeight);
+	m_pOcclusionShader->use();
+	m_pOcclusionShader->setSampler2DValue("sceneDepth", depthUnit);
+	m_pOcclusionShader->setMat4Value("projection", projection);
+	m_pOcclusionShader->setMat4Value("inverseProjection", glm::inverse(projection));
+	m_pOcclusionShader->setVec2Value("depthTexelSize", fullTexelSize);
+	DrawFullScreen();
+	m_timers[PASS_OCCLUSION].End();
+
+	// blur across into the second target and down back into the first
+	m_timers[PASS_BLUR].Begin();
+	m_pBlurShader->use();
+	m_pBlurShader->setSampler2DValue("occlusion", occlusionUnit);
+	for (int i = 0; i < 2; i++)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_pResources->GetName(m_occlusionFramebuffers[1 - i]));
+		glActiveTexture(GL_TEXTURE0 + occlusionUnit);
+		glBindTexture(GL_TEXTURE_2D, m_pResources->GetName(m_occlusionTextures[i]));
+		m_pBlurShader->setVec2Value("blurStep", (i == 0) ? glm::vec2(occlusionTexelSize.x, 0.0f) : glm::vec2(0.0f, occlusionTexelSize.y));
+		DrawFullScreen();
+	}
+	m_timers[PASS_BLUR].End();
+
+	// upsample and darken the scene color into the saved target
+	m_timers[PASS_COMPOSITE].Begin();
+	glBindFramebuffer(GL_FRAMEBUFFER, m_savedFramebuffer);
+	glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+	glActiveTexture(GL_TEXTURE0 + occlusionUnit);
+	glBindTexture(GL_TEXTURE_2D, m_pResources->GetName(m_occlusionTextures[0]));
+	glActiveTexture(GL_TEXTURE0 + colorUnit);
+	glBindTexture(GL_TEXTURE_2D, m_pResources->GetName(m_sceneColor));
+	m_pCompositeShader->use();
+	m_pCompositeShader->setSampler2DValue("sceneDepth", depthUnit);
+	m_pCompositeShader->setSampler2DValue("occlusion", occlusionUnit);
+	m_pCompositeShader->setSampler2DValue("sceneColor", colorUnit);
+	m_pCompositeShader->setMat4Value("inverseProjection", glm::inverse(projection));
+	m_pCompositeShader->setVec2Value("occlusionSize", glm::vec2((float)occlusionWidth, (float)occlusionHeight));
+	DrawFullScreen();
+	m_timers[PASS_COMPOSITE].End();
+
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE0);
+	glEnable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+
+	if (m_divisor == 2)
+	{
+		m_halfFrames++;
+	}
+	else
+	{
+		m_quarterFrames++;
+	}
+	UpdateDivisor();
+}
+
+/***********************************************************
+ *  DrawFullScreen()
+ *
+ *  This method is used for drawing a triangle that covers
+ *  the whole viewport.
+ ***********************************************************/
+void AmbientOcclusion::DrawFullScreen()
+{
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+/***********************************************************
+ *  UpdateDivisor()
+ *
+ *  This method is used for keeping the occlusion and blur
+ *  inside their GPU budget.  Over the budget the passes
+ *  drop to a quarter resolution, and they go back to half
+ *  resolution once four times the quarter time fits well
+ *  inside the budget.  The timings lag a few frames behind,
+ *  so a change waits for the timings of the new targets.
+ ***********************************************************/
+void AmbientOcclusion::UpdateDivisor()
+{
+	m_framesAtDivisor++;
+	if (m_framesAtDivisor < g_DivisorSettleFrames)
+	{
+		return;
+	}
+
+	double milliseconds = m_timers[PASS_OCCLUSION].GetLastMilliseconds() + m_timers[PASS_BLUR].GetLastMilliseconds();
+	if ((m_divisor == 2) && (milliseconds > m_budgetMilliseconds))
+	{
+		m_divisor = 4;
+		m_width = 0;
+	}
+	else if ((m_divisor == 4) && (milliseconds * 4.0 < m_budgetMilliseconds * g_HalfResolutionShare))
+	{
+		m_divisor = 2;
+		m_width = 0;
+	}
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the average GPU time of
+ *  every pass and how often each resolution was used.
+ ***********************************************************/
+void AmbientOcclusion::PrintStats() const
+{
+	const char* passNames[PASS_COUNT] = { "occlusion", "blur", "composite" };
+	std::cout << "Ambient occlusion: " << m_halfFrames << " frames at half resolution, "
+		<< m_quarterFrames << " at quarter resolution, budget " << m_budgetMilliseconds << " ms" << std::endl;
+	for (int i = 0; i < PASS_COUNT; i++)
+	{
+		std::cout << "  " << passNames[i] << " pass: " << m_timers[i].GetAverageMilliseconds() << " ms GPU" << std::endl;
+	}
+}
@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+// ambientocclusion.h
+// ============
+// darken the creases where objects meet with screen-space ambient occlusion
+//
+//	The scene is drawn into an offscreen color and depth target.  The
+//	occlusion is then worked out at half or quarter resolution from the
+//	depth alone, with the normals rebuilt from neighboring depths, blurred
+//	with a separable filter that does not blur across depth edges, and
+//	upsampled with the same depth weights while it is applied to the
+//	scene color.  Every pass is timed on the GPU, and the resolution drops
+//	to a quarter when the occlusion and blur go over their time budget.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GpuResourceManager.h"
+#include "ShaderManager.h"
+#include "GpuTimer.h"
+
+/***********************************************************
+ *  AmbientOcclusion
+ *
+ *  This class owns the offscreen targets, programs and
+ *  timers of the ambient occlusion passes.
+ ***********************************************************/
+class AmbientOcclusion
+{
+public:
+	// passes that are timed
+	enum PASS
+	{
+		PASS_OCCLUSION = 0,
+		PASS_BLUR,
+		PASS_COMPOSITE,
+		PASS_COUNT
+	};
+
+	// constructor - the targets are owned by the resource manager
+	AmbientOcclusion(GpuResourceManager* pResources);
+	// destructor
+	~AmbientOcclusion();
+
+	// build the pass programs, with the passed in texture unit and the
+	// two after it used for the pass inputs
+	bool Create(int firstTextureUnit, float budgetMilliseconds);
+
+	// draw the scene into the offscreen target from here on
+	void BeginScene();
+	// work out the occlusion for the passed in projection and draw the
+	// occluded scene into the render target that was bound before
+	void EndScene(const glm::mat4& projection);
+
+	// get the resolution divisor of the occlusion passes
+	int GetDivisor() const { return(m_divisor); }
+	// print the GPU time of every pass
+	void PrintStats() const;
+
+private:
+	// resource manager that owns the targets
+	GpuResourceManager* m_pResources;
+	// programs of the three passes
+	ShaderManager* m_pOcclusionShader;
+	ShaderManager* m_pBlurShader;
+	ShaderManager* m_pCompositeShader;
+	// empty vertex array for the full screen triangles
+	GPU_HANDLE m_vao;
+
+	// full resolution scene color and depth
+	GPU_HANDLE m_sceneFramebuffer;
+	GPU_HANDLE m_sceneColor;
+	GPU_HANDLE m_sceneDepth;
+	// reduced resolution occlusion and linear depth, ping-ponged by the
+	// blur passes
+	GPU_HANDLE m_occlusionFramebuffers[2];
+	GPU_HANDLE m_occlusionTextures[2];
+
+	// size the targets were created for
+	int m_width;
+	int m_height;
+	int m_divisor;
+	int m_firstTextureUnit;
+	float m_budgetMilliseconds;
+	// frames since the resolution last changed
+	int m_framesAtDivisor;
+
+	// render state saved while the scene is drawn offscreen
+	GLint m_savedViewport[4];
+	GLint m_savedFramebuffer;
+
+	GpuTimer m_timers[PASS_COUNT];
+	// frames drawn at half and at quarter resolution
+	int64_t m_halfFrames;
+	int64_t m_quarterFrames;
+
+	// build the program of one pass
+	ShaderManager* BuildPass(const char* fragmentFile);
+	// create the targets for a window size and divisor
+	bool CreateTargets(int width, int height, int divisor);
+	// release the targets
+	void DestroyTargets();
+	// create a texture for a target
+	GPU_HANDLE CreateTargetTexture(int width, int height, GLenum internalFormat, GLenum format, GLenum type,
+		GLenum filter, const char* label);
+	// pick the resolution for the next frames from the latest timings
+	void UpdateDivisor();
+	// draw one full screen triangle
+	void DrawFullScreen();
+};
@@ -0,0 +1,522 @@
+///////////////////////////////////////////////////////////////////////////////
+// animationsystem.cpp
+// ============
+// move scene objects along keyframed position, rotation and scale tracks
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AnimationSystem.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// x64 builds always have SSE, and 32-bit builds have it when it is
+// switched on with /arch or -msse
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#include <xmmintrin.h>
+#define ANIMATION_SIMD 1
+#endif
+
+// declaration of global variables
+namespace
+{
+	// smallest change of a blended value that counts as a change
+	const float g_ChangeEpsilon = 0.0001f;
+	// smallest squared length a blended rotation is divided by
+	const float g_MinRotationLength = 1.0e-12f;
+	// keys per channel and frame time of the benchmark tracks
+	const int g_BenchmarkKeys = 8;
+	const double g_BenchmarkFrameSeconds = 1.0 / 60.0;
+}
+
+/***********************************************************
+ *  AnimationSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AnimationSystem::AnimationSystem()
+{
+	m_laneCount = 0;
+	m_bAllChanged = false;
+	m_time = 0.0;
+	m_updates = 0;
+	m_sampledTracks = 0;
+	m_changedTotal = 0;
+	m_cachedLookups = 0;
+	m_searchedLookups = 0;
+}
+
+/***********************************************************
+ *  IsSimdEnabled()
+ *
+ *  This method is used for checking whether the tracks are
+ *  blended and compared with SSE instructions.
+ ***********************************************************/
+bool AnimationSystem::IsSimdEnabled()
+{
+#ifdef ANIMATION_SIMD
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  RotationFromDegrees()
+ *
+ *  This method is used for turning the rotation angles of a
+ *  scene object into a quaternion.  The model matrices turn
+ *  around X, then Y, then Z, so the quaternions are chained
+ *  in the same order.
+ ***********************************************************/
+glm::quat AnimationSystem::RotationFromDegrees(const glm::vec3& rotationDegrees)
+{
+	glm::quat rotationX = glm::angleAxis(glm::radians(rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f));
+	glm::quat rotationY = glm::angleAxis(glm::radians(rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::quat rotationZ = glm::angleAxis(glm::radians(rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+	return(rotationZ * rotationY * rotationX);
+}
+
+/***********************************************************
+ *  AddTrack()
+ *
+ *  This method is used for adding a track and growing the
+ *  component arrays to a multiple of four tracks.  The
+ *  padding lanes are blended like any other track but are
+ *  never reported.
+ ***********************************************************/
+int AnimationSystem::AddTrack(int target, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	TRACK track;
+	track.target = target;
+	track.restValues[CHANNEL_POSITION] = glm::vec4(position, 0.0f);
+	track.restValues[CHANNEL_ROTATION] = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+	track.restValues[CHANNEL_SCALE] = glm::vec4(scale, 0.0f);
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		track.cachedKeys[channel] = 0;
+	}
+	track.duration = 0.0f;
+	m_tracks.push_back(track);
+
+	m_laneCount = (m_tracks.size() + 3) & ~((size_t)3);
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			m_from[channel].components[c].resize(m_laneCount, 0.0f);
+			m_to[channel].components[c].resize(m_laneCount, 0.0f);
+			m_results[channel].components[c].resize(m_laneCount, 0.0f);
+			m_previous[channel].components[c].resize(m_laneCount, 0.0f);
+		}
+		m_factors[channel].resize(m_laneCount, 0.0f);
+	}
+	m_bAllChanged = true;
+	return((int)m_tracks.size() - 1);
+}
+
+/***********************************************************
+ *  AddPositionKey()
+ *
+ *  This method is used for adding a position key.
+ ***********************************************************/
+void AnimationSystem::AddPositionKey(int track, float time, const glm::vec3& position)
+{
+	AddKey(track, CHANNEL_POSITION, time, glm::vec4(position, 0.0f));
+}
+
+/***********************************************************
+ *  AddRotationKey()
+ *
+ *  This method is used for adding a rotation key.
+ ***********************************************************/
+void AnimationSystem::AddRotationKey(int track, float time, const glm::quat& rotation)
+{
+	AddKey(track, CHANNEL_ROTATION, time, glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w));
+}
+
+/***********************************************************
+ *  AddScaleKey()
+ *
+ *  This method is used for adding a scale key.
+ ***********************************************************/
+void AnimationSystem::AddScaleKey(int track, float time, const glm::vec3& scale)
+{
+	AddKey(track, CHANNEL_SCALE, time, glm::vec4(scale, 0.0f));
+}
+
+/***********************************************************
+ *  AddKey()
+ *
+ *  This method is used for adding a key to a channel in
+ *  order of time.  The track loops over its last key.
+ ***********************************************************/
+void AnimationSystem::AddKey(int track, int channel, float time, const glm::vec4& value)
+{
+	KEY key;
+	key.time = std::max(time, 0.0f);
+	key.value = value;
+
+	TRACK& target = m_tracks[track];
+	std::vector<KEY>& keys = target.keys[channel];
+	std::vector<KEY>::iterator position = keys.begin();
+	while ((position != keys.end()) && (position->time <= key.time))
+	{
+		++position;
+	}
+	keys.insert(position, key);
+	target.cachedKeys[channel] = 0;
+	target.duration = std::max(target.duration, key.time);
+	m_bAllChanged = true;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for sampling every track at the new
+ *  animation time.  The key pairs are found and gathered
+ *  one track at a time, and then every channel is blended
+ *  over all of the tracks at once.
+ ***********************************************************/
+void AnimationSystem::Update(double elapsedSeconds)
+{
+	m_time += std::max(elapsedSeconds, 0.0);
+
+	for (size_t i = 0; i < m_tracks.size(); i++)
+	{
+		TRACK& track = m_tracks[i];
+		float time = (track.duration > 0.0f) ? (float)std::fmod(m_time, (double)track.duration) : 0.0f;
+		for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+		{
+			SampleChannel(track, channel, time, i);
+		}
+	}
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		BlendChannel(channel);
+	}
+	FindChangedTracks();
+
+	m_updates++;
+	m_sampledTracks += (int64_t)m_tracks.size();
+	m_changedTotal += (int64_t)m_changedTracks.size();
+}
+
+/***********************************************************
+ *  SampleChannel()
+ *
+ *  This method is used for finding the keys before and
+ *  after a time.  Time mostly moves on by less than a key
+ *  per frame, so the pair used last time and the pair after
+ *  it are tried first, and the keys are only searched when
+ *  the track looped or jumped.
+ ***********************************************************/
+void AnimationSystem::SampleChannel(TRACK& track, int channel, float time, size_t lane)
+{
+	const std::vector<KEY>& keys = track.keys[channel];
+	glm::vec4 from = track.restValues[channel];
+	glm::vec4 to = from;
+	float factor = 0.0f;
+
+	if (keys.size() == 1)
+	{
+		from = keys[0].value;
+		to = from;
+	}
+	else if (keys.size() > 1)
+	{
+		int lastPair = (int)keys.size() - 2;
+		int pair = track.cachedKeys[channel];
+		if ((pair <= lastPair) && (keys[pair].time <= time) && (time < keys[pair + 1].time))
+		{
+			m_cachedLookups++;
+		}
+		else if ((pair + 1 <= lastPair) && (keys[pair + 1].time <= time) && (time < keys[pair + 2].time))
+		{
+			pair++;
+			m_cachedLookups++;
+		}
+		else
+		{
+			std::vector<KEY>::const_iterator after = std::upper_bound(keys.begin(), keys.end(), time,
+				[](float value, const KEY& key) { return(value < key.time); });
+			pair = std::min(std::max((int)(after - keys.begin()) - 1, 0), lastPair);
+			m_searchedLookups++;
+		}
+		track.cachedKeys[channel] = pair;
+
+		float span = keys[pair + 1].time - keys[pair].time;
+		factor = (span > 0.0f) ? std::min(std::max((time - keys[pair].time) / span, 0.0f), 1.0f) : 1.0f;
+		from = keys[pair].value;
+		to = keys[pair + 1].value;
+	}
+
+	for (int c = 0; c < 4; c++)
+	{
+		m_from[channel].components[c][lane] = from[c];
+		m_to[channel].components[c][lane] = to[c];
+	}
+	m_factors[channel][lane] = factor;
+}
+
+/***********************************************************
+ *  BlendChannel()
+ *
+ *  This method is used for blending the gathered key pairs
+ *  of a channel, four tracks at a time.  Rotations take the
+ *  shorter way round and are normalized after the blend,
+ *  which stays close to a spherical blend for keys that are
+ *  not far apart.
+ ***********************************************************/
+void AnimationSystem::BlendChannel(int channel)
+{
+	const LANES& from = m_from[channel];
+	const LANES& to = m_to[channel];
+	LANES& results = m_results[channel];
+	const float* pFactors = m_factors[channel].data();
+	bool bRotation = (channel == CHANNEL_ROTATION);
+
+#ifdef ANIMATION_SIMD
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 minLength = _mm_set1_ps(g_MinRotationLength);
+	for (size_t i = 0; i < m_laneCount; i += 4)
+	{
+		__m128 factor = _mm_loadu_ps(pFactors + i);
+		__m128 start[4];
+		__m128 end[4];
+		for (int c = 0; c < 4; c++)
+		{
+			start[c] = _mm_loadu_ps(from.components[c].data() + i);
+			end[c] = _mm_loadu_ps(to.components[c].data() + i);
+		}
+		if (bRotation)
+		{
+			__m128 dot = _mm_mul_ps(start[0], end[0]);
+			for (int c = 1; c < 4; c++)
+			{
+				dot = _mm_add_ps(dot, _mm_mul_ps(start[c], end[c]));
+			}
+			__m128 flip = _mm_and_ps(_mm_cmplt_ps(dot, zero), signMask);
+			for (int c = 0; c < 4; c++)
+			{
+				end[c] = _mm_xor_ps(end[c], flip);
+			}
+		}
+
+		__m128 blended[4];
+		for (int c = 0; c < 4; c++)
+		{
+			blended[c] = _mm_add_ps(start[c], _mm_mul_ps(_mm_sub_ps(end[c], start[c]), factor));
+		}
+		if (bRotation)
+		{
+			__m128 lengthSquared = _mm_mul_ps(blended[0], blended[0]);
+			for (int c = 1; c < 4; c++)
+			{
+				lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(blended[c], blended[c]));
+			}
+			__m128 scale = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(lengthSquared, minLength)));
+			for (int c = 0; c < 4; c++)
+			{
+				blended[c] = _mm_mul_ps(blended[c], scale);
+			}
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			_mm_storeu_ps(results.components[c].data() + i, blended[c]);
+		}
+	}
+#else
+	for (size_t i = 0; i < m_laneCount; i++)
+	{
+		float sign = 1.0f;
+		if (bRotation)
+		{
+			float dot = 0.0f;
+			for (int c = 0; c < 4; c++)
+			{
+				dot += from.components[c][i] * to.components[c][i];
+			}
+			sign = (dot < 0.0f) ? -1.0f : 1.0f;
+		}
+
+		float lengthSquared = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			float start = from.components[c][i];
+			float end = to.components[c][i] * sign;
+			results.components[c][i] = start + ((end - start) * pFactors[i]);
+			lengthSquared += results.components[c][i] * results.components[c][i];
+		}
+		if (bRotation)
+		{
+			float scale = 1.0f / std::sqrt(std::max(lengthSquared, g_MinRotationLength));
+			for (int c = 0; c < 4; c++)
+			{
+				results.components[c][i] *= scale;
+			}
+		}
+	}
+#endif
+}
+
+/***********************************************************
+ *  FindChangedTracks()
+ *
+ *  This method is used for listing the tracks whose values
+ *  moved since they were last reported.  The values are
+ *  compared with the last reported ones rather than the
+ *  last frame's, so a slow track that moves less than the
+ *  threshold every frame is still reported once it added
+ *  up to more.
+ ***********************************************************/
+void AnimationSystem::FindChangedTracks()
+{
+	m_changedTracks.clear();
+	size_t trackCount = m_tracks.size();
+
+#ifdef ANIMATION_SIMD
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 epsilon = _mm_set1_ps(g_ChangeEpsilon);
+	for (size_t i = 0; i < m_laneCount; i += 4)
+	{
+		__m128 largest = _mm_setzero_ps();
+		for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				__m128 difference = _mm_sub_ps(_mm_loadu_ps(m_results[channel].components[c].data() + i),
+					_mm_loadu_ps(m_previous[channel].components[c].data() + i));
+				largest = _mm_max_ps(largest, _mm_andnot_ps(signMask, difference));
+			}
+		}
+		int changedLanes = m_bAllChanged ? 0xF : _mm_movemask_ps(_mm_cmpgt_ps(largest, epsilon));
+		for (int lane = 0; (lane < 4) && (changedLanes != 0); lane++)
+		{
+			if (((changedLanes & (1 << lane)) != 0) && (i + lane < trackCount))
+			{
+				m_changedTracks.push_back((int)(i + lane));
+			}
+		}
+	}
+#else
+	for (size_t i = 0; i < trackCount; i++)
+	{
+		float largest = 0.0f;
+		for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				largest = std::max(largest,
+					std::fabs(m_results[channel].components[c][i] - m_previous[channel].components[c][i]));
+			}
+		}
+		if ((m_bAllChanged) || (largest > g_ChangeEpsilon))
+		{
+			m_changedTracks.push_back((int)i);
+		}
+	}
+#endif
+
+	for (size_t i = 0; i < m_changedTracks.size(); i++)
+	{
+		size_t track = (size_t)m_changedTracks[i];
+		for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				m_previous[channel].components[c][track] = m_results[channel].components[c][track];
+			}
+		}
+	}
+	m_bAllChanged = false;
+}
+
+/***********************************************************
+ *  GetModelMatrix()
+ *
+ *  This method is used for building the model matrix of a
+ *  track from its blended values - scaled, then turned,
+ *  then moved, like the model matrices of the scene.
+ ***********************************************************/
+glm::mat4 AnimationSystem::GetModelMatrix(int track) const
+{
+	size_t i = (size_t)track;
+	const LANES& positions = m_results[CHANNEL_POSITION];
+	const LANES& rotations = m_results[CHANNEL_ROTATION];
+	const LANES& scales = m_results[CHANNEL_SCALE];
+
+	glm::vec3 position(positions.components[0][i], positions.components[1][i], positions.components[2][i]);
+	glm::quat rotation(rotations.components[3][i], rotations.components[0][i],
+		rotations.components[1][i], rotations.components[2][i]);
+	glm::vec3 scale(scales.components[0][i], scales.components[1][i], scales.components[2][i]);
+
+	return(glm::translate(position) * glm::mat4_cast(rotation) * glm::scale(scale));
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing how many tracks were
+ *  sampled and changed, and how often the key pair of the
+ *  last update could be used again.
+ ***********************************************************/
+void AnimationSystem::PrintStats() const
+{
+	std::cout << "Animation: " << m_tracks.size() << " tracks over " << m_updates << " frames, "
+		<< m_changedTotal << " of " << m_sampledTracks << " samples changed, "
+		<< m_cachedLookups << " cached and " << m_searchedLookups << " searched key lookups"
+		<< (IsSimdEnabled() ? " (SSE)" : "") << std::endl;
+}
+
+/***********************************************************
+ *  RunBenchmark()
+ *
+ *  This method is used for timing the sampling of many
+ *  tracks.  Every track turns and moves through its own
+ *  keys, with a different length so the tracks loop at
+ *  different times, and a quarter of them only have a
+ *  single key and hold still.
+ ***********************************************************/
+bool AnimationSystem::RunBenchmark(int trackCount, int frameCount)
+{
+	if ((trackCount <= 0) || (frameCount <= 0))
+	{
+		std::cout << "The animation benchmark needs at least one track and frame" << std::endl;
+		return(false);
+	}
+
+	AnimationSystem animation;
+	for (int i = 0; i < trackCount; i++)
+	{
+		int track = animation.AddTrack(i, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+		int keyCount = ((i % 4) == 3) ? 1 : g_BenchmarkKeys;
+		float keySpacing = 0.25f + (0.05f * (float)(i % 7));
+		for (int k = 0; k < keyCount; k++)
+		{
+			float time = keySpacing * (float)k;
+			float angle = glm::radians(45.0f * (float)k);
+			animation.AddPositionKey(track, time, glm::vec3((float)k, (float)(i % 11), (float)(k * k) * 0.1f));
+			animation.AddRotationKey(track, time, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+			animation.AddScaleKey(track, time, glm::vec3(1.0f + (0.1f * (float)k)));
+		}
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		animation.Update(g_BenchmarkFrameSeconds);
+	}
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "Animation benchmark - " << trackCount << " tracks, " << frameCount << " frames" << std::endl;
+	std::cout << "  " << (milliseconds / (double)frameCount) << " ms per frame, "
+		<< (milliseconds * 1000000.0 / ((double)frameCount * (double)trackCount)) << " ns per track" << std::endl;
+	animation.PrintStats();
+	return(true);
+}
@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// animationsystem.h
+// ============
+// move scene objects along keyframed position, rotation and scale tracks
+//
+//	Every track has keys for the position, rotation and scale of one
+//	target and loops over the time of its last key.  Each frame the key
+//	pair around the track time is found from the pair used the frame
+//	before, with a binary search only when the time jumped further, and
+//	the values of the pairs are copied into one array per component.
+//	The blends then run over four tracks at a time with SIMD math, and
+//	only the tracks whose transform changed are reported, so the callers
+//	rebuild and upload nothing for the objects that hold still.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  AnimationSystem
+ *
+ *  This class contains the animation tracks and the code
+ *  for sampling them every frame.
+ ***********************************************************/
+class AnimationSystem
+{
+public:
+	// values a track can animate
+	enum CHANNEL
+	{
+		CHANNEL_POSITION = 0,
+		CHANNEL_ROTATION,
+		CHANNEL_SCALE,
+		CHANNEL_COUNT
+	};
+
+	// constructor
+	AnimationSystem();
+
+	// check whether the tracks are blended with SIMD instructions
+	static bool IsSimdEnabled();
+	// get the rotation of a set of angles in degrees, turned in the same
+	// order as the scene model matrices - X first, then Y, then Z
+	static glm::quat RotationFromDegrees(const glm::vec3& rotationDegrees);
+
+	// add a track for the passed in target, with the transform it keeps
+	// on the channels that get no keys, and get its index
+	int AddTrack(int target, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+	// add keys to a track - the keys of a channel are kept in order of
+	// their time
+	void AddPositionKey(int track, float time, const glm::vec3& position);
+	void AddRotationKey(int track, float time, const glm::quat& rotation);
+	void AddScaleKey(int track, float time, const glm::vec3& scale);
+
+	// move the animation time on and sample every track
+	void Update(double elapsedSeconds);
+	// get the tracks whose transform changed in the last update
+	const std::vector<int>& GetChangedTracks() const { return(m_changedTracks); }
+	// get the number of tracks
+	int GetTrackCount() const { return((int)m_tracks.size()); }
+	// get the target of a track
+	int GetTarget(int track) const { return(m_tracks[track].target); }
+	// get the sampled model matrix of a track
+	glm::mat4 GetModelMatrix(int track) const;
+
+	// print how many tracks were sampled and how the keys were found
+	void PrintStats() const;
+	// time the sampling of many tracks and print the result
+	static bool RunBenchmark(int trackCount, int frameCount);
+
+private:
+	// value of a channel at a time - rotations are x, y, z and w
+	struct KEY
+	{
+		float time;
+		glm::vec4 value;
+	};
+
+	// one animated target
+	struct TRACK
+	{
+		int target;
+		std::vector<KEY> keys[CHANNEL_COUNT];
+		// value of the channels without keys
+		glm::vec4 restValues[CHANNEL_COUNT];
+		// first key of the pair used in the last update
+		int cachedKeys[CHANNEL_COUNT];
+		// time of the last key
+		float duration;
+	};
+
+	// one array per component, so four tracks are loaded at once
+	struct LANES
+	{
+		std::vector<float> components[4];
+	};
+
+	std::vector<TRACK> m_tracks;
+	// key pairs and blend factors gathered for this update, the blended
+	// values, and the values of the update before
+	LANES m_from[CHANNEL_COUNT];
+	LANES m_to[CHANNEL_COUNT];
+	std::vector<float> m_factors[CHANNEL_COUNT];
+	LANES m_results[CHANNEL_COUNT];
+	LANES m_previous[CHANNEL_COUNT];
+	// track count rounded up to a multiple of four
+	size_t m_laneCount;
+	std::vector<int> m_changedTracks;
+	// whether every track is reported as changed in the next update
+	bool m_bAllChanged;
+	double m_time;
+
+	// work done so far
+	int64_t m_updates;
+	int64_t m_sampledTracks;
+	int64_t m_changedTotal;
+	int64_t m_cachedLookups;
+	int64_t m_searchedLookups;
+
+	// add a key to a channel of a track
+	void AddKey(int track, int channel, float time, const glm::vec4& value);
+	// find the key pair of a channel for a time and gather its values
+	void SampleChannel(TRACK& track, int channel, float time, size_t lane);
+	// blend the gathered key pairs of a channel
+	void BlendChannel(int channel);
+	// compare the blended values with the last update and list the
+	// tracks that changed
+	void FindChangedTracks();
+};
@@ -0,0 +1,306 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetbenchmark.cpp
+// ============
+// measure the load times of the different asset formats
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetBenchmark.h"
+#include "AssetPack.h"
+#include "JobSystem.h"
+#include "ImageDecoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+// declaration of global variables
+namespace
+{
+	// load times of the runs for one format
+	struct RUN_TIMES
+	{
+		double best;
+		double mean;
+	};
+
+	// get the elapsed milliseconds since a time point
+	double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	// fold the time of one run into the run times
+	void AddRunTime(RUN_TIMES& times, double milliseconds, int run, int runCount)
+	{
+		times.best = (run == 0) ? milliseconds : std::min(times.best, milliseconds);
+		times.mean += milliseconds / runCount;
+	}
+
+	// image scales compared by the decoder benchmark
+	const int g_DecodeScales[] = { 1, 2, 4, 8 };
+	const int g_DecodeScaleCount = sizeof(g_DecodeScales) / sizeof(g_DecodeScales[0]);
+
+	// read a whole file into memory
+	bool ReadWholeFile(const std::string& filename, std::vector<unsigned char>& data)
+	{
+		std::ifstream file(filename, std::ios::in | std::ios::binary);
+		data.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		return(data.size() > 0);
+	}
+
+	// print one row of the results table
+	void PrintRow(const char* format, uint64_t fileBytes, uint64_t rawBytes, double cookMilliseconds, const RUN_TIMES& times)
+	{
+		char row[160];
+		snprintf(row, sizeof(row), "  %-6s %10.2f %8.3f %10.1f %10.2f %10.2f %10.1f",
+			format,
+			fileBytes / (1024.0 * 1024.0),
+			(rawBytes > 0) ? (double)fileBytes / rawBytes : 0.0,
+			cookMilliseconds,
+			times.best,
+			times.mean,
+			(times.best > 0.0) ? (rawBytes / (1024.0 * 1024.0)) / (times.best / 1000.0) : 0.0);
+		std::cout << row << std::endl;
+	}
+}
+
+/***********************************************************
+ *  RunAssetPackBenchmark()
+ *
+ *  This method is used for comparing the load time and file
+ *  size of texture packs written with each compression mode
+ *  against decoding the source image files.  Every format is
+ *  loaded in parallel on the job system, the same way the
+ *  scene loads it, into memory that stands in for the mapped
+ *  upload buffers.  The files are read back from the file
+ *  cache, so the times show the CPU cost of each format.
+ ***********************************************************/
+bool AssetBenchmark::RunAssetPackBenchmark(const std::vector<TexturePack::TEXTURE_SOURCE>& sources, int runCount)
+{
+	if ((sources.size() == 0) || (runCount <= 0))
+	{
+		return(false);
+	}
+
+	JobSystem jobSystem;
+
+	// decode the source image files, as the scene does without a pack
+	uint64_t sourceBytes = 0;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		std::error_code error;
+		sourceBytes += (uint64_t)std::filesystem::file_size(sources[i].filename, error);
+	}
+
+	std::atomic<uint64_t> rawBytes(0);
+	std::atomic<int> failures(0);
+	RUN_TIMES decodeTimes = { 0.0, 0.0 };
+	for (int run = 0; run < runCount; run++)
+	{
+		rawBytes = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			jobSystem.AddTask("benchmark decode", [&sources, &rawBytes, &failures, i]() {
+				std::vector<unsigned char> fileBytes;
+				DECODED_IMAGE image;
+				if ((ReadWholeFile(sources[i].filename, fileBytes) == false) ||
+					(ImageDecoder::DecodeImage(fileBytes.data(), fileBytes.size(), 1, image) == false))
+				{
+					failures++;
+					return;
+				}
+				rawBytes += image.pixels.size();
+			});
+		}
+		jobSystem.WaitForAll();
+		AddRunTime(decodeTimes, ElapsedMilliseconds(start), run, runCount);
+	}
+	if (failures > 0)
+	{
+		std::cout << "Could not decode the benchmark images" << std::endl;
+		return(false);
+	}
+
+	std::cout << "Asset pack benchmark - " << sources.size() << " textures, "
+		<< jobSystem.GetWorkerCount() << " worker threads, best of " << runCount << " runs" << std::endl;
+	std::cout << "  format    file MB    ratio    cook ms    best ms    mean ms  raw MB/s" << std::endl;
+	PrintRow("jpeg", sourceBytes, rawBytes, 0.0, decodeTimes);
+
+	// the uncompressed pack is loaded first and checks the others
+	std::vector<std::vector<unsigned char>> referencePixels;
+	bool bResult = true;
+	for (int compression = 0; compression < AssetPack::COMPRESSION_COUNT; compression++)
+	{
+		const char* compressionName = AssetPack::GetCompressionName(compression);
+		if (AssetPack::IsCompressionSupported(compression) == false)
+		{
+			std::cout << "  " << compressionName << " - not built in" << std::endl;
+			continue;
+		}
+
+		std::string filename = std::string("asset_pack_bench_") + compressionName + ".apak";
+		std::chrono::steady_clock::time_point cookStart = std::chrono::steady_clock::now();
+		if (TexturePack::WritePack(filename.c_str(), sources, compression, TexturePack::GetDefaultLevel(compression)) == false)
+		{
+			bResult = false;
+			continue;
+		}
+		double cookMilliseconds = ElapsedMilliseconds(cookStart);
+
+		// the upload memory is allocated once, like mapped buffers
+		// that the driver hands out
+		std::vector<std::vector<unsigned char>> pixels;
+		RUN_TIMES loadTimes = { 0.0, 0.0 };
+		uint64_t fileBytes = 0;
+		for (int run = 0; run < runCount; run++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			TexturePack pack;
+			if (pack.Open(filename.c_str()) == false)
+			{
+				failures++;
+				break;
+			}
+			if (pixels.size() == 0)
+			{
+				pixels.resize(pack.GetTextureCount());
+				for (int i = 0; i < pack.GetTextureCount(); i++)
+				{
+					pixels[i].resize(pack.GetTexture(i).pixelBytes);
+				}
+				start = std::chrono::steady_clock::now();
+			}
+			for (int i = 0; i < pack.GetTextureCount(); i++)
+			{
+				jobSystem.AddTask("benchmark decompress", [&pack, &pixels, &failures, i]() {
+					if (pack.DecompressTexture(i, pixels[i].data()) == false)
+					{
+						failures++;
+					}
+				});
+			}
+			jobSystem.WaitForAll();
+			AddRunTime(loadTimes, ElapsedMilliseconds(start), run, runCount);
+			fileBytes = pack.GetFileSize();
+		}
+
+		if (referencePixels.size() == 0)
+		{
+			referencePixels = pixels;
+		}
+		if ((failures > 0) || (pixels != referencePixels))
+		{
+			std::cout << "  " << compressionName << " - pack did not load back correctly" << std::endl;
+			failures = 0;
+			bResult = false;
+		}
+		else
+		{
+			PrintRow(compressionName, fileBytes, rawBytes, cookMilliseconds, loadTimes);
+		}
+
+		std::error_code error;
+		std::filesystem::remove(filename, error);
+	}
+
+	return(bResult);
+}
+
+/***********************************************************
+ *  RunDecoderBenchmark()
+ *
+ *  This method is used for comparing the decode times of
+ *  the built in image decoders on the source image files, at
+ *  full size and at every reduced scale.  The images are
+ *  decoded one at a time on this thread, so the times show
+ *  the decoders and not the worker threads.
+ ***********************************************************/
+bool AssetBenchmark::RunDecoderBenchmark(const std::vector<TexturePack::TEXTURE_SOURCE>& sources, int runCount)
+{
+	if ((sources.size() == 0) || (runCount <= 0))
+	{
+		return(false);
+	}
+
+	// the files are read up front, so only the decoding is timed
+	std::vector<std::vector<unsigned char>> fileBytes(sources.size());
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		if (ReadWholeFile(sources[i].filename, fileBytes[i]) == false)
+		{
+			std::cout << "Could not load image:" << sources[i].filename << std::endl;
+			return(false);
+		}
+	}
+
+	std::cout << "Image decoder benchmark - " << sources.size() << " textures, one thread, best of " << runCount << " runs" << std::endl;
+
+	bool bResult = true;
+	for (int d = 0; d < ImageDecoder::GetDecoderCount(); d++)
+	{
+		const ImageDecoder* pDecoder = ImageDecoder::GetDecoder(d);
+		std::cout << "  " << pDecoder->GetName() << std::endl;
+		std::cout << "    texture                  file KB       size      1/1 ms    1/2 ms    1/4 ms    1/8 ms" << std::endl;
+
+		double totalMilliseconds[g_DecodeScaleCount] = { 0.0 };
+		uint64_t totalPixelBytes = 0;
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			if (pDecoder->CanDecode(fileBytes[i].data(), fileBytes[i].size()) == false)
+			{
+				std::cout << "    " << sources[i].tag << " - not read by this decoder" << std::endl;
+				continue;
+			}
+
+			double bestMilliseconds[g_DecodeScaleCount] = { 0.0 };
+			int width = 0;
+			int height = 0;
+			for (int s = 0; s < g_DecodeScaleCount; s++)
+			{
+				for (int run = 0; run < runCount; run++)
+				{
+					DECODED_IMAGE image;
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					bool bDecoded = pDecoder->Decode(fileBytes[i].data(), fileBytes[i].size(), g_DecodeScales[s], image);
+					double milliseconds = ElapsedMilliseconds(start);
+					if (bDecoded == false)
+					{
+						std::cout << "    " << sources[i].tag << " - could not decode at 1/" << g_DecodeScales[s] << std::endl;
+						bResult = false;
+						break;
+					}
+					bestMilliseconds[s] = (run == 0) ? milliseconds : std::min(bestMilliseconds[s], milliseconds);
+					if (s == 0)
+					{
+						width = image.width;
+						height = image.height;
+						totalPixelBytes += (run == 0) ? image.pixels.size() : 0;
+					}
+				}
+				totalMilliseconds[s] += bestMilliseconds[s];
+			}
+
+			char row[160];
+			snprintf(row, sizeof(row), "    %-24s %7.0f %5dx%-5d %9.2f %9.2f %9.2f %9.2f",
+				sources[i].tag.c_str(), fileBytes[i].size() / 1024.0, width, height,
+				bestMilliseconds[0], bestMilliseconds[1], bestMilliseconds[2], bestMilliseconds[3]);
+			std::cout << row << std::endl;
+		}
+
+		char row[160];
+		snprintf(row, sizeof(row), "    %-24s %7s %11s %9.2f %9.2f %9.2f %9.2f   (%.1f MB/s at full size)",
+			"total", "", "",
+			totalMilliseconds[0], totalMilliseconds[1], totalMilliseconds[2], totalMilliseconds[3],
+			(totalMilliseconds[0] > 0.0) ? (totalPixelBytes / (1024.0 * 1024.0)) / (totalMilliseconds[0] / 1000.0) : 0.0);
+		std::cout << row << std::endl;
+	}
+
+	return(bResult);
+}
@@ -0,0 +1,29 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetbenchmark.h
+// ============
+// measure the load times of the different asset formats
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TexturePack.h"
+
+#include <vector>
+
+/***********************************************************
+ *  AssetBenchmark
+ *
+ *  This class contains the command line benchmarks that
+ *  compare the ways the scene assets can be loaded.  None of
+ *  them need an OpenGL context.
+ ***********************************************************/
+class AssetBenchmark
+{
+public:
+	// compare loading textures from packs with each compression
+	// mode against decoding the source image files
+	static bool RunAssetPackBenchmark(const std::vector<TexturePack::TEXTURE_SOURCE>& sources, int runCount);
+	// compare the decode times of every built in image decoder at
+	// every scale on the source image files
+	static bool RunDecoderBenchmark(const std::vector<TexturePack::TEXTURE_SOURCE>& sources, int runCount);
+};
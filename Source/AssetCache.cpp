@@ -0,0 +1,312 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetcache.cpp
+// ============
+// content addressed cache of processed assets that is shared across runs
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetCache.h"
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// chunk types of a cache entry
+	const uint32_t g_KeyChunk = ASSETPACK_FOURCC('C', 'K', 'E', 'Y');
+	const uint32_t g_DataChunk = ASSETPACK_FOURCC('D', 'A', 'T', 'A');
+
+	// file extension of finished cache entries
+	const char* g_EntryExtension = ".apak";
+
+	// cache entry on disk used while trimming
+	struct CACHE_FILE
+	{
+		std::filesystem::path path;
+		std::filesystem::file_time_type lastUsed;
+		uint64_t size;
+	};
+}
+
+/***********************************************************
+ *  AssetCache()
+ *
+ *  The constructor for the class.  The cache directory is
+ *  created if it does not exist yet.
+ ***********************************************************/
+AssetCache::AssetCache(const char* directory, uint64_t maxBytes)
+{
+	m_directory = directory;
+	m_maxBytes = maxBytes;
+	m_estimatedBytes = 0;
+	m_tempCounter = 0;
+	m_hits = 0;
+	m_misses = 0;
+	m_stores = 0;
+	m_evictions = 0;
+	m_bytesRead = 0;
+	m_bytesWritten = 0;
+
+	std::random_device random;
+	m_processTag = ((uint64_t)random() << 32) | (uint64_t)random();
+
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+	m_bEnabled = std::filesystem::is_directory(m_directory, error);
+	if (m_bEnabled == false)
+	{
+		std::cout << "Could not open asset cache directory:" << m_directory << std::endl;
+		return;
+	}
+
+	// start from the current size of the directory
+	Trim();
+}
+
+/***********************************************************
+ *  HashBytes()
+ *
+ *  This method is used for hashing bytes with 64-bit FNV-1a.
+ *  Passing a previous hash in continues hashing from it.
+ ***********************************************************/
+uint64_t AssetCache::HashBytes(const void* pData, size_t size, uint64_t hash)
+{
+	const unsigned char* pBytes = (const unsigned char*)pData;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= pBytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return(hash);
+}
+
+/***********************************************************
+ *  MakeKey()
+ *
+ *  This method is used for building the cache key of an
+ *  asset.  The key starts with the kind of asset so that the
+ *  cache directory is easy to read.
+ ***********************************************************/
+std::string AssetCache::MakeKey(const char* kind, const void* pSource, size_t sourceSize, const std::string& parameters)
+{
+	uint64_t hash = HashBytes(kind, strlen(kind));
+	hash = HashBytes(pSource, sourceSize, hash);
+	hash = HashBytes(parameters.data(), parameters.size(), hash);
+	// mix in the size so that sources sharing a prefix do not collide
+	hash = HashBytes(&sourceSize, sizeof(sourceSize), hash);
+
+	std::stringstream key;
+	key << kind << "_" << std::hex;
+	key.width(16);
+	key.fill('0');
+	key << hash;
+	return(key.str());
+}
+
+/***********************************************************
+ *  GetEntryPath()
+ *
+ *  This method is used for getting the path of the file
+ *  that holds the entry for a key.
+ ***********************************************************/
+std::string AssetCache::GetEntryPath(const std::string& key) const
+{
+	return(m_directory + "/" + key + g_EntryExtension);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading the payload stored for a
+ *  key.  A hit marks the entry as recently used.
+ ***********************************************************/
+bool AssetCache::Load(const std::string& key, std::vector<unsigned char>& data)
+{
+	if (m_bEnabled == false)
+	{
+		m_misses++;
+		return(false);
+	}
+
+	std::string path = GetEntryPath(key);
+	bool bLoaded = false;
+	{
+		AssetPackReader reader;
+		if (reader.Open(path.c_str()))
+		{
+			// the stored key guards against hash file name collisions
+			std::vector<unsigned char> storedKey;
+			int keyChunk = reader.FindChunk(g_KeyChunk);
+			int dataChunk = reader.FindChunk(g_DataChunk);
+			bLoaded = (keyChunk >= 0) && (dataChunk >= 0) &&
+				(reader.ReadChunk(keyChunk, storedKey)) &&
+				(std::string(storedKey.begin(), storedKey.end()) == key) &&
+				(reader.ReadChunk(dataChunk, data));
+		}
+	}
+
+	if (bLoaded == false)
+	{
+		m_misses++;
+		return(false);
+	}
+
+	// the modification time is used as the last use time for trimming
+	std::error_code error;
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+	m_hits++;
+	m_bytesRead += data.size();
+	return(true);
+}
+
+/***********************************************************
+ *  Store()
+ *
+ *  This method is used for storing a payload for a key.  The
+ *  entry is written to a temporary file and renamed into
+ *  place, so that other threads and processes never read a
+ *  partly written entry.  When another process stores the
+ *  same key first, its entry is kept - both hold the same
+ *  content.
+ ***********************************************************/
+bool AssetCache::Store(const std::string& key, const std::vector<unsigned char>& data)
+{
+	if (m_bEnabled == false)
+	{
+		return(false);
+	}
+
+	std::stringstream tempName;
+	tempName << m_directory << "/" << key << "." << std::hex << m_processTag << "."
+		<< std::hash<std::thread::id>()(std::this_thread::get_id()) << "." << m_tempCounter++ << ".tmp";
+	std::string tempPath = tempName.str();
+
+	AssetPackWriter writer;
+	writer.AddChunk(g_KeyChunk, key.data(), key.size());
+	writer.AddChunk(g_DataChunk, data.data(), data.size(), AssetPack::COMPRESSION_LZ4);
+	if (writer.WriteToFile(tempPath.c_str()) == false)
+	{
+		std::error_code error;
+		std::filesystem::remove(tempPath, error);
+		return(false);
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, GetEntryPath(key), error);
+	if (error)
+	{
+		// the entry is in use by another process - it has the same content
+		std::filesystem::remove(tempPath, error);
+		return(false);
+	}
+
+	m_stores++;
+	m_bytesWritten += data.size();
+	m_estimatedBytes += data.size();
+	if (m_estimatedBytes > m_maxBytes)
+	{
+		Trim();
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Trim()
+ *
+ *  This method is used for removing the least recently used
+ *  entries until the cache directory fits its size limit.
+ *  Entries that another process is still reading may fail
+ *  to be removed, and are left for a later trim.
+ ***********************************************************/
+void AssetCache::Trim()
+{
+	if (m_bEnabled == false)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_trimMutex);
+
+	std::vector<CACHE_FILE> files;
+	uint64_t totalBytes = 0;
+	std::error_code error;
+	for (std::filesystem::directory_iterator it(m_directory, error), end; (!error) && (it != end); it.increment(error))
+	{
+		if ((it->is_regular_file(error) == false) || (it->path().extension() != g_EntryExtension))
+		{
+			continue;
+		}
+
+		CACHE_FILE file;
+		file.path = it->path();
+		file.lastUsed = it->last_write_time(error);
+		file.size = it->file_size(error);
+		if (error)
+		{
+			error.clear();
+			continue;
+		}
+		totalBytes += file.size;
+		files.push_back(file);
+	}
+
+	if (totalBytes > m_maxBytes)
+	{
+		std::sort(files.begin(), files.end(), [](const CACHE_FILE& a, const CACHE_FILE& b) {
+			return(a.lastUsed < b.lastUsed);
+		});
+
+		for (size_t i = 0; (i < files.size()) && (totalBytes > m_maxBytes); i++)
+		{
+			if (std::filesystem::remove(files[i].path, error))
+			{
+				totalBytes -= files[i].size;
+				m_evictions++;
+			}
+		}
+	}
+
+	m_estimatedBytes = totalBytes;
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the hit and miss counts
+ *  of the cache.
+ ***********************************************************/
+AssetCache::CACHE_STATS AssetCache::GetStats() const
+{
+	CACHE_STATS stats;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.stores = m_stores;
+	stats.evictions = m_evictions;
+	stats.bytesRead = m_bytesRead;
+	stats.bytesWritten = m_bytesWritten;
+	return(stats);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the hit and miss counts
+ *  of the cache.
+ ***********************************************************/
+void AssetCache::PrintStats() const
+{
+	CACHE_STATS stats = GetStats();
+	std::cout << "Asset cache " << m_directory << ": " << stats.hits << " hits, " << stats.misses << " misses, "
+		<< stats.stores << " stores, " << stats.evictions << " evictions, "
+		<< (stats.bytesRead / 1024) << " KB read, " << (stats.bytesWritten / 1024) << " KB written, "
+		<< (m_estimatedBytes / 1024) << " KB of " << (m_maxBytes / 1024) << " KB used" << std::endl;
+}
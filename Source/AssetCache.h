@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetcache.h
+// ============
+// content addressed cache of processed assets that is shared across runs
+//
+//	Every entry is named by a hash of the source bytes and the parameters
+//	used to process them, so a changed source or a changed setting simply
+//	produces a new key.  Entries are written to a temporary file and then
+//	renamed into place, which lets several processes share one cache
+//	directory - a reader only ever sees complete entries.  The directory is
+//	trimmed back to its size limit by removing the least recently used
+//	entries first.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  AssetCache
+ *
+ *  This class stores and loads processed asset payloads by
+ *  key.  All of the methods are safe to call from any thread.
+ ***********************************************************/
+class AssetCache
+{
+public:
+	// hit and miss counts for the cache
+	struct CACHE_STATS
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t stores;
+		uint64_t evictions;
+		uint64_t bytesRead;
+		uint64_t bytesWritten;
+	};
+
+	// constructor
+	AssetCache(const char* directory, uint64_t maxBytes);
+
+	// build a cache key from the kind of asset, its source bytes and
+	// the processing parameters
+	static std::string MakeKey(const char* kind, const void* pSource, size_t sourceSize, const std::string& parameters);
+	// hash bytes with 64-bit FNV-1a, continuing from a previous hash
+	static uint64_t HashBytes(const void* pData, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+	// load the payload stored for a key
+	bool Load(const std::string& key, std::vector<unsigned char>& data);
+	// store a payload for a key
+	bool Store(const std::string& key, const std::vector<unsigned char>& data);
+	// remove the least recently used entries until the cache fits its limit
+	void Trim();
+
+	// get the hit and miss counts
+	CACHE_STATS GetStats() const;
+	// print the hit and miss counts
+	void PrintStats() const;
+
+	const std::string& GetDirectory() const { return(m_directory); }
+
+private:
+	// get the file path used for a key
+	std::string GetEntryPath(const std::string& key) const;
+
+	std::string m_directory;
+	uint64_t m_maxBytes;
+	bool m_bEnabled;
+
+	// estimated size of the cache directory
+	std::atomic<uint64_t> m_estimatedBytes;
+	// counter for making temporary file names unique
+	std::atomic<uint32_t> m_tempCounter;
+	// random tag for making temporary file names unique across processes
+	uint64_t m_processTag;
+	// only one thread trims the directory at a time
+	std::mutex m_trimMutex;
+
+	std::atomic<uint64_t> m_hits;
+	std::atomic<uint64_t> m_misses;
+	std::atomic<uint64_t> m_stores;
+	std::atomic<uint64_t> m_evictions;
+	std::atomic<uint64_t> m_bytesRead;
+	std::atomic<uint64_t> m_bytesWritten;
+};
@@ -0,0 +1,470 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.cpp
+// ============
+// read and write chunked asset pack files - world cells and packed assets
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetPack.h"
+
+#include <climits>
+#include <iostream>
+
+#ifdef ASSETPACK_USE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+#ifdef ASSETPACK_USE_ZSTD
+#include <zstd.h>
+#endif
+
+/***********************************************************
+ *  IsCompressionSupported()
+ *
+ *  This method is used for checking whether the codec for a
+ *  compression mode was built in.
+ ***********************************************************/
+bool AssetPack::IsCompressionSupported(int compression)
+{
+	switch (compression)
+	{
+	case COMPRESSION_NONE:
+		return(true);
+#ifdef ASSETPACK_USE_LZ4
+	case COMPRESSION_LZ4:
+		return(true);
+#endif
+#ifdef ASSETPACK_USE_ZSTD
+	case COMPRESSION_ZSTD:
+		return(true);
+#endif
+	default:
+		return(false);
+	}
+}
+
+/***********************************************************
+ *  GetCompressionName()
+ *
+ *  This method is used for getting the display name of a
+ *  compression mode.
+ ***********************************************************/
+const char* AssetPack::GetCompressionName(int compression)
+{
+	switch (compression)
+	{
+	case COMPRESSION_NONE:
+		return("none");
+	case COMPRESSION_LZ4:
+		return("lz4");
+	case COMPRESSION_ZSTD:
+		return("zstd");
+	default:
+		return("unknown");
+	}
+}
+
+/***********************************************************
+ *  FindCompression()
+ *
+ *  This method is used for finding a compression mode by
+ *  its display name.  -1 is returned for unknown names.
+ ***********************************************************/
+int AssetPack::FindCompression(const char* name)
+{
+	for (int compression = 0; compression < COMPRESSION_COUNT; compression++)
+	{
+		if (strcmp(name, GetCompressionName(compression)) == 0)
+		{
+			return(compression);
+		}
+	}
+	return(-1);
+}
+
+/***********************************************************
+ *  CompressBytes()
+ *
+ *  This method is used for compressing bytes with one of the
+ *  compression modes.  For LZ4 a level above zero switches
+ *  to the slower high compression mode, which still
+ *  decompresses just as fast.
+ ***********************************************************/
+bool AssetPack::CompressBytes(int compression, int level, const void* pData, size_t size, std::vector<unsigned char>& compressed)
+{
+	compressed.clear();
+#if !defined(ASSETPACK_USE_LZ4) && !defined(ASSETPACK_USE_ZSTD)
+	(void)level;
+#endif
+
+	switch (compression)
+	{
+	case COMPRESSION_NONE:
+		compressed.assign((const unsigned char*)pData, (const unsigned char*)pData + size);
+		return(true);
+#ifdef ASSETPACK_USE_LZ4
+	case COMPRESSION_LZ4:
+	{
+		// the LZ4 block functions work with int sizes
+		if (size > (size_t)LZ4_MAX_INPUT_SIZE)
+		{
+			return(false);
+		}
+		compressed.resize((size_t)LZ4_compressBound((int)size));
+		int compressedSize = 0;
+		if (level > 0)
+		{
+			compressedSize = LZ4_compress_HC((const char*)pData, (char*)compressed.data(), (int)size, (int)compressed.size(), level);
+		}
+		else
+		{
+			compressedSize = LZ4_compress_default((const char*)pData, (char*)compressed.data(), (int)size, (int)compressed.size());
+		}
+		if (compressedSize <= 0)
+		{
+			compressed.clear();
+			return(false);
+		}
+		compressed.resize((size_t)compressedSize);
+		return(true);
+	}
+#endif
+#ifdef ASSETPACK_USE_ZSTD
+	case COMPRESSION_ZSTD:
+	{
+		compressed.resize(ZSTD_compressBound(size));
+		size_t compressedSize = ZSTD_compress(compressed.data(), compressed.size(), pData, size,
+			(level > 0) ? level : ZSTD_CLEVEL_DEFAULT);
+		if (ZSTD_isError(compressedSize))
+		{
+			compressed.clear();
+			return(false);
+		}
+		compressed.resize(compressedSize);
+		return(true);
+	}
+#endif
+	default:
+		return(false);
+	}
+}
+
+/***********************************************************
+ *  DecompressBytes()
+ *
+ *  This method is used for decompressing bytes into memory
+ *  that holds exactly the raw size, like a mapped upload
+ *  buffer.  It makes no OpenGL calls and keeps no state, so
+ *  chunks can be decompressed on several threads at once.
+ ***********************************************************/
+bool AssetPack::DecompressBytes(int compression, const void* pStored, size_t storedSize, void* pRaw, size_t rawSize)
+{
+	switch (compression)
+	{
+	case COMPRESSION_NONE:
+		if (storedSize != rawSize)
+		{
+			return(false);
+		}
+		if (rawSize > 0)
+		{
+			memcpy(pRaw, pStored, rawSize);
+		}
+		return(true);
+#ifdef ASSETPACK_USE_LZ4
+	case COMPRESSION_LZ4:
+	{
+		if ((storedSize > (size_t)INT_MAX) || (rawSize > (size_t)INT_MAX))
+		{
+			return(false);
+		}
+		int decompressedSize = LZ4_decompress_safe((const char*)pStored, (char*)pRaw, (int)storedSize, (int)rawSize);
+		return((decompressedSize >= 0) && ((size_t)decompressedSize == rawSize));
+	}
+#endif
+#ifdef ASSETPACK_USE_ZSTD
+	case COMPRESSION_ZSTD:
+	{
+		size_t decompressedSize = ZSTD_decompress(pRaw, rawSize, pStored, storedSize);
+		return((!ZSTD_isError(decompressedSize)) && (decompressedSize == rawSize));
+	}
+#endif
+	default:
+		return(false);
+	}
+}
+
+/***********************************************************
+ *  AddChunk()
+ *
+ *  This method is used for adding a chunk payload that will
+ *  be written out with the pack file.  The payload is
+ *  compressed right away.  When the compression mode is not
+ *  built in, the payload is too large for readers to accept
+ *  compressed, or compressing does not make it smaller, the
+ *  payload is stored as it is.
+ ***********************************************************/
+void AssetPackWriter::AddChunk(uint32_t type, const void* pData, size_t size, int compression, int level)
+{
+	PENDING_CHUNK chunk;
+	chunk.type = type;
+	chunk.flags = AssetPack::COMPRESSION_NONE;
+	chunk.rawSize = size;
+
+	if ((compression != AssetPack::COMPRESSION_NONE) &&
+		((uint64_t)size <= AssetPack::MAX_COMPRESSED_RAW_SIZE) &&
+		(AssetPack::IsCompressionSupported(compression)) &&
+		(AssetPack::CompressBytes(compression, level, pData, size, chunk.data)) &&
+		(chunk.data.size() < size))
+	{
+		chunk.flags = (uint32_t)compression;
+	}
+	else
+	{
+		chunk.data.assign((const unsigned char*)pData, (const unsigned char*)pData + size);
+	}
+
+	m_chunks.push_back(chunk);
+}
+
+/***********************************************************
+ *  WriteToFile()
+ *
+ *  This method is used for writing the header, the chunk
+ *  table, and all of the chunk payloads into a pack file.
+ ***********************************************************/
+bool AssetPackWriter::WriteToFile(const char* filename) const
+{
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not create asset pack:" << filename << std::endl;
+		return(false);
+	}
+
+	// packs without compressed chunks stay readable by version 1 readers
+	uint32_t version = 1;
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		if (m_chunks[i].flags != AssetPack::COMPRESSION_NONE)
+		{
+			version = AssetPack::PACK_VERSION;
+		}
+	}
+
+	AssetPack::PACK_HEADER header;
+	header.magic = AssetPack::PACK_MAGIC;
+	header.version = version;
+	header.chunkCount = (uint32_t)m_chunks.size();
+	header.reserved = 0;
+
+	// the payloads start right after the chunk table
+	uint64_t offset = sizeof(header) + (m_chunks.size() * sizeof(AssetPack::CHUNK_ENTRY));
+
+	std::vector<AssetPack::CHUNK_ENTRY> entries(m_chunks.size());
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		entries[i].type = m_chunks[i].type;
+		entries[i].flags = m_chunks[i].flags;
+		entries[i].offset = offset;
+		entries[i].storedSize = m_chunks[i].data.size();
+		entries[i].rawSize = m_chunks[i].rawSize;
+		offset += m_chunks[i].data.size();
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	if (entries.size() > 0)
+	{
+		file.write((const char*)entries.data(), entries.size() * sizeof(AssetPack::CHUNK_ENTRY));
+	}
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		if (m_chunks[i].data.size() > 0)
+		{
+			file.write((const char*)m_chunks[i].data.data(), m_chunks[i].data.size());
+		}
+	}
+
+	if (!file)
+	{
+		std::cout << "Failed writing asset pack:" << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for opening a pack file and reading
+ *  its header and chunk table into memory.
+ ***********************************************************/
+bool AssetPackReader::Open(const char* filename)
+{
+	Close();
+
+	m_file.open(filename, std::ios::binary);
+	if (!m_file)
+	{
+		return(false);
+	}
+
+	m_file.seekg(0, std::ios::end);
+	m_fileSize = (uint64_t)m_file.tellg();
+	m_file.seekg(0, std::ios::beg);
+
+	AssetPack::PACK_HEADER header;
+	m_file.read((char*)&header, sizeof(header));
+	if ((!m_file) ||
+		(header.magic != AssetPack::PACK_MAGIC) ||
+		(header.version > AssetPack::PACK_VERSION))
+	{
+		std::cout << "Not a valid asset pack:" << filename << std::endl;
+		Close();
+		return(false);
+	}
+
+	// the chunk table has to fit in the file, so a corrupt count does
+	// not turn into a huge allocation
+	if ((uint64_t)header.chunkCount * sizeof(AssetPack::CHUNK_ENTRY) > m_fileSize - sizeof(header))
+	{
+		std::cout << "Truncated asset pack chunk table:" << filename << std::endl;
+		Close();
+		return(false);
+	}
+
+	m_entries.resize(header.chunkCount);
+	if (header.chunkCount > 0)
+	{
+		m_file.read((char*)m_entries.data(), header.chunkCount * sizeof(AssetPack::CHUNK_ENTRY));
+	}
+	if (!m_file)
+	{
+		std::cout << "Truncated asset pack chunk table:" << filename << std::endl;
+		Close();
+		return(false);
+	}
+
+	// reject chunks that point outside of the file, and compressed
+	// chunks that would decompress into more memory than allowed
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		if ((m_entries[i].offset > m_fileSize) ||
+			(m_entries[i].storedSize > m_fileSize - m_entries[i].offset) ||
+			((GetChunkCompression((int)i) != AssetPack::COMPRESSION_NONE) &&
+			(m_entries[i].rawSize > AssetPack::MAX_COMPRESSED_RAW_SIZE)))
+		{
+			std::cout << "Corrupt chunk entry in asset pack:" << filename << std::endl;
+			Close();
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for closing the pack file.
+ ***********************************************************/
+void AssetPackReader::Close()
+{
+	if (m_file.is_open())
+	{
+		m_file.close();
+	}
+	m_file.clear();
+	m_entries.clear();
+	m_fileSize = 0;
+}
+
+/***********************************************************
+ *  FindChunk()
+ *
+ *  This method is used for finding the index of the next
+ *  chunk with the passed in type, or -1 if there is none.
+ ***********************************************************/
+int AssetPackReader::FindChunk(uint32_t type, int startIndex) const
+{
+	for (int i = startIndex; i < (int)m_entries.size(); i++)
+	{
+		if (m_entries[i].type == type)
+		{
+			return(i);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  ReadChunk()
+ *
+ *  This method is used for reading the payload of a chunk
+ *  from the pack file into memory, and decompressing it if
+ *  it is stored compressed.
+ ***********************************************************/
+bool AssetPackReader::ReadChunk(int index, std::vector<unsigned char>& data)
+{
+	if ((index < 0) || (index >= (int)m_entries.size()))
+	{
+		return(false);
+	}
+
+	int compression = GetChunkCompression(index);
+	if (compression == AssetPack::COMPRESSION_NONE)
+	{
+		return(ReadStoredChunk(index, data));
+	}
+
+	// a raw size over the limit is refused before anything is allocated
+	if (m_entries[index].rawSize > AssetPack::MAX_COMPRESSED_RAW_SIZE)
+	{
+		std::cout << "Compressed chunk " << index << " is too large to read" << std::endl;
+		return(false);
+	}
+
+	std::vector<unsigned char> stored;
+	if (ReadStoredChunk(index, stored) == false)
+	{
+		return(false);
+	}
+
+	data.resize((size_t)m_entries[index].rawSize);
+	if (AssetPack::DecompressBytes(compression, stored.data(), stored.size(), data.data(), data.size()) == false)
+	{
+		std::cout << "Could not decompress " << AssetPack::GetCompressionName(compression) << " chunk " << index << std::endl;
+		data.clear();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadStoredChunk()
+ *
+ *  This method is used for reading the payload of a chunk
+ *  from the pack file into memory as it is stored, without
+ *  decompressing it.
+ ***********************************************************/
+bool AssetPackReader::ReadStoredChunk(int index, std::vector<unsigned char>& data)
+{
+	if ((index < 0) || (index >= (int)m_entries.size()))
+	{
+		return(false);
+	}
+
+	const AssetPack::CHUNK_ENTRY& entry = m_entries[index];
+	data.resize((size_t)entry.storedSize);
+	if (entry.storedSize == 0)
+	{
+		return(true);
+	}
+
+	m_file.seekg((std::streamoff)entry.offset, std::ios::beg);
+	m_file.read((char*)data.data(), (std::streamsize)entry.storedSize);
+
+	return((bool)m_file);
+}
@@ -0,0 +1,234 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.h
+// ============
+// read and write chunked asset pack files - world cells and packed assets
+//
+//	A pack file is a small header, a table of chunk entries, and then the
+//	chunk payloads.  Every chunk is tagged with a four character type code
+//	so that readers can skip the chunks they do not understand.  All values
+//	are stored little-endian.
+//
+//	Chunk payloads can be compressed one by one with LZ4, for fast loading,
+//	or Zstd, for smaller files.  The codecs are optional libraries - define
+//	ASSETPACK_USE_LZ4 and/or ASSETPACK_USE_ZSTD and link liblz4 / libzstd to
+//	enable them.  Without them chunks are written uncompressed, and packs
+//	with compressed chunks cannot be read.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// build a four character code used for tagging pack chunks
+#define ASSETPACK_FOURCC(a, b, c, d) \
+	((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+/***********************************************************
+ *  AssetPack
+ *
+ *  This class holds the shared definitions for the chunked
+ *  asset pack file format.
+ ***********************************************************/
+class AssetPack
+{
+public:
+	// file identification values - version 2 adds compressed chunks
+	static const uint32_t PACK_MAGIC = ASSETPACK_FOURCC('A', 'P', 'A', 'K');
+	static const uint32_t PACK_VERSION = 2;
+
+	// compression of a chunk payload, kept in the low bits of the flags
+	enum CHUNK_COMPRESSION
+	{
+		COMPRESSION_NONE = 0,
+		COMPRESSION_LZ4 = 1,
+		COMPRESSION_ZSTD = 2,
+		COMPRESSION_COUNT
+	};
+	static const uint32_t COMPRESSION_MASK = 0xFF;
+	// largest raw size of a compressed chunk - readers reject larger
+	// sizes instead of allocating them, so larger payloads are stored
+	// as they are
+	static const uint64_t MAX_COMPRESSED_RAW_SIZE = 512ull * 1024 * 1024;
+
+	// header at the start of every pack file
+	struct PACK_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t chunkCount;
+		uint32_t reserved;
+	};
+
+	// table entry describing one chunk payload
+	struct CHUNK_ENTRY
+	{
+		uint32_t type;
+		uint32_t flags;
+		uint64_t offset;
+		uint64_t storedSize;
+		uint64_t rawSize;
+	};
+
+	// check whether a compression mode was built in
+	static bool IsCompressionSupported(int compression);
+	// get the display name of a compression mode
+	static const char* GetCompressionName(int compression);
+	// find a compression mode by its display name, or -1
+	static int FindCompression(const char* name);
+	// compress bytes - level zero uses the default level of the codec
+	static bool CompressBytes(int compression, int level, const void* pData, size_t size, std::vector<unsigned char>& compressed);
+	// decompress bytes into memory that holds exactly the raw size
+	static bool DecompressBytes(int compression, const void* pStored, size_t storedSize, void* pRaw, size_t rawSize);
+};
+
+/***********************************************************
+ *  AssetPackWriter
+ *
+ *  This class collects chunk payloads in memory and writes
+ *  them out as a single pack file.
+ ***********************************************************/
+class AssetPackWriter
+{
+public:
+	// add a chunk with the passed in type and payload - the payload is
+	// stored uncompressed when compressing does not make it smaller
+	void AddChunk(uint32_t type, const void* pData, size_t size,
+		int compression = AssetPack::COMPRESSION_NONE, int level = 0);
+	// write all the added chunks into the pack file
+	bool WriteToFile(const char* filename) const;
+
+private:
+	struct PENDING_CHUNK
+	{
+		uint32_t type;
+		uint32_t flags;
+		uint64_t rawSize;
+		std::vector<unsigned char> data;
+	};
+	std::vector<PENDING_CHUNK> m_chunks;
+};
+
+/***********************************************************
+ *  AssetPackReader
+ *
+ *  This class opens a pack file, reads the chunk table, and
+ *  reads individual chunk payloads on request.  A reader is
+ *  meant to be used from one thread at a time.
+ ***********************************************************/
+class AssetPackReader
+{
+public:
+	// open the pack file and read the chunk table
+	bool Open(const char* filename);
+	// close the pack file
+	void Close();
+
+	// get the number of chunks in the pack
+	int GetChunkCount() const { return((int)m_entries.size()); }
+	// get the table entry for a chunk
+	const AssetPack::CHUNK_ENTRY& GetChunk(int index) const { return(m_entries[index]); }
+	// find the next chunk of the passed in type
+	int FindChunk(uint32_t type, int startIndex = 0) const;
+	// read the payload of a chunk into memory, decompressing it
+	bool ReadChunk(int index, std::vector<unsigned char>& data);
+	// read the payload of a chunk as it is stored in the file
+	bool ReadStoredChunk(int index, std::vector<unsigned char>& data);
+	// get the compression mode of a chunk
+	int GetChunkCompression(int index) const { return((int)(m_entries[index].flags & AssetPack::COMPRESSION_MASK)); }
+	// get the total size of the pack file in bytes
+	uint64_t GetFileSize() const { return(m_fileSize); }
+
+private:
+	std::ifstream m_file;
+	std::vector<AssetPack::CHUNK_ENTRY> m_entries;
+	uint64_t m_fileSize = 0;
+};
+
+/***********************************************************
+ *  ChunkWriter
+ *
+ *  This class is used for serializing values into a chunk
+ *  payload buffer.
+ ***********************************************************/
+class ChunkWriter
+{
+public:
+	// append a plain value to the payload
+	template<typename T>
+	void Write(const T& value)
+	{
+		WriteBytes(&value, sizeof(T));
+	}
+	// append a length prefixed string to the payload
+	void WriteString(const std::string& value)
+	{
+		Write((uint32_t)value.size());
+		WriteBytes(value.data(), value.size());
+	}
+	// append raw bytes to the payload
+	void WriteBytes(const void* pData, size_t size)
+	{
+		const unsigned char* pBytes = (const unsigned char*)pData;
+		m_data.insert(m_data.end(), pBytes, pBytes + size);
+	}
+
+	const std::vector<unsigned char>& GetData() const { return(m_data); }
+
+private:
+	std::vector<unsigned char> m_data;
+};
+
+/***********************************************************
+ *  ChunkReader
+ *
+ *  This class is used for reading values back out of a
+ *  chunk payload buffer.  Every read is bounds checked and
+ *  returns false when the payload is too short.
+ ***********************************************************/
+class ChunkReader
+{
+public:
+	ChunkReader(const unsigned char* pData, size_t size)
+		: m_pData(pData), m_size(size), m_position(0) {}
+
+	// read a plain value from the payload
+	template<typename T>
+	bool Read(T& value)
+	{
+		return(ReadBytes(&value, sizeof(T)));
+	}
+	// read a length prefixed string from the payload
+	bool ReadString(std::string& value)
+	{
+		uint32_t length = 0;
+		if ((Read(length) == false) || (length > GetRemaining()))
+		{
+			return(false);
+		}
+		value.assign((const char*)m_pData + m_position, length);
+		m_position += length;
+		return(true);
+	}
+	// read raw bytes from the payload
+	bool ReadBytes(void* pData, size_t size)
+	{
+		if (size > GetRemaining())
+		{
+			return(false);
+		}
+		memcpy(pData, m_pData + m_position, size);
+		m_position += size;
+		return(true);
+	}
+
+	size_t GetRemaining() const { return(m_size - m_position); }
+
+private:
+	const unsigned char* m_pData;
+	size_t m_size;
+	size_t m_position;
+};
@@ -0,0 +1,202 @@
+///////////////////////////////////////////////////////////////////////////////
+// bindlesstextures.cpp
+// ============
+// sample the scene textures through resident bindless handles
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BindlessTextures.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// storage block of the handle table in the fragment shader
+	const char* g_TableBlockName = "MaterialTextures";
+	const GLuint g_TableBinding = 0;
+}
+
+/***********************************************************
+ *  BindlessTextures()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BindlessTextures::BindlessTextures(GpuResourceManager* pResources)
+{
+	m_pResources = pResources;
+	m_buffer = GPU_HANDLE();
+	m_bDirty = false;
+	m_boundProgram = 0;
+}
+
+/***********************************************************
+ *  ~BindlessTextures()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BindlessTextures::~BindlessTextures()
+{
+	ReleaseAll();
+	m_pResources->Release(m_buffer);
+	m_pResources = NULL;
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the driver has
+ *  the extensions for bindless textures and for the shader
+ *  storage buffer that holds the handles.
+ ***********************************************************/
+bool BindlessTextures::IsSupported()
+{
+	return((GLEW_ARB_bindless_texture) && (GLEW_ARB_shader_storage_buffer_object));
+}
+
+/***********************************************************
+ *  GetShaderDefine()
+ *
+ *  This method is used for getting the define that selects
+ *  the bindless texture path in the scene shaders.
+ ***********************************************************/
+const char* BindlessTextures::GetShaderDefine()
+{
+	return("#define USE_BINDLESS_TEXTURES");
+}
+
+/***********************************************************
+ *  SetTexture()
+ *
+ *  This method is used for setting the texture and sampler
+ *  pair of a table slot.  The handle of the pair is made
+ *  resident, and the handle it replaces is made non-resident
+ *  unless another slot still uses it.  A handle fixes the
+ *  state of its texture and sampler, which is fine since the
+ *  scene textures and samplers never change once created.
+ ***********************************************************/
+void BindlessTextures::SetTexture(int slot, GLuint textureID, GLuint sampler)
+{
+	if (slot < 0)
+	{
+		return;
+	}
+	if (slot >= (int)m_entries.size())
+	{
+		TABLE_ENTRY empty = { 0, 0, 0 };
+		m_entries.resize(slot + 1, empty);
+	}
+
+	TABLE_ENTRY& entry = m_entries[slot];
+	if ((entry.textureID == textureID) && (entry.sampler == sampler))
+	{
+		return;
+	}
+
+	GLuint64 handle = 0;
+	if (textureID != 0)
+	{
+		handle = glGetTextureSamplerHandleARB(textureID, sampler);
+		if ((handle != 0) && (glIsTextureHandleResidentARB(handle) == GL_FALSE))
+		{
+			glMakeTextureHandleResidentARB(handle);
+		}
+	}
+	if ((entry.handle != 0) && (entry.handle != handle) && (IsHandleShared(slot, entry.handle) == false))
+	{
+		glMakeTextureHandleNonResidentARB(entry.handle);
+	}
+
+	entry.textureID = textureID;
+	entry.sampler = sampler;
+	entry.handle = handle;
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for uploading the handle table when
+ *  it changed, and binding it to the storage block of the
+ *  passed in program.  A changed table goes into a new
+ *  buffer, and the old one is released once the frames
+ *  using it are done.
+ ***********************************************************/
+void BindlessTextures::Bind(GLuint programID)
+{
+	if (m_pResources->IsValid(m_buffer) == false)
+	{
+		m_bDirty = true;
+	}
+
+	if (m_bDirty)
+	{
+		std::vector<GLuint64> handles(m_entries.size() > 0 ? m_entries.size() : 1, 0);
+		for (size_t i = 0; i < m_entries.size(); i++)
+		{
+			handles[i] = m_entries[i].handle;
+		}
+		size_t bytes = handles.size() * sizeof(GLuint64);
+		m_pResources->Release(m_buffer);
+		m_buffer = m_pResources->CreateBuffer("bindless texture table");
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_pResources->GetName(m_buffer));
+		glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, handles.data(), GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		m_pResources->SetBytes(m_buffer, bytes);
+		m_bDirty = false;
+	}
+
+	if ((programID != 0) && (programID != m_boundProgram))
+	{
+		GLuint blockIndex = glGetProgramResourceIndex(programID, GL_SHADER_STORAGE_BLOCK, g_TableBlockName);
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glShaderStorageBlockBinding(programID, blockIndex, g_TableBinding);
+		}
+		else
+		{
+			std::cout << "Shader has no bindless texture table:" << g_TableBlockName << std::endl;
+		}
+		m_boundProgram = programID;
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_TableBinding, m_pResources->GetName(m_buffer));
+}
+
+/***********************************************************
+ *  ReleaseAll()
+ *
+ *  This method is used for making every handle in the table
+ *  non-resident and clearing the table.  It has to be called
+ *  before the textures are deleted.
+ ***********************************************************/
+void BindlessTextures::ReleaseAll()
+{
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		if ((m_entries[i].handle != 0) && (IsHandleShared((int)i, m_entries[i].handle) == false))
+		{
+			glMakeTextureHandleNonResidentARB(m_entries[i].handle);
+		}
+		m_entries[i].handle = 0;
+	}
+	m_entries.clear();
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  IsHandleShared()
+ *
+ *  This method is used for checking whether a slot other
+ *  than the passed in one still uses a handle.
+ ***********************************************************/
+bool BindlessTextures::IsHandleShared(int slot, GLuint64 handle) const
+{
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		if (((int)i != slot) && (m_entries[i].handle == handle))
+		{
+			return(true);
+		}
+	}
+	return(false);
+}
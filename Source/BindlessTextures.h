@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// bindlesstextures.h
+// ============
+// sample the scene textures through resident bindless handles
+//
+//	With ARB_bindless_texture every texture and sampler pair gets a 64-bit
+//	handle that is made resident once.  The handles of the texture slots
+//	are kept in a shader storage buffer, so a draw selects its texture with
+//	an index instead of a texture bind.  Drivers without the extension use
+//	the texture slots as before.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+#include "GpuResourceManager.h"
+
+/***********************************************************
+ *  BindlessTextures
+ *
+ *  This class owns the table of resident texture handles and
+ *  the shader storage buffer that holds it.
+ ***********************************************************/
+class BindlessTextures
+{
+public:
+	// constructor
+	BindlessTextures(GpuResourceManager* pResources);
+	// destructor - makes the handles non-resident
+	~BindlessTextures();
+
+	// check whether the driver supports bindless textures
+	static bool IsSupported();
+	// get the shader define that selects the bindless texture path
+	static const char* GetShaderDefine();
+
+	// set the texture and sampler pair sampled through a table slot
+	void SetTexture(int slot, GLuint textureID, GLuint sampler);
+	// upload the changed table and bind it for the passed in program
+	void Bind(GLuint programID);
+	// make every handle non-resident and clear the table
+	void ReleaseAll();
+
+private:
+	// handle and the pair it was made from for every table slot
+	struct TABLE_ENTRY
+	{
+		GLuint textureID;
+		GLuint sampler;
+		GLuint64 handle;
+	};
+	std::vector<TABLE_ENTRY> m_entries;
+
+	// resource manager that owns the table buffer
+	GpuResourceManager* m_pResources;
+	// shader storage buffer with the handles
+	GPU_HANDLE m_buffer;
+	// whether the table changed since the last upload
+	bool m_bDirty;
+	// program whose storage block was last bound
+	GLuint m_boundProgram;
+
+	// check whether another slot still uses a handle
+	bool IsHandleShared(int slot, GLuint64 handle) const;
+};
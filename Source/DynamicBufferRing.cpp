@@ -0,0 +1,250 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicbufferring.cpp
+// ============
+// stream per-frame data through a persistently mapped, triple-buffered ring
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DynamicBufferRing.h"
+#include "TraceLog.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// longest single wait for a fence before waiting again
+	const GLuint64 g_FenceTimeoutNanoseconds = 100000000;
+}
+
+/***********************************************************
+ *  DynamicBufferRing()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DynamicBufferRing::DynamicBufferRing(GpuResourceManager* pResources)
+{
+	m_pResources = pResources;
+	m_buffer = GPU_HANDLE();
+	m_pMapped = NULL;
+	m_sectionBytes = 0;
+	m_alignment = 1;
+	for (int i = 0; i < SECTION_COUNT; i++)
+	{
+		m_fences[i] = 0;
+	}
+	m_section = 0;
+	m_position = 0;
+	m_bInFrame = false;
+	m_frameBytes = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  ~DynamicBufferRing()
+ *
+ *  The destructor for the class.  The buffer is released to
+ *  the resource manager, which keeps it until the GPU has
+ *  finished with it.
+ ***********************************************************/
+DynamicBufferRing::~DynamicBufferRing()
+{
+	for (int i = 0; i < SECTION_COUNT; i++)
+	{
+		if (m_fences[i] != 0)
+		{
+			glDeleteSync(m_fences[i]);
+			m_fences[i] = 0;
+		}
+	}
+	if (NULL != m_pMapped)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_pResources->GetName(m_buffer));
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		m_pMapped = NULL;
+	}
+	m_pResources->Release(m_buffer);
+	m_pResources = NULL;
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the ring buffer with
+ *  room for three sections.  With ARB_buffer_storage the
+ *  storage is immutable and mapped once for the lifetime of
+ *  the buffer, with coherent writes so that no flushing is
+ *  needed before drawing.
+ ***********************************************************/
+bool DynamicBufferRing::Create(size_t sectionBytes, size_t alignment, const char* label)
+{
+	if ((sectionBytes == 0) || (alignment == 0) || (m_pResources->IsValid(m_buffer)))
+	{
+		return(false);
+	}
+
+	m_alignment = alignment;
+	m_sectionBytes = ((sectionBytes + alignment - 1) / alignment) * alignment;
+	GLsizeiptr totalBytes = (GLsizeiptr)(m_sectionBytes * SECTION_COUNT);
+
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if (GLEW_ARB_buffer_storage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, totalBytes, NULL, flags);
+		m_pMapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalBytes, flags);
+		if (NULL == m_pMapped)
+		{
+			std::cout << "Could not map " << label << " persistently" << std::endl;
+		}
+	}
+	else
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, totalBytes, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	// the storage may be immutable, so the buffer is adopted rather
+	// than taken from the pool
+	m_buffer = m_pResources->AdoptObject(GpuResourceManager::RESOURCE_BUFFER, buffer, (size_t)totalBytes, label);
+	m_section = 0;
+	m_position = 0;
+	return(true);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for moving on to the next section and
+ *  waiting until the GPU has finished the frame that last
+ *  used it.  With three sections this only waits when the
+ *  GPU is more than two frames behind.
+ ***********************************************************/
+void DynamicBufferRing::BeginFrame()
+{
+	if (m_bInFrame)
+	{
+		EndFrame();
+	}
+
+	m_section = (m_section + 1) % SECTION_COUNT;
+	m_position = 0;
+	WaitForSection();
+	m_bInFrame = true;
+	m_frameBytes = 0;
+	m_stats.frames++;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for placing a fence after the draws
+ *  that read the current section.
+ ***********************************************************/
+void DynamicBufferRing::EndFrame()
+{
+	if (m_fences[m_section] != 0)
+	{
+		glDeleteSync(m_fences[m_section]);
+	}
+	m_fences[m_section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_bInFrame = false;
+	if (m_frameBytes > m_stats.peakFrameBytes)
+	{
+		m_stats.peakFrameBytes = m_frameBytes;
+	}
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used for copying data into the current
+ *  section.  When the section is full, it is fenced and the
+ *  next section is used, so frames with more data than one
+ *  section, like impostor baking, still work at the cost of
+ *  a possible wait.
+ ***********************************************************/
+GLintptr DynamicBufferRing::Write(const void* pData, size_t size)
+{
+	if ((size > m_sectionBytes) || (m_pResources->IsValid(m_buffer) == false))
+	{
+		return(-1);
+	}
+
+	if (m_position + size > m_sectionBytes)
+	{
+		m_stats.overflows++;
+		size_t frameBytes = m_frameBytes;
+		EndFrame();
+		m_section = (m_section + 1) % SECTION_COUNT;
+		m_position = 0;
+		WaitForSection();
+		m_bInFrame = true;
+		m_frameBytes = frameBytes;
+	}
+
+	GLintptr offset = (GLintptr)(m_section * m_sectionBytes + m_position);
+	if (NULL != m_pMapped)
+	{
+		memcpy(m_pMapped + offset, pData, size);
+	}
+	else
+	{
+		// the fences keep queued draws away from this range, though
+		// the driver may still synchronize on the whole buffer
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_pResources->GetName(m_buffer));
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, pData);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	m_position += ((size + m_alignment - 1) / m_alignment) * m_alignment;
+	m_frameBytes += size;
+	return(offset);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing how often, and for how
+ *  long, the CPU had to wait for the GPU.
+ ***********************************************************/
+void DynamicBufferRing::PrintStats(const char* name) const
+{
+	std::cout << "Dynamic " << name << " ring (" << (IsPersistent() ? "persistent" : "buffer sub data") << "): "
+		<< m_stats.frames << " frames, " << m_stats.stalls << " stalls, "
+		<< (m_stats.stallMicroseconds / 1000) << " ms waiting, " << m_stats.overflows << " overflows, "
+		<< (m_stats.peakFrameBytes / 1024) << " KB peak of " << (m_sectionBytes / 1024) << " KB per frame" << std::endl;
+}
+
+/***********************************************************
+ *  WaitForSection()
+ *
+ *  This method is used for waiting on the fence of the
+ *  current section.  Waiting is counted as a stall.
+ ***********************************************************/
+void DynamicBufferRing::WaitForSection()
+{
+	GLsync fence = m_fences[m_section];
+	if (fence == 0)
+	{
+		return;
+	}
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if ((result == GL_TIMEOUT_EXPIRED) || (result == GL_WAIT_FAILED))
+	{
+		int64_t start = TraceLog::GetMicroseconds();
+		m_stats.stalls++;
+		do
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeoutNanoseconds);
+		} while (result == GL_TIMEOUT_EXPIRED);
+		m_stats.stallMicroseconds += TraceLog::GetMicroseconds() - start;
+	}
+
+	glDeleteSync(fence);
+	m_fences[m_section] = 0;
+}
@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicbufferring.h
+// ============
+// stream per-frame data through a persistently mapped, triple-buffered ring
+//
+//	The buffer is split into three sections, one per frame in flight.  The
+//	CPU writes a frame into one section while the GPU still reads the two
+//	before it, and a fence after each frame tells when its section can be
+//	written again.  With ARB_buffer_storage the buffer stays mapped, so a
+//	write is a plain memory copy; without it the data is uploaded with
+//	glBufferSubData into the section the fences show to be free.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+#include "GpuResourceManager.h"
+
+/***********************************************************
+ *  DynamicBufferRing
+ *
+ *  This class hands out ranges of a ring buffer for data
+ *  that is written once and drawn in the same frame.
+ ***********************************************************/
+class DynamicBufferRing
+{
+public:
+	// counters of how often the CPU had to wait for the GPU
+	struct RING_STATS
+	{
+		int64_t frames;
+		int64_t stalls;
+		int64_t stallMicroseconds;
+		// sections that filled up before the frame ended
+		int64_t overflows;
+		size_t peakFrameBytes;
+	};
+
+	// constructor
+	DynamicBufferRing(GpuResourceManager* pResources);
+	// destructor
+	~DynamicBufferRing();
+
+	// create the buffer with the passed in bytes per section - every
+	// write starts at a multiple of the alignment
+	bool Create(size_t sectionBytes, size_t alignment, const char* label);
+	// wait until the next section is free and start writing into it
+	void BeginFrame();
+	// place the fence that tells when the section is free again
+	void EndFrame();
+
+	// copy data into the current section and return its offset in the
+	// buffer, or -1 if the data is larger than a section
+	GLintptr Write(const void* pData, size_t size);
+
+	// get the OpenGL buffer to bind the written ranges from
+	GLuint GetBuffer() const { return(m_pResources->GetName(m_buffer)); }
+	// check whether the buffer is persistently mapped
+	bool IsPersistent() const { return(NULL != m_pMapped); }
+	// get the stall counters
+	const RING_STATS& GetStats() const { return(m_stats); }
+	// print the stall counters
+	void PrintStats(const char* name) const;
+
+private:
+	// number of frames the CPU may run ahead of the GPU
+	static const int SECTION_COUNT = 3;
+
+	GpuResourceManager* m_pResources;
+	GPU_HANDLE m_buffer;
+	// start of the persistent mapping, or NULL when not mapped
+	unsigned char* m_pMapped;
+	size_t m_sectionBytes;
+	size_t m_alignment;
+	// fence after the last frame written into each section
+	GLsync m_fences[SECTION_COUNT];
+	// section being written, and the write position inside it
+	int m_section;
+	size_t m_position;
+	bool m_bInFrame;
+	// bytes written since the frame began
+	size_t m_frameBytes;
+	RING_STATS m_stats;
+
+	// wait for the fence of the current section
+	void WaitForSection();
+};
@@ -0,0 +1,360 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.cpp
+// ============
+// cull the scene objects and pick their level of detail in a compute shader
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCulling.h"
+#include "ProgramBuilder.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// storage buffer bindings of the compute shader, above the ones
+	// used by the scene shader
+	const GLuint g_ObjectBinding = 2;
+	const GLuint g_GroupBinding = 3;
+	const GLuint g_CommandBinding = 4;
+	const GLuint g_ImpostorBinding = 5;
+	const GLuint g_CounterBinding = 0;
+	// objects culled by one compute work group
+	const uint32_t g_WorkGroupSize = 64;
+	// floats per impostor billboard instance (center, radius, layer)
+	const int g_ImpostorInstanceFloats = 5;
+
+	// indirect command read by glMultiDrawElementsIndirect
+	struct DRAW_ELEMENTS_COMMAND
+	{
+		uint32_t count;
+		uint32_t instanceCount;
+		uint32_t firstIndex;
+		int32_t baseVertex;
+		uint32_t baseInstance;
+	};
+
+	// the counter buffer starts with the number of object draws,
+	// followed by an indirect command for the impostor billboards
+	// whose instance count is the second counter
+	const uint32_t g_CounterReset[5] = { 0, 4, 0, 0, 0 };
+	const GLintptr g_ImpostorCommandOffset = sizeof(uint32_t);
+}
+
+/***********************************************************
+ *  GpuCulling()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCulling::GpuCulling(GpuResourceManager* pResources)
+{
+	m_pResources = pResources;
+	m_programHandle = GPU_HANDLE();
+	m_program = 0;
+	m_frustumPlanesLocation = -1;
+	m_cameraPositionLocation = -1;
+	m_impostorDistanceLocation = -1;
+	m_useImpostorsLocation = -1;
+	m_compactDrawsLocation = -1;
+	m_objectCountLocation = -1;
+	m_objectBuffer = GPU_HANDLE();
+	m_groupBuffer = GPU_HANDLE();
+	m_drawDataBuffer = GPU_HANDLE();
+	m_commandBuffer = GPU_HANDLE();
+	m_impostorBuffer = GPU_HANDLE();
+	m_counterBuffer = GPU_HANDLE();
+	m_objectCount = 0;
+	m_groupCount = 0;
+	m_drawDataBytes = 0;
+	m_bCompactDraws = GLEW_ARB_indirect_parameters ? true : false;
+}
+
+/***********************************************************
+ *  ~GpuCulling()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCulling::~GpuCulling()
+{
+	m_pResources->Release(m_programHandle);
+	m_program = 0;
+	m_pResources->Release(m_objectBuffer);
+	m_pResources->Release(m_groupBuffer);
+	m_pResources->Release(m_drawDataBuffer);
+	m_pResources->Release(m_commandBuffer);
+	m_pResources->Release(m_impostorBuffer);
+	m_pResources->Release(m_counterBuffer);
+	m_pResources = NULL;
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the driver has
+ *  compute shaders, storage buffers, atomic counters and
+ *  multi-draw indirect with a base instance per command.
+ ***********************************************************/
+bool GpuCulling::IsSupported()
+{
+	return((GLEW_ARB_compute_shader) && (GLEW_ARB_shader_storage_buffer_object) &&
+		(GLEW_ARB_shader_atomic_counters) && (GLEW_ARB_multi_draw_indirect) &&
+		(GLEW_ARB_base_instance));
+}
+
+/***********************************************************
+ *  GetShaderDefine()
+ *
+ *  This method is used for getting the define that builds
+ *  the scene shader with its per-draw values read from a
+ *  storage buffer at the draw index.
+ ***********************************************************/
+const char* GpuCulling::GetShaderDefine()
+{
+	return("#define USE_GPU_DRAWS");
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for building the culling compute
+ *  program and the counter buffer.
+ ***********************************************************/
+bool GpuCulling::Create(const char* computeFile)
+{
+	m_programHandle = ProgramBuilder::BuildComputeProgram(m_pResources, computeFile, "");
+	m_program = m_pResources->GetName(m_programHandle);
+	if (m_program == 0)
+	{
+		return(false);
+	}
+
+	m_frustumPlanesLocation = glGetUniformLocation(m_program, "frustumPlanes");
+	m_cameraPositionLocation = glGetUniformLocation(m_program, "cameraPosition");
+	m_impostorDistanceLocation = glGetUniformLocation(m_program, "impostorDistanceFactor");
+	m_useImpostorsLocation = glGetUniformLocation(m_program, "bUseImpostors");
+	m_compactDrawsLocation = glGetUniformLocation(m_program, "bCompactDraws");
+	m_objectCountLocation = glGetUniformLocation(m_program, "objectCount");
+
+	UploadBuffer(m_counterBuffer, g_CounterReset, sizeof(g_CounterReset), GL_DYNAMIC_DRAW, "culling counters");
+	return(true);
+}
+
+/***********************************************************
+ *  SetObjects()
+ *
+ *  This method is used for uploading the object and group
+ *  records and the per-draw values of every object, and for
+ *  making room for the commands and billboards the compute
+ *  shader writes.  The per-draw values of an object are
+ *  found at its index, which its command passes on as the
+ *  base instance.
+ ***********************************************************/
+void GpuCulling::SetObjects(
+	const std::vector<CULL_OBJECT>& objects,
+	const std::vector<CULL_GROUP>& groups,
+	const void* pDrawData,
+	size_t drawDataBytes)
+{
+	m_objectCount = (uint32_t)objects.size();
+	m_groupCount = (uint32_t)groups.size();
+	m_drawDataBytes = drawDataBytes;
+	if (m_objectCount == 0)
+	{
+		return;
+	}
+
+	UploadBuffer(m_objectBuffer, objects.data(), objects.size() * sizeof(CULL_OBJECT), GL_STATIC_DRAW, "culling objects");
+	UploadBuffer(m_groupBuffer, groups.data(), std::max(groups.size(), (size_t)1) * sizeof(CULL_GROUP), GL_STATIC_DRAW, "culling groups");
+	UploadBuffer(m_drawDataBuffer, pDrawData, objects.size() * drawDataBytes, GL_DYNAMIC_DRAW, "culling draw data");
+	UploadBuffer(m_commandBuffer, NULL, objects.size() * sizeof(DRAW_ELEMENTS_COMMAND), GL_DYNAMIC_COPY, "culling draw commands");
+	UploadBuffer(m_impostorBuffer, NULL, std::max(groups.size(), (size_t)1) * g_ImpostorInstanceFloats * sizeof(float),
+		GL_DYNAMIC_COPY, "culling impostor instances");
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for running the culling compute
+ *  shader for the passed in camera.  The frustum planes are
+ *  taken from the rows of the view projection matrix and
+ *  normalized, so a sphere can be tested with one dot
+ *  product per plane.
+ ***********************************************************/
+void GpuCulling::Cull(const glm::mat4& viewProjection, const glm::vec3& cameraPosition,
+	float impostorDistanceFactor, bool bUseImpostors)
+{
+	if ((m_program == 0) || (m_objectCount == 0))
+	{
+		return;
+	}
+
+	glm::mat4 rows = glm::transpose(viewProjection);
+	glm::vec4 planes[6] =
+	{
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2]
+	};
+	for (int i = 0; i < 6; i++)
+	{
+		planes[i] = planes[i] * (1.0f / glm::length(glm::vec3(planes[i])));
+	}
+
+	// the counters start over every frame
+	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_pResources->GetName(m_counterBuffer));
+	glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(g_CounterReset), g_CounterReset);
+	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+	glUseProgram(m_program);
+	glUniform4fv(m_frustumPlanesLocation, 6, glm::value_ptr(planes[0]));
+	glUniform3fv(m_cameraPositionLocation, 1, glm::value_ptr(cameraPosition));
+	glUniform1f(m_impostorDistanceLocation, impostorDistanceFactor);
+	glUniform1i(m_useImpostorsLocation, bUseImpostors ? 1 : 0);
+	glUniform1i(m_compactDrawsLocation, m_bCompactDraws ? 1 : 0);
+	glUniform1ui(m_objectCountLocation, m_objectCount);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_ObjectBinding, m_pResources->GetName(m_objectBuffer));
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_GroupBinding, m_pResources->GetName(m_groupBuffer));
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CommandBinding, m_pResources->GetName(m_commandBuffer));
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_ImpostorBinding, m_pResources->GetName(m_impostorBuffer));
+	glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, g_CounterBinding, m_pResources->GetName(m_counterBuffer));
+
+	glDispatchCompute((m_objectCount + g_WorkGroupSize - 1) / g_WorkGroupSize, 1, 1);
+
+	// the draws read the results as commands and vertex attributes
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+	glUseProgram(0);
+}
+
+/***********************************************************
+ *  UpdateDrawData()
+ *
+ *  This method is used for uploading new per-draw values for
+ *  every object, in the same order as the objects.
+ ***********************************************************/
+void GpuCulling::UpdateDrawData(const void* pDrawData)
+{
+	if ((m_objectCount == 0) || (NULL == pDrawData))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_pResources->GetName(m_drawDataBuffer));
+	glBufferSubData(GL_COPY_WRITE_BUFFER, 0, m_objectCount * m_drawDataBytes, pDrawData);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UpdateObjectSphere()
+ *
+ *  This method is used for uploading the bounding sphere of
+ *  one object in place, so an animated object is culled
+ *  where it is now without uploading every record again.
+ ***********************************************************/
+void GpuCulling::UpdateObjectSphere(uint32_t index, const glm::vec4& sphere)
+{
+	if (index >= m_objectCount)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_pResources->GetName(m_objectBuffer));
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)((index * sizeof(CULL_OBJECT)) + offsetof(CULL_OBJECT, sphere)),
+		sizeof(glm::vec4), glm::value_ptr(sphere));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UpdateGroupSphere()
+ *
+ *  This method is used for uploading the bounding sphere of
+ *  one group in place.
+ ***********************************************************/
+void GpuCulling::UpdateGroupSphere(uint32_t index, const glm::vec4& sphere)
+{
+	if (index >= m_groupCount)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_pResources->GetName(m_groupBuffer));
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)((index * sizeof(CULL_GROUP)) + offsetof(CULL_GROUP, sphere)),
+		sizeof(glm::vec4), glm::value_ptr(sphere));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  DrawObjects()
+ *
+ *  This method is used for drawing every object that passed
+ *  the culling with the currently active scene shader.  The
+ *  per-draw values can come from a range of another buffer,
+ *  such as values streamed in for this frame.
+ ***********************************************************/
+void GpuCulling::DrawObjects(const MeshLibrary* pMeshLibrary, GLuint drawDataBinding,
+	GLuint drawDataBuffer, GLintptr drawDataOffset) const
+{
+	if ((NULL == pMeshLibrary) || (m_objectCount == 0))
+	{
+		return;
+	}
+
+	if (drawDataBuffer != 0)
+	{
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, drawDataBinding, drawDataBuffer,
+			drawDataOffset, (GLsizeiptr)(m_objectCount * m_drawDataBytes));
+	}
+	else
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, drawDataBinding, m_pResources->GetName(m_drawDataBuffer));
+	}
+	pMeshLibrary->DrawIndirect(m_pResources->GetName(m_commandBuffer),
+		m_bCompactDraws ? m_pResources->GetName(m_counterBuffer) : 0, (GLsizei)m_objectCount);
+}
+
+/***********************************************************
+ *  DrawImpostors()
+ *
+ *  This method is used for drawing the impostor billboards
+ *  of the groups that passed the culling.  The number of
+ *  instances is taken from the counter the compute shader
+ *  added them with.
+ ***********************************************************/
+void GpuCulling::DrawImpostors(GLuint vertexArray) const
+{
+	if ((m_objectCount == 0) || (m_groupCount == 0))
+	{
+		return;
+	}
+
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, m_pResources->GetName(m_impostorBuffer));
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, g_ImpostorInstanceFloats * sizeof(float), (void*)0);
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, g_ImpostorInstanceFloats * sizeof(float), (void*)(4 * sizeof(float)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_pResources->GetName(m_counterBuffer));
+	glDrawArraysIndirect(GL_TRIANGLE_STRIP, (void*)g_ImpostorCommandOffset);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  UploadBuffer()
+ *
+ *  This method is used for replacing a buffer with a new one
+ *  holding the passed in data.  The old buffer is released
+ *  once the frames using it are done.
+ ***********************************************************/
+void GpuCulling::UploadBuffer(GPU_HANDLE& buffer, const void* pData, size_t bytes, GLenum usage, const char* label)
+{
+	m_pResources->Release(buffer);
+	buffer = m_pResources->CreateBuffer(label);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_pResources->GetName(buffer));
+	glBufferData(GL_COPY_WRITE_BUFFER, bytes, pData, usage);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	m_pResources->SetBytes(buffer, bytes);
+}
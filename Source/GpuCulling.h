@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.h
+// ============
+// cull the scene objects and pick their level of detail in a compute shader
+//
+//	The bounding spheres, mesh ranges and per-draw values of the objects are
+//	uploaded once into shader storage buffers.  Every frame a compute shader
+//	tests each object against the view frustum, swaps far away groups of
+//	objects for their impostor billboard, and appends the surviving draws
+//	to an indirect command buffer through atomic counters.  The objects are
+//	then drawn with one multi-draw call and the impostors with one indirect
+//	instanced call, so the CPU cost stays the same however many objects
+//	there are.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "GpuResourceManager.h"
+#include "MeshLibrary.h"
+
+/***********************************************************
+ *  GpuCulling
+ *
+ *  This class owns the compute program and the buffers for
+ *  culling the scene objects on the GPU, and draws the
+ *  objects that pass.
+ ***********************************************************/
+class GpuCulling
+{
+public:
+	// one drawn object, laid out like the std430 records of the
+	// compute shader
+	struct CULL_OBJECT
+	{
+		// world space bounding sphere (center, radius)
+		glm::vec4 sphere;
+		uint32_t nIndices;
+		uint32_t firstIndex;
+		int32_t baseVertex;
+		// group the object belongs to
+		uint32_t group;
+	};
+
+	// objects that are swapped for one impostor billboard together
+	struct CULL_GROUP
+	{
+		glm::vec4 sphere;
+		// atlas layer of the impostor, or -1 when there is none
+		int32_t impostorLayer;
+		// object that adds the billboard for the whole group
+		uint32_t firstObject;
+		uint32_t padding[2];
+	};
+
+	// constructor - the buffers are owned by the resource manager
+	GpuCulling(GpuResourceManager* pResources);
+	// destructor
+	~GpuCulling();
+
+	// check whether the driver supports compute culling and
+	// multi-draw indirect
+	static bool IsSupported();
+	// get the shader define that reads the per-draw values of the
+	// scene shader from a storage buffer
+	static const char* GetShaderDefine();
+
+	// build the culling compute program
+	bool Create(const char* computeFile);
+	// upload the objects and groups, with the per-draw values of each
+	// object at the passed in size
+	void SetObjects(
+		const std::vector<CULL_OBJECT>& objects,
+		const std::vector<CULL_GROUP>& groups,
+		const void* pDrawData,
+		size_t drawDataBytes);
+	// get the number of uploaded objects
+	uint32_t GetObjectCount() const { return(m_objectCount); }
+
+	// cull the objects for the passed in camera - groups farther than
+	// the distance factor times their radius use their impostor
+	void Cull(const glm::mat4& viewProjection, const glm::vec3& cameraPosition,
+		float impostorDistanceFactor, bool bUseImpostors);
+	// replace the per-draw values of all the objects
+	void UpdateDrawData(const void* pDrawData);
+	// replace the bounding sphere of one object or group that moved
+	void UpdateObjectSphere(uint32_t index, const glm::vec4& sphere);
+	void UpdateGroupSphere(uint32_t index, const glm::vec4& sphere);
+	// draw the objects that passed, with their per-draw values bound
+	// to the passed in storage buffer binding - from the passed in
+	// buffer range when it is set, or else from the uploaded values
+	void DrawObjects(const MeshLibrary* pMeshLibrary, GLuint drawDataBinding,
+		GLuint drawDataBuffer = 0, GLintptr drawDataOffset = 0) const;
+	// draw the impostor billboards that passed with the bound program
+	// and the passed in vertex array
+	void DrawImpostors(GLuint vertexArray) const;
+
+private:
+	// resource manager that owns the buffers
+	GpuResourceManager* m_pResources;
+	// culling compute program and its uniform locations
+	GPU_HANDLE m_programHandle;
+	GLuint m_program;
+	GLint m_frustumPlanesLocation;
+	GLint m_cameraPositionLocation;
+	GLint m_impostorDistanceLocation;
+	GLint m_useImpostorsLocation;
+	GLint m_compactDrawsLocation;
+	GLint m_objectCountLocation;
+
+	// input records and per-draw values
+	GPU_HANDLE m_objectBuffer;
+	GPU_HANDLE m_groupBuffer;
+	GPU_HANDLE m_drawDataBuffer;
+	// indirect draw commands and impostor instances written by the
+	// compute shader
+	GPU_HANDLE m_commandBuffer;
+	GPU_HANDLE m_impostorBuffer;
+	// atomic counters, which double as the draw count and the
+	// indirect impostor draw command
+	GPU_HANDLE m_counterBuffer;
+	uint32_t m_objectCount;
+	uint32_t m_groupCount;
+	// size of the per-draw values of one object
+	size_t m_drawDataBytes;
+	// whether the number of draws is read from the counter buffer -
+	// without it culled commands are kept with no instances
+	bool m_bCompactDraws;
+
+	// replace a buffer with one holding the passed in data
+	void UploadBuffer(GPU_HANDLE& buffer, const void* pData, size_t bytes, GLenum usage, const char* label);
+};
@@ -0,0 +1,534 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuresourcemanager.cpp
+// ============
+// own the OpenGL buffers, textures, vertex arrays, framebuffers and programs
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuResourceManager.h"
+#include "TextureStorage.h"
+#include "TextureBudget.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// most objects kept in the pool of one type - released objects
+	// beyond this are deleted
+	const size_t g_MaxPooledObjects = 32;
+	// display names of the object types
+	const char* g_TypeNames[GpuResourceManager::RESOURCE_TYPE_COUNT] =
+	{
+		"buffer", "texture", "vertex array", "framebuffer", "program"
+	};
+}
+
+/***********************************************************
+ *  GpuResourceManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuResourceManager::GpuResourceManager()
+{
+	for (int i = 0; i < RESOURCE_TYPE_COUNT; i++)
+	{
+		m_createdCounts[i] = 0;
+		m_recycledCounts[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~GpuResourceManager()
+ *
+ *  The destructor for the class.  Every object that is still
+ *  live is reported as a leak before all the objects are
+ *  deleted.
+ ***********************************************************/
+GpuResourceManager::~GpuResourceManager()
+{
+	PrintReport();
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].bLive)
+		{
+			std::cout << "GPU resource leak: " << GetTypeName(m_slots[i].type) << " " << m_slots[i].name
+				<< " (" << m_slots[i].label << "), " << (m_slots[i].bytes / 1024) << " KB" << std::endl;
+			DeleteObject(m_slots[i].type, m_slots[i].name);
+		}
+	}
+	m_slots.clear();
+	m_freeSlots.clear();
+
+	// nothing is drawn anymore, so the pending objects can go at once
+	for (size_t i = 0; i < m_releasedObjects.size(); i++)
+	{
+		DeleteObject(m_releasedObjects[i].type, m_releasedObjects[i].name);
+	}
+	m_releasedObjects.clear();
+	while (m_releaseBatches.size() > 0)
+	{
+		RELEASE_BATCH& batch = m_releaseBatches.front();
+		glDeleteSync(batch.fence);
+		for (size_t i = 0; i < batch.objects.size(); i++)
+		{
+			DeleteObject(batch.objects[i].type, batch.objects[i].name);
+		}
+		m_releaseBatches.pop_front();
+	}
+	for (int type = 0; type < RESOURCE_TYPE_COUNT; type++)
+	{
+		for (size_t i = 0; i < m_pools[type].size(); i++)
+		{
+			DeleteObject(type, m_pools[type][i].name);
+		}
+		m_pools[type].clear();
+	}
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used for creating a buffer object.  A
+ *  buffer taken from the pool still holds its old storage,
+ *  so the caller always has to call glBufferData on it.
+ ***********************************************************/
+GPU_HANDLE GpuResourceManager::CreateBuffer(const char* label)
+{
+	return(AddSlot(RESOURCE_BUFFER, AcquireObject(RESOURCE_BUFFER), 0, label));
+}
+
+/***********************************************************
+ *  CreateVertexArray()
+ *
+ *  This method is used for creating a vertex array object.
+ *  Vertex arrays are never pooled, since a recycled one
+ *  would keep the enabled attributes and divisors of its
+ *  last user, and they are cheap to create.
+ ***********************************************************/
+GPU_HANDLE GpuResourceManager::CreateVertexArray(const char* label)
+{
+	return(AddSlot(RESOURCE_VERTEX_ARRAY, AcquireObject(RESOURCE_VERTEX_ARRAY), 0, label));
+}
+
+/***********************************************************
+ *  CreateFramebuffer()
+ *
+ *  This method is used for creating a framebuffer object.
+ *  A framebuffer taken from the pool still holds its old
+ *  attachments, so the caller has to attach every target.
+ ***********************************************************/
+GPU_HANDLE GpuResourceManager::CreateFramebuffer(const char* label)
+{
+	return(AddSlot(RESOURCE_FRAMEBUFFER, AcquireObject(RESOURCE_FRAMEBUFFER), 0, label));
+}
+
+/***********************************************************
+ *  CreateProgram()
+ *
+ *  This method is used for creating a program object.
+ *  Programs are never pooled, like vertex arrays, but a
+ *  released program is still kept until the frames that
+ *  dispatched with it are done.
+ ***********************************************************/
+GPU_HANDLE GpuResourceManager::CreateProgram(const char* label)
+{
+	return(AddSlot(RESOURCE_PROGRAM, AcquireObject(RESOURCE_PROGRAM), 0, label));
+}
+
+/***********************************************************
+ *  CreateTexture2D()
+ *
+ *  This method is used for creating a mipmapped 2D texture
+ *  from pixels, or from the bound pixel unpack buffer.  A
+ *  pooled texture of the same size and channel count gets
+ *  the new pixels instead of allocating new storage.  An
+ *  empty handle is returned for unsupported formats.
+ ***********************************************************/
+GPU_HANDLE GpuResourceManager::CreateTexture2D(int width, int height, int colorChannels, const void* pPixels, const char* label)
+{
+	GPU_HANDLE handle = GPU_HANDLE();
+	GLuint name = 0;
+
+	if (TakeFromPool(RESOURCE_TEXTURE, width, height, colorChannels, name))
+	{
+		TextureStorage::UploadTexture2D(name, width, height, colorChannels, pPixels);
+	}
+	else
+	{
+		name = TextureStorage::CreateTexture2D(width, height, colorChannels, pPixels);
+		if (name == 0)
+		{
+			return(handle);
+		}
+		m_createdCounts[RESOURCE_TEXTURE]++;
+	}
+
+	handle = AddSlot(RESOURCE_TEXTURE, name, TextureBudget::GetTextureBytes(width, height, colorChannels, 0), label);
+	RESOURCE_SLOT& slot = m_slots[handle.index];
+	slot.width = width;
+	slot.height = height;
+	slot.colorChannels = colorChannels;
+	return(handle);
+}
+
+/***********************************************************
+ *  AdoptObject()
+ *
+ *  This method is used for taking over an object that was
+ *  created outside of the manager.  Adopted objects may have
+ *  any shape or immutable storage, so they are deleted
+ *  instead of pooled once they are released.
+ ***********************************************************/
+GPU_HANDLE GpuResourceManager::AdoptObject(int type, GLuint name, size_t bytes, const char* label)
+{
+	if ((type < 0) || (type >= RESOURCE_TYPE_COUNT) || (name == 0))
+	{
+		return(GPU_HANDLE());
+	}
+
+	m_createdCounts[type]++;
+	GPU_HANDLE handle = AddSlot(type, name, bytes, label);
+	m_slots[handle.index].bPoolable = false;
+	return(handle);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for releasing an object.  The handle
+ *  goes stale at once, but the object is kept until the GPU
+ *  has finished the current frame.  The passed in handle is
+ *  cleared, and empty or stale handles are ignored.
+ ***********************************************************/
+void GpuResourceManager::Release(GPU_HANDLE& handle)
+{
+	if (IsValid(handle) == false)
+	{
+		handle = GPU_HANDLE();
+		return;
+	}
+
+	RESOURCE_SLOT& slot = m_slots[handle.index];
+	RELEASED_OBJECT object;
+	object.type = slot.type;
+	object.name = slot.name;
+	object.bytes = slot.bytes;
+	object.bPoolable = slot.bPoolable;
+	object.width = slot.width;
+	object.height = slot.height;
+	object.colorChannels = slot.colorChannels;
+	m_releasedObjects.push_back(object);
+
+	// the next handle for this slot gets a new generation
+	slot.bLive = false;
+	slot.name = 0;
+	slot.label.clear();
+	slot.generation++;
+	if (slot.generation == 0)
+	{
+		slot.generation = 1;
+	}
+	m_freeSlots.push_back(handle.index);
+	handle = GPU_HANDLE();
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for placing a fence after the draws
+ *  of the frame that released objects, and for recycling the
+ *  objects of every earlier frame whose fence has passed.
+ *  It is called once per frame after the draws are issued.
+ ***********************************************************/
+void GpuResourceManager::Update()
+{
+	if (m_releasedObjects.size() > 0)
+	{
+		RELEASE_BATCH batch;
+		batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		batch.objects.swap(m_releasedObjects);
+		m_releaseBatches.push_back(batch);
+	}
+
+	while (m_releaseBatches.size() > 0)
+	{
+		RELEASE_BATCH& batch = m_releaseBatches.front();
+		// never wait here - the batch is checked again next frame
+		GLenum result = glClientWaitSync(batch.fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			break;
+		}
+		glDeleteSync(batch.fence);
+		for (size_t i = 0; i < batch.objects.size(); i++)
+		{
+			RecycleObject(batch.objects[i]);
+		}
+		m_releaseBatches.pop_front();
+	}
+}
+
+/***********************************************************
+ *  GetName()
+ *
+ *  This method is used for getting the OpenGL name of the
+ *  object behind a handle.  Zero is returned for empty and
+ *  stale handles.
+ ***********************************************************/
+GLuint GpuResourceManager::GetName(GPU_HANDLE handle) const
+{
+	if (IsValid(handle) == false)
+	{
+		return(0);
+	}
+	return(m_slots[handle.index].name);
+}
+
+/***********************************************************
+ *  IsValid()
+ *
+ *  This method is used for checking whether a handle still
+ *  refers to the live object it was created for.
+ ***********************************************************/
+bool GpuResourceManager::IsValid(GPU_HANDLE handle) const
+{
+	return((handle.generation != 0) &&
+		(handle.index < m_slots.size()) &&
+		(m_slots[handle.index].bLive) &&
+		(m_slots[handle.index].generation == handle.generation));
+}
+
+/***********************************************************
+ *  SetBytes()
+ *
+ *  This method is used for setting the GPU memory that is
+ *  used by an object, after its storage has been specified.
+ ***********************************************************/
+void GpuResourceManager::SetBytes(GPU_HANDLE handle, size_t bytes)
+{
+	if (IsValid(handle))
+	{
+		m_slots[handle.index].bytes = bytes;
+	}
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the number and memory of
+ *  the live, pending and pooled objects of every type, along
+ *  with how many objects were created and recycled.
+ ***********************************************************/
+void GpuResourceManager::PrintReport() const
+{
+	int liveCounts[RESOURCE_TYPE_COUNT] = { 0 };
+	size_t liveBytes[RESOURCE_TYPE_COUNT] = { 0 };
+	int pendingCounts[RESOURCE_TYPE_COUNT] = { 0 };
+	size_t pooledBytes[RESOURCE_TYPE_COUNT] = { 0 };
+
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].bLive)
+		{
+			liveCounts[m_slots[i].type]++;
+			liveBytes[m_slots[i].type] += m_slots[i].bytes;
+		}
+	}
+	for (size_t i = 0; i < m_releasedObjects.size(); i++)
+	{
+		pendingCounts[m_releasedObjects[i].type]++;
+	}
+	for (size_t b = 0; b < m_releaseBatches.size(); b++)
+	{
+		for (size_t i = 0; i < m_releaseBatches[b].objects.size(); i++)
+		{
+			pendingCounts[m_releaseBatches[b].objects[i].type]++;
+		}
+	}
+
+	for (int type = 0; type < RESOURCE_TYPE_COUNT; type++)
+	{
+		for (size_t i = 0; i < m_pools[type].size(); i++)
+		{
+			pooledBytes[type] += m_pools[type][i].bytes;
+		}
+		std::cout << "GPU " << GetTypeName(type) << "s: " << liveCounts[type] << " live ("
+			<< (liveBytes[type] / 1024) << " KB), " << pendingCounts[type] << " pending, "
+			<< m_pools[type].size() << " pooled (" << (pooledBytes[type] / 1024) << " KB), "
+			<< m_createdCounts[type] << " created, " << m_recycledCounts[type] << " recycled" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  GetTypeName()
+ *
+ *  This method is used for getting the display name of an
+ *  object type.
+ ***********************************************************/
+const char* GpuResourceManager::GetTypeName(int type)
+{
+	if ((type < 0) || (type >= RESOURCE_TYPE_COUNT))
+	{
+		return("unknown");
+	}
+	return(g_TypeNames[type]);
+}
+
+/***********************************************************
+ *  AddSlot()
+ *
+ *  This method is used for registering a live object and
+ *  building the handle that refers to it.
+ ***********************************************************/
+GPU_HANDLE GpuResourceManager::AddSlot(int type, GLuint name, size_t bytes, const char* label)
+{
+	uint32_t index = 0;
+	if (m_freeSlots.size() > 0)
+	{
+		index = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		RESOURCE_SLOT empty;
+		empty.generation = 1;
+		index = (uint32_t)m_slots.size();
+		m_slots.push_back(empty);
+	}
+
+	RESOURCE_SLOT& slot = m_slots[index];
+	slot.type = type;
+	slot.name = name;
+	slot.bytes = bytes;
+	slot.bLive = true;
+	slot.width = 0;
+	slot.height = 0;
+	slot.colorChannels = 0;
+	slot.bPoolable = (type != RESOURCE_VERTEX_ARRAY) && (type != RESOURCE_PROGRAM);
+	slot.label = (NULL != label) ? label : "";
+
+	GPU_HANDLE handle;
+	handle.index = index;
+	handle.generation = slot.generation;
+	return(handle);
+}
+
+/***********************************************************
+ *  AcquireObject()
+ *
+ *  This method is used for taking a buffer, vertex array,
+ *  framebuffer or program out of its pool, or generating a
+ *  new one when the pool is empty.
+ ***********************************************************/
+GLuint GpuResourceManager::AcquireObject(int type)
+{
+	GLuint name = 0;
+	if (TakeFromPool(type, 0, 0, 0, name) == false)
+	{
+		name = GenerateObject(type);
+		m_createdCounts[type]++;
+	}
+	return(name);
+}
+
+/***********************************************************
+ *  TakeFromPool()
+ *
+ *  This method is used for taking an object out of the pool
+ *  of a type.  Textures are only taken when their size and
+ *  channel count match.
+ ***********************************************************/
+bool GpuResourceManager::TakeFromPool(int type, int width, int height, int colorChannels, GLuint& name)
+{
+	std::vector<RELEASED_OBJECT>& pool = m_pools[type];
+	for (size_t i = pool.size(); i > 0; i--)
+	{
+		const RELEASED_OBJECT& object = pool[i - 1];
+		if ((object.width == width) && (object.height == height) && (object.colorChannels == colorChannels))
+		{
+			name = object.name;
+			pool.erase(pool.begin() + (i - 1));
+			m_recycledCounts[type]++;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  RecycleObject()
+ *
+ *  This method is used for putting an object that the GPU is
+ *  done with into its pool.  Vertex arrays, programs,
+ *  adopted objects and objects beyond the pool size are
+ *  deleted instead.
+ ***********************************************************/
+void GpuResourceManager::RecycleObject(const RELEASED_OBJECT& object)
+{
+	if ((object.bPoolable) && (m_pools[object.type].size() < g_MaxPooledObjects))
+	{
+		m_pools[object.type].push_back(object);
+	}
+	else
+	{
+		DeleteObject(object.type, object.name);
+	}
+}
+
+/***********************************************************
+ *  GenerateObject()
+ *
+ *  This method is used for generating a new OpenGL object of
+ *  the passed in type.
+ ***********************************************************/
+GLuint GpuResourceManager::GenerateObject(int type)
+{
+	GLuint name = 0;
+	switch (type)
+	{
+	case RESOURCE_BUFFER:
+		glGenBuffers(1, &name);
+		break;
+	case RESOURCE_TEXTURE:
+		glGenTextures(1, &name);
+		break;
+	case RESOURCE_VERTEX_ARRAY:
+		glGenVertexArrays(1, &name);
+		break;
+	case RESOURCE_FRAMEBUFFER:
+		glGenFramebuffers(1, &name);
+		break;
+	case RESOURCE_PROGRAM:
+		name = glCreateProgram();
+		break;
+	}
+	return(name);
+}
+
+/***********************************************************
+ *  DeleteObject()
+ *
+ *  This method is used for deleting an OpenGL object of the
+ *  passed in type.
+ ***********************************************************/
+void GpuResourceManager::DeleteObject(int type, GLuint name)
+{
+	switch (type)
+	{
+	case RESOURCE_BUFFER:
+		glDeleteBuffers(1, &name);
+		break;
+	case RESOURCE_TEXTURE:
+		glDeleteTextures(1, &name);
+		break;
+	case RESOURCE_VERTEX_ARRAY:
+		glDeleteVertexArrays(1, &name);
+		break;
+	case RESOURCE_FRAMEBUFFER:
+		glDeleteFramebuffers(1, &name);
+		break;
+	case RESOURCE_PROGRAM:
+		glDeleteProgram(name);
+		break;
+	}
+}
@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuresourcemanager.h
+// ============
+// own the OpenGL buffers, textures, vertex arrays, framebuffers and programs
+//
+//	Objects are handed out as generational handles, so that a handle kept
+//	after its object was released resolves to zero instead of to whatever
+//	object reuses the name.  Released objects are only reused or deleted
+//	once a fence shows that the GPU has finished the frames that used them,
+//	and buffers, framebuffers and textures are kept in pools for reuse
+//	instead of being deleted.  Programs are only tracked and deleted late,
+//	since a recycled program would keep its old shaders and uniforms.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// handle of an object owned by the resource manager - generation zero
+// is never used, so a zeroed handle does not refer to any object
+struct GPU_HANDLE
+{
+	uint32_t index;
+	uint32_t generation;
+};
+
+/***********************************************************
+ *  GpuResourceManager
+ *
+ *  This class contains the code for creating, tracking,
+ *  recycling and deleting OpenGL objects.
+ ***********************************************************/
+class GpuResourceManager
+{
+public:
+	// kinds of OpenGL objects that are owned by the manager
+	enum RESOURCE_TYPE
+	{
+		RESOURCE_BUFFER = 0,
+		RESOURCE_TEXTURE,
+		RESOURCE_VERTEX_ARRAY,
+		RESOURCE_FRAMEBUFFER,
+		RESOURCE_PROGRAM,
+		RESOURCE_TYPE_COUNT
+	};
+
+	// constructor
+	GpuResourceManager();
+	// destructor - reports the objects that were never released
+	~GpuResourceManager();
+
+	// create a buffer - a recycled buffer has to be given new storage
+	GPU_HANDLE CreateBuffer(const char* label);
+	// create a vertex array
+	GPU_HANDLE CreateVertexArray(const char* label);
+	// create a framebuffer - a recycled one has to be attached again
+	GPU_HANDLE CreateFramebuffer(const char* label);
+	// create an empty program for the caller to attach and link
+	GPU_HANDLE CreateProgram(const char* label);
+	// create a mipmapped 2D texture, reusing a pooled one of the same size
+	GPU_HANDLE CreateTexture2D(int width, int height, int colorChannels, const void* pPixels, const char* label);
+	// take over an object that was created elsewhere - adopted objects
+	// may have immutable storage, so they are never pooled
+	GPU_HANDLE AdoptObject(int type, GLuint name, size_t bytes, const char* label);
+
+	// release an object and clear the passed in handle
+	void Release(GPU_HANDLE& handle);
+	// fence this frame's releases and recycle the objects the GPU is done with
+	void Update();
+
+	// get the OpenGL name of an object, or zero for a stale handle
+	GLuint GetName(GPU_HANDLE handle) const;
+	// check whether a handle still refers to a live object
+	bool IsValid(GPU_HANDLE handle) const;
+	// set the GPU memory used by an object
+	void SetBytes(GPU_HANDLE handle, size_t bytes);
+
+	// print the live, pooled and pending objects of every type
+	void PrintReport() const;
+	// get the display name of an object type
+	static const char* GetTypeName(int type);
+
+private:
+	// object behind a handle
+	struct RESOURCE_SLOT
+	{
+		int type;
+		GLuint name;
+		size_t bytes;
+		uint32_t generation;
+		bool bLive;
+		// texture size, so that pooled textures are only reused for
+		// textures of the same size - zero for other objects
+		int width;
+		int height;
+		int colorChannels;
+		// whether the object can be reused once it is released
+		bool bPoolable;
+		std::string label;
+	};
+
+	// object waiting for the GPU, or waiting in a pool
+	struct RELEASED_OBJECT
+	{
+		int type;
+		GLuint name;
+		size_t bytes;
+		int width;
+		int height;
+		int colorChannels;
+		bool bPoolable;
+	};
+
+	// objects released during one frame and the fence after that frame
+	struct RELEASE_BATCH
+	{
+		GLsync fence;
+		std::vector<RELEASED_OBJECT> objects;
+	};
+
+	// objects indexed by handle
+	std::vector<RESOURCE_SLOT> m_slots;
+	// slots that can be reused
+	std::vector<uint32_t> m_freeSlots;
+	// objects released since the last update
+	std::vector<RELEASED_OBJECT> m_releasedObjects;
+	// released objects that the GPU may still be using, oldest first
+	std::deque<RELEASE_BATCH> m_releaseBatches;
+	// objects ready to be reused, for every type
+	std::vector<RELEASED_OBJECT> m_pools[RESOURCE_TYPE_COUNT];
+	// number of objects created and recycled, for every type
+	int m_createdCounts[RESOURCE_TYPE_COUNT];
+	int m_recycledCounts[RESOURCE_TYPE_COUNT];
+
+	// add a live object and return its handle
+	GPU_HANDLE AddSlot(int type, GLuint name, size_t bytes, const char* label);
+	// take an object out of its pool, or generate a new one
+	GLuint AcquireObject(int type);
+	// take an object out of a pool - the texture size has to match
+	bool TakeFromPool(int type, int width, int height, int colorChannels, GLuint& name);
+	// put an object that the GPU is done with into its pool
+	void RecycleObject(const RELEASED_OBJECT& object);
+	// generate a new object of a type
+	static GLuint GenerateObject(int type);
+	// delete an object of a type
+	static void DeleteObject(int type, GLuint name);
+};
@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// gputimer.cpp
+// ============
+// measure how long the GPU takes for a part of the frame with timer queries
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuTimer.h"
+
+/***********************************************************
+ *  GpuTimer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuTimer::GpuTimer()
+{
+	m_next = 0;
+	m_bRunning = false;
+	m_samples = 0;
+	m_totalNanoseconds = 0;
+	m_lastNanoseconds = 0;
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		m_queries[i] = 0;
+		m_bPending[i] = false;
+	}
+	if (IsSupported())
+	{
+		glGenQueries(QUERY_COUNT, m_queries);
+	}
+}
+
+/***********************************************************
+ *  ~GpuTimer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuTimer::~GpuTimer()
+{
+	if (m_queries[0] != 0)
+	{
+		glDeleteQueries(QUERY_COUNT, m_queries);
+	}
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the driver has
+ *  time elapsed queries.
+ ***********************************************************/
+bool GpuTimer::IsSupported()
+{
+	return((GLEW_VERSION_3_3 || GLEW_ARB_timer_query) ? true : false);
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for starting a measurement.  The
+ *  query being reused was issued a few frames ago, so its
+ *  result is read first, which hardly ever has to wait.
+ ***********************************************************/
+void GpuTimer::Begin()
+{
+	if ((m_queries[0] == 0) || (m_bRunning))
+	{
+		return;
+	}
+
+	if (m_bPending[m_next])
+	{
+		ReadQuery(m_next);
+	}
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+	m_bRunning = true;
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  This method is used for ending the current measurement.
+ ***********************************************************/
+void GpuTimer::End()
+{
+	if (m_bRunning == false)
+	{
+		return;
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+	m_bPending[m_next] = true;
+	m_next = (m_next + 1) % QUERY_COUNT;
+	m_bRunning = false;
+}
+
+/***********************************************************
+ *  GetAverageMilliseconds()
+ *
+ *  This method is used for getting the average GPU time of
+ *  the measurements read so far.
+ ***********************************************************/
+double GpuTimer::GetAverageMilliseconds() const
+{
+	if (m_samples == 0)
+	{
+		return(0.0);
+	}
+	return(((double)m_totalNanoseconds / (double)m_samples) / 1000000.0);
+}
+
+/***********************************************************
+ *  ReadQuery()
+ *
+ *  This method is used for reading the result of a query and
+ *  adding it to the total.
+ ***********************************************************/
+void GpuTimer::ReadQuery(int query)
+{
+	GLuint64 nanoseconds = 0;
+	glGetQueryObjectui64v(m_queries[query], GL_QUERY_RESULT, &nanoseconds);
+	m_totalNanoseconds += nanoseconds;
+	m_lastNanoseconds = nanoseconds;
+	m_samples++;
+	m_bPending[query] = false;
+}
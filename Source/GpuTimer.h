@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// gputimer.h
+// ============
+// measure how long the GPU takes for a part of the frame with timer queries
+//
+//	A time elapsed query wraps the measured commands.  The result is only
+//	read back a few frames later, when the query object comes round again,
+//	so measuring does not make the CPU wait for the GPU to catch up.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+/***********************************************************
+ *  GpuTimer
+ *
+ *  This class owns a small ring of timer queries and adds up
+ *  the GPU time they measure.
+ ***********************************************************/
+class GpuTimer
+{
+public:
+	// constructor
+	GpuTimer();
+	// destructor
+	~GpuTimer();
+
+	// check whether the driver supports timer queries
+	static bool IsSupported();
+
+	// start measuring the commands that follow
+	void Begin();
+	// stop measuring
+	void End();
+
+	// get the number of measurements read back so far
+	int64_t GetSamples() const { return(m_samples); }
+	// get the average time of the measurements read back so far
+	double GetAverageMilliseconds() const;
+	// get the time of the latest measurement read back
+	double GetLastMilliseconds() const { return((double)m_lastNanoseconds / 1000000.0); }
+
+private:
+	// measurements in flight before the oldest result is read
+	static const int QUERY_COUNT = 4;
+
+	GLuint m_queries[QUERY_COUNT];
+	// whether each query holds a measurement that was not read yet
+	bool m_bPending[QUERY_COUNT];
+	// query used by the next measurement
+	int m_next;
+	bool m_bRunning;
+	int64_t m_samples;
+	uint64_t m_totalNanoseconds;
+	uint64_t m_lastNanoseconds;
+
+	// add the result of a query to the total
+	void ReadQuery(int query);
+};
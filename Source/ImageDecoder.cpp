@@ -0,0 +1,290 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagedecoder.cpp
+// ============
+// decode texture image files with the fastest available decoder
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageDecoder.h"
+
+#include "stb_image.h"
+
+#ifdef IMAGEDECODER_USE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+#include <climits>
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  StbImageDecoder
+	 *
+	 *  This class decodes images with stb_image.  It decodes at
+	 *  full size and reduces the pixels afterwards.
+	 ***********************************************************/
+	class StbImageDecoder : public ImageDecoder
+	{
+	public:
+		const char* GetName() const { return("stb_image"); }
+
+		bool CanDecode(const unsigned char* pData, size_t size) const
+		{
+			int width = 0;
+			int height = 0;
+			int colorChannels = 0;
+			return((size <= (size_t)INT_MAX) &&
+				(stbi_info_from_memory(pData, (int)size, &width, &height, &colorChannels) != 0));
+		}
+
+		bool Decode(const unsigned char* pData, size_t size, int scaleDenominator, DECODED_IMAGE& image) const
+		{
+			if (size > (size_t)INT_MAX)
+			{
+				return(false);
+			}
+
+			// the flip setting of this thread only, since decoders run
+			// on several worker threads
+			stbi_set_flip_vertically_on_load_thread(1);
+			unsigned char* pPixels = stbi_load_from_memory(pData, (int)size,
+				&image.width, &image.height, &image.colorChannels, 0);
+			if (NULL == pPixels)
+			{
+				return(false);
+			}
+
+			image.pixels.assign(pPixels, pPixels + ((size_t)image.width * image.height * image.colorChannels));
+			stbi_image_free(pPixels);
+
+			DownscaleImage(image, scaleDenominator);
+			return(true);
+		}
+	};
+
+#ifdef IMAGEDECODER_USE_TURBOJPEG
+	/***********************************************************
+	 *  TurboJpegDecoder
+	 *
+	 *  This class decodes JPEG images with libjpeg-turbo.  The
+	 *  size is reduced in the DCT domain, so smaller images are
+	 *  also faster to decode.
+	 ***********************************************************/
+	class TurboJpegDecoder : public ImageDecoder
+	{
+	public:
+		const char* GetName() const { return("libjpeg-turbo"); }
+
+		bool CanDecode(const unsigned char* pData, size_t size) const
+		{
+			// every JPEG file starts with the start of image marker
+			return((size > 3) && (pData[0] == 0xFF) && (pData[1] == 0xD8) && (pData[2] == 0xFF));
+		}
+
+		bool Decode(const unsigned char* pData, size_t size, int scaleDenominator, DECODED_IMAGE& image) const
+		{
+			// decompressor handles are not shared between threads
+			tjhandle handle = tjInitDecompress();
+			if (NULL == handle)
+			{
+				return(false);
+			}
+
+			int width = 0;
+			int height = 0;
+			int subsampling = 0;
+			int colorspace = 0;
+			bool bResult = (tjDecompressHeader3(handle, pData, (unsigned long)size, &width, &height, &subsampling, &colorspace) == 0);
+
+			// use the scaling factor of 1/scaleDenominator when there is one
+			tjscalingfactor scalingFactor = { 1, 1 };
+			int factorCount = 0;
+			tjscalingfactor* pFactors = tjGetScalingFactors(&factorCount);
+			for (int i = 0; (NULL != pFactors) && (i < factorCount); i++)
+			{
+				if ((pFactors[i].num == 1) && (pFactors[i].denom == scaleDenominator))
+				{
+					scalingFactor = pFactors[i];
+				}
+			}
+
+			if (bResult)
+			{
+				image.width = TJSCALED(width, scalingFactor);
+				image.height = TJSCALED(height, scalingFactor);
+				image.colorChannels = 3;
+				image.pixels.resize((size_t)image.width * image.height * image.colorChannels);
+
+				// decode the bottom row first to match the OpenGL texture origin
+				bResult = (tjDecompress2(handle, pData, (unsigned long)size, image.pixels.data(),
+					image.width, 0, image.height, TJPF_RGB, TJFLAG_BOTTOMUP) == 0);
+			}
+			tjDestroy(handle);
+
+			if (bResult == false)
+			{
+				image.pixels.clear();
+				return(false);
+			}
+
+			// reduce the rest of the way when no scaling factor matched
+			if (scalingFactor.denom != scaleDenominator)
+			{
+				DownscaleImage(image, scaleDenominator);
+			}
+			return(true);
+		}
+	};
+
+	TurboJpegDecoder g_TurboJpegDecoder;
+#endif
+
+	StbImageDecoder g_StbImageDecoder;
+
+	// built in decoders in order of preference - stb_image is last,
+	// since it reads every format
+	const ImageDecoder* const g_Decoders[] =
+	{
+#ifdef IMAGEDECODER_USE_TURBOJPEG
+		&g_TurboJpegDecoder,
+#endif
+		&g_StbImageDecoder
+	};
+	const int g_DecoderCount = sizeof(g_Decoders) / sizeof(g_Decoders[0]);
+}
+
+/***********************************************************
+ *  FindDecoder()
+ *
+ *  This method is used for finding the preferred decoder
+ *  for an encoded image.  stb_image is returned when no other
+ *  decoder reads the image.
+ ***********************************************************/
+const ImageDecoder* ImageDecoder::FindDecoder(const unsigned char* pData, size_t size)
+{
+	for (int i = 0; i < g_DecoderCount; i++)
+	{
+		if (g_Decoders[i]->CanDecode(pData, size))
+		{
+			return(g_Decoders[i]);
+		}
+	}
+	return(&g_StbImageDecoder);
+}
+
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method is used for decoding an image with the
+ *  preferred decoder.  When that decoder fails, the decoders
+ *  after it are tried, so stb_image gets the last chance.
+ ***********************************************************/
+bool ImageDecoder::DecodeImage(const unsigned char* pData, size_t size, int scaleDenominator, DECODED_IMAGE& image, const ImageDecoder** ppUsedDecoder)
+{
+	image.width = 0;
+	image.height = 0;
+	image.colorChannels = 0;
+	image.pixels.clear();
+
+	for (int i = 0; i < g_DecoderCount; i++)
+	{
+		if ((g_Decoders[i]->CanDecode(pData, size)) &&
+			(g_Decoders[i]->Decode(pData, size, scaleDenominator, image)))
+		{
+			if (NULL != ppUsedDecoder)
+			{
+				*ppUsedDecoder = g_Decoders[i];
+			}
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  GetDecoderCount()
+ *
+ *  This method is used for getting the number of built in
+ *  decoders.
+ ***********************************************************/
+int ImageDecoder::GetDecoderCount()
+{
+	return(g_DecoderCount);
+}
+
+/***********************************************************
+ *  GetDecoder()
+ *
+ *  This method is used for getting a built in decoder, in
+ *  order of preference.
+ ***********************************************************/
+const ImageDecoder* ImageDecoder::GetDecoder(int index)
+{
+	if ((index < 0) || (index >= g_DecoderCount))
+	{
+		return(NULL);
+	}
+	return(g_Decoders[index]);
+}
+
+/***********************************************************
+ *  ReadImageInfo()
+ *
+ *  This method is used for reading the size and channels of
+ *  an image file from its header, without decoding it.
+ ***********************************************************/
+bool ImageDecoder::ReadImageInfo(const char* filename, int& width, int& height, int& colorChannels)
+{
+	return(stbi_info(filename, &width, &height, &colorChannels) != 0);
+}
+
+/***********************************************************
+ *  DownscaleImage()
+ *
+ *  This method is used for reducing decoded pixels by the
+ *  scale denominator.  Every output pixel is the average of
+ *  a block of input pixels, and the blocks at the right and
+ *  top edges are cut short when the size does not divide.
+ ***********************************************************/
+void ImageDecoder::DownscaleImage(DECODED_IMAGE& image, int scaleDenominator)
+{
+	if ((scaleDenominator <= 1) || (image.pixels.size() == 0))
+	{
+		return;
+	}
+
+	int width = (image.width + scaleDenominator - 1) / scaleDenominator;
+	int height = (image.height + scaleDenominator - 1) / scaleDenominator;
+	int channels = image.colorChannels;
+	std::vector<unsigned char> pixels((size_t)width * height * channels);
+
+	for (int y = 0; y < height; y++)
+	{
+		int y0 = y * scaleDenominator;
+		int y1 = (y0 + scaleDenominator < image.height) ? (y0 + scaleDenominator) : image.height;
+		for (int x = 0; x < width; x++)
+		{
+			int x0 = x * scaleDenominator;
+			int x1 = (x0 + scaleDenominator < image.width) ? (x0 + scaleDenominator) : image.width;
+			int count = (y1 - y0) * (x1 - x0);
+			for (int c = 0; c < channels; c++)
+			{
+				int sum = 0;
+				for (int sy = y0; sy < y1; sy++)
+				{
+					const unsigned char* pRow = image.pixels.data() + ((size_t)sy * image.width * channels);
+					for (int sx = x0; sx < x1; sx++)
+					{
+						sum += pRow[sx * channels + c];
+					}
+				}
+				pixels[((size_t)y * width + x) * channels + c] = (unsigned char)((sum + count / 2) / count);
+			}
+		}
+	}
+
+	image.width = width;
+	image.height = height;
+	image.pixels.swap(pixels);
+}
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagedecoder.h
+// ============
+// decode texture image files with the fastest available decoder
+//
+//	JPEG files are decoded with libjpeg-turbo when it is built in, which
+//	uses SIMD code for the inverse DCT and the color conversion and can
+//	reduce the image size while decoding by skipping DCT coefficients.
+//	Define IMAGEDECODER_USE_TURBOJPEG and link libturbojpeg to enable it.
+//	stb_image decodes everything else, and is the fallback when the
+//	libjpeg-turbo decoder fails.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// pixels of a decoded image, with the bottom row first
+struct DECODED_IMAGE
+{
+	int width;
+	int height;
+	int colorChannels;
+	std::vector<unsigned char> pixels;
+};
+
+/***********************************************************
+ *  ImageDecoder
+ *
+ *  This class is the interface of the image decoders, and
+ *  holds the list of decoders that are built in.  Decoders
+ *  keep no state between calls, so they can be used from
+ *  several threads at once.
+ ***********************************************************/
+class ImageDecoder
+{
+public:
+	virtual ~ImageDecoder() {}
+
+	// get the name of the decoder for messages and cache keys
+	virtual const char* GetName() const = 0;
+	// check whether the decoder reads the passed in encoded image
+	virtual bool CanDecode(const unsigned char* pData, size_t size) const = 0;
+	// decode an image flipped vertically, with its size divided by the
+	// scale denominator (1, 2, 4 or 8)
+	virtual bool Decode(const unsigned char* pData, size_t size, int scaleDenominator, DECODED_IMAGE& image) const = 0;
+
+	// find the preferred decoder for an encoded image
+	static const ImageDecoder* FindDecoder(const unsigned char* pData, size_t size);
+	// decode an image with the preferred decoder, falling back to the
+	// decoders after it when that fails
+	static bool DecodeImage(const unsigned char* pData, size_t size, int scaleDenominator, DECODED_IMAGE& image, const ImageDecoder** ppUsedDecoder = NULL);
+	// get the built in decoders in order of preference
+	static int GetDecoderCount();
+	static const ImageDecoder* GetDecoder(int index);
+	// read the size of an image file without decoding it
+	static bool ReadImageInfo(const char* filename, int& width, int& height, int& colorChannels);
+	// reduce decoded pixels by averaging blocks of the scale denominator
+	static void DownscaleImage(DECODED_IMAGE& image, int scaleDenominator);
+};
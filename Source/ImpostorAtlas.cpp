@@ -0,0 +1,404 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostoratlas.cpp
+// ============
+// bake compound objects into octahedral impostor atlases for distant LOD
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImpostorAtlas.h"
+#include "AssetPack.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// chunk types used by impostor atlas pack files
+	const uint32_t CHUNK_IMPOSTOR_HEADER = ASSETPACK_FOURCC('I', 'M', 'P', 'H');
+	const uint32_t CHUNK_IMPOSTOR_COLOR = ASSETPACK_FOURCC('I', 'M', 'P', 'C');
+	const uint32_t CHUNK_IMPOSTOR_DEPTH = ASSETPACK_FOURCC('I', 'M', 'P', 'D');
+
+	// sign function that never returns zero, for octahedral folding
+	float SignNotZero(float value)
+	{
+		return((value >= 0.0f) ? 1.0f : -1.0f);
+	}
+}
+
+/***********************************************************
+ *  ImpostorAtlas()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ImpostorAtlas::ImpostorAtlas(GpuResourceManager* pResources)
+{
+	m_pResources = pResources;
+	m_framebufferHandle = GPU_HANDLE();
+	m_colorHandle = GPU_HANDLE();
+	m_depthHandle = GPU_HANDLE();
+	m_framebuffer = 0;
+	m_colorTexture = 0;
+	m_depthTexture = 0;
+	m_layerCount = 0;
+	m_framesPerSide = 0;
+	m_frameSize = 0;
+	m_savedFramebuffer = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_savedViewport[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~ImpostorAtlas()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ImpostorAtlas::~ImpostorAtlas()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the color and depth
+ *  texture arrays and the framebuffer used for baking.
+ ***********************************************************/
+bool ImpostorAtlas::Create(int layerCount, int framesPerSide, int frameSize)
+{
+	if (CreateTextures(layerCount, framesPerSide, frameSize) == false)
+	{
+		return(false);
+	}
+
+	m_framebufferHandle = m_pResources->CreateFramebuffer("impostor atlas framebuffer");
+	m_framebuffer = m_pResources->GetName(m_framebufferHandle);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_colorTexture, 0, 0);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Impostor atlas framebuffer is incomplete, status:" << status << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateTextures()
+ *
+ *  This method is used for creating the empty color and
+ *  depth texture arrays of the atlas.
+ ***********************************************************/
+bool ImpostorAtlas::CreateTextures(int layerCount, int framesPerSide, int frameSize)
+{
+	Destroy();
+
+	if ((layerCount <= 0) || (framesPerSide <= 0) || (frameSize <= 0))
+	{
+		return(false);
+	}
+
+	m_layerCount = layerCount;
+	m_framesPerSide = framesPerSide;
+	m_frameSize = frameSize;
+	int atlasSize = framesPerSide * frameSize;
+	size_t layerBytes = (size_t)atlasSize * atlasSize * 4;
+
+	glGenTextures(1, &m_colorTexture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_colorTexture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, atlasSize, atlasSize, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	m_colorHandle = m_pResources->AdoptObject(GpuResourceManager::RESOURCE_TEXTURE, m_colorTexture, layerBytes * layerCount, "impostor atlas color");
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_depthTexture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, atlasSize, atlasSize, layerCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+	m_depthHandle = m_pResources->AdoptObject(GpuResourceManager::RESOURCE_TEXTURE, m_depthTexture, layerBytes * layerCount, "impostor atlas depth");
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the atlas textures and
+ *  framebuffer.
+ ***********************************************************/
+void ImpostorAtlas::Destroy()
+{
+	// the objects are deleted once the GPU is done with them
+	m_pResources->Release(m_framebufferHandle);
+	m_pResources->Release(m_colorHandle);
+	m_pResources->Release(m_depthHandle);
+	m_framebuffer = 0;
+	m_colorTexture = 0;
+	m_depthTexture = 0;
+	m_layerCount = 0;
+	m_framesPerSide = 0;
+	m_frameSize = 0;
+}
+
+/***********************************************************
+ *  BeginBake()
+ *
+ *  This method is used for binding the atlas framebuffer and
+ *  setting up the blending used for capturing the frames.
+ *  Colors are stored premultiplied by alpha so that partly
+ *  transparent objects like the glass cup keep their look.
+ ***********************************************************/
+void ImpostorAtlas::BeginBake()
+{
+	glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_SCISSOR_TEST);
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for selecting the atlas layer and the
+ *  frame that the next view is rendered into, and clearing
+ *  that frame.
+ ***********************************************************/
+void ImpostorAtlas::BeginFrame(int layer, int frameX, int frameY)
+{
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_colorTexture, 0, layer);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, layer);
+
+	glViewport(frameX * m_frameSize, frameY * m_frameSize, m_frameSize, m_frameSize);
+	glScissor(frameX * m_frameSize, frameY * m_frameSize, m_frameSize, m_frameSize);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClearDepth(1.0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+/***********************************************************
+ *  EndBake()
+ *
+ *  This method is used for restoring the render target and
+ *  state that were active before baking.
+ ***********************************************************/
+void ImpostorAtlas::EndBake()
+{
+	glDisable(GL_SCISSOR_TEST);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_savedFramebuffer);
+	glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+}
+
+/***********************************************************
+ *  SaveToFile()
+ *
+ *  This method is used for reading the baked atlas back from
+ *  OpenGL and writing it into an asset pack file, so that it
+ *  can be baked once without a visible window and reused.
+ ***********************************************************/
+bool ImpostorAtlas::SaveToFile(const char* filename) const
+{
+	if (m_colorTexture == 0)
+	{
+		return(false);
+	}
+
+	int atlasSize = m_framesPerSide * m_frameSize;
+	size_t texelCount = (size_t)atlasSize * atlasSize * m_layerCount;
+	std::vector<unsigned char> color(texelCount * 4);
+	std::vector<float> depth(texelCount);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_colorTexture);
+	glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, GL_UNSIGNED_BYTE, color.data());
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_depthTexture);
+	glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT, GL_FLOAT, depth.data());
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	ChunkWriter header;
+	header.Write((int32_t)m_layerCount);
+	header.Write((int32_t)m_framesPerSide);
+	header.Write((int32_t)m_frameSize);
+
+	AssetPackWriter pack;
+	pack.AddChunk(CHUNK_IMPOSTOR_HEADER, header.GetData().data(), header.GetData().size());
+	// the atlas is mostly empty background, which compresses well
+	pack.AddChunk(CHUNK_IMPOSTOR_COLOR, color.data(), color.size(), AssetPack::COMPRESSION_LZ4);
+	pack.AddChunk(CHUNK_IMPOSTOR_DEPTH, depth.data(), depth.size() * sizeof(float), AssetPack::COMPRESSION_LZ4);
+
+	if (pack.WriteToFile(filename) == false)
+	{
+		return(false);
+	}
+
+	std::cout << "Saved impostor atlas:" << filename << ", layers:" << m_layerCount << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  LoadFromFile()
+ *
+ *  This method is used for loading a previously baked atlas.
+ *  The load fails when the file holds a different number of
+ *  layers than the scene needs, so that a stale atlas gets
+ *  baked again instead of being shown on the wrong objects.
+ ***********************************************************/
+bool ImpostorAtlas::LoadFromFile(const char* filename, int layerCount)
+{
+	AssetPackReader reader;
+	std::vector<unsigned char> payload;
+	if ((reader.Open(filename) == false) ||
+		(reader.ReadChunk(reader.FindChunk(CHUNK_IMPOSTOR_HEADER), payload) == false))
+	{
+		return(false);
+	}
+
+	int32_t fileLayers = 0;
+	int32_t framesPerSide = 0;
+	int32_t frameSize = 0;
+	ChunkReader header(payload.data(), payload.size());
+	if ((header.Read(fileLayers) == false) || (header.Read(framesPerSide) == false) ||
+		(header.Read(frameSize) == false) || (fileLayers != layerCount))
+	{
+		return(false);
+	}
+
+	size_t atlasSize = (size_t)framesPerSide * frameSize;
+	size_t texelCount = atlasSize * atlasSize * fileLayers;
+	std::vector<unsigned char> color;
+	std::vector<unsigned char> depth;
+	if ((reader.ReadChunk(reader.FindChunk(CHUNK_IMPOSTOR_COLOR), color) == false) ||
+		(reader.ReadChunk(reader.FindChunk(CHUNK_IMPOSTOR_DEPTH), depth) == false) ||
+		(color.size() != texelCount * 4) || (depth.size() != texelCount * sizeof(float)))
+	{
+		std::cout << "Corrupt impostor atlas:" << filename << std::endl;
+		return(false);
+	}
+
+	if (Create(fileLayers, framesPerSide, frameSize) == false)
+	{
+		return(false);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_colorTexture);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, (GLsizei)atlasSize, (GLsizei)atlasSize, fileLayers, GL_RGBA, GL_UNSIGNED_BYTE, color.data());
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_depthTexture);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, (GLsizei)atlasSize, (GLsizei)atlasSize, fileLayers, GL_DEPTH_COMPONENT, GL_FLOAT, depth.data());
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	std::cout << "Loaded impostor atlas:" << filename << ", layers:" << fileLayers << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  GetFrameDirection()
+ *
+ *  This method is used for getting the direction, pointing
+ *  from the object toward the capture camera, that belongs
+ *  to the center of an atlas frame.
+ ***********************************************************/
+glm::vec3 ImpostorAtlas::GetFrameDirection(int frameX, int frameY, int framesPerSide)
+{
+	glm::vec2 uv(
+		(frameX + 0.5f) / (float)framesPerSide,
+		(frameY + 0.5f) / (float)framesPerSide);
+	return(DecodeOctahedral(uv));
+}
+
+/***********************************************************
+ *  GetFrameViewMatrix()
+ *
+ *  This method is used for getting the view matrix of the
+ *  capture camera.  The impostor shader builds its billboard
+ *  from the same axes, so the two must stay in sync.
+ ***********************************************************/
+glm::mat4 ImpostorAtlas::GetFrameViewMatrix(glm::vec3 center, float radius, glm::vec3 direction)
+{
+	glm::vec3 up(0.0f, 1.0f, 0.0f);
+	if (std::fabs(direction.y) > 0.99f)
+	{
+		up = glm::vec3(0.0f, 0.0f, 1.0f);
+	}
+
+	return(glm::lookAt(center + (direction * (2.0f * radius)), center, up));
+}
+
+/***********************************************************
+ *  GetFrameProjectionMatrix()
+ *
+ *  This method is used for getting the orthographic capture
+ *  projection.  The depth range covers the bounding sphere,
+ *  so stored depth maps linearly onto [-radius, radius].
+ ***********************************************************/
+glm::mat4 ImpostorAtlas::GetFrameProjectionMatrix(float radius)
+{
+	return(glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius));
+}
+
+/***********************************************************
+ *  EncodeOctahedral()
+ *
+ *  This method is used for mapping a unit direction onto the
+ *  octahedral square, with +Y at the center of the square.
+ ***********************************************************/
+glm::vec2 ImpostorAtlas::EncodeOctahedral(glm::vec3 direction)
+{
+	float sum = std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z);
+	glm::vec3 n = direction / sum;
+	glm::vec2 p(n.x, n.z);
+
+	// fold the lower hemisphere over the diagonals
+	if (n.y < 0.0f)
+	{
+		p = glm::vec2(
+			(1.0f - std::fabs(n.z)) * SignNotZero(n.x),
+			(1.0f - std::fabs(n.x)) * SignNotZero(n.z));
+	}
+
+	return((p * 0.5f) + glm::vec2(0.5f, 0.5f));
+}
+
+/***********************************************************
+ *  DecodeOctahedral()
+ *
+ *  This method is used for mapping a point of the octahedral
+ *  square back to a unit direction.
+ ***********************************************************/
+glm::vec3 ImpostorAtlas::DecodeOctahedral(glm::vec2 uv)
+{
+	glm::vec2 p = (uv * 2.0f) - glm::vec2(1.0f, 1.0f);
+	glm::vec3 n(p.x, 1.0f - std::fabs(p.x) - std::fabs(p.y), p.y);
+
+	// unfold the lower hemisphere
+	if (n.y < 0.0f)
+	{
+		float x = n.x;
+		n.x = (1.0f - std::fabs(n.z)) * SignNotZero(x);
+		n.z = (1.0f - std::fabs(x)) * SignNotZero(n.z);
+	}
+
+	return(glm::normalize(n));
+}
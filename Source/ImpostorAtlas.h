@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostoratlas.h
+// ============
+// bake compound objects into octahedral impostor atlases for distant LOD
+//
+//	Every baked object gets one layer of a 2D texture array.  The layer is
+//	split into a grid of frames, and each frame holds the object rendered
+//	from one direction on an octahedron around it.  A depth layer is kept
+//	alongside the color so that impostors can write correct depth.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GpuResourceManager.h"
+
+/***********************************************************
+ *  ImpostorAtlas
+ *
+ *  This class contains the code for creating, baking, saving
+ *  and loading octahedral impostor atlases.
+ ***********************************************************/
+class ImpostorAtlas
+{
+public:
+	// constructor - the textures and framebuffer are owned by the
+	// resource manager
+	ImpostorAtlas(GpuResourceManager* pResources);
+	// destructor
+	~ImpostorAtlas();
+
+	// create the atlas textures and framebuffer
+	bool Create(int layerCount, int framesPerSide, int frameSize);
+	// free the atlas textures and framebuffer
+	void Destroy();
+
+	// start baking into the atlas
+	void BeginBake();
+	// select the atlas frame to render the next view into
+	void BeginFrame(int layer, int frameX, int frameY);
+	// finish baking and restore the previous render target
+	void EndBake();
+
+	// save the baked atlas into an asset pack file
+	bool SaveToFile(const char* filename) const;
+	// load a baked atlas from an asset pack file
+	bool LoadFromFile(const char* filename, int layerCount);
+
+	// get the direction that an atlas frame was captured from
+	static glm::vec3 GetFrameDirection(int frameX, int frameY, int framesPerSide);
+	// get the view matrix for capturing an object from a direction
+	static glm::mat4 GetFrameViewMatrix(glm::vec3 center, float radius, glm::vec3 direction);
+	// get the projection matrix for capturing an object
+	static glm::mat4 GetFrameProjectionMatrix(float radius);
+	// map a unit direction into the octahedral [0,1] square
+	static glm::vec2 EncodeOctahedral(glm::vec3 direction);
+	// map a point of the octahedral [0,1] square back to a direction
+	static glm::vec3 DecodeOctahedral(glm::vec2 uv);
+
+	GLuint GetColorTexture() const { return(m_colorTexture); }
+	GLuint GetDepthTexture() const { return(m_depthTexture); }
+	int GetLayerCount() const { return(m_layerCount); }
+	int GetFramesPerSide() const { return(m_framesPerSide); }
+
+private:
+	// resource manager that owns the atlas objects
+	GpuResourceManager* m_pResources;
+	// handles and OpenGL names of the atlas objects
+	GPU_HANDLE m_framebufferHandle;
+	GPU_HANDLE m_colorHandle;
+	GPU_HANDLE m_depthHandle;
+	GLuint m_framebuffer;
+	GLuint m_colorTexture;
+	GLuint m_depthTexture;
+
+	// atlas layout
+	int m_layerCount;
+	int m_framesPerSide;
+	int m_frameSize;
+
+	// render state saved while baking
+	GLint m_savedViewport[4];
+	GLint m_savedFramebuffer;
+
+	// create the empty atlas textures
+	bool CreateTextures(int layerCount, int framesPerSide, int frameSize);
+};
@@ -0,0 +1,479 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// run a graph of dependent tasks on worker threads and the main thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+#include "TraceLog.h"
+
+#include <chrono>
+#include <string>
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem(int workerCount)
+{
+	m_pendingTasks = 0;
+	m_bStopping = false;
+	m_pLoop = NULL;
+
+	// leave one core for the main thread
+	if (workerCount <= 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+		if (workerCount < 1)
+		{
+			workerCount = 1;
+		}
+	}
+
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerThreadMain, this, i));
+	}
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_workAvailable.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+}
+
+/***********************************************************
+ *  AddTask()
+ *
+ *  This method is used for adding a task to the graph.  The
+ *  task is queued as soon as every task in the dependency
+ *  list is complete.  Main thread tasks are only run from
+ *  RunMainThreadTasks() or while the main thread waits.
+ ***********************************************************/
+int JobSystem::AddTask(
+	const char* name,
+	std::function<void()> function,
+	const std::vector<int>& dependencies,
+	bool bMainThread)
+{
+	return(AddTaskNode(name, function, std::function<bool()>(), dependencies, bMainThread));
+}
+
+/***********************************************************
+ *  AddPollTask()
+ *
+ *  This method is used for adding a main thread task that
+ *  waits on something outside of the graph, like the driver
+ *  finishing a shader compile.  The poll function is run once
+ *  per RunMainThreadTasks() call until it returns true, and
+ *  only then is the task complete.
+ ***********************************************************/
+int JobSystem::AddPollTask(
+	const char* name,
+	std::function<bool()> poll,
+	const std::vector<int>& dependencies)
+{
+	return(AddTaskNode(name, std::function<void()>(), poll, dependencies, true));
+}
+
+/***********************************************************
+ *  AddTaskNode()
+ *
+ *  This method is used for adding a node to the task graph
+ *  and registering it with the tasks it depends on.
+ ***********************************************************/
+int JobSystem::AddTaskNode(
+	const char* name,
+	std::function<void()> function,
+	std::function<bool()> poll,
+	const std::vector<int>& dependencies,
+	bool bMainThread)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	int taskID = (int)m_tasks.size();
+	TASK task;
+	task.name = name;
+	task.function = function;
+	task.poll = poll;
+	task.remainingDependencies = 0;
+	task.bMainThread = bMainThread;
+	task.bComplete = false;
+	m_tasks.push_back(task);
+	m_pendingTasks++;
+
+	for (size_t i = 0; i < dependencies.size(); i++)
+	{
+		int dependency = dependencies[i];
+		if ((dependency < 0) || (dependency >= taskID) || (m_tasks[dependency].bComplete))
+		{
+			continue;
+		}
+		m_tasks[dependency].dependents.push_back(taskID);
+		m_tasks[taskID].remainingDependencies++;
+	}
+
+	if (m_tasks[taskID].remainingDependencies == 0)
+	{
+		QueueReadyTask(taskID);
+	}
+
+	return(taskID);
+}
+
+/***********************************************************
+ *  QueueReadyTask()
+ *
+ *  This method is used for queuing a task that has no more
+ *  dependencies to wait for.  The mutex must already be held
+ *  by the caller.
+ ***********************************************************/
+void JobSystem::QueueReadyTask(int taskID)
+{
+	if (m_tasks[taskID].bMainThread)
+	{
+		m_mainQueue.push_back(taskID);
+		// the main thread may be waiting for this task
+		m_taskFinished.notify_all();
+	}
+	else
+	{
+		m_workerQueue.push_back(taskID);
+		m_workAvailable.notify_one();
+	}
+}
+
+/***********************************************************
+ *  RunTask()
+ *
+ *  This method is used for running a task and then releasing
+ *  the tasks that were waiting for it.  A polled task that
+ *  is not done yet is left incomplete and false is returned.
+ ***********************************************************/
+bool JobSystem::RunTask(int taskID)
+{
+	std::function<void()> function;
+	std::function<bool()> poll;
+	std::string name;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		function.swap(m_tasks[taskID].function);
+		poll = m_tasks[taskID].poll;
+		name = m_tasks[taskID].name;
+	}
+
+	if (poll)
+	{
+		// only the poll that finishes the task shows up in the trace
+		int64_t startTime = TraceLog::GetMicroseconds();
+		if (poll() == false)
+		{
+			return(false);
+		}
+		TraceLog::AddEvent(name.c_str(), "task", startTime, TraceLog::GetMicroseconds() - startTime);
+	}
+	else
+	{
+		TraceScope trace(name.c_str(), "task");
+		if (function)
+		{
+			function();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		TASK& task = m_tasks[taskID];
+		task.bComplete = true;
+		task.poll = std::function<bool()>();
+		m_pendingTasks--;
+		for (size_t i = 0; i < task.dependents.size(); i++)
+		{
+			int dependent = task.dependents[i];
+			m_tasks[dependent].remainingDependencies--;
+			if (m_tasks[dependent].remainingDependencies == 0)
+			{
+				QueueReadyTask(dependent);
+			}
+		}
+		task.dependents.clear();
+	}
+	m_taskFinished.notify_all();
+
+	return(true);
+}
+
+/***********************************************************
+ *  RunMainThreadTasks()
+ *
+ *  This method is used for running the ready main thread
+ *  tasks.  At least one ready task is run, and then tasks
+ *  are run until the time budget is spent.  Polled tasks are
+ *  checked once per call.  The number of tasks that finished
+ *  is returned.
+ ***********************************************************/
+int JobSystem::RunMainThreadTasks(double budgetMilliseconds)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	std::vector<int> polledTasks;
+	int tasksRun = 0;
+
+	while (true)
+	{
+		int taskID = -1;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_mainQueue.size() == 0)
+			{
+				break;
+			}
+			taskID = m_mainQueue.front();
+			m_mainQueue.pop_front();
+		}
+
+		if (RunTask(taskID))
+		{
+			tasksRun++;
+		}
+		else
+		{
+			polledTasks.push_back(taskID);
+		}
+
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		if (elapsed >= budgetMilliseconds)
+		{
+			break;
+		}
+	}
+
+	// polled tasks that are not done go back on the queue for the next call
+	if (polledTasks.size() > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_mainQueue.insert(m_mainQueue.end(), polledTasks.begin(), polledTasks.end());
+	}
+
+	return(tasksRun);
+}
+
+/***********************************************************
+ *  IsTaskComplete()
+ *
+ *  This method is used for checking whether a task has
+ *  finished running.
+ ***********************************************************/
+bool JobSystem::IsTaskComplete(int taskID) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if ((taskID < 0) || (taskID >= (int)m_tasks.size()))
+	{
+		return(false);
+	}
+	return(m_tasks[taskID].bComplete);
+}
+
+/***********************************************************
+ *  IsIdle()
+ *
+ *  This method is used for checking whether every added
+ *  task has finished running.
+ ***********************************************************/
+bool JobSystem::IsIdle() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_pendingTasks == 0);
+}
+
+/***********************************************************
+ *  WaitForTask()
+ *
+ *  This method is used for blocking the main thread until a
+ *  task is complete.  Main thread tasks are run while
+ *  waiting, since the task may depend on them.
+ ***********************************************************/
+void JobSystem::WaitForTask(int taskID)
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if ((taskID < 0) || (taskID >= (int)m_tasks.size()))
+			{
+				return;
+			}
+			m_taskFinished.wait(lock, [this, taskID]() {
+				return((m_tasks[taskID].bComplete) || (m_mainQueue.size() > 0));
+			});
+			if (m_tasks[taskID].bComplete)
+			{
+				return;
+			}
+		}
+		if (RunMainThreadTasks(0.0) == 0)
+		{
+			// only polled tasks are waiting, so give the driver some time
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  WaitForAll()
+ *
+ *  This method is used for blocking the main thread until
+ *  every added task is complete.
+ ***********************************************************/
+void JobSystem::WaitForAll()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskFinished.wait(lock, [this]() {
+				return((m_pendingTasks == 0) || (m_mainQueue.size() > 0));
+			});
+			if (m_pendingTasks == 0)
+			{
+				return;
+			}
+		}
+		if (RunMainThreadTasks(0.0) == 0)
+		{
+			// only polled tasks are waiting, so give the driver some time
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running a function over a range
+ *  of indices.  The workers that are idle join in, and the
+ *  calling thread works on the loop too, so a loop never
+ *  waits for a worker that is busy with a long task.  The
+ *  call returns once every index has been run.
+ ***********************************************************/
+void JobSystem::ParallelFor(int count, std::function<void(int)> function)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	PARALLEL_LOOP loop;
+	loop.function = function;
+	loop.nextIndex = 0;
+	loop.count = count;
+	loop.activeWorkers = 0;
+
+	// a single index is not worth waking anyone for
+	if ((count > 1) && (m_workers.size() > 0))
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pLoop = &loop;
+	}
+	m_workAvailable.notify_all();
+
+	RunLoopIndices(loop);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_pLoop = NULL;
+	m_loopFinished.wait(lock, [&loop]() {
+		return(loop.activeWorkers == 0);
+	});
+}
+
+/***********************************************************
+ *  RunLoopIndices()
+ *
+ *  This method is used for taking indices of a parallel loop
+ *  one at a time and running them.
+ ***********************************************************/
+void JobSystem::RunLoopIndices(PARALLEL_LOOP& loop)
+{
+	for (int index = loop.nextIndex++; index < loop.count; index = loop.nextIndex++)
+	{
+		loop.function(index);
+	}
+}
+
+/***********************************************************
+ *  HasLoopWork()
+ *
+ *  This method is used for checking whether a worker can
+ *  join the running parallel loop.
+ ***********************************************************/
+bool JobSystem::HasLoopWork() const
+{
+	return((NULL != m_pLoop) && (m_pLoop->nextIndex < m_pLoop->count));
+}
+
+/***********************************************************
+ *  WorkerThreadMain()
+ *
+ *  This method is used for running queued tasks on a worker
+ *  thread until the job system is destroyed.
+ ***********************************************************/
+void JobSystem::WorkerThreadMain(int workerIndex)
+{
+	std::string threadName = "worker " + std::to_string(workerIndex);
+	TraceLog::SetThreadName(threadName.c_str());
+
+	while (true)
+	{
+		int taskID = -1;
+		PARALLEL_LOOP* pLoop = NULL;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workAvailable.wait(lock, [this]() {
+				return((m_bStopping) || (m_workerQueue.size() > 0) || (HasLoopWork()));
+			});
+			if (m_bStopping)
+			{
+				return;
+			}
+			// the thread that started a loop is waiting on it, so
+			// loops go before the queued tasks
+			if (HasLoopWork())
+			{
+				pLoop = m_pLoop;
+				pLoop->activeWorkers++;
+			}
+			else
+			{
+				taskID = m_workerQueue.front();
+				m_workerQueue.pop_front();
+			}
+		}
+
+		if (NULL != pLoop)
+		{
+			RunLoopIndices(*pLoop);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				pLoop->activeWorkers--;
+			}
+			m_loopFinished.notify_all();
+			continue;
+		}
+
+		RunTask(taskID);
+	}
+}
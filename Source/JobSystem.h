@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// run a graph of dependent tasks on worker threads and the main thread
+//
+//	Every task can depend on tasks that were added before it, and starts
+//	once all of them are complete.  Tasks that make OpenGL calls are marked
+//	as main thread tasks, since the OpenGL context belongs to the main
+//	thread.  They are run in between frames by RunMainThreadTasks().
+//
+//	Work that is repeated every frame, like the physics steps, runs as a
+//	parallel loop instead.  The loop hands out its indices to the idle
+//	workers and the calling thread, and adds nothing to the task graph.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class owns the worker threads and the task graph.
+ *  Tasks can be added from any thread.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor - zero workers uses one per spare CPU core
+	JobSystem(int workerCount = 0);
+	// destructor - waits for the running tasks to finish
+	~JobSystem();
+
+	// add a task that runs once all of its dependencies are complete
+	int AddTask(
+		const char* name,
+		std::function<void()> function,
+		const std::vector<int>& dependencies = std::vector<int>(),
+		bool bMainThread = false);
+	// add a main thread task that is polled until it returns true
+	int AddPollTask(
+		const char* name,
+		std::function<bool()> poll,
+		const std::vector<int>& dependencies = std::vector<int>());
+
+	// run ready main thread tasks until the time budget is spent
+	int RunMainThreadTasks(double budgetMilliseconds);
+	// check whether a task has finished running
+	bool IsTaskComplete(int taskID) const;
+	// check whether every added task has finished running
+	bool IsIdle() const;
+	// wait for a task, running main thread tasks while waiting
+	void WaitForTask(int taskID);
+	// wait for every added task, running main thread tasks while waiting
+	void WaitForAll();
+
+	// run a function for every index from zero up to the count on the
+	// workers and the calling thread, and wait until all are done - one
+	// loop runs at a time, and it must not be started from a task.  The
+	// loops run every frame, so they are left out of the trace.
+	void ParallelFor(int count, std::function<void(int)> function);
+
+	// get the number of worker threads
+	int GetWorkerCount() const { return((int)m_workers.size()); }
+
+private:
+	// one node of the task graph
+	struct TASK
+	{
+		std::string name;
+		std::function<void()> function;
+		std::function<bool()> poll;
+		std::vector<int> dependents;
+		int remainingDependencies;
+		bool bMainThread;
+		bool bComplete;
+	};
+
+	// indices of a parallel loop that the threads take in turn
+	struct PARALLEL_LOOP
+	{
+		std::function<void(int)> function;
+		std::atomic<int> nextIndex;
+		int count;
+		// workers that are running indices of the loop
+		int activeWorkers;
+	};
+
+	// add a task node and queue it if it has nothing to wait for
+	int AddTaskNode(
+		const char* name,
+		std::function<void()> function,
+		std::function<bool()> poll,
+		const std::vector<int>& dependencies,
+		bool bMainThread);
+	// run a task and release the tasks that depend on it - false
+	// is returned when a polled task has to be run again later
+	bool RunTask(int taskID);
+	// queue a task whose dependencies are all complete
+	void QueueReadyTask(int taskID);
+	// loop run by every worker thread
+	void WorkerThreadMain(int workerIndex);
+	// run indices of a parallel loop until there are none left
+	static void RunLoopIndices(PARALLEL_LOOP& loop);
+	// check whether the parallel loop has indices left to hand out - the
+	// mutex must already be held by the caller
+	bool HasLoopWork() const;
+
+	// all added tasks indexed by task ID
+	std::deque<TASK> m_tasks;
+	// tasks that are ready to run
+	std::deque<int> m_workerQueue;
+	std::deque<int> m_mainQueue;
+	// number of added tasks that have not finished
+	int m_pendingTasks;
+
+	std::vector<std::thread> m_workers;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_taskFinished;
+	bool m_bStopping;
+	// parallel loop that is running, or NULL
+	PARALLEL_LOOP* m_pLoop;
+	std::condition_variable m_loopFinished;
+};
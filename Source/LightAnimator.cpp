@@ -0,0 +1,339 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightanimator.cpp
+// ============
+// move the scene lights through a day with keyframed values
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightAnimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// x64 builds always have SSE, and 32-bit builds have it when it is
+// switched on with /arch or -msse
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#include <xmmintrin.h>
+#define LIGHT_SIMD 1
+#endif
+
+// declaration of global variables
+namespace
+{
+	const float g_HoursPerDay = 24.0f;
+	// smallest change of a value that is written into the shader
+	const float g_WriteEpsilon = 0.001f;
+	// changes that make the data drawn with the old lighting stale - the
+	// sun turning by about five degrees, a point light moving a quarter
+	// of a unit, or any color changing by this much
+	const float g_InvalidateCosine = 0.996f;
+	const float g_InvalidateDistance = 0.25f;
+	const float g_InvalidateColor = 0.05f;
+	// uniform names of the four values of a light
+	const char* g_DirectionName = ".direction";
+	const char* g_PositionName = ".position";
+	const char* g_AmbientName = ".ambient";
+	const char* g_DiffuseName = ".diffuse";
+	const char* g_SpecularName = ".specular";
+}
+
+/***********************************************************
+ *  LightAnimator()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightAnimator::LightAnimator()
+{
+	m_dayLength = 240.0f;
+	m_hour = 7.0f;
+	m_bInvalidated = false;
+	m_updates = 0;
+	m_writtenLights = 0;
+	m_invalidations = 0;
+}
+
+/***********************************************************
+ *  IsSimdEnabled()
+ *
+ *  This method is used for checking whether the lights are
+ *  blended and compared with SSE instructions.
+ ***********************************************************/
+bool LightAnimator::IsSimdEnabled()
+{
+#ifdef LIGHT_SIMD
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a light that is written
+ *  into the shader uniforms with the passed in name.
+ ***********************************************************/
+int LightAnimator::AddLight(int type, const std::string& uniformName)
+{
+	LIGHT light;
+	light.type = type;
+	light.uniformNames[0] = uniformName + ((type == LIGHT_DIRECTIONAL) ? g_DirectionName : g_PositionName);
+	light.uniformNames[1] = uniformName + g_AmbientName;
+	light.uniformNames[2] = uniformName + g_DiffuseName;
+	light.uniformNames[3] = uniformName + g_SpecularName;
+	std::fill(light.current, light.current + LIGHT_FLOATS, 0.0f);
+	std::fill(light.written, light.written + LIGHT_FLOATS, 0.0f);
+	std::fill(light.reference, light.reference + LIGHT_FLOATS, 0.0f);
+	light.bWritten = false;
+	m_lights.push_back(light);
+	return((int)m_lights.size() - 1);
+}
+
+/***********************************************************
+ *  AddKey()
+ *
+ *  This method is used for adding the values of a light at
+ *  an hour of the day.  The keys are kept sorted by hour.
+ ***********************************************************/
+void LightAnimator::AddKey(int light, float hour, const glm::vec3& vector, const glm::vec3& ambient,
+	const glm::vec3& diffuse, const glm::vec3& specular)
+{
+	LIGHT_KEY key;
+	key.hour = std::fmod(std::max(hour, 0.0f), g_HoursPerDay);
+	const glm::vec3* pValues[4] = { &vector, &ambient, &diffuse, &specular };
+	for (int i = 0; i < 4; i++)
+	{
+		key.values[(i * 4) + 0] = pValues[i]->x;
+		key.values[(i * 4) + 1] = pValues[i]->y;
+		key.values[(i * 4) + 2] = pValues[i]->z;
+		key.values[(i * 4) + 3] = 0.0f;
+	}
+
+	std::vector<LIGHT_KEY>& keys = m_lights[light].keys;
+	std::vector<LIGHT_KEY>::iterator position = keys.begin();
+	while ((position != keys.end()) && (position->hour <= key.hour))
+	{
+		++position;
+	}
+	keys.insert(position, key);
+}
+
+/***********************************************************
+ *  SetTimeOfDay()
+ *
+ *  This method is used for jumping to an hour of the day.
+ ***********************************************************/
+void LightAnimator::SetTimeOfDay(float hour)
+{
+	m_hour = std::fmod(hour, g_HoursPerDay);
+	if (m_hour < 0.0f)
+	{
+		m_hour += g_HoursPerDay;
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for moving the time of day on and
+ *  working out every light for it.  A light is written into
+ *  the shader when any of its values moved by more than a
+ *  rounding step, so lights that hold still between two
+ *  keys cost no uniform updates.  The data drawn with the
+ *  lights is only marked stale once a light crossed one of
+ *  the thresholds since that data was last refreshed.
+ ***********************************************************/
+void LightAnimator::Update(double elapsedSeconds, ShaderManager* pShaderManager)
+{
+	if (m_dayLength > 0.0f)
+	{
+		SetTimeOfDay(m_hour + (float)(elapsedSeconds * g_HoursPerDay / m_dayLength));
+	}
+
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		LIGHT& light = m_lights[i];
+		if (light.keys.empty())
+		{
+			continue;
+		}
+		EvaluateLight(light);
+
+		if ((light.bWritten == false) ||
+			(MaxDifference(light.current, light.written, LIGHT_FLOATS) > g_WriteEpsilon))
+		{
+			WriteLight(light, pShaderManager);
+			std::copy(light.current, light.current + LIGHT_FLOATS, light.written);
+			m_writtenLights++;
+		}
+
+		// the first values are what the cached data is drawn with
+		if (light.bWritten == false)
+		{
+			std::copy(light.current, light.current + LIGHT_FLOATS, light.reference);
+			light.bWritten = true;
+		}
+		else if (IsPastThreshold(light))
+		{
+			std::copy(light.current, light.current + LIGHT_FLOATS, light.reference);
+			m_bInvalidated = true;
+		}
+	}
+	m_updates++;
+}
+
+/***********************************************************
+ *  ConsumeInvalidation()
+ *
+ *  This method is used for checking whether the lighting
+ *  changed enough to draw the cached data again, and for
+ *  clearing the check for the next time.
+ ***********************************************************/
+bool LightAnimator::ConsumeInvalidation()
+{
+	bool bInvalidated = m_bInvalidated;
+	m_bInvalidated = false;
+	if (bInvalidated)
+	{
+		m_invalidations++;
+	}
+	return(bInvalidated);
+}
+
+/***********************************************************
+ *  EvaluateLight()
+ *
+ *  This method is used for blending the two keys around
+ *  the time of day.  The keys wrap around midnight, so the
+ *  last key of the day blends into the first one.  All
+ *  sixteen values are blended four at a time.
+ ***********************************************************/
+void LightAnimator::EvaluateLight(LIGHT& light) const
+{
+	const std::vector<LIGHT_KEY>& keys = light.keys;
+	size_t next = 0;
+	while ((next < keys.size()) && (keys[next].hour <= m_hour))
+	{
+		next++;
+	}
+	size_t previous = (next + keys.size() - 1) % keys.size();
+	next = next % keys.size();
+
+	float start = keys[previous].hour;
+	float end = keys[next].hour;
+	float hour = m_hour;
+	if (end <= start)
+	{
+		end += g_HoursPerDay;
+	}
+	if (hour < start)
+	{
+		hour += g_HoursPerDay;
+	}
+	float factor = (end > start) ? ((hour - start) / (end - start)) : 0.0f;
+
+	const float* pPrevious = keys[previous].values;
+	const float* pNext = keys[next].values;
+#ifdef LIGHT_SIMD
+	__m128 blend = _mm_set1_ps(factor);
+	for (int i = 0; i < LIGHT_FLOATS; i += 4)
+	{
+		__m128 from = _mm_loadu_ps(pPrevious + i);
+		__m128 to = _mm_loadu_ps(pNext + i);
+		_mm_storeu_ps(light.current + i, _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), blend)));
+	}
+#else
+	for (int i = 0; i < LIGHT_FLOATS; i++)
+	{
+		light.current[i] = pPrevious[i] + ((pNext[i] - pPrevious[i]) * factor);
+	}
+#endif
+}
+
+/***********************************************************
+ *  IsPastThreshold()
+ *
+ *  This method is used for comparing a light with the
+ *  values the cached data was last drawn with.  The sun is
+ *  compared by the angle it turned through, since only its
+ *  direction counts, and a point light by how far it moved.
+ ***********************************************************/
+bool LightAnimator::IsPastThreshold(const LIGHT& light) const
+{
+	glm::vec3 current(light.current[0], light.current[1], light.current[2]);
+	glm::vec3 reference(light.reference[0], light.reference[1], light.reference[2]);
+	if (light.type == LIGHT_DIRECTIONAL)
+	{
+		float lengths = glm::length(current) * glm::length(reference);
+		if ((lengths > 0.0f) && ((glm::dot(current, reference) / lengths) < g_InvalidateCosine))
+		{
+			return(true);
+		}
+	}
+	else if (glm::length(current - reference) > g_InvalidateDistance)
+	{
+		return(true);
+	}
+
+	// the colors follow the direction or position
+	return(MaxDifference(light.current + 4, light.reference + 4, LIGHT_FLOATS - 4) > g_InvalidateColor);
+}
+
+/***********************************************************
+ *  WriteLight()
+ *
+ *  This method is used for setting the uniforms of a light.
+ ***********************************************************/
+void LightAnimator::WriteLight(const LIGHT& light, ShaderManager* pShaderManager) const
+{
+	for (int i = 0; i < 4; i++)
+	{
+		const float* pValue = light.current + (i * 4);
+		pShaderManager->setVec3Value(light.uniformNames[i], pValue[0], pValue[1], pValue[2]);
+	}
+}
+
+/***********************************************************
+ *  MaxDifference()
+ *
+ *  This method is used for finding the largest difference
+ *  between two runs of values.  The differences are taken
+ *  four at a time and their maximum is kept per lane, so
+ *  the lanes are only folded together at the end.
+ ***********************************************************/
+float LightAnimator::MaxDifference(const float* pLeft, const float* pRight, int count)
+{
+#ifdef LIGHT_SIMD
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 largest = _mm_setzero_ps();
+	for (int i = 0; i < count; i += 4)
+	{
+		__m128 difference = _mm_sub_ps(_mm_loadu_ps(pLeft + i), _mm_loadu_ps(pRight + i));
+		largest = _mm_max_ps(largest, _mm_andnot_ps(signMask, difference));
+	}
+	largest = _mm_max_ps(largest, _mm_movehl_ps(largest, largest));
+	largest = _mm_max_ss(largest, _mm_shuffle_ps(largest, largest, 1));
+	return(_mm_cvtss_f32(largest));
+#else
+	float largest = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		largest = std::max(largest, std::fabs(pLeft[i] - pRight[i]));
+	}
+	return(largest);
+#endif
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing how many lights were
+ *  written and how often the lighting made the cached data
+ *  stale.
+ ***********************************************************/
+void LightAnimator::PrintStats() const
+{
+	std::cout << "Light animation: " << m_lights.size() << " lights over " << m_updates << " frames, "
+		<< m_writtenLights << " light writes, "
+		<< m_invalidations << " refreshes of the cached lighting" << std::endl;
+}
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightanimator.h
+// ============
+// move the scene lights through a day with keyframed values
+//
+//	Every light has keyframes at hours of the day for its direction or
+//	position and its colors.  The time of day moves on every frame, and
+//	all of the lights are worked out again with SIMD math, but only the
+//	lights whose values changed are written into the shader.  Anything
+//	that was drawn with the old lighting, like the reflection probes, is
+//	only refreshed once a light has moved or changed color by more than a
+//	threshold, instead of on every small step.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ShaderManager.h"
+
+/***********************************************************
+ *  LightAnimator
+ *
+ *  This class contains the keyframes of the scene lights
+ *  and the code for working out their values for a time of
+ *  day.
+ ***********************************************************/
+class LightAnimator
+{
+public:
+	// kinds of lights, which decide the first value of a light
+	enum LIGHT_TYPE
+	{
+		LIGHT_DIRECTIONAL = 0,
+		LIGHT_POINT
+	};
+
+	// values of a light - the direction or position and the ambient,
+	// diffuse and specular colors, each padded to four floats
+	static const int LIGHT_FLOATS = 16;
+
+	// values of a light at an hour of the day
+	struct LIGHT_KEY
+	{
+		float hour;
+		float values[LIGHT_FLOATS];
+	};
+
+	// constructor
+	LightAnimator();
+
+	// check whether the lights are worked out with SIMD instructions
+	static bool IsSimdEnabled();
+
+	// add a light with the passed in shader uniform name, like
+	// "directionalLight" or "pointLights[0]", and get its index
+	int AddLight(int type, const std::string& uniformName);
+	// add a keyframe to a light - the keys of a light are kept in
+	// order of the hour, and the last key blends into the first one
+	void AddKey(int light, float hour, const glm::vec3& vector, const glm::vec3& ambient,
+		const glm::vec3& diffuse, const glm::vec3& specular);
+
+	// set the seconds one day takes to go by
+	void SetDayLength(float seconds) { m_dayLength = seconds; }
+	// set the hour of the day, from 0 up to 24
+	void SetTimeOfDay(float hour);
+	// get the hour of the day
+	float GetTimeOfDay() const { return(m_hour); }
+
+	// move the time of day on, work out every light and write the lights
+	// that changed into the shader
+	void Update(double elapsedSeconds, ShaderManager* pShaderManager);
+	// check whether a light crossed a threshold since the last call, so
+	// anything drawn with the old lighting has to be drawn again
+	bool ConsumeInvalidation();
+
+	// print how many lights were worked out and written
+	void PrintStats() const;
+
+private:
+	// one animated light
+	struct LIGHT
+	{
+		int type;
+		// uniform names of the four values
+		std::string uniformNames[4];
+		std::vector<LIGHT_KEY> keys;
+		// values worked out for this frame, last written into the
+		// shader, and last used to refresh the cached data
+		float current[LIGHT_FLOATS];
+		float written[LIGHT_FLOATS];
+		float reference[LIGHT_FLOATS];
+		bool bWritten;
+	};
+
+	std::vector<LIGHT> m_lights;
+	float m_dayLength;
+	float m_hour;
+	bool m_bInvalidated;
+
+	// work done so far
+	int64_t m_updates;
+	int64_t m_writtenLights;
+	int64_t m_invalidations;
+
+	// work out the values of a light for the time of day
+	void EvaluateLight(LIGHT& light) const;
+	// check whether a light moved or changed color past the thresholds
+	bool IsPastThreshold(const LIGHT& light) const;
+	// write the values of a light into the shader
+	void WriteLight(const LIGHT& light, ShaderManager* pShaderManager) const;
+	// get the largest difference between two runs of values, with a
+	// count that is a multiple of four
+	static float MaxDifference(const float* pLeft, const float* pRight, int count);
+};
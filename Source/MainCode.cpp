@@ -9,6 +9,7 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -22,6 +23,24 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "WorldStreamer.h"
+#include "JobSystem.h"
+#include "ProgramBuilder.h"
+#include "TraceLog.h"
+#include "AssetCache.h"
+#include "AssetPack.h"
+#include "TexturePack.h"
+#include "AssetBenchmark.h"
+#include "TextureBudget.h"
+#include "SamplerCache.h"
+#include "BindlessTextures.h"
+#include "GpuCulling.h"
+#include "ProceduralShapes.h"
+#include "ViewSet.h"
+#include "ReflectionProbes.h"
+#include "AnimationSystem.h"
+#include "PhysicsWorld.h"
+#include "SpatialQuery.h"
 
 // Namespace for declaring global variables
 namespace
@@ -38,6 +57,29 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// world streamer object for streaming large scenes around the camera
+	WorldStreamer* g_WorldStreamer = nullptr;
+	// job system object for running the startup tasks
+	JobSystem* g_JobSystem = nullptr;
+	// asset cache object for reusing processed assets between runs
+	AssetCache* g_AssetCache = nullptr;
+
+	// size limit of the asset cache directory
+	const uint64_t g_AssetCacheBytes = 256ULL * 1024 * 1024;
+	// number of timed runs for every format in the asset benchmarks
+	const int g_BenchmarkRuns = 5;
+	// tracks and frames sampled by the animation benchmark
+	const int g_BenchmarkTracks = 10000;
+	const int g_BenchmarkFrames = 600;
+	// bodies and fixed steps run by the physics benchmark
+	const int g_BenchmarkBodies = 10000;
+	const int g_BenchmarkSteps = 300;
+	// colliders and queries run by the spatial query benchmark
+	const int g_BenchmarkColliders = 100000;
+	const int g_BenchmarkQueries = 100000;
+
+	// time budget per frame for startup tasks once the scene is drawn
+	const double g_StartupTaskBudget = 4.0;
 }
 
 // Function declarations - all functions that are called manually
@@ -54,12 +96,288 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// directory of a streamed world to open with the scene
+	const char* worldDirectory = NULL;
+	// pre-baked impostor atlas to load instead of baking at startup
+	const char* impostorFile = NULL;
+	// impostor atlas file to bake into before exiting
+	const char* bakeImpostorFile = NULL;
+	// file the startup timeline is written to
+	const char* traceFile = "startup_trace.json";
+	// directory of the asset cache, or NULL to process every asset
+	const char* cacheDirectory = "asset_cache";
+	// pack of compressed texture pixels to load the textures from
+	const char* texturePackFile = NULL;
+	// quality tier and memory budget in megabytes of the textures, or
+	// -1 to keep the scene defaults
+	int textureQuality = -1;
+	int textureBudgetMegabytes = -1;
+	// filter of the scene textures, or -1 to keep the scene default
+	int textureFilter = -1;
+	// whether the scene textures may be sampled through bindless handles
+	bool bBindlessTextures = true;
+	// whether the shared mesh buffers are compacted while running
+	bool bCompactMeshes = false;
+	// whether the compound objects are culled in a compute shader
+	bool bGpuCulling = false;
+	// whether hidden compound objects are skipped with occlusion queries
+	bool bOcclusionQueries = false;
+	// whether the round shapes are generated in the vertex shader
+	bool bProceduralShapes = false;
+	// whether the generated shapes are smoothed by tessellation shaders
+	bool bTessellatedShapes = false;
+	// layout of several views drawn together, from ViewSet::VIEW_LAYOUT
+	int multiViewLayout = ViewSet::LAYOUT_NONE;
+	// whether the views take turns between one pass and a pass per view
+	bool bBenchmarkMultiView = false;
+	// whether metal and glass reflect the scene from cubemap probes
+	bool bReflectionProbes = false;
+	// most probe cubemap faces that are captured in one frame
+	int probeFacesPerFrame = 1;
+	// whether the creases are darkened with screen-space ambient occlusion
+	bool bAmbientOcclusion = false;
+	// whether the lights go through a day, how many seconds the day
+	// takes and the hour it starts at
+	bool bDayCycle = false;
+	float dayLengthSeconds = 240.0f;
+	float startHour = 7.0f;
+	// whether scene objects move along their animation tracks
+	bool bAnimateObjects = false;
+	// whether the can and the apple are simulated as rigid bodies
+	bool bPhysics = false;
+	// whether the camera collides with the scene, and whether it walks
+	// over the ground
+	bool bCameraCollision = false;
+	bool bCameraWalk = false;
+	// whether the GPU time of the solid scene geometry is measured, and
+	// whether the frames take turns between the two vertex transforms
+	bool bTimeScene = false;
+	bool bBenchmarkTransforms = false;
+	// value returned when the application exits
+	int exitCode = EXIT_SUCCESS;
+
+	// parse the command line options
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--cook-world") == 0) && (i + 1 < argc))
+		{
+			// write the demo world and exit - no window is needed for this
+			bool bCooked = WorldStreamer::CookDemoWorld(argv[i + 1], 8, 8, 40.0f);
+			return(bCooked ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		if ((strcmp(argv[i], "--pack-textures") == 0) && (i + 2 < argc))
+		{
+			// write the scene textures into a pack with the passed in
+			// compression mode (none, lz4 or zstd) and exit
+			int compression = AssetPack::FindCompression(argv[i + 2]);
+			if (compression < 0)
+			{
+				std::cout << "Unknown compression mode:" << argv[i + 2] << std::endl;
+				return(EXIT_FAILURE);
+			}
+			std::vector<TexturePack::TEXTURE_SOURCE> sources;
+			SceneManager::GetSceneTextureSources(sources);
+			bool bPacked = TexturePack::WritePack(argv[i + 1], sources, compression, TexturePack::GetDefaultLevel(compression));
+			return(bPacked ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		if (strcmp(argv[i], "--bench-asset-pack") == 0)
+		{
+			// compare the texture load times of every pack format and exit
+			std::vector<TexturePack::TEXTURE_SOURCE> sources;
+			SceneManager::GetSceneTextureSources(sources);
+			bool bMeasured = AssetBenchmark::RunAssetPackBenchmark(sources, g_BenchmarkRuns);
+			return(bMeasured ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		if (strcmp(argv[i], "--bench-decoders") == 0)
+		{
+			// compare the image decoders on the scene textures and exit
+			std::vector<TexturePack::TEXTURE_SOURCE> sources;
+			SceneManager::GetSceneTextureSources(sources);
+			bool bMeasured = AssetBenchmark::RunDecoderBenchmark(sources, g_BenchmarkRuns);
+			return(bMeasured ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		if (strcmp(argv[i], "--bench-animation") == 0)
+		{
+			// time the sampling of many animation tracks and exit
+			bool bMeasured = AnimationSystem::RunBenchmark(g_BenchmarkTracks, g_BenchmarkFrames);
+			return(bMeasured ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		if (strcmp(argv[i], "--bench-physics") == 0)
+		{
+			// time the steps of a pile of rigid bodies and exit
+			bool bMeasured = PhysicsWorld::RunBenchmark(g_BenchmarkBodies, g_BenchmarkSteps);
+			return(bMeasured ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		if (strcmp(argv[i], "--bench-spatial-query") == 0)
+		{
+			// time the camera queries against a large field and exit
+			bool bMeasured = SpatialQuery::RunBenchmark(g_BenchmarkColliders, g_BenchmarkQueries);
+			return(bMeasured ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		if ((strcmp(argv[i], "--texture-quality") == 0) && (i + 1 < argc))
+		{
+			textureQuality = TextureBudget::FindQuality(argv[++i]);
+			if (textureQuality < 0)
+			{
+				std::cout << "Texture quality must be low, medium, high or full" << std::endl;
+				return(EXIT_FAILURE);
+			}
+		}
+		if ((strcmp(argv[i], "--texture-filter") == 0) && (i + 1 < argc))
+		{
+			textureFilter = SamplerCache::FindFilter(argv[++i]);
+			if (textureFilter < 0)
+			{
+				std::cout << "Texture filter must be linear, trilinear or aniso" << std::endl;
+				return(EXIT_FAILURE);
+			}
+		}
+		if ((strcmp(argv[i], "--texture-budget") == 0) && (i + 1 < argc))
+		{
+			// zero megabytes turns the budget off
+			textureBudgetMegabytes = atoi(argv[++i]);
+			if (textureBudgetMegabytes < 0)
+			{
+				std::cout << "Texture budget must be zero or more megabytes" << std::endl;
+				return(EXIT_FAILURE);
+			}
+		}
+		if (strcmp(argv[i], "--compact-meshes") == 0)
+		{
+			bCompactMeshes = true;
+		}
+		if (strcmp(argv[i], "--no-bindless") == 0)
+		{
+			bBindlessTextures = false;
+		}
+		if (strcmp(argv[i], "--gpu-culling") == 0)
+		{
+			bGpuCulling = true;
+		}
+		if (strcmp(argv[i], "--occlusion-queries") == 0)
+		{
+			bOcclusionQueries = true;
+		}
+		if (strcmp(argv[i], "--procedural-shapes") == 0)
+		{
+			bProceduralShapes = true;
+		}
+		if (strcmp(argv[i], "--tessellation") == 0)
+		{
+			bTessellatedShapes = true;
+		}
+		if (strcmp(argv[i], "--multi-view") == 0)
+		{
+			multiViewLayout = ViewSet::LAYOUT_REVIEW;
+		}
+		if (strcmp(argv[i], "--stereo") == 0)
+		{
+			multiViewLayout = ViewSet::LAYOUT_STEREO;
+		}
+		if (strcmp(argv[i], "--bench-multi-view") == 0)
+		{
+			bBenchmarkMultiView = true;
+		}
+		if (strcmp(argv[i], "--reflection-probes") == 0)
+		{
+			bReflectionProbes = true;
+		}
+		if ((strcmp(argv[i], "--probe-faces-per-frame") == 0) && (i + 1 < argc))
+		{
+			bReflectionProbes = true;
+			probeFacesPerFrame = atoi(argv[++i]);
+		}
+		if (strcmp(argv[i], "--ambient-occlusion") == 0)
+		{
+			bAmbientOcclusion = true;
+		}
+		if (strcmp(argv[i], "--animate-objects") == 0)
+		{
+			bAnimateObjects = true;
+		}
+		if (strcmp(argv[i], "--physics") == 0)
+		{
+			bPhysics = true;
+		}
+		if (strcmp(argv[i], "--time-scene") == 0)
+		{
+			bTimeScene = true;
+		}
+		if (strcmp(argv[i], "--bench-transforms") == 0)
+		{
+			bTimeScene = true;
+			bBenchmarkTransforms = true;
+		}
+		if (strcmp(argv[i], "--camera-collision") == 0)
+		{
+			bCameraCollision = true;
+		}
+		if (strcmp(argv[i], "--camera-walk") == 0)
+		{
+			bCameraCollision = true;
+			bCameraWalk = true;
+		}
+		if (strcmp(argv[i], "--day-cycle") == 0)
+		{
+			bDayCycle = true;
+		}
+		if ((strcmp(argv[i], "--day-length") == 0) && (i + 1 < argc))
+		{
+			bDayCycle = true;
+			dayLengthSeconds = (float)atof(argv[++i]);
+		}
+		if ((strcmp(argv[i], "--time-of-day") == 0) && (i + 1 < argc))
+		{
+			bDayCycle = true;
+			startHour = (float)atof(argv[++i]);
+		}
+		if ((strcmp(argv[i], "--texture-pack") == 0) && (i + 1 < argc))
+		{
+			texturePackFile = argv[++i];
+		}
+		if ((strcmp(argv[i], "--world") == 0) && (i + 1 < argc))
+		{
+			worldDirectory = argv[++i];
+		}
+		if ((strcmp(argv[i], "--impostors") == 0) && (i + 1 < argc))
+		{
+			impostorFile = argv[++i];
+		}
+		if ((strcmp(argv[i], "--bake-impostors") == 0) && (i + 1 < argc))
+		{
+			bakeImpostorFile = argv[++i];
+		}
+		if ((strcmp(argv[i], "--trace") == 0) && (i + 1 < argc))
+		{
+			traceFile = argv[++i];
+		}
+		if ((strcmp(argv[i], "--cache") == 0) && (i + 1 < argc))
+		{
+			cacheDirectory = argv[++i];
+		}
+		if (strcmp(argv[i], "--no-cache") == 0)
+		{
+			cacheDirectory = NULL;
+		}
+	}
+
+	// record the startup timeline from the very beginning
+	TraceLog::Start();
+	TraceLog::SetThreadName("main");
+	int64_t startupTime = TraceLog::GetMicroseconds();
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
 
+	// baking only needs an OpenGL context, so keep the window hidden
+	if (NULL != bakeImpostorFile)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
 	// try to create a new shader manager object
 	g_ShaderManager = new ShaderManager();
 	// try to create a new view manager object
@@ -75,20 +393,192 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
+	TraceLog::AddEvent("create window", "startup", startupTime, TraceLog::GetMicroseconds() - startupTime);
+
+	// open the cache of processed assets shared with earlier runs
+	if (NULL != cacheDirectory)
+	{
+		g_AssetCache = new AssetCache(cacheDirectory, g_AssetCacheBytes);
+	}
+
+	// start the worker threads for the startup tasks
+	g_JobSystem = new JobSystem();
+	ProgramBuilder::EnableParallelCompile();
+
+	// load the shader code from the external GLSL files - the driver
+	// compiles it while the rest of the scene is prepared
+	// textures are sampled bindless whenever the driver allows it
+	bBindlessTextures = bBindlessTextures && BindlessTextures::IsSupported();
+	std::string sceneDefines = bBindlessTextures ? BindlessTextures::GetShaderDefine() : "";
+	// the benchmark shows the design review views unless stereo is on
+	if ((bBenchmarkMultiView) && (multiViewLayout == ViewSet::LAYOUT_NONE))
+	{
+		multiViewLayout = ViewSet::LAYOUT_REVIEW;
+	}
+	// the transform benchmark times the single view without tessellation,
+	// which are the draws that transform in the vertex shader
+	if ((bBenchmarkTransforms) && ((multiViewLayout != ViewSet::LAYOUT_NONE) || (bTessellatedShapes)))
+	{
+		std::cout << "The transform benchmark turns off multiple views and tessellation" << std::endl;
+		multiViewLayout = ViewSet::LAYOUT_NONE;
+		bBenchmarkMultiView = false;
+		bTessellatedShapes = false;
+	}
+	if (bBenchmarkTransforms)
+	{
+		sceneDefines += std::string("\n") + SceneManager::GetTransformBenchmarkDefine();
+	}
+	bool bMultiView = (multiViewLayout != ViewSet::LAYOUT_NONE);
+	// the views share their own culling and draw every part in full
+	// detail, so they replace the other ways of drawing the objects
+	if ((bMultiView) && ((bGpuCulling) || (bOcclusionQueries) || (bTessellatedShapes)))
+	{
+		std::cout << "Multiple views turn off GPU culling, occlusion queries and tessellation" << std::endl;
+		bGpuCulling = false;
+		bOcclusionQueries = false;
+		bTessellatedShapes = false;
+	}
+	if (bMultiView)
+	{
+		sceneDefines += std::string("\n") + ViewSet::GetShaderDefine();
+	}
+	if (bReflectionProbes)
+	{
+		sceneDefines += std::string("\n") + ReflectionProbes::GetShaderDefine();
+	}
+	// culled objects are drawn together, so they sample bindless
+	bGpuCulling = bGpuCulling && bBindlessTextures && GpuCulling::IsSupported();
+	if (bGpuCulling)
+	{
+		sceneDefines += std::string("\n") + GpuCulling::GetShaderDefine();
+	}
+	// the tessellation shaders smooth the generated shapes, so they
+	// turn the generated shapes on as well
+	bTessellatedShapes = bTessellatedShapes && ProceduralShapes::IsTessellationSupported();
+	bProceduralShapes = bProceduralShapes || bTessellatedShapes;
+	if (bProceduralShapes)
+	{
+		sceneDefines += std::string("\n") + ProceduralShapes::GetShaderDefine();
+	}
+	if (bTessellatedShapes)
+	{
+		sceneDefines += std::string("\n") + ProceduralShapes::GetTessellationDefine();
+	}
+	ProgramBuilder::PENDING_PROGRAM sceneProgram;
+	int readShaderTask = g_JobSystem->AddTask("read scene shaders",
+		[&sceneProgram, &sceneDefines, bTessellatedShapes]() {
+			ProgramBuilder::LoadProgramSources(
+				"shaders/vertexShader.glsl",
+				"shaders/fragmentShader.glsl",
+				sceneDefines, sceneProgram);
+			if (bTessellatedShapes)
+			{
+				ProgramBuilder::LoadTessellationSources(
+					"shaders/tessControlShader.glsl",
+					"shaders/tessEvaluationShader.glsl",
+					sceneDefines, sceneProgram);
+			}
+		});
+	int compileShaderTask = g_JobSystem->AddTask("compile scene shaders",
+		[&sceneProgram]() { ProgramBuilder::CompileProgram(sceneProgram, g_AssetCache); },
+		std::vector<int>(1, readShaderTask), true);
+	int shaderTask = g_JobSystem->AddPollTask("link scene shaders",
+		[&sceneProgram]() {
+			if (ProgramBuilder::IsProgramReady(sceneProgram) == false)
+			{
+				return(false);
+			}
+			ProgramBuilder::FinishProgram(sceneProgram, g_ShaderManager, g_AssetCache);
+			g_ShaderManager->use();
+			return(true);
+		},
+		std::vector<int>(1, compileShaderTask));
 
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	g_SceneManager->SetViewManager(g_ViewManager);
+	g_SceneManager->SetAssetCache(g_AssetCache);
+	if (textureQuality >= 0)
+	{
+		g_SceneManager->SetTextureQuality(textureQuality);
+	}
+	if (textureBudgetMegabytes >= 0)
+	{
+		g_SceneManager->SetTextureBudget((uint64_t)textureBudgetMegabytes * 1024 * 1024);
+	}
+	if (textureFilter >= 0)
+	{
+		g_SceneManager->SetTextureFilter(textureFilter);
+	}
+	g_SceneManager->SetBindlessTextures(bBindlessTextures);
+	g_SceneManager->SetGpuCulling(bGpuCulling);
+	g_SceneManager->SetOcclusionQueries(bOcclusionQueries);
+	g_SceneManager->SetProceduralShapes(bProceduralShapes);
+	g_SceneManager->SetTessellatedShapes(bTessellatedShapes);
+	g_SceneManager->SetMultiView(multiViewLayout, bBenchmarkMultiView);
+	g_SceneManager->SetReflectionProbes(bReflectionProbes, probeFacesPerFrame);
+	g_SceneManager->SetAmbientOcclusion(bAmbientOcclusion);
+	g_SceneManager->SetDayCycle(bDayCycle, dayLengthSeconds, startHour);
+	g_SceneManager->SetObjectAnimation(bAnimateObjects);
+	g_SceneManager->SetPhysics(bPhysics);
+	g_SceneManager->SetSpatialQuery(bCameraCollision);
+	if (bCameraCollision)
+	{
+		g_ViewManager->SetCameraCollision(g_SceneManager->GetSpatialQuery(), bCameraWalk);
+	}
+	g_SceneManager->SetMeshCompaction(bCompactMeshes);
+	g_SceneManager->SetSceneTiming(bTimeScene, bBenchmarkTransforms);
+	if (NULL != texturePackFile)
+	{
+		g_SceneManager->SetTexturePack(texturePackFile);
+	}
+	if ((NULL != impostorFile) && (NULL == bakeImpostorFile))
+	{
+		g_SceneManager->SetImpostorFile(impostorFile);
+	}
+	g_SceneManager->PrepareScene(g_JobSystem, shaderTask);
+
+	// save the baked impostors and skip the render loop
+	if (NULL != bakeImpostorFile)
+	{
+		g_JobSystem->WaitForAll();
+		if (g_SceneManager->SaveImpostors(bakeImpostorFile) == false)
+		{
+			exitCode = EXIT_FAILURE;
+		}
+		glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+	}
+
+	// open the streamed world if one was requested
+	if (NULL != worldDirectory)
+	{
+		g_WorldStreamer = new WorldStreamer(g_SceneManager->GetMeshLibrary());
+		if (g_WorldStreamer->OpenWorld(worldDirectory, WorldStreamer::DefaultSettings()))
+		{
+			g_SceneManager->SetWorldStreamer(g_WorldStreamer);
+		}
+	}
+
+	// whether the first frame of the scene has been drawn
+	bool bFirstFrameShown = false;
+	// whether the startup timeline has been written
+	bool bStartupTraced = false;
+	// whether the ambient occlusion key was down in the last frame
+	bool bOcclusionKeyDown = false;
+	// whether the push key was down in the last frame
+	bool bPushKeyDown = false;
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
+		// run the startup tasks that need the OpenGL context - until the
+		// scene can be drawn there is nothing else to spend the frame on
+		if (g_JobSystem->IsIdle() == false)
+		{
+			g_JobSystem->RunMainThreadTasks(g_SceneManager->IsSceneReady() ? g_StartupTaskBudget : 100.0);
+		}
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -96,13 +586,53 @@ int main(int argc, char* argv[])
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		if (g_SceneManager->IsSceneReady())
+		{
+			// convert from 3D object space to 2D view
+			g_ViewManager->PrepareSceneView();
+
+			// stream the world cells around the camera
+			if (NULL != g_WorldStreamer)
+			{
+				g_WorldStreamer->Update(g_ViewManager->GetCamera()->Position, glfwGetTime());
+			}
+
+			// refresh the 3D scene
+			g_SceneManager->RenderScene();
+
+			if (bFirstFrameShown == false)
+			{
+				TraceLog::AddEvent("first frame", "startup", startupTime, TraceLog::GetMicroseconds() - startupTime);
+				std::cout << "INFO: First frame after " << ((TraceLog::GetMicroseconds() - startupTime) / 1000) << " ms" << std::endl;
+				bFirstFrameShown = true;
+			}
+		}
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+		// write the startup timeline once all of the startup tasks are done
+		if ((bFirstFrameShown) && (bStartupTraced == false) && (g_JobSystem->IsIdle()))
+		{
+			TraceLog::AddEvent("startup", "startup", startupTime, TraceLog::GetMicroseconds() - startupTime);
+			TraceLog::WriteToFile(traceFile);
+			bStartupTraced = true;
+		}
 
 
+		// the K key switches the ambient occlusion on and off, once per press
+		bool bOcclusionKey = (glfwGetKey(g_Window, GLFW_KEY_K) == GLFW_PRESS);
+		if ((bOcclusionKey) && (bOcclusionKeyDown == false) && (bAmbientOcclusion))
+		{
+			g_SceneManager->SetAmbientOcclusionActive(g_SceneManager->IsAmbientOcclusionActive() == false);
+		}
+		bOcclusionKeyDown = bOcclusionKey;
+
+		// the G key pushes the rigid bodies the way the camera looks
+		bool bPushKey = (glfwGetKey(g_Window, GLFW_KEY_G) == GLFW_PRESS);
+		if ((bPushKey) && (bPushKeyDown == false) && (bPhysics))
+		{
+			g_SceneManager->PushPhysicsObjects(g_ViewManager->GetCamera()->Front);
+		}
+		bPushKeyDown = bPushKey;
+
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
 
@@ -110,9 +640,28 @@ int main(int argc, char* argv[])
 		glfwPollEvents();
 	}
 
-	// clear the allocated manager objects from memory
+	// clear the allocated manager objects from memory - the job system
+	// goes first, since its tasks use the other manager objects
+	if (NULL != g_JobSystem)
+	{
+		delete g_JobSystem;
+		g_JobSystem = NULL;
+	}
+	if (NULL != g_AssetCache)
+	{
+		g_AssetCache->PrintStats();
+		delete g_AssetCache;
+		g_AssetCache = NULL;
+	}
+	if (NULL != g_WorldStreamer)
+	{
+		g_WorldStreamer->PrintStats();
+		delete g_WorldStreamer;
+		g_WorldStreamer = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
+		g_SceneManager->PrintStats();
 		delete g_SceneManager;
 		g_SceneManager = NULL;
 	}
@@ -127,8 +676,8 @@ int main(int argc, char* argv[])
 		g_ShaderManager = NULL;
 	}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	// Terminates the program
+	exit(exitCode); 
 }
 
 /***********************************************************
@@ -0,0 +1,373 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcooker.cpp
+// ============
+// generate the vertex data for the basic shapes on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshCooker.h"
+#include "AssetPack.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const float g_Pi = 3.14159265358979f;
+
+	// tessellation used for the round shapes
+	const int g_RoundSlices = 36;
+	const int g_SphereStacks = 18;
+	const int g_TorusTubeSlices = 18;
+
+	// the top of the tapered cylinder is half the width of the bottom
+	const float g_TaperedTopRadius = 0.5f;
+	// ring sizes for the torus
+	const float g_TorusMainRadius = 1.0f;
+	const float g_TorusTubeRadius = 0.2f;
+
+	// version of the generated shapes - change this whenever the
+	// generation code changes, so that cached shapes are cooked again
+	const int g_CookerVersion = 1;
+}
+
+/***********************************************************
+ *  CookShape()
+ *
+ *  This method is used for generating the mesh data for one
+ *  of the basic shapes.  False is returned for shapes that
+ *  cannot be generated.
+ ***********************************************************/
+bool MeshCooker::CookShape(int shape, MESH_DATA& meshData)
+{
+	meshData.vertices.clear();
+	meshData.indices.clear();
+
+	switch (shape)
+	{
+	case SHAPE_BOX:
+		CookBox(meshData);
+		break;
+	case SHAPE_CONE:
+		CookCylinder(meshData, 1.0f, 0.0f, false, g_RoundSlices);
+		break;
+	case SHAPE_CYLINDER:
+		CookCylinder(meshData, 1.0f, 1.0f, true, g_RoundSlices);
+		break;
+	case SHAPE_PLANE:
+		CookPlane(meshData);
+		break;
+	case SHAPE_SPHERE:
+		CookSphere(meshData, g_SphereStacks, g_RoundSlices);
+		break;
+	case SHAPE_TAPERED_CYLINDER:
+		CookCylinder(meshData, 1.0f, g_TaperedTopRadius, true, g_RoundSlices);
+		break;
+	case SHAPE_TORUS:
+		CookTorus(meshData, g_TorusMainRadius, g_TorusTubeRadius, g_RoundSlices, g_TorusTubeSlices);
+		break;
+	default:
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetShapeParameters()
+ *
+ *  This method is used for getting a string of everything
+ *  that the cooked data of a shape depends on.  The shapes
+ *  are generated rather than read from a file, so this takes
+ *  the place of the source bytes in the cache key.
+ ***********************************************************/
+std::string MeshCooker::GetShapeParameters(int shape)
+{
+	return("shape=" + std::to_string(shape) +
+		";version=" + std::to_string(g_CookerVersion) +
+		";slices=" + std::to_string(g_RoundSlices) +
+		";stacks=" + std::to_string(g_SphereStacks) +
+		";tube=" + std::to_string(g_TorusTubeSlices));
+}
+
+/***********************************************************
+ *  SerializeMesh()
+ *
+ *  This method is used for packing the vertices and indices
+ *  of a mesh into bytes.
+ ***********************************************************/
+void MeshCooker::SerializeMesh(const MESH_DATA& meshData, std::vector<unsigned char>& data)
+{
+	ChunkWriter writer;
+	writer.Write((uint32_t)meshData.vertices.size());
+	writer.Write((uint32_t)meshData.indices.size());
+	writer.WriteBytes(meshData.vertices.data(), meshData.vertices.size() * sizeof(MESH_VERTEX));
+	writer.WriteBytes(meshData.indices.data(), meshData.indices.size() * sizeof(uint32_t));
+	data = writer.GetData();
+}
+
+/***********************************************************
+ *  DeserializeMesh()
+ *
+ *  This method is used for unpacking mesh data that was
+ *  packed by SerializeMesh().
+ ***********************************************************/
+bool MeshCooker::DeserializeMesh(const unsigned char* pData, size_t size, MESH_DATA& meshData)
+{
+	ChunkReader reader(pData, size);
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	if ((reader.Read(vertexCount) == false) ||
+		(reader.Read(indexCount) == false) ||
+		(reader.GetRemaining() != ((uint64_t)vertexCount * sizeof(MESH_VERTEX)) + ((uint64_t)indexCount * sizeof(uint32_t))))
+	{
+		return(false);
+	}
+
+	meshData.vertices.resize(vertexCount);
+	meshData.indices.resize(indexCount);
+	return((reader.ReadBytes(meshData.vertices.data(), vertexCount * sizeof(MESH_VERTEX))) &&
+		(reader.ReadBytes(meshData.indices.data(), indexCount * sizeof(uint32_t))));
+}
+
+/***********************************************************
+ *  AddVertex()
+ *
+ *  This method is used for appending a vertex to the mesh
+ *  data and returning its index.
+ ***********************************************************/
+uint32_t MeshCooker::AddVertex(MESH_DATA& meshData, glm::vec3 position, glm::vec3 normal, glm::vec2 textureCoordinate)
+{
+	MESH_VERTEX vertex;
+	vertex.position = position;
+	vertex.normal = normal;
+	vertex.textureCoordinate = textureCoordinate;
+	meshData.vertices.push_back(vertex);
+	return((uint32_t)(meshData.vertices.size() - 1));
+}
+
+/***********************************************************
+ *  CookBox()
+ *
+ *  This method is used for generating a unit box centered on
+ *  the origin.  Every face has its own vertices, so that the
+ *  whole texture is mapped onto each face.
+ ***********************************************************/
+void MeshCooker::CookBox(MESH_DATA& meshData)
+{
+	// outward normal, and the right and up directions of every face
+	const glm::vec3 faces[6][3] =
+	{
+		{ glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+		{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) }
+	};
+
+	for (int f = 0; f < 6; f++)
+	{
+		glm::vec3 normal = faces[f][0];
+		glm::vec3 right = faces[f][1] * 0.5f;
+		glm::vec3 up = faces[f][2] * 0.5f;
+		glm::vec3 center = normal * 0.5f;
+
+		uint32_t first = AddVertex(meshData, center - right - up, normal, glm::vec2(0.0f, 0.0f));
+		AddVertex(meshData, center + right - up, normal, glm::vec2(1.0f, 0.0f));
+		AddVertex(meshData, center + right + up, normal, glm::vec2(1.0f, 1.0f));
+		AddVertex(meshData, center - right + up, normal, glm::vec2(0.0f, 1.0f));
+
+		meshData.indices.push_back(first);
+		meshData.indices.push_back(first + 1);
+		meshData.indices.push_back(first + 2);
+		meshData.indices.push_back(first);
+		meshData.indices.push_back(first + 2);
+		meshData.indices.push_back(first + 3);
+	}
+}
+
+/***********************************************************
+ *  CookPlane()
+ *
+ *  This method is used for generating a 2x2 plane on the XZ
+ *  plane that faces up.
+ ***********************************************************/
+void MeshCooker::CookPlane(MESH_DATA& meshData)
+{
+	glm::vec3 normal(0.0f, 1.0f, 0.0f);
+
+	uint32_t first = AddVertex(meshData, glm::vec3(-1.0f, 0.0f, 1.0f), normal, glm::vec2(0.0f, 0.0f));
+	AddVertex(meshData, glm::vec3(1.0f, 0.0f, 1.0f), normal, glm::vec2(1.0f, 0.0f));
+	AddVertex(meshData, glm::vec3(1.0f, 0.0f, -1.0f), normal, glm::vec2(1.0f, 1.0f));
+	AddVertex(meshData, glm::vec3(-1.0f, 0.0f, -1.0f), normal, glm::vec2(0.0f, 1.0f));
+
+	meshData.indices.push_back(first);
+	meshData.indices.push_back(first + 1);
+	meshData.indices.push_back(first + 2);
+	meshData.indices.push_back(first);
+	meshData.indices.push_back(first + 2);
+	meshData.indices.push_back(first + 3);
+}
+
+/***********************************************************
+ *  AddDisc()
+ *
+ *  This method is used for adding a flat disc that caps the
+ *  top or the bottom of a cylinder.
+ ***********************************************************/
+void MeshCooker::AddDisc(MESH_DATA& meshData, float radius, float height, bool bFacingUp, int slices)
+{
+	glm::vec3 normal(0.0f, bFacingUp ? 1.0f : -1.0f, 0.0f);
+	uint32_t center = AddVertex(meshData, glm::vec3(0.0f, height, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+
+	for (int i = 0; i <= slices; i++)
+	{
+		float angle = (2.0f * g_Pi * i) / slices;
+		float x = cosf(angle);
+		float z = sinf(angle);
+		AddVertex(meshData, glm::vec3(x * radius, height, z * radius), normal, glm::vec2(0.5f + (0.5f * x), 0.5f + (0.5f * z)));
+	}
+
+	for (int i = 0; i < slices; i++)
+	{
+		uint32_t current = center + 1 + i;
+		meshData.indices.push_back(center);
+		if (bFacingUp)
+		{
+			meshData.indices.push_back(current + 1);
+			meshData.indices.push_back(current);
+		}
+		else
+		{
+			meshData.indices.push_back(current);
+			meshData.indices.push_back(current + 1);
+		}
+	}
+}
+
+/***********************************************************
+ *  CookCylinder()
+ *
+ *  This method is used for generating a cylinder that sits
+ *  on the origin and is 1 unit tall.  Different top and
+ *  bottom radii make tapered cylinders, and a top radius of
+ *  zero makes a cone.
+ ***********************************************************/
+void MeshCooker::CookCylinder(MESH_DATA& meshData, float bottomRadius, float topRadius, bool bDrawTop, int slices)
+{
+	// the side normals lean up as the side narrows
+	float slope = bottomRadius - topRadius;
+
+	uint32_t first = (uint32_t)meshData.vertices.size();
+	for (int i = 0; i <= slices; i++)
+	{
+		float angle = (2.0f * g_Pi * i) / slices;
+		float x = cosf(angle);
+		float z = sinf(angle);
+		float u = (float)i / slices;
+		glm::vec3 normal = glm::normalize(glm::vec3(x, slope, z));
+
+		AddVertex(meshData, glm::vec3(x * bottomRadius, 0.0f, z * bottomRadius), normal, glm::vec2(u, 0.0f));
+		AddVertex(meshData, glm::vec3(x * topRadius, 1.0f, z * topRadius), normal, glm::vec2(u, 1.0f));
+	}
+
+	for (int i = 0; i < slices; i++)
+	{
+		uint32_t bottom0 = first + (i * 2);
+		uint32_t top0 = bottom0 + 1;
+		uint32_t bottom1 = bottom0 + 2;
+		uint32_t top1 = bottom0 + 3;
+
+		meshData.indices.push_back(bottom0);
+		meshData.indices.push_back(top0);
+		meshData.indices.push_back(top1);
+		meshData.indices.push_back(bottom0);
+		meshData.indices.push_back(top1);
+		meshData.indices.push_back(bottom1);
+	}
+
+	AddDisc(meshData, bottomRadius, 0.0f, false, slices);
+	if ((bDrawTop) && (topRadius > 0.0f))
+	{
+		AddDisc(meshData, topRadius, 1.0f, true, slices);
+	}
+}
+
+/***********************************************************
+ *  CookSphere()
+ *
+ *  This method is used for generating a unit radius sphere
+ *  centered on the origin.
+ ***********************************************************/
+void MeshCooker::CookSphere(MESH_DATA& meshData, int stacks, int slices)
+{
+	uint32_t first = (uint32_t)meshData.vertices.size();
+	for (int stack = 0; stack <= stacks; stack++)
+	{
+		float theta = (g_Pi * stack) / stacks;
+		for (int slice = 0; slice <= slices; slice++)
+		{
+			float phi = (2.0f * g_Pi * slice) / slices;
+			glm::vec3 normal(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+			AddVertex(meshData, normal, normal, glm::vec2((float)slice / slices, 1.0f - ((float)stack / stacks)));
+		}
+	}
+
+	uint32_t rowLength = (uint32_t)slices + 1;
+	for (int stack = 0; stack < stacks; stack++)
+	{
+		for (int slice = 0; slice < slices; slice++)
+		{
+			uint32_t upper0 = first + (stack * rowLength) + slice;
+			uint32_t lower0 = upper0 + rowLength;
+
+			meshData.indices.push_back(lower0);
+			meshData.indices.push_back(upper0);
+			meshData.indices.push_back(upper0 + 1);
+			meshData.indices.push_back(lower0);
+			meshData.indices.push_back(upper0 + 1);
+			meshData.indices.push_back(lower0 + 1);
+		}
+	}
+}
+
+/***********************************************************
+ *  CookTorus()
+ *
+ *  This method is used for generating a torus centered on
+ *  the origin, with the ring lying on the XY plane.
+ ***********************************************************/
+void MeshCooker::CookTorus(MESH_DATA& meshData, float mainRadius, float tubeRadius, int mainSlices, int tubeSlices)
+{
+	uint32_t first = (uint32_t)meshData.vertices.size();
+	for (int i = 0; i <= mainSlices; i++)
+	{
+		float mainAngle = (2.0f * g_Pi * i) / mainSlices;
+		glm::vec3 ringDirection(cosf(mainAngle), sinf(mainAngle), 0.0f);
+
+		for (int j = 0; j <= tubeSlices; j++)
+		{
+			float tubeAngle = (2.0f * g_Pi * j) / tubeSlices;
+			glm::vec3 normal = (ringDirection * cosf(tubeAngle)) + glm::vec3(0.0f, 0.0f, sinf(tubeAngle));
+			glm::vec3 position = (ringDirection * mainRadius) + (normal * tubeRadius);
+			AddVertex(meshData, position, normal, glm::vec2((float)i / mainSlices, (float)j / tubeSlices));
+		}
+	}
+
+	uint32_t rowLength = (uint32_t)tubeSlices + 1;
+	for (int i = 0; i < mainSlices; i++)
+	{
+		for (int j = 0; j < tubeSlices; j++)
+		{
+			uint32_t current = first + (i * rowLength) + j;
+			uint32_t next = current + rowLength;
+
+			meshData.indices.push_back(current);
+			meshData.indices.push_back(next);
+			meshData.indices.push_back(next + 1);
+			meshData.indices.push_back(current);
+			meshData.indices.push_back(next + 1);
+			meshData.indices.push_back(current + 1);
+		}
+	}
+}
@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcooker.h
+// ============
+// generate the vertex data for the basic shapes on the CPU
+//
+//	The generated shapes match the sizes used by the rest of the scene code -
+//	a unit box centered on the origin, a 2x2 plane on the XZ plane, and unit
+//	radius cylinders and cones that sit on the origin and are 1 unit tall.
+//	No OpenGL calls are made, so the shapes can be cooked on any thread and
+//	uploaded with MeshLibrary::CreateMesh() afterwards.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshLibrary.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  MeshCooker
+ *
+ *  This class contains the code for generating the vertex
+ *  and index data of the basic shapes.
+ ***********************************************************/
+class MeshCooker
+{
+public:
+	// generate the mesh data for one of the basic shapes
+	static bool CookShape(int shape, MESH_DATA& meshData);
+
+	static void CookBox(MESH_DATA& meshData);
+	static void CookPlane(MESH_DATA& meshData);
+	static void CookCylinder(MESH_DATA& meshData, float bottomRadius, float topRadius, bool bDrawTop, int slices);
+	static void CookSphere(MESH_DATA& meshData, int stacks, int slices);
+	static void CookTorus(MESH_DATA& meshData, float mainRadius, float tubeRadius, int mainSlices, int tubeSlices);
+
+	// get the parameters that the cooked data of a shape depends on,
+	// for building asset cache keys
+	static std::string GetShapeParameters(int shape);
+	// pack mesh data into bytes for storing in the asset cache
+	static void SerializeMesh(const MESH_DATA& meshData, std::vector<unsigned char>& data);
+	// unpack mesh data stored by SerializeMesh()
+	static bool DeserializeMesh(const unsigned char* pData, size_t size, MESH_DATA& meshData);
+
+private:
+	// add a flat disc facing up or down at the passed in height
+	static void AddDisc(MESH_DATA& meshData, float radius, float height, bool bFacingUp, int slices);
+	// add a vertex and return its index
+	static uint32_t AddVertex(MESH_DATA& meshData, glm::vec3 position, glm::vec3 normal, glm::vec2 textureCoordinate);
+};
@@ -0,0 +1,524 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlibrary.cpp
+// ============
+// manage GPU meshes that are built from vertex data at runtime
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshLibrary.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// starting size of the shared buffers, in vertices and indices
+	const uint32_t g_InitialVertexCount = 64 * 1024;
+	const uint32_t g_InitialIndexCount = 256 * 1024;
+	// compaction waits until this share of the free space is in holes
+	const float g_CompactFragmentation = 0.2f;
+}
+
+/***********************************************************
+ *  MeshLibrary()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshLibrary::MeshLibrary(GpuResourceManager* pResources)
+{
+	m_pResources = pResources;
+	m_vao = GPU_HANDLE();
+	m_drawIndexBuffer = GPU_HANDLE();
+	m_drawIndexCount = 0;
+	m_layoutVersion = 0;
+	m_drawMode = GL_TRIANGLES;
+	m_viewCount = 1;
+
+	m_vertexArena.buffer = GPU_HANDLE();
+	m_vertexArena.elementBytes = sizeof(MESH_VERTEX);
+	m_vertexArena.label = "mesh vertices";
+	m_vertexArena.movedBytes = 0;
+	m_indexArena.buffer = GPU_HANDLE();
+	m_indexArena.elementBytes = sizeof(uint32_t);
+	m_indexArena.label = "mesh indices";
+	m_indexArena.movedBytes = 0;
+}
+
+/***********************************************************
+ *  ~MeshLibrary()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshLibrary::~MeshLibrary()
+{
+	for (int i = 0; i < (int)m_meshes.size(); i++)
+	{
+		DestroyMesh(i);
+	}
+	m_meshes.clear();
+	m_freeMeshIDs.clear();
+	m_pResources->Release(m_vao);
+	m_pResources->Release(m_drawIndexBuffer);
+	m_pResources->Release(m_vertexArena.buffer);
+	m_pResources->Release(m_indexArena.buffer);
+	m_pResources = NULL;
+}
+
+/***********************************************************
+ *  CreateMesh()
+ *
+ *  This method is used for copying vertex and index data
+ *  into ranges of the shared buffers.  The returned ID is
+ *  used for drawing and destroying the mesh, or -1 if the
+ *  data is empty.
+ ***********************************************************/
+int MeshLibrary::CreateMesh(const MESH_DATA& meshData)
+{
+	if ((meshData.vertices.size() == 0) || (meshData.indices.size() == 0))
+	{
+		return(-1);
+	}
+
+	GL_MESH mesh;
+	mesh.nIndices = (GLsizei)meshData.indices.size();
+	mesh.nBytes = GetDataBytes(meshData);
+	mesh.bActive = true;
+	mesh.vertexRange = AllocateRange(m_vertexArena, (uint32_t)meshData.vertices.size());
+	mesh.indexRange = AllocateRange(m_indexArena, (uint32_t)meshData.indices.size());
+	if ((mesh.vertexRange < 0) || (mesh.indexRange < 0))
+	{
+		m_vertexArena.allocator.Free(mesh.vertexRange);
+		m_indexArena.allocator.Free(mesh.indexRange);
+		return(-1);
+	}
+
+	// the copy binding points leave the vertex array state alone
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_pResources->GetName(m_vertexArena.buffer));
+	glBufferSubData(GL_COPY_WRITE_BUFFER,
+		m_vertexArena.allocator.GetOffset(mesh.vertexRange) * sizeof(MESH_VERTEX),
+		meshData.vertices.size() * sizeof(MESH_VERTEX), meshData.vertices.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_pResources->GetName(m_indexArena.buffer));
+	glBufferSubData(GL_COPY_WRITE_BUFFER,
+		m_indexArena.allocator.GetOffset(mesh.indexRange) * sizeof(uint32_t),
+		meshData.indices.size() * sizeof(uint32_t), meshData.indices.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	// reuse a free mesh ID when one is available
+	int meshID = -1;
+	if (m_freeMeshIDs.size() > 0)
+	{
+		meshID = m_freeMeshIDs.back();
+		m_freeMeshIDs.pop_back();
+		m_meshes[meshID] = mesh;
+	}
+	else
+	{
+		meshID = (int)m_meshes.size();
+		m_meshes.push_back(mesh);
+	}
+
+	return(meshID);
+}
+
+/***********************************************************
+ *  DestroyMesh()
+ *
+ *  This method is used for freeing the ranges of the shared
+ *  buffers that belong to a mesh.  Draws that are already
+ *  queued still read the old data, since OpenGL orders the
+ *  later writes into the freed ranges after them.
+ ***********************************************************/
+void MeshLibrary::DestroyMesh(int meshID)
+{
+	if ((meshID < 0) || (meshID >= (int)m_meshes.size()) || (m_meshes[meshID].bActive == false))
+	{
+		return;
+	}
+
+	m_vertexArena.allocator.Free(m_meshes[meshID].vertexRange);
+	m_indexArena.allocator.Free(m_meshes[meshID].indexRange);
+	m_meshes[meshID].bActive = false;
+	m_freeMeshIDs.push_back(meshID);
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing a previously created mesh
+ *  with the currently active shader settings.  The base
+ *  vertex moves the mesh indices to its vertex range.  With
+ *  several views the mesh is instanced once for each view.
+ ***********************************************************/
+void MeshLibrary::DrawMesh(int meshID) const
+{
+	if ((meshID < 0) || (meshID >= (int)m_meshes.size()) || (m_meshes[meshID].bActive == false))
+	{
+		return;
+	}
+
+	const GL_MESH& mesh = m_meshes[meshID];
+	size_t indexOffset = m_indexArena.allocator.GetOffset(mesh.indexRange) * sizeof(uint32_t);
+	GLint baseVertex = (GLint)m_vertexArena.allocator.GetOffset(mesh.vertexRange);
+
+	glBindVertexArray(m_pResources->GetName(m_vao));
+	if (m_viewCount > 1)
+	{
+		glDrawElementsInstancedBaseVertex(m_drawMode, mesh.nIndices, GL_UNSIGNED_INT, (void*)indexOffset, m_viewCount, baseVertex);
+	}
+	else
+	{
+		glDrawElementsBaseVertex(m_drawMode, mesh.nIndices, GL_UNSIGNED_INT, (void*)indexOffset, baseVertex);
+	}
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  GetDrawRange()
+ *
+ *  This method is used for getting the values that draw a
+ *  mesh from the shared buffers, for building indirect draw
+ *  commands.  The first index is counted in indices.
+ ***********************************************************/
+bool MeshLibrary::GetDrawRange(int meshID, GLsizei& nIndices, GLuint& firstIndex, GLint& baseVertex) const
+{
+	if ((meshID < 0) || (meshID >= (int)m_meshes.size()) || (m_meshes[meshID].bActive == false))
+	{
+		return(false);
+	}
+
+	const GL_MESH& mesh = m_meshes[meshID];
+	nIndices = mesh.nIndices;
+	firstIndex = (GLuint)m_indexArena.allocator.GetOffset(mesh.indexRange);
+	baseVertex = (GLint)m_vertexArena.allocator.GetOffset(mesh.vertexRange);
+	return(true);
+}
+
+/***********************************************************
+ *  SetDrawIndexCount()
+ *
+ *  This method is used for filling a buffer with the indices
+ *  0, 1, 2 and so on, and feeding it to the draw index
+ *  attribute once per instance.  An instanced attribute is
+ *  read at the base instance of the draw, so every indirect
+ *  draw command picks its own index without any extension
+ *  for reading the draw parameters in the shader.  Plain
+ *  draws read index 0.
+ ***********************************************************/
+void MeshLibrary::SetDrawIndexCount(uint32_t count)
+{
+	if ((count <= m_drawIndexCount) && (m_pResources->IsValid(m_drawIndexBuffer)))
+	{
+		return;
+	}
+
+	count = std::max(count, (uint32_t)1);
+	std::vector<uint32_t> indices(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		indices[i] = i;
+	}
+
+	m_pResources->Release(m_drawIndexBuffer);
+	m_drawIndexBuffer = m_pResources->CreateBuffer("mesh draw indices");
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_pResources->GetName(m_drawIndexBuffer));
+	glBufferData(GL_COPY_WRITE_BUFFER, count * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	m_pResources->SetBytes(m_drawIndexBuffer, count * sizeof(uint32_t));
+	m_drawIndexCount = count;
+	// the vertex array is set up with the first shared buffers
+	if (m_pResources->IsValid(m_vertexArena.buffer))
+	{
+		SetupVertexArray();
+	}
+}
+
+/***********************************************************
+ *  DrawIndirect()
+ *
+ *  This method is used for drawing meshes from the draw
+ *  commands in an indirect buffer with a single call.  When
+ *  a count buffer is passed in, the GPU reads how many of
+ *  the commands to draw from it.
+ ***********************************************************/
+void MeshLibrary::DrawIndirect(GLuint commandBuffer, GLuint countBuffer, GLsizei maxDrawCount) const
+{
+	if (maxDrawCount <= 0)
+	{
+		return;
+	}
+
+	glBindVertexArray(m_pResources->GetName(m_vao));
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	if (countBuffer != 0)
+	{
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, countBuffer);
+		glMultiDrawElementsIndirectCountARB(m_drawMode, GL_UNSIGNED_INT, NULL, 0, maxDrawCount, 0);
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+	}
+	else
+	{
+		glMultiDrawElementsIndirect(m_drawMode, GL_UNSIGNED_INT, NULL, maxDrawCount, 0);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  GetMeshBytes()
+ *
+ *  This method is used for getting the GPU memory used by
+ *  a created mesh.
+ ***********************************************************/
+size_t MeshLibrary::GetMeshBytes(int meshID) const
+{
+	if ((meshID < 0) || (meshID >= (int)m_meshes.size()) || (m_meshes[meshID].bActive == false))
+	{
+		return(0);
+	}
+
+	return(m_meshes[meshID].nBytes);
+}
+
+/***********************************************************
+ *  Compact()
+ *
+ *  This method is used for moving meshes from the top of the
+ *  shared buffers into free ranges further down, so that the
+ *  holes left by destroyed meshes are filled.  It is called
+ *  once per frame with a small byte budget, so the work is
+ *  spread over many frames.  The number of bytes moved is
+ *  returned.
+ ***********************************************************/
+size_t MeshLibrary::Compact(size_t maxBytes)
+{
+	size_t movedBytes = CompactArena(m_vertexArena, true, maxBytes);
+	if (movedBytes < maxBytes)
+	{
+		movedBytes += CompactArena(m_indexArena, false, maxBytes - movedBytes);
+	}
+	return(movedBytes);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the used and free space
+ *  of the shared buffers, and how much of the free space is
+ *  scattered in holes.
+ ***********************************************************/
+void MeshLibrary::PrintStats() const
+{
+	const MESH_ARENA* arenas[2] = { &m_vertexArena, &m_indexArena };
+	for (int i = 0; i < 2; i++)
+	{
+		RangeAllocator::ALLOCATOR_STATS stats = arenas[i]->allocator.GetStats();
+		size_t elementBytes = arenas[i]->elementBytes;
+		std::cout << "Shared " << arenas[i]->label << ": " << ((stats.usedUnits * elementBytes) / 1024) << " KB of "
+			<< ((stats.capacity * elementBytes) / 1024) << " KB used in " << stats.usedRanges << " ranges, "
+			<< stats.freeRanges << " free ranges, largest free " << ((stats.largestFreeUnits * elementBytes) / 1024) << " KB, "
+			<< (int)(stats.fragmentation * 100.0f) << "% fragmented, " << (arenas[i]->movedBytes / 1024) << " KB compacted" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  AllocateRange()
+ *
+ *  This method is used for allocating a range of a shared
+ *  buffer, making the buffer larger when no free range fits.
+ ***********************************************************/
+int MeshLibrary::AllocateRange(MESH_ARENA& arena, uint32_t count)
+{
+	int range = arena.allocator.Allocate(count);
+	if (range < 0)
+	{
+		GrowArena(arena, count);
+		range = arena.allocator.Allocate(count);
+	}
+	return(range);
+}
+
+/***********************************************************
+ *  GrowArena()
+ *
+ *  This method is used for replacing a shared buffer with
+ *  one that is at least twice as large and has room for the
+ *  passed in number of elements.  The old contents are
+ *  copied on the GPU, and the old buffer is released once
+ *  the frames drawing from it are done.
+ ***********************************************************/
+void MeshLibrary::GrowArena(MESH_ARENA& arena, uint32_t count)
+{
+	uint32_t oldCapacity = arena.allocator.GetCapacity();
+	uint32_t capacity = (oldCapacity > 0) ? (oldCapacity * 2) :
+		((&arena == &m_vertexArena) ? g_InitialVertexCount : g_InitialIndexCount);
+	while (capacity < oldCapacity + count)
+	{
+		capacity *= 2;
+	}
+
+	GPU_HANDLE buffer = m_pResources->CreateBuffer(arena.label);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_pResources->GetName(buffer));
+	glBufferData(GL_COPY_WRITE_BUFFER, capacity * arena.elementBytes, NULL, GL_STATIC_DRAW);
+	if (oldCapacity > 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, m_pResources->GetName(arena.buffer));
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldCapacity * arena.elementBytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	m_pResources->SetBytes(buffer, capacity * arena.elementBytes);
+
+	m_pResources->Release(arena.buffer);
+	arena.buffer = buffer;
+	arena.allocator.Grow(capacity);
+	SetupVertexArray();
+}
+
+/***********************************************************
+ *  SetupVertexArray()
+ *
+ *  This method is used for pointing the shared vertex array
+ *  at the current vertex and index buffers.
+ ***********************************************************/
+void MeshLibrary::SetupVertexArray()
+{
+	if (m_pResources->IsValid(m_vao) == false)
+	{
+		m_vao = m_pResources->CreateVertexArray("mesh vertex array");
+	}
+	glBindVertexArray(m_pResources->GetName(m_vao));
+
+	// match the attribute locations used by the vertex shader
+	glBindBuffer(GL_ARRAY_BUFFER, m_pResources->GetName(m_vertexArena.buffer));
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (void*)offsetof(MESH_VERTEX, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (void*)offsetof(MESH_VERTEX, normal));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (void*)offsetof(MESH_VERTEX, textureCoordinate));
+	glEnableVertexAttribArray(2);
+	if (m_pResources->IsValid(m_drawIndexBuffer))
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_pResources->GetName(m_drawIndexBuffer));
+		glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+		glVertexAttribDivisor(3, 1);
+		glEnableVertexAttribArray(3);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_pResources->GetName(m_indexArena.buffer));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  CompactArena()
+ *
+ *  This method is used for moving the meshes at the top of
+ *  a shared buffer into the lowest free range below them
+ *  that fits.  The new range always ends before the old one
+ *  starts, so the copy inside the buffer never overlaps.
+ ***********************************************************/
+size_t MeshLibrary::CompactArena(MESH_ARENA& arena, bool bVertices, size_t maxBytes)
+{
+	RangeAllocator::ALLOCATOR_STATS stats = arena.allocator.GetStats();
+	if ((maxBytes == 0) || (stats.fragmentation < g_CompactFragmentation))
+	{
+		return(0);
+	}
+
+	// meshes from the top of the buffer down
+	std::vector<std::pair<uint32_t, int> > meshOrder;
+	for (int i = 0; i < (int)m_meshes.size(); i++)
+	{
+		if (m_meshes[i].bActive)
+		{
+			int range = bVertices ? m_meshes[i].vertexRange : m_meshes[i].indexRange;
+			meshOrder.push_back(std::make_pair(arena.allocator.GetOffset(range), i));
+		}
+	}
+	std::sort(meshOrder.rbegin(), meshOrder.rend());
+
+	GLuint buffer = m_pResources->GetName(arena.buffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+	size_t movedBytes = 0;
+	for (size_t i = 0; (i < meshOrder.size()) && (movedBytes < maxBytes); i++)
+	{
+		int& range = bVertices ? m_meshes[meshOrder[i].second].vertexRange : m_meshes[meshOrder[i].second].indexRange;
+		uint32_t offset = arena.allocator.GetOffset(range);
+		uint32_t size = arena.allocator.GetSize(range);
+		int newRange = arena.allocator.AllocateBelow(size, offset);
+		if (newRange < 0)
+		{
+			continue;
+		}
+
+		size_t bytes = size * arena.elementBytes;
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			offset * arena.elementBytes, arena.allocator.GetOffset(newRange) * arena.elementBytes, bytes);
+		arena.allocator.Free(range);
+		range = newRange;
+		movedBytes += bytes;
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	arena.movedBytes += movedBytes;
+	if (movedBytes > 0)
+	{
+		m_layoutVersion++;
+	}
+	return(movedBytes);
+}
+
+/***********************************************************
+ *  GetDataBytes()
+ *
+ *  This method is used for getting the memory needed for
+ *  the vertex and index data of a mesh.
+ ***********************************************************/
+size_t MeshLibrary::GetDataBytes(const MESH_DATA& meshData)
+{
+	return((meshData.vertices.size() * sizeof(MESH_VERTEX)) +
+		(meshData.indices.size() * sizeof(uint32_t)));
+}
+
+/***********************************************************
+ *  GetShapeBounds()
+ *
+ *  This method is used for getting the local space bounding
+ *  box of a basic shape mesh before any transformation is
+ *  applied.
+ ***********************************************************/
+void MeshLibrary::GetShapeBounds(int shape, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+	switch (shape)
+	{
+	case SHAPE_BOX:
+		boundsMin = glm::vec3(-0.5f, -0.5f, -0.5f);
+		boundsMax = glm::vec3(0.5f, 0.5f, 0.5f);
+		break;
+	case SHAPE_PLANE:
+		boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+		boundsMax = glm::vec3(1.0f, 0.0f, 1.0f);
+		break;
+	case SHAPE_CONE:
+	case SHAPE_CYLINDER:
+	case SHAPE_TAPERED_CYLINDER:
+		// these shapes sit on their base at the origin
+		boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+		boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+		break;
+	case SHAPE_TORUS:
+		// include the thickness of the ring
+		boundsMin = glm::vec3(-1.3f, -1.3f, -1.3f);
+		boundsMax = glm::vec3(1.3f, 1.3f, 1.3f);
+		break;
+	case SHAPE_SPHERE:
+	default:
+		boundsMin = glm::vec3(-1.0f, -1.0f, -1.0f);
+		boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+		break;
+	}
+}
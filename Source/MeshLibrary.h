@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlibrary.h
+// ============
+// manage GPU meshes that are built from vertex data at runtime
+//
+//	All meshes share one vertex buffer and one index buffer, and a range
+//	allocator hands out the part of each buffer that a mesh uses.  Meshes
+//	are drawn with a base vertex, so they all use the same vertex array.
+//	The buffers grow when they are full, and an optional compaction pass
+//	moves meshes down into the holes left by destroyed meshes.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GpuResourceManager.h"
+#include "RangeAllocator.h"
+
+#include <cstdint>
+#include <vector>
+
+// basic shapes that can be referenced from scene data
+enum MESH_SHAPE
+{
+	SHAPE_CUSTOM = -1,
+	SHAPE_BOX = 0,
+	SHAPE_CONE,
+	SHAPE_CYLINDER,
+	SHAPE_PLANE,
+	SHAPE_SPHERE,
+	SHAPE_TAPERED_CYLINDER,
+	SHAPE_TORUS,
+	SHAPE_COUNT
+};
+
+// vertex layout shared with the shader attribute locations
+// (0 = position, 1 = normal, 2 = texture coordinate) - location 3
+// holds the per-instance draw index when it is enabled
+struct MESH_VERTEX
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 textureCoordinate;
+};
+
+// CPU side mesh data before it is uploaded
+struct MESH_DATA
+{
+	std::vector<MESH_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+};
+
+/***********************************************************
+ *  MeshLibrary
+ *
+ *  This class owns the OpenGL buffers for meshes that are
+ *  created from vertex data, and hands out integer IDs for
+ *  drawing them.
+ ***********************************************************/
+class MeshLibrary
+{
+public:
+	// constructor - the buffers are owned by the resource manager
+	MeshLibrary(GpuResourceManager* pResources);
+	// destructor
+	~MeshLibrary();
+
+	// upload mesh data into OpenGL buffers and return its ID
+	int CreateMesh(const MESH_DATA& meshData);
+	// free the OpenGL buffers for a mesh
+	void DestroyMesh(int meshID);
+	// draw a previously created mesh
+	void DrawMesh(int meshID) const;
+	// get the index range and base vertex for drawing a mesh
+	bool GetDrawRange(int meshID, GLsizei& nIndices, GLuint& firstIndex, GLint& baseVertex) const;
+	// feed the draw index attribute from a buffer of increasing indices,
+	// so that the base instance of a draw selects its per-draw values
+	void SetDrawIndexCount(uint32_t count);
+	// draw the commands in an indirect buffer, with the number of draws
+	// read from the first value of the count buffer when it is not 0
+	void DrawIndirect(GLuint commandBuffer, GLuint countBuffer, GLsizei maxDrawCount) const;
+	// draw the triangles as patches of three vertices, for a program
+	// with tessellation shaders
+	void SetDrawPatches(bool bPatches) { m_drawMode = bPatches ? GL_PATCHES : GL_TRIANGLES; }
+	// draw every mesh once per view, for shaders that pick the view
+	// from the instance
+	void SetViewCount(int viewCount) { m_viewCount = viewCount; }
+	// get a number that changes whenever meshes move in the buffers
+	uint32_t GetLayoutVersion() const { return(m_layoutVersion); }
+
+	// get the GPU memory used by a mesh
+	size_t GetMeshBytes(int meshID) const;
+	// move meshes into lower free ranges, up to the passed in number of
+	// bytes - does nothing while the buffers are hardly fragmented
+	size_t Compact(size_t maxBytes);
+	// print the used and free space of the shared buffers
+	void PrintStats() const;
+	// get the memory needed for the passed in mesh data
+	static size_t GetDataBytes(const MESH_DATA& meshData);
+	// get the local space bounding box of a basic shape
+	static void GetShapeBounds(int shape, glm::vec3& boundsMin, glm::vec3& boundsMax);
+	// get the resource manager that owns the GPU objects
+	GpuResourceManager* GetResources() const { return(m_pResources); }
+
+private:
+	// shared buffer for one kind of mesh data, counted in elements
+	struct MESH_ARENA
+	{
+		GPU_HANDLE buffer;
+		RangeAllocator allocator;
+		size_t elementBytes;
+		const char* label;
+		size_t movedBytes;
+	};
+
+	// ranges of the shared buffers used by one uploaded mesh
+	struct GL_MESH
+	{
+		int vertexRange;
+		int indexRange;
+		GLsizei nIndices;
+		size_t nBytes;
+		bool bActive;
+	};
+
+	// resource manager that owns the vertex arrays and buffers
+	GpuResourceManager* m_pResources;
+	// shared vertex and index buffers, and the vertex array using them
+	MESH_ARENA m_vertexArena;
+	MESH_ARENA m_indexArena;
+	GPU_HANDLE m_vao;
+	// uploaded meshes indexed by mesh ID
+	std::vector<GL_MESH> m_meshes;
+	// mesh IDs that can be reused
+	std::vector<int> m_freeMeshIDs;
+	// buffer of increasing draw indices and the number it holds
+	GPU_HANDLE m_drawIndexBuffer;
+	uint32_t m_drawIndexCount;
+	// changed every time compaction moves a mesh
+	uint32_t m_layoutVersion;
+	// primitive type that the meshes are drawn with
+	GLenum m_drawMode;
+	// instances drawn of every mesh
+	int m_viewCount;
+
+	// allocate a range, making the buffer larger when nothing fits
+	int AllocateRange(MESH_ARENA& arena, uint32_t count);
+	// make a shared buffer larger, keeping its contents
+	void GrowArena(MESH_ARENA& arena, uint32_t count);
+	// point the vertex array at the current shared buffers
+	void SetupVertexArray();
+	// move the highest meshes of a buffer into lower free ranges
+	size_t CompactArena(MESH_ARENA& arena, bool bVertices, size_t maxBytes);
+};
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionqueries.cpp
+// ============
+// skip the draws of hidden objects with occlusion queries and conditional
+// rendering
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionQueries.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  OcclusionQueries()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OcclusionQueries::OcclusionQueries()
+{
+	m_current = 0;
+	// the conservative test may pass a few hidden boxes, but it is
+	// cheaper and never hides a visible one
+	m_target = GLEW_VERSION_4_3 ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+	m_stats.frames = 0;
+	m_stats.queries = 0;
+	m_stats.conditionalDraws = 0;
+	m_stats.unconditionalDraws = 0;
+}
+
+/***********************************************************
+ *  ~OcclusionQueries()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OcclusionQueries::~OcclusionQueries()
+{
+	DeleteQueries();
+}
+
+/***********************************************************
+ *  SetObjectCount()
+ *
+ *  This method is used for creating the two queries of every
+ *  object.  Changing the count drops all of the results, so
+ *  every object is drawn as usual for the next frame.
+ ***********************************************************/
+void OcclusionQueries::SetObjectCount(int objectCount)
+{
+	if (objectCount == (int)m_queries[0].size())
+	{
+		return;
+	}
+
+	DeleteQueries();
+	for (int i = 0; i < 2; i++)
+	{
+		m_queries[i].resize((size_t)objectCount, 0);
+		m_bIssued[i].assign((size_t)objectCount, 0);
+		if (objectCount > 0)
+		{
+			glGenQueries(objectCount, m_queries[i].data());
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for making the queries of the last
+ *  frame the ones that draws depend on, and clearing the
+ *  other set for the queries of this frame.
+ ***********************************************************/
+void OcclusionQueries::BeginFrame()
+{
+	m_current = 1 - m_current;
+	m_bIssued[m_current].assign(m_bIssued[m_current].size(), 0);
+	m_stats.frames++;
+}
+
+/***********************************************************
+ *  BeginConditionalDraw()
+ *
+ *  This method is used for starting a conditional render on
+ *  the query the object issued last frame.  The render does
+ *  not wait for the result, so when the GPU has not finished
+ *  the query yet the object is simply drawn.
+ ***********************************************************/
+bool OcclusionQueries::BeginConditionalDraw(int object)
+{
+	int previous = 1 - m_current;
+	if ((object < 0) || (object >= (int)m_queries[previous].size()) || (m_bIssued[previous][object] == 0))
+	{
+		m_stats.unconditionalDraws++;
+		return(false);
+	}
+
+	glBeginConditionalRender(m_queries[previous][object], GL_QUERY_NO_WAIT);
+	m_stats.conditionalDraws++;
+	return(true);
+}
+
+/***********************************************************
+ *  EndConditionalDraw()
+ *
+ *  This method is used for ending a conditional render.
+ ***********************************************************/
+void OcclusionQueries::EndConditionalDraw()
+{
+	glEndConditionalRender();
+}
+
+/***********************************************************
+ *  BeginQuery()
+ *
+ *  This method is used for starting the query of an object
+ *  for this frame.  The caller draws the bounding box with
+ *  color and depth writes turned off.
+ ***********************************************************/
+void OcclusionQueries::BeginQuery(int object)
+{
+	if ((object < 0) || (object >= (int)m_queries[m_current].size()))
+	{
+		return;
+	}
+
+	glBeginQuery(m_target, m_queries[m_current][object]);
+	m_bIssued[m_current][object] = 1;
+	m_stats.queries++;
+}
+
+/***********************************************************
+ *  EndQuery()
+ *
+ *  This method is used for ending the query of the bounding
+ *  box drawn since BeginQuery().
+ ***********************************************************/
+void OcclusionQueries::EndQuery()
+{
+	glEndQuery(m_target);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing how many queries were
+ *  issued and how many draws depended on them.
+ ***********************************************************/
+void OcclusionQueries::PrintStats() const
+{
+	std::cout << "Occlusion queries: " << m_stats.queries << " queries in " << m_stats.frames << " frames, "
+		<< m_stats.conditionalDraws << " conditional and " << m_stats.unconditionalDraws << " unconditional object draws" << std::endl;
+}
+
+/***********************************************************
+ *  DeleteQueries()
+ *
+ *  This method is used for deleting all of the query objects.
+ ***********************************************************/
+void OcclusionQueries::DeleteQueries()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		if (m_queries[i].size() > 0)
+		{
+			glDeleteQueries((GLsizei)m_queries[i].size(), m_queries[i].data());
+		}
+		m_queries[i].clear();
+		m_bIssued[i].clear();
+	}
+}
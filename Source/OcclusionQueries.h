@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionqueries.h
+// ============
+// skip the draws of hidden objects with occlusion queries and conditional
+// rendering
+//
+//	Every object gets a query that counts whether any pixel of its bounding
+//	box passes the depth test, with color and depth writes off.  The next
+//	frame wraps the draws of the object in a conditional render on that
+//	result, so the GPU skips the draws of an object that was hidden without
+//	the CPU ever reading the result back.  Each object has two queries that
+//	take turns, one being written while the other is used.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  OcclusionQueries
+ *
+ *  This class owns the occlusion query objects of a list of
+ *  objects and the conditional rendering that uses them.
+ ***********************************************************/
+class OcclusionQueries
+{
+public:
+	// counters of the issued queries and conditional draws
+	struct QUERY_STATS
+	{
+		int64_t frames;
+		int64_t queries;
+		int64_t conditionalDraws;
+		int64_t unconditionalDraws;
+	};
+
+	// constructor
+	OcclusionQueries();
+	// destructor
+	~OcclusionQueries();
+
+	// set the number of objects that have queries
+	void SetObjectCount(int objectCount);
+	// switch the queries written this frame with the ones used
+	void BeginFrame();
+
+	// start drawing an object on the result of its last query - false
+	// when there is no result and the object is drawn as usual
+	bool BeginConditionalDraw(int object);
+	// end drawing an object started with a conditional draw
+	void EndConditionalDraw();
+
+	// start counting the samples of an object's bounding box
+	void BeginQuery(int object);
+	// end counting the samples of the bounding box
+	void EndQuery();
+
+	// get the query and draw counters
+	const QUERY_STATS& GetStats() const { return(m_stats); }
+	// print the query and draw counters
+	void PrintStats() const;
+
+private:
+	// queries of every object for the two alternating frames
+	std::vector<GLuint> m_queries[2];
+	// whether each query was issued in its frame
+	std::vector<char> m_bIssued[2];
+	// queries written in the current frame
+	int m_current;
+	// kind of query - any samples, conservative when supported
+	GLenum m_target;
+	QUERY_STATS m_stats;
+
+	// delete all of the query objects
+	void DeleteQueries();
+};
@@ -0,0 +1,1579 @@
+///////////////////////////////////////////////////////////////////////////////
+// physicsworld.cpp
+// ============
+// simulate the scene objects as rigid bodies at a fixed time step
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PhysicsWorld.h"
+#include "JobSystem.h"
+#include "TraceLog.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// x64 builds always have SSE, and 32-bit builds have it when it is
+// switched on with /arch or -msse
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#include <xmmintrin.h>
+#define PHYSICS_SIMD 1
+#endif
+
+// declaration of global variables
+namespace
+{
+	const float g_TimeStep = 1.0f / 60.0f;
+	// steps run in one update at most, so a long frame does not make
+	// the next one longer still
+	const int g_MaxStepsPerUpdate = 4;
+	// the scene is modeled in units of about a centimeter and a half, so
+	// real gravity would be far too fast to follow - this is a toy scale
+	const float g_Gravity = -20.0f;
+	const int g_SolverIterations = 10;
+	// share of the overlap that is pushed out per step, and the overlap
+	// that is left alone so resting contacts do not jitter
+	const float g_Baumgarte = 0.2f;
+	const float g_Slop = 0.01f;
+	// share of the smallest face overlap of two boxes that the overlap
+	// along a pair of edges has to be below for an edge contact, so
+	// boxes resting face on face keep to their corner contacts
+	const float g_EdgeAxisBias = 0.95f;
+	const float g_Restitution = 0.2f;
+	const float g_RestitutionSpeed = 1.0f;
+	const float g_Friction = 0.5f;
+	const float g_LinearDamping = 0.05f;
+	const float g_AngularDamping = 0.1f;
+	// squared speed a body counts as still below, and the steps every
+	// body of an island has to be still for before it goes to sleep
+	const float g_SleepSpeedSquared = 0.01f;
+	const int g_SleepSteps = 30;
+	// indices handed to one job of a parallel loop
+	const int g_BodyBlock = 256;
+	const int g_PairBlock = 256;
+	const int g_IslandBlock = 8;
+	// layout of the benchmark pile
+	const int g_BenchmarkLayers = 10;
+	const float g_BenchmarkSpacing = 1.5f;
+	const float g_BenchmarkHalfSize = 0.5f;
+	// names of the phases in the printed stats
+	const char* g_PhaseNames[4] = { "integrate", "broadphase", "narrowphase", "solve" };
+}
+
+/***********************************************************
+ *  PhysicsWorld()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PhysicsWorld::PhysicsWorld(JobSystem* pJobSystem)
+{
+	m_pJobSystem = pJobSystem;
+	m_gravity = glm::vec3(0.0f, g_Gravity, 0.0f);
+	m_accumulator = 0.0;
+	m_sweepAxis = 0;
+	m_steps = 0;
+	m_pairTotal = 0;
+	m_contactTotal = 0;
+	m_islandTotal = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_phaseMicroseconds[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  IsSimdEnabled()
+ *
+ *  This method is used for checking whether the box
+ *  corners and the pair bounds are tested with SSE
+ *  instructions.
+ ***********************************************************/
+bool PhysicsWorld::IsSimdEnabled()
+{
+#ifdef PHYSICS_SIMD
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  AddBody()
+ *
+ *  This method is used for adding a body.  The inertia of a
+ *  solid sphere, box or cylinder is worked out from the mass
+ *  and the size, and a static body gets zero inverse mass
+ *  and inertia, so the solver never moves it.  A plane has
+ *  no inside to weigh, so it is always static.
+ ***********************************************************/
+int PhysicsWorld::AddBody(int type, const glm::vec3& size, const glm::vec3& position, const glm::quat& orientation, float mass)
+{
+	BODY body;
+	body.type = type;
+	body.size = size;
+	body.position = position;
+	body.orientation = glm::normalize(orientation);
+	body.linearVelocity = glm::vec3(0.0f);
+	body.angularVelocity = glm::vec3(0.0f);
+	body.inverseMass = 0.0f;
+	body.inverseInertia = glm::vec3(0.0f);
+	body.stillSteps = 0;
+	body.bAwake = false;
+
+	if ((mass > 0.0f) && (type != COLLIDER_PLANE))
+	{
+		glm::vec3 inertia;
+		if (type == COLLIDER_SPHERE)
+		{
+			inertia = glm::vec3(0.4f * mass * size.x * size.x);
+		}
+		else if (type == COLLIDER_CYLINDER)
+		{
+			// the height is twice the half height in the size
+			float across = mass * ((3.0f * size.x * size.x) + (4.0f * size.y * size.y)) / 12.0f;
+			inertia = glm::vec3(across, 0.5f * mass * size.x * size.x, across);
+		}
+		else
+		{
+			glm::vec3 squared = size * size;
+			inertia = (mass / 3.0f) * glm::vec3(squared.y + squared.z, squared.x + squared.z, squared.x + squared.y);
+		}
+		body.inverseMass = 1.0f / mass;
+		for (int i = 0; i < 3; i++)
+		{
+			body.inverseInertia[i] = (inertia[i] > 0.0f) ? (1.0f / inertia[i]) : 0.0f;
+		}
+		body.bAwake = true;
+	}
+
+	UpdateDerived(body);
+	m_bodies.push_back(body);
+	m_sortedBodies.push_back((int)m_bodies.size() - 1);
+	return((int)m_bodies.size() - 1);
+}
+
+/***********************************************************
+ *  ApplyImpulse()
+ *
+ *  This method is used for pushing a body at a point in
+ *  world space.  Pushing off the center sets it turning.
+ ***********************************************************/
+void PhysicsWorld::ApplyImpulse(int body, const glm::vec3& impulse, const glm::vec3& point)
+{
+	BODY& target = m_bodies[body];
+	if (target.inverseMass <= 0.0f)
+	{
+		return;
+	}
+
+	target.linearVelocity += impulse * target.inverseMass;
+	target.angularVelocity += target.inverseInertiaWorld * glm::cross(point - target.position, impulse);
+	target.stillSteps = 0;
+	target.bAwake = true;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for running the fixed steps that fit
+ *  into the elapsed time.  The time left over is carried to
+ *  the next update, unless the step limit was reached, in
+ *  which case the simulation falls behind the clock rather
+ *  than taking longer on every frame.
+ ***********************************************************/
+int PhysicsWorld::Update(double elapsedSeconds)
+{
+	m_accumulator += elapsedSeconds;
+
+	int steps = 0;
+	while ((m_accumulator >= g_TimeStep) && (steps < g_MaxStepsPerUpdate))
+	{
+		Step();
+		m_accumulator -= g_TimeStep;
+		steps++;
+	}
+	if (steps == g_MaxStepsPerUpdate)
+	{
+		m_accumulator = 0.0;
+	}
+	return(steps);
+}
+
+/***********************************************************
+ *  Step()
+ *
+ *  This method is used for running one fixed step.  The
+ *  velocities, the contacts and the islands are spread over
+ *  the job system in blocks, and the sweep over the sorted
+ *  bounds and the grouping into islands run on the calling
+ *  thread, since they are short and hard to split.
+ ***********************************************************/
+void PhysicsWorld::Step()
+{
+	int64_t start = TraceLog::GetMicroseconds();
+	RunBlocks((int)m_bodies.size(), g_BodyBlock, [this](int /*block*/, int first, int last) {
+		IntegrateVelocities(first, last);
+	});
+
+	int64_t integrated = TraceLog::GetMicroseconds();
+	FindPairs();
+
+	int64_t paired = TraceLog::GetMicroseconds();
+	int blockCount = ((int)m_pairs.size() + g_PairBlock - 1) / g_PairBlock;
+	if ((int)m_blockContacts.size() < blockCount)
+	{
+		m_blockContacts.resize(blockCount);
+	}
+	RunBlocks((int)m_pairs.size(), g_PairBlock, [this](int block, int first, int last) {
+		m_blockContacts[block].clear();
+		FindContacts(first, last, m_blockContacts[block]);
+	});
+	m_contacts.clear();
+	for (int i = 0; i < blockCount; i++)
+	{
+		m_contacts.insert(m_contacts.end(), m_blockContacts[i].begin(), m_blockContacts[i].end());
+	}
+
+	int64_t contacted = TraceLog::GetMicroseconds();
+	BuildIslands();
+	RunBlocks((int)m_islands.size(), g_IslandBlock, [this](int /*block*/, int first, int last) {
+		for (int i = first; i < last; i++)
+		{
+			SolveIsland(m_islands[i]);
+		}
+	});
+	int64_t solved = TraceLog::GetMicroseconds();
+
+	m_phaseMicroseconds[0] += integrated - start;
+	m_phaseMicroseconds[1] += paired - integrated;
+	m_phaseMicroseconds[2] += contacted - paired;
+	m_phaseMicroseconds[3] += solved - contacted;
+	m_pairTotal += (int64_t)m_pairs.size();
+	m_contactTotal += (int64_t)m_contacts.size();
+	m_islandTotal += (int64_t)m_islands.size();
+	m_steps++;
+}
+
+/***********************************************************
+ *  GetMass()
+ *
+ *  This method is used for getting the mass of a body.
+ ***********************************************************/
+float PhysicsWorld::GetMass(int body) const
+{
+	float inverseMass = m_bodies[body].inverseMass;
+	return((inverseMass > 0.0f) ? (1.0f / inverseMass) : 0.0f);
+}
+
+/***********************************************************
+ *  IsAwake()
+ *
+ *  This method is used for checking whether a body moves
+ *  and has not been put to sleep.
+ ***********************************************************/
+bool PhysicsWorld::IsAwake(int body) const
+{
+	return((m_bodies[body].inverseMass > 0.0f) && (m_bodies[body].bAwake));
+}
+
+/***********************************************************
+ *  GetTransform()
+ *
+ *  This method is used for getting the position and the
+ *  orientation of a body as a matrix.
+ ***********************************************************/
+glm::mat4 PhysicsWorld::GetTransform(int body) const
+{
+	const BODY& source = m_bodies[body];
+	return(glm::translate(source.position) * glm::mat4_cast(source.orientation));
+}
+
+/***********************************************************
+ *  RunBlocks()
+ *
+ *  This method is used for splitting a range into blocks
+ *  and running the blocks as a parallel loop.  A range that
+ *  fits into one block runs on the calling thread.
+ ***********************************************************/
+void PhysicsWorld::RunBlocks(int count, int blockSize, const std::function<void(int, int, int)>& function)
+{
+	int blockCount = (count + blockSize - 1) / blockSize;
+	std::function<void(int)> runBlock = [&function, count, blockSize](int block) {
+		int first = block * blockSize;
+		function(block, first, std::min(first + blockSize, count));
+	};
+
+	if ((NULL != m_pJobSystem) && (blockCount > 1))
+	{
+		m_pJobSystem->ParallelFor(blockCount, runBlock);
+	}
+	else
+	{
+		for (int block = 0; block < blockCount; block++)
+		{
+			runBlock(block);
+		}
+	}
+}
+
+/***********************************************************
+ *  IntegrateVelocities()
+ *
+ *  This method is used for adding gravity to the velocities
+ *  of a block of bodies.  Static and sleeping bodies are
+ *  left as they are.
+ ***********************************************************/
+void PhysicsWorld::IntegrateVelocities(int first, int last)
+{
+	glm::vec3 gravityStep = m_gravity * g_TimeStep;
+	for (int i = first; i < last; i++)
+	{
+		BODY& body = m_bodies[i];
+		if ((body.inverseMass > 0.0f) && (body.bAwake))
+		{
+			body.linearVelocity += gravityStep;
+		}
+	}
+}
+
+/***********************************************************
+ *  FindSweepAxis()
+ *
+ *  This method is used for finding the axis along which the
+ *  centers of the bodies spread the most, so the sweep sees
+ *  the fewest overlapping bounds on it.
+ ***********************************************************/
+int PhysicsWorld::FindSweepAxis() const
+{
+	glm::vec3 sum(0.0f);
+	glm::vec3 sumSquared(0.0f);
+	for (size_t i = 0; i < m_bodies.size(); i++)
+	{
+		glm::vec3 center = (m_bodies[i].boundsMin + m_bodies[i].boundsMax) * 0.5f;
+		sum += center;
+		sumSquared += center * center;
+	}
+	glm::vec3 variance = sumSquared - ((sum * sum) / (float)std::max((int)m_bodies.size(), 1));
+
+	int axis = 0;
+	if (variance.y > variance[axis])
+	{
+		axis = 1;
+	}
+	if (variance.z > variance[axis])
+	{
+		axis = 2;
+	}
+	return(axis);
+}
+
+/***********************************************************
+ *  FindPairs()
+ *
+ *  This method is used for finding the pairs of bodies whose
+ *  bounding boxes overlap.  The bodies stay sorted by the
+ *  low side of their bounds on the sweep axis, and move
+ *  little from one step to the next, so an insertion sort
+ *  of the last order is close to linear.  The sweep then
+ *  only compares a body with the ones that start before it
+ *  ends, four at a time on the other two axes.  Pairs where
+ *  neither body moves are skipped.
+ ***********************************************************/
+void PhysicsWorld::FindPairs()
+{
+	m_pairs.clear();
+	int count = (int)m_sortedBodies.size();
+	if (count < 2)
+	{
+		return;
+	}
+
+	int axis = FindSweepAxis();
+	if (axis != m_sweepAxis)
+	{
+		// a new axis scrambles the order, which the insertion sort
+		// would take quadratic time over
+		m_sweepAxis = axis;
+		std::sort(m_sortedBodies.begin(), m_sortedBodies.end(), [this, axis](int left, int right) {
+			return(m_bodies[left].boundsMin[axis] < m_bodies[right].boundsMin[axis]);
+		});
+	}
+	else
+	{
+		for (int i = 1; i < count; i++)
+		{
+			int body = m_sortedBodies[i];
+			float key = m_bodies[body].boundsMin[axis];
+			int j = i - 1;
+			while ((j >= 0) && (m_bodies[m_sortedBodies[j]].boundsMin[axis] > key))
+			{
+				m_sortedBodies[j + 1] = m_sortedBodies[j];
+				j--;
+			}
+			m_sortedBodies[j + 1] = body;
+		}
+	}
+
+	// copy the bounds in sorted order - the other two axes are padded to
+	// a multiple of four with boxes that overlap nothing
+	int axisA = (axis + 1) % 3;
+	int axisB = (axis + 2) % 3;
+	size_t padded = ((size_t)count + 3) & ~(size_t)3;
+	for (int i = 0; i < 6; i++)
+	{
+		m_sortedBounds[i].assign(padded, (i & 1) ? -1.0e30f : 1.0e30f);
+	}
+	m_sortedMoving.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		const BODY& body = m_bodies[m_sortedBodies[i]];
+		m_sortedBounds[0][i] = body.boundsMin[axis];
+		m_sortedBounds[1][i] = body.boundsMax[axis];
+		m_sortedBounds[2][i] = body.boundsMin[axisA];
+		m_sortedBounds[3][i] = body.boundsMax[axisA];
+		m_sortedBounds[4][i] = body.boundsMin[axisB];
+		m_sortedBounds[5][i] = body.boundsMax[axisB];
+		m_sortedMoving[i] = ((body.inverseMass > 0.0f) && (body.bAwake)) ? 1 : 0;
+	}
+
+	const float* pMinA = m_sortedBounds[2].data();
+	const float* pMaxA = m_sortedBounds[3].data();
+	const float* pMinB = m_sortedBounds[4].data();
+	const float* pMaxB = m_sortedBounds[5].data();
+	for (int i = 0; i < count; i++)
+	{
+		float sweepEnd = m_sortedBounds[1][i];
+		int end = i + 1;
+		while ((end < count) && (m_sortedBounds[0][end] <= sweepEnd))
+		{
+			end++;
+		}
+
+		for (int j = i + 1; j < end; j += 4)
+		{
+			int overlapMask = 0;
+#ifdef PHYSICS_SIMD
+			__m128 overlap = _mm_and_ps(
+				_mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(pMinA + j), _mm_set1_ps(pMaxA[i])),
+					_mm_cmpge_ps(_mm_loadu_ps(pMaxA + j), _mm_set1_ps(pMinA[i]))),
+				_mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(pMinB + j), _mm_set1_ps(pMaxB[i])),
+					_mm_cmpge_ps(_mm_loadu_ps(pMaxB + j), _mm_set1_ps(pMinB[i]))));
+			overlapMask = _mm_movemask_ps(overlap);
+#else
+			for (int lane = 0; lane < 4; lane++)
+			{
+				int k = j + lane;
+				if ((k < count) && (pMinA[k] <= pMaxA[i]) && (pMaxA[k] >= pMinA[i]) &&
+					(pMinB[k] <= pMaxB[i]) && (pMaxB[k] >= pMinB[i]))
+				{
+					overlapMask |= (1 << lane);
+				}
+			}
+#endif
+			// lanes past the end of the sweep are real bodies that
+			// start too late on the sweep axis
+			for (int lane = 0; (overlapMask != 0) && (lane < 4); lane++)
+			{
+				int k = j + lane;
+				if (((overlapMask & (1 << lane)) != 0) && (k < end) && (m_sortedMoving[i] | m_sortedMoving[k]))
+				{
+					PAIR pair;
+					pair.bodyA = m_sortedBodies[i];
+					pair.bodyB = m_sortedBodies[k];
+					m_pairs.push_back(pair);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  FindContacts()
+ *
+ *  This method is used for working out the contacts of a
+ *  block of pairs.  The body with the lower collider type
+ *  goes first, so every pair of types has one case.  Two
+ *  boxes test the corners of each box against the other
+ *  one and look for edges that cross, and a cylinder is
+ *  tested by the points round its caps.
+ ***********************************************************/
+void PhysicsWorld::FindContacts(int first, int last, std::vector<CONTACT>& contacts) const
+{
+	for (int i = first; i < last; i++)
+	{
+		int indexA = m_pairs[i].bodyA;
+		int indexB = m_pairs[i].bodyB;
+		if (m_bodies[indexA].type > m_bodies[indexB].type)
+		{
+			std::swap(indexA, indexB);
+		}
+		const BODY& a = m_bodies[indexA];
+		const BODY& b = m_bodies[indexB];
+
+		if (a.type == COLLIDER_SPHERE)
+		{
+			if (b.type == COLLIDER_SPHERE)
+			{
+				CollideSpheres(a, b, indexA, indexB, contacts);
+			}
+			else if (b.type == COLLIDER_BOX)
+			{
+				CollideSphereBox(a, b, indexA, indexB, true, contacts);
+			}
+			else if (b.type == COLLIDER_CYLINDER)
+			{
+				CollideSphereCylinder(a, b, indexA, indexB, contacts);
+			}
+			else
+			{
+				CollideSpherePlane(a, b, indexA, indexB, contacts);
+			}
+		}
+		else if (b.type == COLLIDER_BOX)
+		{
+			CollideBoxCorners(a, b, indexA, indexB, true, contacts);
+			CollideBoxCorners(b, a, indexB, indexA, false, contacts);
+			CollideBoxEdges(a, b, indexA, indexB, contacts);
+		}
+		else if (b.type == COLLIDER_CYLINDER)
+		{
+			CollideOutline(a, b, indexA, indexB, true, contacts);
+			CollideOutline(b, a, indexB, indexA, false, contacts);
+		}
+		else if (a.type != COLLIDER_PLANE)
+		{
+			CollideOutline(a, b, indexA, indexB, true, contacts);
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildIslands()
+ *
+ *  This method is used for grouping the moving bodies into
+ *  islands of bodies that touch.  A moving body wakes the
+ *  sleeping bodies it touches first.  Static bodies join no
+ *  island, since the solver only reads them, so islands
+ *  that rest on the same table are still solved apart.
+ *  The bodies and the contacts are then sorted by island.
+ ***********************************************************/
+void PhysicsWorld::BuildIslands()
+{
+	size_t bodyCount = m_bodies.size();
+	for (size_t i = 0; i < m_contacts.size(); i++)
+	{
+		BODY& a = m_bodies[m_contacts[i].bodyA];
+		BODY& b = m_bodies[m_contacts[i].bodyB];
+		if ((a.inverseMass > 0.0f) && (b.inverseMass > 0.0f) && (a.bAwake != b.bAwake))
+		{
+			a.bAwake = true;
+			b.bAwake = true;
+			a.stillSteps = 0;
+			b.stillSteps = 0;
+		}
+	}
+
+	m_islandParents.assign(bodyCount, -1);
+	for (size_t i = 0; i < bodyCount; i++)
+	{
+		if ((m_bodies[i].inverseMass > 0.0f) && (m_bodies[i].bAwake))
+		{
+			m_islandParents[i] = (int)i;
+		}
+	}
+	for (size_t i = 0; i < m_contacts.size(); i++)
+	{
+		int a = m_contacts[i].bodyA;
+		int b = m_contacts[i].bodyB;
+		if ((m_islandParents[a] >= 0) && (m_islandParents[b] >= 0))
+		{
+			int rootA = FindIsland(a);
+			int rootB = FindIsland(b);
+			if (rootA != rootB)
+			{
+				m_islandParents[rootA] = rootB;
+			}
+		}
+	}
+
+	// number the islands and count their bodies and contacts
+	m_islands.clear();
+	m_bodyIslands.assign(bodyCount, -1);
+	// the body list is only filled in below, so until then it holds
+	// the island number of every root
+	std::vector<int>& rootIslands = m_islandBodies;
+	rootIslands.assign(bodyCount, -1);
+	for (size_t i = 0; i < bodyCount; i++)
+	{
+		if (m_islandParents[i] < 0)
+		{
+			continue;
+		}
+		int root = FindIsland((int)i);
+		if (rootIslands[root] < 0)
+		{
+			ISLAND island = { 0, 0, 0, 0 };
+			rootIslands[root] = (int)m_islands.size();
+			m_islands.push_back(island);
+		}
+		m_bodyIslands[i] = rootIslands[root];
+		m_islands[m_bodyIslands[i]].bodyCount++;
+	}
+	m_contactIslands.resize(m_contacts.size());
+	for (size_t i = 0; i < m_contacts.size(); i++)
+	{
+		int island = m_bodyIslands[m_contacts[i].bodyA];
+		if (island < 0)
+		{
+			island = m_bodyIslands[m_contacts[i].bodyB];
+		}
+		m_contactIslands[i] = island;
+		if (island >= 0)
+		{
+			m_islands[island].contactCount++;
+		}
+	}
+
+	// lay the islands out one after another
+	int bodyTotal = 0;
+	int contactTotal = 0;
+	for (size_t i = 0; i < m_islands.size(); i++)
+	{
+		m_islands[i].firstBody = bodyTotal;
+		m_islands[i].firstContact = contactTotal;
+		bodyTotal += m_islands[i].bodyCount;
+		contactTotal += m_islands[i].contactCount;
+		m_islands[i].bodyCount = 0;
+		m_islands[i].contactCount = 0;
+	}
+	m_islandBodies.assign(bodyTotal, 0);
+	m_islandContacts.resize(contactTotal);
+	for (size_t i = 0; i < bodyCount; i++)
+	{
+		int island = m_bodyIslands[i];
+		if (island >= 0)
+		{
+			ISLAND& target = m_islands[island];
+			m_islandBodies[target.firstBody + target.bodyCount] = (int)i;
+			target.bodyCount++;
+		}
+	}
+	for (size_t i = 0; i < m_contacts.size(); i++)
+	{
+		int island = m_contactIslands[i];
+		if (island >= 0)
+		{
+			ISLAND& target = m_islands[island];
+			m_islandContacts[target.firstContact + target.contactCount] = m_contacts[i];
+			target.contactCount++;
+		}
+	}
+}
+
+/***********************************************************
+ *  FindIsland()
+ *
+ *  This method is used for following the parents of a body
+ *  up to the root of its island, pointing the bodies on
+ *  the way at their grandparents so later finds are short.
+ ***********************************************************/
+int PhysicsWorld::FindIsland(int body)
+{
+	while (m_islandParents[body] != body)
+	{
+		m_islandParents[body] = m_islandParents[m_islandParents[body]];
+		body = m_islandParents[body];
+	}
+	return(body);
+}
+
+/***********************************************************
+ *  SolveIsland()
+ *
+ *  This method is used for solving the contacts of an
+ *  island with sequential impulses and moving its bodies
+ *  on.  Islands share no moving bodies, so they are solved
+ *  at the same time on different threads.  An island whose
+ *  bodies have all been still for a while goes to sleep.
+ ***********************************************************/
+void PhysicsWorld::SolveIsland(const ISLAND& island)
+{
+	CONTACT* pContacts = m_islandContacts.data() + island.firstContact;
+	for (int i = 0; i < island.contactCount; i++)
+	{
+		PrepareContact(pContacts[i]);
+	}
+	for (int iteration = 0; iteration < g_SolverIterations; iteration++)
+	{
+		for (int i = 0; i < island.contactCount; i++)
+		{
+			SolveContact(pContacts[i]);
+		}
+	}
+
+	bool bStill = true;
+	const int* pBodies = m_islandBodies.data() + island.firstBody;
+	for (int i = 0; i < island.bodyCount; i++)
+	{
+		BODY& body = m_bodies[pBodies[i]];
+		IntegratePosition(body);
+		bStill = bStill && (body.stillSteps >= g_SleepSteps);
+	}
+
+	if (bStill)
+	{
+		for (int i = 0; i < island.bodyCount; i++)
+		{
+			BODY& body = m_bodies[pBodies[i]];
+			body.linearVelocity = glm::vec3(0.0f);
+			body.angularVelocity = glm::vec3(0.0f);
+			body.bAwake = false;
+		}
+	}
+}
+
+/***********************************************************
+ *  PrepareContact()
+ *
+ *  This method is used for working out the values of a
+ *  contact that stay the same over the solver iterations -
+ *  the lever arms, the masses the impulses act against
+ *  along the normal and the two friction directions, and
+ *  the speed that pushes the overlap out and bounces the
+ *  bodies off a fast hit.
+ ***********************************************************/
+void PhysicsWorld::PrepareContact(CONTACT& contact) const
+{
+	const BODY& a = m_bodies[contact.bodyA];
+	const BODY& b = m_bodies[contact.bodyB];
+	const glm::vec3& normal = contact.normal;
+	contact.offsetA = contact.point - a.position;
+	contact.offsetB = contact.point - b.position;
+
+	if (std::fabs(normal.x) >= 0.57735f)
+	{
+		contact.tangents[0] = glm::normalize(glm::vec3(normal.y, -normal.x, 0.0f));
+	}
+	else
+	{
+		contact.tangents[0] = glm::normalize(glm::vec3(0.0f, normal.z, -normal.y));
+	}
+	contact.tangents[1] = glm::cross(normal, contact.tangents[0]);
+
+	glm::vec3 directions[3] = { normal, contact.tangents[0], contact.tangents[1] };
+	float masses[3];
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec3 armA = glm::cross(contact.offsetA, directions[i]);
+		glm::vec3 armB = glm::cross(contact.offsetB, directions[i]);
+		float mass = a.inverseMass + b.inverseMass +
+			glm::dot(armA, a.inverseInertiaWorld * armA) + glm::dot(armB, b.inverseInertiaWorld * armB);
+		masses[i] = (mass > 0.0f) ? (1.0f / mass) : 0.0f;
+	}
+	contact.normalMass = masses[0];
+	contact.tangentMass[0] = masses[1];
+	contact.tangentMass[1] = masses[2];
+
+	glm::vec3 relativeVelocity =
+		(b.linearVelocity + glm::cross(b.angularVelocity, contact.offsetB)) -
+		(a.linearVelocity + glm::cross(a.angularVelocity, contact.offsetA));
+	float normalSpeed = glm::dot(relativeVelocity, normal);
+	contact.bias = (g_Baumgarte / g_TimeStep) * std::max(contact.penetration - g_Slop, 0.0f);
+	if (normalSpeed < -g_RestitutionSpeed)
+	{
+		contact.bias = std::max(contact.bias, -g_Restitution * normalSpeed);
+	}
+
+	contact.normalImpulse = 0.0f;
+	contact.tangentImpulse[0] = 0.0f;
+	contact.tangentImpulse[1] = 0.0f;
+}
+
+/***********************************************************
+ *  SolveContact()
+ *
+ *  This method is used for one solver iteration of a
+ *  contact.  Friction is solved first and held within the
+ *  cone of the normal impulse, then the normal impulse
+ *  stops the bodies from moving into each other.  The
+ *  impulses are added up and clamped as totals, so an
+ *  iteration can take back what an earlier one pushed too
+ *  far.  Static bodies are never written, since several
+ *  islands read them at once.
+ ***********************************************************/
+void PhysicsWorld::SolveContact(CONTACT& contact)
+{
+	BODY& a = m_bodies[contact.bodyA];
+	BODY& b = m_bodies[contact.bodyB];
+
+	auto relativeVelocity = [&a, &b, &contact]() {
+		return((b.linearVelocity + glm::cross(b.angularVelocity, contact.offsetB)) -
+			(a.linearVelocity + glm::cross(a.angularVelocity, contact.offsetA)));
+	};
+	auto applyImpulse = [&a, &b, &contact](const glm::vec3& impulse) {
+		if (a.inverseMass > 0.0f)
+		{
+			a.linearVelocity -= impulse * a.inverseMass;
+			a.angularVelocity -= a.inverseInertiaWorld * glm::cross(contact.offsetA, impulse);
+		}
+		if (b.inverseMass > 0.0f)
+		{
+			b.linearVelocity += impulse * b.inverseMass;
+			b.angularVelocity += b.inverseInertiaWorld * glm::cross(contact.offsetB, impulse);
+		}
+	};
+
+	float maxFriction = g_Friction * contact.normalImpulse;
+	for (int i = 0; i < 2; i++)
+	{
+		float lambda = -glm::dot(relativeVelocity(), contact.tangents[i]) * contact.tangentMass[i];
+		float total = std::min(std::max(contact.tangentImpulse[i] + lambda, -maxFriction), maxFriction);
+		lambda = total - contact.tangentImpulse[i];
+		contact.tangentImpulse[i] = total;
+		applyImpulse(contact.tangents[i] * lambda);
+	}
+
+	float normalSpeed = glm::dot(relativeVelocity(), contact.normal);
+	float lambda = (contact.bias - normalSpeed) * contact.normalMass;
+	float total = std::max(contact.normalImpulse + lambda, 0.0f);
+	lambda = total - contact.normalImpulse;
+	contact.normalImpulse = total;
+	applyImpulse(contact.normal * lambda);
+}
+
+/***********************************************************
+ *  IntegratePosition()
+ *
+ *  This method is used for moving a body on by its
+ *  velocity, damping the velocity a little, and counting
+ *  the steps the body has been nearly still for.
+ ***********************************************************/
+void PhysicsWorld::IntegratePosition(BODY& body) const
+{
+	if ((body.inverseMass <= 0.0f) || (body.bAwake == false))
+	{
+		return;
+	}
+
+	body.linearVelocity *= 1.0f / (1.0f + (g_TimeStep * g_LinearDamping));
+	body.angularVelocity *= 1.0f / (1.0f + (g_TimeStep * g_AngularDamping));
+	body.position += body.linearVelocity * g_TimeStep;
+
+	const glm::vec3& spin = body.angularVelocity;
+	glm::quat turn = glm::quat(0.0f, spin.x, spin.y, spin.z) * body.orientation;
+	body.orientation = glm::normalize(body.orientation + (turn * (0.5f * g_TimeStep)));
+
+	float speedSquared = std::max(glm::dot(body.linearVelocity, body.linearVelocity),
+		glm::dot(body.angularVelocity, body.angularVelocity));
+	body.stillSteps = (speedSquared < g_SleepSpeedSquared) ? (body.stillSteps + 1) : 0;
+	UpdateDerived(body);
+}
+
+/***********************************************************
+ *  UpdateDerived()
+ *
+ *  This method is used for working out the values that
+ *  follow from the orientation - the rotation matrix, the
+ *  inverse inertia in world space, and the bounding box,
+ *  which takes the absolute rotation of the half size.  The
+ *  box of a cylinder adds its turned axis to the radius of
+ *  its caps, and the box of a plane reaches as far below
+ *  its face as the plane is wide, so a body pushed deep
+ *  into it is still found.
+ ***********************************************************/
+void PhysicsWorld::UpdateDerived(BODY& body)
+{
+	body.rotation = glm::mat3_cast(body.orientation);
+	glm::mat3 inertia(
+		glm::vec3(body.inverseInertia.x, 0.0f, 0.0f),
+		glm::vec3(0.0f, body.inverseInertia.y, 0.0f),
+		glm::vec3(0.0f, 0.0f, body.inverseInertia.z));
+	body.inverseInertiaWorld = body.rotation * inertia * glm::transpose(body.rotation);
+
+	glm::vec3 center = body.position;
+	glm::vec3 extent;
+	if (body.type == COLLIDER_SPHERE)
+	{
+		extent = glm::vec3(body.size.x);
+	}
+	else if (body.type == COLLIDER_CYLINDER)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			float along = std::fabs(body.rotation[1][i]);
+			extent[i] = (along * body.size.y) + (body.size.x * std::sqrt(std::max(1.0f - (along * along), 0.0f)));
+		}
+	}
+	else
+	{
+		glm::vec3 half = body.size;
+		if (body.type == COLLIDER_PLANE)
+		{
+			half.y = std::max(body.size.x, body.size.z) * 0.5f;
+			center -= body.rotation[1] * half.y;
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			extent[i] = (std::fabs(body.rotation[0][i]) * half.x) +
+				(std::fabs(body.rotation[1][i]) * half.y) +
+				(std::fabs(body.rotation[2][i]) * half.z);
+		}
+	}
+	body.boundsMin = center - extent;
+	body.boundsMax = center + extent;
+}
+
+/***********************************************************
+ *  CollideSpheres()
+ *
+ *  This method is used for adding the contact of two
+ *  spheres that overlap.
+ ***********************************************************/
+void PhysicsWorld::CollideSpheres(const BODY& a, const BODY& b, int indexA, int indexB, std::vector<CONTACT>& contacts)
+{
+	glm::vec3 offset = b.position - a.position;
+	float radii = a.size.x + b.size.x;
+	float distanceSquared = glm::dot(offset, offset);
+	if (distanceSquared >= radii * radii)
+	{
+		return;
+	}
+
+	float distance = std::sqrt(distanceSquared);
+	CONTACT contact;
+	contact.bodyA = indexA;
+	contact.bodyB = indexB;
+	contact.normal = (distance > 0.000001f) ? (offset / distance) : glm::vec3(0.0f, 1.0f, 0.0f);
+	contact.penetration = radii - distance;
+	contact.point = a.position + (contact.normal * (a.size.x - (contact.penetration * 0.5f)));
+	contacts.push_back(contact);
+}
+
+/***********************************************************
+ *  CollideSphereBox()
+ *
+ *  This method is used for adding the contact of a sphere
+ *  and a box.  The center of the sphere is brought into the
+ *  space of the box and clamped to it, which gives the
+ *  closest point.  A center inside the box is pushed out
+ *  through the nearest face.
+ ***********************************************************/
+void PhysicsWorld::CollideSphereBox(const BODY& sphere, const BODY& box, int sphereIndex, int boxIndex,
+	bool bSphereFirst, std::vector<CONTACT>& contacts)
+{
+	float radius = sphere.size.x;
+	glm::vec3 local = glm::transpose(box.rotation) * (sphere.position - box.position);
+	glm::vec3 closest = glm::clamp(local, -box.size, box.size);
+	glm::vec3 difference = local - closest;
+	float distanceSquared = glm::dot(difference, difference);
+	if (distanceSquared > radius * radius)
+	{
+		return;
+	}
+
+	glm::vec3 normal;
+	float penetration;
+	if (distanceSquared > 0.000001f)
+	{
+		float distance = std::sqrt(distanceSquared);
+		normal = difference / distance;
+		penetration = radius - distance;
+	}
+	else
+	{
+		int axis = 0;
+		float nearest = box.size.x - std::fabs(local.x);
+		for (int i = 1; i < 3; i++)
+		{
+			float depth = box.size[i] - std::fabs(local[i]);
+			if (depth < nearest)
+			{
+				nearest = depth;
+				axis = i;
+			}
+		}
+		normal = glm::vec3(0.0f);
+		normal[axis] = (local[axis] >= 0.0f) ? 1.0f : -1.0f;
+		closest[axis] = normal[axis] * box.size[axis];
+		penetration = radius + nearest;
+	}
+
+	// the normal points from the box to the sphere
+	CONTACT contact;
+	glm::vec3 worldNormal = box.rotation * normal;
+	contact.bodyA = bSphereFirst ? sphereIndex : boxIndex;
+	contact.bodyB = bSphereFirst ? boxIndex : sphereIndex;
+	contact.normal = bSphereFirst ? -worldNormal : worldNormal;
+	contact.penetration = penetration;
+	contact.point = box.position + (box.rotation * closest);
+	contacts.push_back(contact);
+}
+
+/***********************************************************
+ *  CollideSphereCylinder()
+ *
+ *  This method is used for adding the contact of a sphere
+ *  and a cylinder.  The center of the sphere is brought
+ *  into the space of the cylinder, pulled in to its radius
+ *  and clamped to its height, which gives the closest
+ *  point.  A center inside the cylinder is pushed out
+ *  through the side or the cap that is nearest.
+ ***********************************************************/
+void PhysicsWorld::CollideSphereCylinder(const BODY& sphere, const BODY& cylinder, int sphereIndex, int cylinderIndex,
+	std::vector<CONTACT>& contacts)
+{
+	float radius = sphere.size.x;
+	glm::vec3 local = glm::transpose(cylinder.rotation) * (sphere.position - cylinder.position);
+	float radial = std::sqrt((local.x * local.x) + (local.z * local.z));
+	glm::vec3 closest = local;
+	if (radial > cylinder.size.x)
+	{
+		closest.x *= cylinder.size.x / radial;
+		closest.z *= cylinder.size.x / radial;
+	}
+	closest.y = std::min(std::max(local.y, -cylinder.size.y), cylinder.size.y);
+	glm::vec3 difference = local - closest;
+	float distanceSquared = glm::dot(difference, difference);
+	if (distanceSquared > radius * radius)
+	{
+		return;
+	}
+
+	glm::vec3 normal;
+	float penetration;
+	if (distanceSquared > 0.000001f)
+	{
+		float distance = std::sqrt(distanceSquared);
+		normal = difference / distance;
+		penetration = radius - distance;
+	}
+	else
+	{
+		float sideDepth = cylinder.size.x - radial;
+		float capDepth = cylinder.size.y - std::fabs(local.y);
+		if ((sideDepth < capDepth) && (radial > 0.000001f))
+		{
+			normal = glm::vec3(local.x / radial, 0.0f, local.z / radial);
+			closest.x = normal.x * cylinder.size.x;
+			closest.z = normal.z * cylinder.size.x;
+			penetration = radius + sideDepth;
+		}
+		else
+		{
+			normal = glm::vec3(0.0f, (local.y >= 0.0f) ? 1.0f : -1.0f, 0.0f);
+			closest.y = normal.y * cylinder.size.y;
+			penetration = radius + capDepth;
+		}
+	}
+
+	// the normal points from the sphere to the cylinder
+	CONTACT contact;
+	contact.bodyA = sphereIndex;
+	contact.bodyB = cylinderIndex;
+	contact.normal = -(cylinder.rotation * normal);
+	contact.penetration = penetration;
+	contact.point = cylinder.position + (cylinder.rotation * closest);
+	contacts.push_back(contact);
+}
+
+/***********************************************************
+ *  CollideSpherePlane()
+ *
+ *  This method is used for adding the contact of a sphere
+ *  whose center is over a plane and that reaches below its
+ *  face.  However deep the sphere is, it is pushed back out
+ *  through the face.
+ ***********************************************************/
+void PhysicsWorld::CollideSpherePlane(const BODY& sphere, const BODY& plane, int sphereIndex, int planeIndex,
+	std::vector<CONTACT>& contacts)
+{
+	float radius = sphere.size.x;
+	glm::vec3 local = glm::transpose(plane.rotation) * (sphere.position - plane.position);
+	if ((local.y >= radius) || (std::fabs(local.x) > plane.size.x) || (std::fabs(local.z) > plane.size.z))
+	{
+		return;
+	}
+
+	// the normal points from the sphere into the plane
+	CONTACT contact;
+	contact.bodyA = sphereIndex;
+	contact.bodyB = planeIndex;
+	contact.normal = -plane.rotation[1];
+	contact.penetration = radius - local.y;
+	contact.point = sphere.position - (plane.rotation[1] * local.y);
+	contacts.push_back(contact);
+}
+
+/***********************************************************
+ *  CollideBoxCorners()
+ *
+ *  This method is used for adding a contact for every
+ *  corner of one box that is inside another box.  The
+ *  corners are brought into the space of the box four at a
+ *  time, and each corner inside is pushed out through the
+ *  nearest face.  Two boxes that only cross at their edges
+ *  have no corner inside, and get their contact from
+ *  CollideBoxEdges() instead.
+ ***********************************************************/
+void PhysicsWorld::CollideBoxCorners(const BODY& corners, const BODY& box, int cornersIndex, int boxIndex,
+	bool bCornersFirst, std::vector<CONTACT>& contacts)
+{
+	glm::mat3 toBox = glm::transpose(box.rotation);
+	glm::mat3 relative = toBox * corners.rotation;
+	glm::vec3 offset = toBox * (corners.position - box.position);
+	const glm::vec3& half = corners.size;
+
+	// corner local positions and depths inside the box per face
+	float localX[8];
+	float localY[8];
+	float localZ[8];
+	int insideMask = 0;
+#ifdef PHYSICS_SIMD
+	__m128 signsX = _mm_set_ps(half.x, -half.x, half.x, -half.x);
+	__m128 signsY = _mm_set_ps(half.y, half.y, -half.y, -half.y);
+	__m128 zero = _mm_setzero_ps();
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	for (int group = 0; group < 2; group++)
+	{
+		__m128 signsZ = _mm_set1_ps((group == 0) ? -half.z : half.z);
+		__m128 axes[3];
+		for (int i = 0; i < 3; i++)
+		{
+			axes[i] = _mm_add_ps(_mm_set1_ps(offset[i]),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(relative[0][i]), signsX),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(relative[1][i]), signsY),
+						_mm_mul_ps(_mm_set1_ps(relative[2][i]), signsZ))));
+		}
+		__m128 inside = _mm_and_ps(
+			_mm_cmpgt_ps(_mm_sub_ps(_mm_set1_ps(box.size.x), _mm_andnot_ps(signMask, axes[0])), zero),
+			_mm_and_ps(
+				_mm_cmpgt_ps(_mm_sub_ps(_mm_set1_ps(box.size.y), _mm_andnot_ps(signMask, axes[1])), zero),
+				_mm_cmpgt_ps(_mm_sub_ps(_mm_set1_ps(box.size.z), _mm_andnot_ps(signMask, axes[2])), zero)));
+		insideMask |= _mm_movemask_ps(inside) << (group * 4);
+		_mm_storeu_ps(localX + (group * 4), axes[0]);
+		_mm_storeu_ps(localY + (group * 4), axes[1]);
+		_mm_storeu_ps(localZ + (group * 4), axes[2]);
+	}
+#else
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 sign(
+			(corner & 1) ? half.x : -half.x,
+			(corner & 2) ? half.y : -half.y,
+			(corner & 4) ? half.z : -half.z);
+		glm::vec3 local = offset + (relative * sign);
+		localX[corner] = local.x;
+		localY[corner] = local.y;
+		localZ[corner] = local.z;
+		if ((std::fabs(local.x) < box.size.x) && (std::fabs(local.y) < box.size.y) && (std::fabs(local.z) < box.size.z))
+		{
+			insideMask |= (1 << corner);
+		}
+	}
+#endif
+
+	for (int corner = 0; (insideMask != 0) && (corner < 8); corner++)
+	{
+		if ((insideMask & (1 << corner)) == 0)
+		{
+			continue;
+		}
+
+		glm::vec3 local(localX[corner], localY[corner], localZ[corner]);
+		int axis = 0;
+		float nearest = box.size.x - std::fabs(local.x);
+		for (int i = 1; i < 3; i++)
+		{
+			float depth = box.size[i] - std::fabs(local[i]);
+			if (depth < nearest)
+			{
+				nearest = depth;
+				axis = i;
+			}
+		}
+		glm::vec3 normal(0.0f);
+		normal[axis] = (local[axis] >= 0.0f) ? 1.0f : -1.0f;
+
+		// the normal points from the box to the corners
+		CONTACT contact;
+		glm::vec3 worldNormal = box.rotation * normal;
+		contact.bodyA = bCornersFirst ? cornersIndex : boxIndex;
+		contact.bodyB = bCornersFirst ? boxIndex : cornersIndex;
+		contact.normal = bCornersFirst ? -worldNormal : worldNormal;
+		contact.penetration = nearest;
+		contact.point = box.position + (box.rotation * local);
+		contacts.push_back(contact);
+	}
+}
+
+/***********************************************************
+ *  CollideBoxEdges()
+ *
+ *  This method is used for adding the contact of two boxes
+ *  that cross at an edge of each.  The boxes are tested for
+ *  overlap along the three face normals of each and the
+ *  nine crossings of their edge directions.  When a pair of
+ *  edges overlaps clearly the least, the boxes are pushed
+ *  apart along its crossing at the point between the two
+ *  closest points of those edges - otherwise the corner
+ *  contacts already hold the boxes apart.
+ ***********************************************************/
+void PhysicsWorld::CollideBoxEdges(const BODY& a, const BODY& b, int indexA, int indexB, std::vector<CONTACT>& contacts)
+{
+	// the axes of the second box and its offset in the space of the
+	// first box
+	glm::mat3 toA = glm::transpose(a.rotation);
+	glm::mat3 relative = toA * b.rotation;
+	glm::vec3 offset = toA * (b.position - a.position);
+
+	float facePenetration = FLT_MAX;
+	for (int i = 0; i < 3; i++)
+	{
+		float reachB = (std::fabs(relative[0][i]) * b.size.x) + (std::fabs(relative[1][i]) * b.size.y) +
+			(std::fabs(relative[2][i]) * b.size.z);
+		float reachA = (std::fabs(relative[i].x) * a.size.x) + (std::fabs(relative[i].y) * a.size.y) +
+			(std::fabs(relative[i].z) * a.size.z);
+		float penetrationA = a.size[i] + reachB - std::fabs(offset[i]);
+		float penetrationB = reachA + b.size[i] - std::fabs(glm::dot(offset, relative[i]));
+		facePenetration = std::min(facePenetration, std::min(penetrationA, penetrationB));
+	}
+	if (facePenetration <= 0.0f)
+	{
+		return;
+	}
+
+	float edgePenetration = FLT_MAX;
+	int edgeA = -1;
+	int edgeB = -1;
+	glm::vec3 edgeAxis;
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			glm::vec3 unit(0.0f);
+			unit[i] = 1.0f;
+			glm::vec3 axis = glm::cross(unit, relative[j]);
+			float length = glm::length(axis);
+			// edges that are nearly parallel are covered by the faces
+			if (length < 0.001f)
+			{
+				continue;
+			}
+			axis /= length;
+
+			float reachA = (std::fabs(axis.x) * a.size.x) + (std::fabs(axis.y) * a.size.y) + (std::fabs(axis.z) * a.size.z);
+			float reachB = (std::fabs(glm::dot(axis, relative[0])) * b.size.x) +
+				(std::fabs(glm::dot(axis, relative[1])) * b.size.y) +
+				(std::fabs(glm::dot(axis, relative[2])) * b.size.z);
+			float penetration = reachA + reachB - std::fabs(glm::dot(offset, axis));
+			if (penetration <= 0.0f)
+			{
+				return;
+			}
+			if (penetration < edgePenetration)
+			{
+				edgePenetration = penetration;
+				edgeA = i;
+				edgeB = j;
+				edgeAxis = (glm::dot(offset, axis) >= 0.0f) ? axis : -axis;
+			}
+		}
+	}
+	if ((edgeA < 0) || (edgePenetration >= facePenetration * g_EdgeAxisBias))
+	{
+		return;
+	}
+
+	// the crossing edges are the ones the furthest into each other
+	// along the axis
+	glm::vec3 cornerA(0.0f);
+	glm::vec3 cornerB(0.0f);
+	for (int k = 0; k < 3; k++)
+	{
+		if (k != edgeA)
+		{
+			cornerA[k] = (edgeAxis[k] >= 0.0f) ? a.size[k] : -a.size[k];
+		}
+		if (k != edgeB)
+		{
+			cornerB[k] = (glm::dot(edgeAxis, relative[k]) >= 0.0f) ? -b.size[k] : b.size[k];
+		}
+	}
+	glm::vec3 pointA = a.position + (a.rotation * cornerA);
+	glm::vec3 pointB = b.position + (b.rotation * cornerB);
+	glm::vec3 directionA = a.rotation[edgeA];
+	glm::vec3 directionB = b.rotation[edgeB];
+
+	// closest points of the two edge lines, kept on the edges
+	glm::vec3 between = pointA - pointB;
+	float cosine = glm::dot(directionA, directionB);
+	float alongA = glm::dot(directionA, between);
+	float alongB = glm::dot(directionB, between);
+	float denominator = std::max(1.0f - (cosine * cosine), 0.000001f);
+	float s = ((cosine * alongB) - alongA) / denominator;
+	s = std::min(std::max(s, -a.size[edgeA]), a.size[edgeA]);
+	float t = alongB + (cosine * s);
+	t = std::min(std::max(t, -b.size[edgeB]), b.size[edgeB]);
+
+	CONTACT contact;
+	contact.bodyA = indexA;
+	contact.bodyB = indexB;
+	contact.normal = a.rotation * edgeAxis;
+	contact.penetration = edgePenetration;
+	contact.point = ((pointA + (directionA * s)) + (pointB + (directionB * t))) * 0.5f;
+	contacts.push_back(contact);
+}
+
+/***********************************************************
+ *  GetOutlinePoints()
+ *
+ *  This method is used for getting the points a box or a
+ *  cylinder is tested by - the corners of a box, or four
+ *  points round each cap of a cylinder.  The first point of
+ *  a cap lies the furthest along the direction, so a
+ *  cylinder on its side touches with its two lowest
+ *  points, and the others are a quarter turn apart, so a
+ *  cylinder standing on a cap rests on four.
+ ***********************************************************/
+void PhysicsWorld::GetOutlinePoints(const BODY& body, const glm::vec3& direction, glm::vec3 points[8])
+{
+	if (body.type == COLLIDER_BOX)
+	{
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 sign(
+				(corner & 1) ? body.size.x : -body.size.x,
+				(corner & 2) ? body.size.y : -body.size.y,
+				(corner & 4) ? body.size.z : -body.size.z);
+			points[corner] = body.position + (body.rotation * sign);
+		}
+		return;
+	}
+
+	glm::vec3 axis = body.rotation[1];
+	glm::vec3 across = direction - (axis * glm::dot(direction, axis));
+	float lengthSquared = glm::dot(across, across);
+	across = (lengthSquared > 0.000001f) ? (across / std::sqrt(lengthSquared)) : body.rotation[0];
+	glm::vec3 side = glm::cross(axis, across);
+	glm::vec3 rim[4] = { across, -across, side, -side };
+	for (int cap = 0; cap < 2; cap++)
+	{
+		glm::vec3 capCenter = body.position + (axis * ((cap == 0) ? -body.size.y : body.size.y));
+		for (int i = 0; i < 4; i++)
+		{
+			points[(cap * 4) + i] = capCenter + (rim[i] * body.size.x);
+		}
+	}
+}
+
+/***********************************************************
+ *  GetPointDepth()
+ *
+ *  This method is used for finding whether a point is
+ *  inside a box, a cylinder or a plane, how deep it is and
+ *  the normal it is pushed out along.  A point in a box or
+ *  a cylinder goes out through the nearest face, and a
+ *  point under a plane goes back out through its face.
+ ***********************************************************/
+bool PhysicsWorld::GetPointDepth(const BODY& body, const glm::vec3& point, glm::vec3& normal, float& depth)
+{
+	glm::vec3 local = glm::transpose(body.rotation) * (point - body.position);
+	glm::vec3 localNormal(0.0f);
+	if (body.type == COLLIDER_PLANE)
+	{
+		if ((local.y >= 0.0f) || (std::fabs(local.x) > body.size.x) || (std::fabs(local.z) > body.size.z))
+		{
+			return(false);
+		}
+		localNormal.y = 1.0f;
+		depth = -local.y;
+	}
+	else if (body.type == COLLIDER_CYLINDER)
+	{
+		float radial = std::sqrt((local.x * local.x) + (local.z * local.z));
+		float sideDepth = body.size.x - radial;
+		float capDepth = body.size.y - std::fabs(local.y);
+		if ((sideDepth <= 0.0f) || (capDepth <= 0.0f))
+		{
+			return(false);
+		}
+		if ((sideDepth < capDepth) && (radial > 0.000001f))
+		{
+			localNormal = glm::vec3(local.x / radial, 0.0f, local.z / radial);
+			depth = sideDepth;
+		}
+		else
+		{
+			localNormal.y = (local.y >= 0.0f) ? 1.0f : -1.0f;
+			depth = capDepth;
+		}
+	}
+	else
+	{
+		int axis = -1;
+		for (int i = 0; i < 3; i++)
+		{
+			float faceDepth = body.size[i] - std::fabs(local[i]);
+			if (faceDepth <= 0.0f)
+			{
+				return(false);
+			}
+			if ((axis < 0) || (faceDepth < depth))
+			{
+				depth = faceDepth;
+				axis = i;
+			}
+		}
+		localNormal[axis] = (local[axis] >= 0.0f) ? 1.0f : -1.0f;
+	}
+	normal = body.rotation * localNormal;
+	return(true);
+}
+
+/***********************************************************
+ *  CollideOutline()
+ *
+ *  This method is used for adding a contact for every
+ *  outline point of a box or a cylinder that is inside
+ *  another body.  The points of a cylinder are turned
+ *  towards the closest point of the other body, or straight
+ *  down into a plane, so the deepest ones are among them.
+ ***********************************************************/
+void PhysicsWorld::CollideOutline(const BODY& outline, const BODY& body, int outlineIndex, int bodyIndex,
+	bool bOutlineFirst, std::vector<CONTACT>& contacts)
+{
+	glm::vec3 direction = -body.rotation[1];
+	if ((outline.type == COLLIDER_CYLINDER) && (body.type != COLLIDER_PLANE))
+	{
+		glm::vec3 local = glm::transpose(body.rotation) * (outline.position - body.position);
+		glm::vec3 closest;
+		if (body.type == COLLIDER_CYLINDER)
+		{
+			float radial = std::sqrt((local.x * local.x) + (local.z * local.z));
+			float scale = (radial > body.size.x) ? (body.size.x / radial) : 1.0f;
+			closest = glm::vec3(local.x * scale, std::min(std::max(local.y, -body.size.y), body.size.y), local.z * scale);
+		}
+		else
+		{
+			closest = glm::clamp(local, -body.size, body.size);
+		}
+		direction = body.rotation * (closest - local);
+		if (glm::dot(direction, direction) < 0.000001f)
+		{
+			direction = body.position - outline.position;
+		}
+	}
+
+	glm::vec3 points[8];
+	GetOutlinePoints(outline, direction, points);
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 normal;
+		float depth;
+		if (GetPointDepth(body, points[i], normal, depth) == false)
+		{
+			continue;
+		}
+
+		// the normal points from the body to the outline
+		CONTACT contact;
+		contact.bodyA = bOutlineFirst ? outlineIndex : bodyIndex;
+		contact.bodyB = bOutlineFirst ? bodyIndex : outlineIndex;
+		contact.normal = bOutlineFirst ? -normal : normal;
+		contact.penetration = depth;
+		contact.point = points[i];
+		contacts.push_back(contact);
+	}
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the average time of
+ *  every phase of a step and the work it did.
+ ***********************************************************/
+void PhysicsWorld::PrintStats() const
+{
+	double steps = (double)std::max(m_steps, (int64_t)1);
+	std::cout << "Physics: " << m_bodies.size() << " bodies over " << m_steps << " steps, "
+		<< ((double)m_pairTotal / steps) << " pairs, "
+		<< ((double)m_contactTotal / steps) << " contacts, "
+		<< ((double)m_islandTotal / steps) << " islands per step" << std::endl;
+	std::cout << "  ms per step:";
+	for (int i = 0; i < 4; i++)
+	{
+		std::cout << " " << g_PhaseNames[i] << " " << ((double)m_phaseMicroseconds[i] / (steps * 1000.0));
+	}
+	std::cout << std::endl;
+}
+
+/***********************************************************
+ *  RunBenchmark()
+ *
+ *  This method is used for timing the steps of a pile of
+ *  bodies.  Spheres, boxes and cylinders are dropped in
+ *  layers onto a static ground plane, once with every phase on the calling
+ *  thread and once spread over the job system, so the two
+ *  times show how well the steps scale.
+ ***********************************************************/
+bool PhysicsWorld::RunBenchmark(int bodyCount, int stepCount)
+{
+	if ((bodyCount <= 0) || (stepCount <= 0))
+	{
+		std::cout << "The physics benchmark needs at least one body and step" << std::endl;
+		return(false);
+	}
+
+	JobSystem jobSystem;
+	int side = (int)std::ceil(std::sqrt((double)bodyCount / (double)g_BenchmarkLayers));
+	float groundHalfSize = (float)side * g_BenchmarkSpacing;
+	std::cout << "Physics benchmark - " << bodyCount << " bodies, " << stepCount << " steps, "
+		<< (IsSimdEnabled() ? "SSE" : "scalar") << " contacts" << std::endl;
+
+	double serialMilliseconds = 0.0;
+	for (int run = 0; run < 2; run++)
+	{
+		PhysicsWorld world((run == 0) ? NULL : &jobSystem);
+		glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+		world.AddBody(COLLIDER_PLANE, glm::vec3(groundHalfSize, 0.0f, groundHalfSize), glm::vec3(0.0f), identity, 0.0f);
+		for (int i = 0; i < bodyCount; i++)
+		{
+			int layer = i / (side * side);
+			int row = (i / side) % side;
+			int column = i % side;
+			// every other layer is shifted, so the bodies land on the
+			// edges of the ones below and tip over
+			float shift = (layer & 1) ? (g_BenchmarkSpacing * 0.3f) : 0.0f;
+			glm::vec3 position(
+				(((float)column - ((float)side * 0.5f)) * g_BenchmarkSpacing) + shift,
+				1.0f + ((float)layer * g_BenchmarkSpacing),
+				(((float)row - ((float)side * 0.5f)) * g_BenchmarkSpacing) + shift);
+			glm::quat orientation = glm::angleAxis(glm::radians((float)(i % 90)), glm::vec3(0.0f, 1.0f, 0.0f));
+			world.AddBody(COLLIDER_SPHERE + (i % 3), glm::vec3(g_BenchmarkHalfSize), position, orientation, 1.0f);
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int step = 0; step < stepCount; step++)
+		{
+			world.Step();
+		}
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		if (run == 0)
+		{
+			serialMilliseconds = milliseconds;
+			std::cout << "  calling thread: " << (milliseconds / (double)stepCount) << " ms per step" << std::endl;
+		}
+		else
+		{
+			std::cout << "  " << (jobSystem.GetWorkerCount() + 1) << " threads: "
+				<< (milliseconds / (double)stepCount) << " ms per step, "
+				<< (serialMilliseconds / std::max(milliseconds, 0.001)) << "x faster" << std::endl;
+		}
+		world.PrintStats();
+	}
+	return(true);
+}
@@ -0,0 +1,229 @@
+///////////////////////////////////////////////////////////////////////////////
+// physicsworld.h
+// ============
+// simulate the scene objects as rigid bodies at a fixed time step
+//
+//	Every body collides as a sphere, an oriented box, a cylinder or a
+//	plane, which is a static half-space under a rectangle.  A step moves
+//	the bodies on under gravity, finds the pairs whose bounding boxes
+//	overlap by keeping the boxes sorted along one axis, and works out the
+//	contacts of those pairs - the box corners are tested four at a time
+//	with SIMD math, and a cylinder is tested by points round its caps.  The bodies that touch are joined into islands, which
+//	share no moving bodies, so the islands are solved in parallel on the
+//	job system.  Islands that come to rest are put to sleep until
+//	something hits them.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class JobSystem;
+
+/***********************************************************
+ *  PhysicsWorld
+ *
+ *  This class contains the rigid bodies and the code for
+ *  stepping them.
+ ***********************************************************/
+class PhysicsWorld
+{
+public:
+	// shapes the bodies collide as
+	enum COLLIDER_TYPE
+	{
+		COLLIDER_SPHERE = 0,
+		COLLIDER_BOX,
+		COLLIDER_CYLINDER,
+		COLLIDER_PLANE
+	};
+
+	// constructor - without a job system the steps run on the calling
+	// thread
+	PhysicsWorld(JobSystem* pJobSystem);
+
+	// check whether the contacts are found with SIMD instructions
+	static bool IsSimdEnabled();
+
+	// add a body and get its index - the size is the radius of a sphere
+	// in x, the half size of a box, the radius in x and the half height
+	// in y of a cylinder along its y axis, or the half size in x and z
+	// of a plane facing along its y axis, and a mass of zero makes a
+	// static body that never moves - planes are always static
+	int AddBody(int type, const glm::vec3& size, const glm::vec3& position, const glm::quat& orientation, float mass);
+	// push a body at a point, which wakes it up
+	void ApplyImpulse(int body, const glm::vec3& impulse, const glm::vec3& point);
+
+	// run as many fixed steps as fit in the elapsed time and get the
+	// number of steps run
+	int Update(double elapsedSeconds);
+	// run one fixed step
+	void Step();
+
+	// get the number of bodies
+	int GetBodyCount() const { return((int)m_bodies.size()); }
+	// get the mass of a body, or zero for a static body
+	float GetMass(int body) const;
+	// check whether a body moves and is not asleep
+	bool IsAwake(int body) const;
+	// get the transform of a body, without its size
+	glm::mat4 GetTransform(int body) const;
+
+	// print how long the phases of the steps took
+	void PrintStats() const;
+	// time the steps of many bodies falling into a pile and print
+	// the result
+	static bool RunBenchmark(int bodyCount, int stepCount);
+
+private:
+	// one rigid body
+	struct BODY
+	{
+		int type;
+		// half size of a box or a plane, the radius in x for a sphere,
+		// or the radius in x and half height in y for a cylinder
+		glm::vec3 size;
+		glm::vec3 position;
+		glm::quat orientation;
+		glm::mat3 rotation;
+		glm::vec3 linearVelocity;
+		glm::vec3 angularVelocity;
+		float inverseMass;
+		// inverse inertia around the body axes and in world space
+		glm::vec3 inverseInertia;
+		glm::mat3 inverseInertiaWorld;
+		// world space bounding box
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		// steps the body has been nearly still for
+		int stillSteps;
+		bool bAwake;
+	};
+
+	// one point where two bodies touch
+	struct CONTACT
+	{
+		int bodyA;
+		int bodyB;
+		glm::vec3 point;
+		// normal from the first body towards the second
+		glm::vec3 normal;
+		float penetration;
+		// values worked out before the solver iterations
+		glm::vec3 offsetA;
+		glm::vec3 offsetB;
+		glm::vec3 tangents[2];
+		float normalMass;
+		float tangentMass[2];
+		float bias;
+		// impulses added up over the iterations
+		float normalImpulse;
+		float tangentImpulse[2];
+	};
+
+	// a pair of bodies whose bounding boxes overlap
+	struct PAIR
+	{
+		int bodyA;
+		int bodyB;
+	};
+
+	// group of touching bodies that is solved on its own
+	struct ISLAND
+	{
+		int firstBody;
+		int bodyCount;
+		int firstContact;
+		int contactCount;
+	};
+
+	// job system the steps are spread over, or NULL
+	JobSystem* m_pJobSystem;
+	glm::vec3 m_gravity;
+	double m_accumulator;
+
+	std::vector<BODY> m_bodies;
+	// body indices sorted by the low side of their bounding boxes on
+	// the sweep axis
+	std::vector<int> m_sortedBodies;
+	std::vector<PAIR> m_pairs;
+	// contacts found by every block of pairs, gathered into one list
+	std::vector<std::vector<CONTACT> > m_blockContacts;
+	std::vector<CONTACT> m_contacts;
+	// axis the bodies are swept along, and their bounds in sorted
+	// order with one array per side, so four are tested at once
+	int m_sweepAxis;
+	std::vector<float> m_sortedBounds[6];
+	std::vector<unsigned char> m_sortedMoving;
+	// island of every body, the bodies and contacts sorted by island,
+	// and the islands themselves
+	std::vector<int> m_islandParents;
+	std::vector<int> m_bodyIslands;
+	std::vector<int> m_contactIslands;
+	std::vector<int> m_islandBodies;
+	std::vector<CONTACT> m_islandContacts;
+	std::vector<ISLAND> m_islands;
+
+	// work done so far
+	int64_t m_steps;
+	int64_t m_pairTotal;
+	int64_t m_contactTotal;
+	int64_t m_islandTotal;
+	int64_t m_phaseMicroseconds[4];
+
+	// run a function over blocks of a range, with the block and its
+	// first and last index, on the job system when there is one
+	void RunBlocks(int count, int blockSize, const std::function<void(int, int, int)>& function);
+	// add gravity to the velocities of the awake bodies
+	void IntegrateVelocities(int first, int last);
+	// pick the axis the bodies are spread out along the most
+	int FindSweepAxis() const;
+	// find the pairs of bodies whose bounding boxes overlap
+	void FindPairs();
+	// work out the contacts of a block of pairs
+	void FindContacts(int first, int last, std::vector<CONTACT>& contacts) const;
+	// group the bodies into islands and sort the contacts by island
+	void BuildIslands();
+	// find the island a body belongs to
+	int FindIsland(int body);
+	// solve the contacts of an island and move its bodies
+	void SolveIsland(const ISLAND& island);
+	// work out the solver values of a contact
+	void PrepareContact(CONTACT& contact) const;
+	// push the bodies of a contact apart
+	void SolveContact(CONTACT& contact);
+	// move a body on by its velocity
+	void IntegratePosition(BODY& body) const;
+	// update the rotation, world inertia and bounding box of a body
+	static void UpdateDerived(BODY& body);
+
+	// contacts between a sphere and another sphere, a box, a cylinder
+	// or a plane
+	static void CollideSpheres(const BODY& a, const BODY& b, int indexA, int indexB, std::vector<CONTACT>& contacts);
+	static void CollideSphereBox(const BODY& sphere, const BODY& box, int sphereIndex, int boxIndex,
+		bool bSphereFirst, std::vector<CONTACT>& contacts);
+	static void CollideSphereCylinder(const BODY& sphere, const BODY& cylinder, int sphereIndex, int cylinderIndex,
+		std::vector<CONTACT>& contacts);
+	static void CollideSpherePlane(const BODY& sphere, const BODY& plane, int sphereIndex, int planeIndex,
+		std::vector<CONTACT>& contacts);
+	// contacts of the corners of one box that are inside another box
+	static void CollideBoxCorners(const BODY& corners, const BODY& box, int cornersIndex, int boxIndex,
+		bool bCornersFirst, std::vector<CONTACT>& contacts);
+	// contact of two boxes that cross at an edge of each
+	static void CollideBoxEdges(const BODY& a, const BODY& b, int indexA, int indexB, std::vector<CONTACT>& contacts);
+	// get the corners of a box, or four points round each cap of a
+	// cylinder with the first of them furthest along a direction
+	static void GetOutlinePoints(const BODY& body, const glm::vec3& direction, glm::vec3 points[8]);
+	// find how deep a point is inside a box, a cylinder or a plane, and
+	// the normal it is pushed out along
+	static bool GetPointDepth(const BODY& body, const glm::vec3& point, glm::vec3& normal, float& depth);
+	// contacts of the outline points of a box or a cylinder that are
+	// inside a box, a cylinder or a plane
+	static void CollideOutline(const BODY& outline, const BODY& body, int outlineIndex, int bodyIndex,
+		bool bOutlineFirst, std::vector<CONTACT>& contacts);
+};
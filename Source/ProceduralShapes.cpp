@@ -0,0 +1,302 @@
+///////////////////////////////////////////////////////////////////////////////
+// proceduralshapes.cpp
+// ============
+// draw the round basic shapes without vertex data by generating them in the
+// vertex shader
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProceduralShapes.h"
+#include "MeshLibrary.h"
+#include "MeshCooker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// uniforms of the scene vertex shader
+	const char* g_ShapeValueName = "proceduralShape";
+	const char* g_GridValueName = "proceduralGrid";
+	// attribute locations of the per-instance values
+	const GLuint g_TessellationLocation = 4;
+	const GLuint g_TransformLocation = 5;
+	const GLuint g_DrawIndexLocation = 3;
+
+	// slices of a shape that covers one unit at one unit away - a shape
+	// of radius 1 seen from 10 units gets the 36 slices of the cooked
+	// shapes
+	const float g_SlicesPerCoverage = 360.0f;
+	const int g_MinSlices = 8;
+	const int g_MaxSlices = 96;
+	// slices of shapes drawn as patches - the tessellation shaders add
+	// the detail, so this only has to keep the patches close to the
+	// surface for the edge lengths measured on screen
+	const int g_PatchSlices = 8;
+}
+
+/***********************************************************
+ *  ProceduralShapes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ProceduralShapes::ProceduralShapes(GpuResourceManager* pResources)
+{
+	m_pResources = pResources;
+	m_draws = 0;
+	m_instances = 0;
+	m_vertices = 0;
+	m_drawMode = GL_TRIANGLES;
+	m_viewCount = 1;
+
+	// a vertex array is needed to draw, even with no vertex buffers
+	m_vao = m_pResources->CreateVertexArray("procedural shapes");
+}
+
+/***********************************************************
+ *  ~ProceduralShapes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ProceduralShapes::~ProceduralShapes()
+{
+	m_pResources->Release(m_vao);
+	m_pResources = NULL;
+}
+
+/***********************************************************
+ *  GetShaderDefine()
+ *
+ *  This method is used for getting the define that adds the
+ *  generated shapes to the scene vertex shader.
+ ***********************************************************/
+const char* ProceduralShapes::GetShaderDefine()
+{
+	return("#define USE_PROCEDURAL_SHAPES");
+}
+
+/***********************************************************
+ *  IsProcedural()
+ *
+ *  This method is used for checking whether the vertex
+ *  shader can generate a basic shape.  The box and plane
+ *  have only a few vertices, so they keep their meshes.
+ ***********************************************************/
+bool ProceduralShapes::IsProcedural(int shape)
+{
+	switch (shape)
+	{
+	case SHAPE_CONE:
+	case SHAPE_CYLINDER:
+	case SHAPE_SPHERE:
+	case SHAPE_TAPERED_CYLINDER:
+	case SHAPE_TORUS:
+		return(true);
+	default:
+		return(false);
+	}
+}
+
+/***********************************************************
+ *  GetTessellation()
+ *
+ *  This method is used for picking the slices and rows of a
+ *  shape.  The slices grow smoothly with the covered size,
+ *  so the detail follows the distance without any steps
+ *  between fixed levels.  The sides of cylinders and cones
+ *  are straight and need a single row, with a row for each
+ *  cap.
+ ***********************************************************/
+glm::ivec2 ProceduralShapes::GetTessellation(int shape, float coverage)
+{
+	int slices = (int)(g_SlicesPerCoverage * coverage);
+	slices = std::min(std::max(slices, g_MinSlices), g_MaxSlices);
+
+	switch (shape)
+	{
+	case SHAPE_SPHERE:
+		return(glm::ivec2(slices, std::max(slices / 2, g_MinSlices / 2)));
+	case SHAPE_TORUS:
+		return(glm::ivec2(slices, std::max(slices / 2, g_MinSlices / 2)));
+	default:
+		return(glm::ivec2(slices, 3));
+	}
+}
+
+/***********************************************************
+ *  GetVertexCount()
+ *
+ *  This method is used for getting the number of vertex IDs
+ *  that cover a grid of quads with two triangles each.
+ ***********************************************************/
+GLsizei ProceduralShapes::GetVertexCount(glm::ivec2 grid)
+{
+	return((GLsizei)(grid.x * grid.y * 6));
+}
+
+/***********************************************************
+ *  IsTessellationSupported()
+ *
+ *  This method is used for checking whether the driver has
+ *  the tessellation shader stages of OpenGL 4.0.
+ ***********************************************************/
+bool ProceduralShapes::IsTessellationSupported()
+{
+	return((GLEW_VERSION_4_0 || GLEW_ARB_tessellation_shader) ? true : false);
+}
+
+/***********************************************************
+ *  GetTessellationDefine()
+ *
+ *  This method is used for getting the define that sends
+ *  the scene shader output through the tessellation stages.
+ ***********************************************************/
+const char* ProceduralShapes::GetTessellationDefine()
+{
+	return("#define USE_TESSELLATION");
+}
+
+/***********************************************************
+ *  GetPatchTessellation()
+ *
+ *  This method is used for getting the coarse grid of a
+ *  shape that is drawn as patches.  The grid is the same
+ *  at any distance, since the tessellation control shader
+ *  picks the detail of every patch on the GPU.
+ ***********************************************************/
+glm::ivec2 ProceduralShapes::GetPatchTessellation(int shape)
+{
+	switch (shape)
+	{
+	case SHAPE_SPHERE:
+	case SHAPE_TORUS:
+		return(glm::ivec2(g_PatchSlices, g_PatchSlices / 2));
+	default:
+		return(glm::ivec2(g_PatchSlices, 3));
+	}
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing one generated shape.  The
+ *  per-instance attributes are not fed from a buffer here,
+ *  so the shader reads their current values, which are set
+ *  to the tessellation and an identity transform.
+ ***********************************************************/
+void ProceduralShapes::Draw(ShaderManager* pShaderManager, int shape, glm::ivec2 tessellation)
+{
+	glVertexAttrib2f(g_TessellationLocation, (float)tessellation.x, (float)tessellation.y);
+	for (int column = 0; column < 4; column++)
+	{
+		glVertexAttrib4f(g_TransformLocation + column,
+			(column == 0) ? 1.0f : 0.0f, (column == 1) ? 1.0f : 0.0f,
+			(column == 2) ? 1.0f : 0.0f, (column == 3) ? 1.0f : 0.0f);
+	}
+	// the per-draw values bound for this draw are at draw index 0
+	glVertexAttribI4ui(g_DrawIndexLocation, 0, 0, 0, 0);
+
+	DrawGrid(pShaderManager, shape, tessellation, 1);
+}
+
+/***********************************************************
+ *  DrawInstances()
+ *
+ *  This method is used for drawing many instances of a
+ *  generated shape with one call.  Every instance reads its
+ *  own tessellation and transform, and the cells of the
+ *  grid beyond its tessellation collapse, so near instances
+ *  can be dense and far ones coarse in the same draw.  With
+ *  several views the instance values step on once every
+ *  view count instances.
+ ***********************************************************/
+void ProceduralShapes::DrawInstances(ShaderManager* pShaderManager, int shape, glm::ivec2 grid,
+	GLuint instanceBuffer, GLintptr offset, GLsizei instanceCount)
+{
+	if (instanceCount <= 0)
+	{
+		return;
+	}
+
+	glBindVertexArray(m_pResources->GetName(m_vao));
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glVertexAttribPointer(g_TessellationLocation, 2, GL_FLOAT, GL_FALSE, sizeof(SHAPE_INSTANCE),
+		(void*)(offset + offsetof(SHAPE_INSTANCE, tessellation)));
+	glVertexAttribDivisor(g_TessellationLocation, (GLuint)m_viewCount);
+	glEnableVertexAttribArray(g_TessellationLocation);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(g_TransformLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(SHAPE_INSTANCE),
+			(void*)(offset + offsetof(SHAPE_INSTANCE, transform) + (column * sizeof(glm::vec4))));
+		glVertexAttribDivisor(g_TransformLocation + column, (GLuint)m_viewCount);
+		glEnableVertexAttribArray(g_TransformLocation + column);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glVertexAttribI4ui(g_DrawIndexLocation, 0, 0, 0, 0);
+
+	DrawGrid(pShaderManager, shape, grid, instanceCount);
+
+	// single draws read the current attribute values again
+	glBindVertexArray(m_pResources->GetName(m_vao));
+	glDisableVertexAttribArray(g_TessellationLocation);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glDisableVertexAttribArray(g_TransformLocation + column);
+	}
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawGrid()
+ *
+ *  This method is used for selecting the generated shape in
+ *  the scene shader and drawing the vertex IDs of the grid.
+ *  The shape is switched off again afterwards, so the other
+ *  draws read their vertex attributes as usual.
+ ***********************************************************/
+void ProceduralShapes::DrawGrid(ShaderManager* pShaderManager, int shape, glm::ivec2 grid, GLsizei instanceCount)
+{
+	GLsizei vertexCount = GetVertexCount(grid);
+	if ((NULL == pShaderManager) || (vertexCount <= 0))
+	{
+		return;
+	}
+
+	pShaderManager->setIntValue(g_ShapeValueName, shape);
+	pShaderManager->setVec2Value(g_GridValueName, (float)grid.x, (float)grid.y);
+
+	glBindVertexArray(m_pResources->GetName(m_vao));
+	glDrawArraysInstanced(m_drawMode, 0, vertexCount, instanceCount * m_viewCount);
+	glBindVertexArray(0);
+
+	pShaderManager->setIntValue(g_ShapeValueName, -1);
+
+	m_draws++;
+	m_instances += instanceCount;
+	m_vertices += (int64_t)vertexCount * instanceCount;
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing how many generated
+ *  shapes were drawn, and the vertex memory the cooked
+ *  meshes of those shapes would have used.
+ ***********************************************************/
+void ProceduralShapes::PrintStats() const
+{
+	size_t savedBytes = 0;
+	for (int shape = 0; shape < SHAPE_COUNT; shape++)
+	{
+		MESH_DATA meshData;
+		if ((IsProcedural(shape)) && (MeshCooker::CookShape(shape, meshData)))
+		{
+			savedBytes += MeshLibrary::GetDataBytes(meshData);
+		}
+	}
+
+	std::cout << "Procedural shapes: " << m_draws << " draws of " << m_instances << " instances, "
+		<< m_vertices << " vertices generated, cooked meshes of these shapes take " << (savedBytes / 1024) << " KB" << std::endl;
+}
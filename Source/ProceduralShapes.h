@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// proceduralshapes.h
+// ============
+// draw the round basic shapes without vertex data by generating them in the
+// vertex shader
+//
+//	The sphere, cylinder, cone, tapered cylinder and torus are parametric, so
+//	the vertex shader can work out every vertex from gl_VertexID alone.  The
+//	vertex IDs are spread over a grid of quads, two triangles each, and the
+//	slices and rows of each instance pick how much of the grid it uses - the
+//	rest collapses to a point.  Instances with different densities can be
+//	drawn in one instanced call, and no vertex memory is used at all.
+//
+//	With tessellation shaders the grid is drawn coarse, as patches, and the
+//	tessellation evaluation shader puts the new points on the true surface.
+//	The tessellation control shader splits each patch edge by its length on
+//	screen, so near shapes are smooth and far ones stay cheap.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+#include "ShaderManager.h"
+#include "GpuResourceManager.h"
+
+/***********************************************************
+ *  ProceduralShapes
+ *
+ *  This class contains the code for drawing the round basic
+ *  shapes from the vertex IDs with the scene shader.
+ ***********************************************************/
+class ProceduralShapes
+{
+public:
+	// per-instance values, read from vertex attributes 4 to 8
+	struct SHAPE_INSTANCE
+	{
+		// slices around the shape and rows along it
+		glm::vec2 tessellation;
+		// transform of the instance inside the draw's model matrix
+		glm::mat4 transform;
+	};
+
+	// constructor - the vertex array is owned by the resource manager
+	ProceduralShapes(GpuResourceManager* pResources);
+	// destructor
+	~ProceduralShapes();
+
+	// get the shader define that adds the generated shapes
+	static const char* GetShaderDefine();
+	// check whether a basic shape can be generated in the shader
+	static bool IsProcedural(int shape);
+	// pick the slices and rows of a shape from the size it covers, as
+	// its radius divided by its distance from the viewer
+	static glm::ivec2 GetTessellation(int shape, float coverage);
+	// get the number of vertex IDs that a grid of quads needs
+	static GLsizei GetVertexCount(glm::ivec2 grid);
+
+	// check whether the driver supports tessellation shaders
+	static bool IsTessellationSupported();
+	// get the shader define that sends the scene through the
+	// tessellation shaders
+	static const char* GetTessellationDefine();
+	// get the coarse slices and rows of a shape drawn as patches
+	static glm::ivec2 GetPatchTessellation(int shape);
+	// draw the grids as patches for the tessellation shaders
+	void SetDrawPatches(bool bPatches) { m_drawMode = bPatches ? GL_PATCHES : GL_TRIANGLES; }
+	// draw every instance once per view, for shaders that pick the
+	// view from the instance
+	void SetViewCount(int viewCount) { m_viewCount = viewCount; }
+
+	// draw one generated shape with the passed in tessellation
+	void Draw(ShaderManager* pShaderManager, int shape, glm::ivec2 tessellation);
+	// draw instances of a generated shape from a buffer of
+	// SHAPE_INSTANCE values - the grid must hold the densest instance
+	void DrawInstances(ShaderManager* pShaderManager, int shape, glm::ivec2 grid,
+		GLuint instanceBuffer, GLintptr offset, GLsizei instanceCount);
+
+	// print the generated draws and the vertex memory they save
+	void PrintStats() const;
+
+private:
+	// resource manager that owns the vertex array
+	GpuResourceManager* m_pResources;
+	// vertex array without any vertex buffers
+	GPU_HANDLE m_vao;
+	// primitive type that the grids are drawn with
+	GLenum m_drawMode;
+	// instances drawn of every shape instance
+	int m_viewCount;
+	// counters of the generated draws
+	int64_t m_draws;
+	int64_t m_instances;
+	int64_t m_vertices;
+
+	// set the shape and grid uniforms and draw the vertex IDs
+	void DrawGrid(ShaderManager* pShaderManager, int shape, glm::ivec2 grid, GLsizei instanceCount);
+};
@@ -0,0 +1,486 @@
+///////////////////////////////////////////////////////////////////////////////
+// programbuilder.cpp
+// ============
+// build shader programs in stages so that compiling can overlap other work
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramBuilder.h"
+#include "AssetPack.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+/***********************************************************
+ *  EnableParallelCompile()
+ *
+ *  This method is used for letting the driver pick how many
+ *  threads it uses for compiling shaders.
+ ***********************************************************/
+void ProgramBuilder::EnableParallelCompile()
+{
+	if (IsParallelCompileSupported())
+	{
+		// 0xFFFFFFFF lets the driver choose the thread count
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		std::cout << "INFO: Parallel shader compile enabled" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  IsParallelCompileSupported()
+ *
+ *  This method is used for checking whether the driver can
+ *  compile shaders in the background.
+ ***********************************************************/
+bool ProgramBuilder::IsParallelCompileSupported()
+{
+	return(GLEW_ARB_parallel_shader_compile ? true : false);
+}
+
+/***********************************************************
+ *  ReadFile()
+ *
+ *  This method is used for reading the whole of a file.
+ ***********************************************************/
+bool ProgramBuilder::ReadFile(const std::string& filename, std::string& contents)
+{
+	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not read shader file:" << filename << std::endl;
+		return(false);
+	}
+
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	contents = buffer.str();
+	return(true);
+}
+
+/***********************************************************
+ *  ReadShaderSource()
+ *
+ *  This method is used for reading a shader source file.
+ *  GLSL has no includes of its own, so each #include line
+ *  is replaced with the named file from the same folder.
+ *  Included files are not searched for further includes.
+ *  The defines are added right after the #version line,
+ *  since the version must stay the first statement.
+ ***********************************************************/
+bool ProgramBuilder::ReadShaderSource(const char* filename, const std::string& defines, std::string& source)
+{
+	if (ReadFile(filename, source) == false)
+	{
+		return(false);
+	}
+
+	std::string folder = filename;
+	size_t folderEnd = folder.find_last_of("/\\");
+	folder = (folderEnd == std::string::npos) ? std::string() : folder.substr(0, folderEnd + 1);
+	const std::string includeToken = "#include \"";
+	size_t includePosition = source.find(includeToken);
+	while (includePosition != std::string::npos)
+	{
+		size_t nameStart = includePosition + includeToken.size();
+		size_t nameEnd = source.find('"', nameStart);
+		if (nameEnd == std::string::npos)
+		{
+			std::cout << "ERROR: unterminated #include in shader file:" << filename << std::endl;
+			return(false);
+		}
+
+		std::string included;
+		if (ReadFile(folder + source.substr(nameStart, nameEnd - nameStart), included) == false)
+		{
+			return(false);
+		}
+		size_t lineEnd = source.find('\n', nameEnd);
+		lineEnd = (lineEnd == std::string::npos) ? source.size() : lineEnd;
+		source.replace(includePosition, lineEnd - includePosition, included);
+		includePosition = source.find(includeToken, includePosition + included.size());
+	}
+
+	if (defines.size() > 0)
+	{
+		size_t insertPosition = 0;
+		size_t versionPosition = source.find("#version");
+		if (versionPosition != std::string::npos)
+		{
+			size_t lineEnd = source.find('\n', versionPosition);
+			insertPosition = (lineEnd == std::string::npos) ? source.size() : lineEnd + 1;
+		}
+		source.insert(insertPosition, defines + "\n");
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadProgramSources()
+ *
+ *  This method is used for reading the vertex and fragment
+ *  shader sources of a program.  No OpenGL calls are made,
+ *  so this can be run on a worker thread.
+ ***********************************************************/
+bool ProgramBuilder::LoadProgramSources(
+	const char* vertexFile,
+	const char* fragmentFile,
+	const std::string& defines,
+	PENDING_PROGRAM& pending)
+{
+	pending.vertexFile = vertexFile;
+	pending.fragmentFile = fragmentFile;
+	pending.bSourcesLoaded =
+		ReadShaderSource(vertexFile, defines, pending.vertexSource) &&
+		ReadShaderSource(fragmentFile, defines, pending.fragmentSource);
+
+	return(pending.bSourcesLoaded);
+}
+
+/***********************************************************
+ *  LoadTessellationSources()
+ *
+ *  This method is used for reading the tessellation control
+ *  and evaluation shader sources of a program.  They are
+ *  compiled and linked along with the vertex and fragment
+ *  shaders, and the program then draws patches.
+ ***********************************************************/
+bool ProgramBuilder::LoadTessellationSources(
+	const char* controlFile,
+	const char* evaluationFile,
+	const std::string& defines,
+	PENDING_PROGRAM& pending)
+{
+	pending.tessControlFile = controlFile;
+	pending.tessEvaluationFile = evaluationFile;
+	pending.bSourcesLoaded =
+		pending.bSourcesLoaded &&
+		ReadShaderSource(controlFile, defines, pending.tessControlSource) &&
+		ReadShaderSource(evaluationFile, defines, pending.tessEvaluationSource);
+
+	return(pending.bSourcesLoaded);
+}
+
+/***********************************************************
+ *  StartShader()
+ *
+ *  This method is used for creating a shader object and
+ *  starting its compile.  The compile status is not read
+ *  here, so that the driver does not have to finish first.
+ ***********************************************************/
+GLuint ProgramBuilder::StartShader(GLenum type, const std::string& source)
+{
+	GLuint shader = glCreateShader(type);
+	const char* pSource = source.c_str();
+	glShaderSource(shader, 1, &pSource, NULL);
+	glCompileShader(shader);
+	return(shader);
+}
+
+/***********************************************************
+ *  LoadCachedProgram()
+ *
+ *  This method is used for creating a program from a binary
+ *  stored in the asset cache.  The key covers the sources and
+ *  the driver, since binaries only work with the driver that
+ *  created them.  A driver can still reject a binary, and
+ *  then the program is compiled from source as usual.
+ ***********************************************************/
+bool ProgramBuilder::LoadCachedProgram(PENDING_PROGRAM& pending, AssetCache* pCache)
+{
+	if ((NULL == pCache) || (!GLEW_ARB_get_program_binary))
+	{
+		return(false);
+	}
+
+	std::string driver =
+		std::string((const char*)glGetString(GL_VENDOR)) + ";" +
+		std::string((const char*)glGetString(GL_RENDERER)) + ";" +
+		std::string((const char*)glGetString(GL_VERSION));
+	std::string sources = pending.vertexSource + '\0' + pending.fragmentSource + '\0' +
+		pending.tessControlSource + '\0' + pending.tessEvaluationSource;
+	pending.cacheKey = AssetCache::MakeKey("program", sources.data(), sources.size(), driver);
+
+	std::vector<unsigned char> data;
+	if (pCache->Load(pending.cacheKey, data) == false)
+	{
+		return(false);
+	}
+
+	ChunkReader reader(data.data(), data.size());
+	uint32_t binaryFormat = 0;
+	if (reader.Read(binaryFormat) == false)
+	{
+		return(false);
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, (GLenum)binaryFormat, data.data() + sizeof(binaryFormat), (GLsizei)reader.GetRemaining());
+
+	GLint bLinked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &bLinked);
+	if (bLinked != GL_TRUE)
+	{
+		glDeleteProgram(program);
+		return(false);
+	}
+
+	pending.program = program;
+	pending.bFromCache = true;
+	return(true);
+}
+
+/***********************************************************
+ *  StoreCachedProgram()
+ *
+ *  This method is used for storing the binary of a linked
+ *  program in the asset cache for later runs.
+ ***********************************************************/
+void ProgramBuilder::StoreCachedProgram(const PENDING_PROGRAM& pending, AssetCache* pCache)
+{
+	if ((NULL == pCache) || (pending.cacheKey.size() == 0) || (pending.bFromCache))
+	{
+		return;
+	}
+
+	GLint binaryLength = 0;
+	glGetProgramiv(pending.program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+	{
+		return;
+	}
+
+	GLenum binaryFormat = 0;
+	std::vector<unsigned char> data(sizeof(uint32_t) + (size_t)binaryLength);
+	glGetProgramBinary(pending.program, binaryLength, NULL, &binaryFormat, data.data() + sizeof(uint32_t));
+	uint32_t storedFormat = (uint32_t)binaryFormat;
+	memcpy(data.data(), &storedFormat, sizeof(storedFormat));
+
+	pCache->Store(pending.cacheKey, data);
+}
+
+/***********************************************************
+ *  CompileProgram()
+ *
+ *  This method is used for starting the compile and link of
+ *  a program from its loaded sources.  When the asset cache
+ *  has a binary of the program, it is used instead and
+ *  nothing is compiled.
+ ***********************************************************/
+void ProgramBuilder::CompileProgram(PENDING_PROGRAM& pending, AssetCache* pCache)
+{
+	if (pending.bSourcesLoaded == false)
+	{
+		return;
+	}
+
+	if (LoadCachedProgram(pending, pCache))
+	{
+		pending.vertexSource.clear();
+		pending.fragmentSource.clear();
+		pending.tessControlSource.clear();
+		pending.tessEvaluationSource.clear();
+		return;
+	}
+
+	pending.vertexShader = StartShader(GL_VERTEX_SHADER, pending.vertexSource);
+	pending.fragmentShader = StartShader(GL_FRAGMENT_SHADER, pending.fragmentSource);
+
+	pending.program = glCreateProgram();
+	glAttachShader(pending.program, pending.vertexShader);
+	glAttachShader(pending.program, pending.fragmentShader);
+	if (pending.tessControlFile.size() > 0)
+	{
+		pending.tessControlShader = StartShader(GL_TESS_CONTROL_SHADER, pending.tessControlSource);
+		pending.tessEvaluationShader = StartShader(GL_TESS_EVALUATION_SHADER, pending.tessEvaluationSource);
+		glAttachShader(pending.program, pending.tessControlShader);
+		glAttachShader(pending.program, pending.tessEvaluationShader);
+	}
+	if (pending.cacheKey.size() > 0)
+	{
+		// keep the linked binary available for the asset cache
+		glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(pending.program);
+
+	// the sources are not needed once they are with the driver
+	pending.vertexSource.clear();
+	pending.fragmentSource.clear();
+	pending.tessControlSource.clear();
+	pending.tessEvaluationSource.clear();
+}
+
+/***********************************************************
+ *  IsProgramReady()
+ *
+ *  This method is used for checking whether the driver has
+ *  finished building a program.  Without the parallel
+ *  compile extension a program is always reported as ready,
+ *  and finishing it blocks until the build is done.
+ ***********************************************************/
+bool ProgramBuilder::IsProgramReady(const PENDING_PROGRAM& pending)
+{
+	if ((pending.program == 0) || (IsParallelCompileSupported() == false))
+	{
+		return(true);
+	}
+
+	GLint bCompleted = GL_FALSE;
+	glGetProgramiv(pending.program, GL_COMPLETION_STATUS_ARB, &bCompleted);
+	return(bCompleted == GL_TRUE);
+}
+
+/***********************************************************
+ *  CheckShader()
+ *
+ *  This method is used for checking the compile status of a
+ *  shader and printing the info log when it failed.
+ ***********************************************************/
+bool ProgramBuilder::CheckShader(GLuint shader, const std::string& filename)
+{
+	GLint bCompiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &bCompiled);
+	if (bCompiled == GL_TRUE)
+	{
+		return(true);
+	}
+
+	GLint logLength = 0;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+	std::vector<char> log((size_t)logLength + 1, '\0');
+	glGetShaderInfoLog(shader, logLength, NULL, log.data());
+	std::cout << "ERROR: shader compile failed:" << filename << std::endl << log.data() << std::endl;
+	return(false);
+}
+
+/***********************************************************
+ *  FinishProgram()
+ *
+ *  This method is used for checking the results of building
+ *  a program and, if it linked, handing it to the shader
+ *  manager in place of any program it had before.
+ ***********************************************************/
+bool ProgramBuilder::FinishProgram(PENDING_PROGRAM& pending, ShaderManager* pShaderManager, AssetCache* pCache)
+{
+	if (pending.program == 0)
+	{
+		std::cout << "ERROR: shader program was never compiled:" << pending.vertexFile << std::endl;
+		return(false);
+	}
+
+	// a cached binary was already linked when it was loaded
+	if (pending.bFromCache)
+	{
+		if (NULL != pShaderManager)
+		{
+			pShaderManager->m_programID = pending.program;
+		}
+		pending.program = 0;
+		return(true);
+	}
+
+	bool bSuccess = CheckShader(pending.vertexShader, pending.vertexFile);
+	bSuccess = CheckShader(pending.fragmentShader, pending.fragmentFile) && bSuccess;
+	if (pending.tessControlShader != 0)
+	{
+		bSuccess = CheckShader(pending.tessControlShader, pending.tessControlFile) && bSuccess;
+		bSuccess = CheckShader(pending.tessEvaluationShader, pending.tessEvaluationFile) && bSuccess;
+	}
+
+	GLint bLinked = GL_FALSE;
+	glGetProgramiv(pending.program, GL_LINK_STATUS, &bLinked);
+	if ((bSuccess) && (bLinked != GL_TRUE))
+	{
+		GLint logLength = 0;
+		glGetProgramiv(pending.program, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log((size_t)logLength + 1, '\0');
+		glGetProgramInfoLog(pending.program, logLength, NULL, log.data());
+		std::cout << "ERROR: shader program link failed:" << pending.vertexFile << std::endl << log.data() << std::endl;
+		bSuccess = false;
+	}
+
+	// the shader objects are not needed once the program is linked
+	glDetachShader(pending.program, pending.vertexShader);
+	glDetachShader(pending.program, pending.fragmentShader);
+	glDeleteShader(pending.vertexShader);
+	glDeleteShader(pending.fragmentShader);
+	pending.vertexShader = 0;
+	pending.fragmentShader = 0;
+	if (pending.tessControlShader != 0)
+	{
+		glDetachShader(pending.program, pending.tessControlShader);
+		glDetachShader(pending.program, pending.tessEvaluationShader);
+		glDeleteShader(pending.tessControlShader);
+		glDeleteShader(pending.tessEvaluationShader);
+		pending.tessControlShader = 0;
+		pending.tessEvaluationShader = 0;
+	}
+
+	if (bSuccess == false)
+	{
+		glDeleteProgram(pending.program);
+		pending.program = 0;
+		return(false);
+	}
+
+	StoreCachedProgram(pending, pCache);
+
+	if (NULL != pShaderManager)
+	{
+		pShaderManager->m_programID = pending.program;
+	}
+	pending.program = 0;
+
+	return(true);
+}
+
+/***********************************************************
+ *  BuildComputeProgram()
+ *
+ *  This method is used for building a program from a single
+ *  compute shader.  Compute programs are small and only
+ *  built when a feature is switched on, so the build is not
+ *  split into stages and waits for the driver.  The program
+ *  is owned by the resource manager, so it shows up in the
+ *  leak report like the buffers it works on.
+ ***********************************************************/
+GPU_HANDLE ProgramBuilder::BuildComputeProgram(GpuResourceManager* pResources, const char* computeFile,
+	const std::string& defines)
+{
+	std::string source;
+	if (ReadShaderSource(computeFile, defines, source) == false)
+	{
+		return(GPU_HANDLE());
+	}
+
+	GLuint shader = StartShader(GL_COMPUTE_SHADER, source);
+	if (CheckShader(shader, computeFile) == false)
+	{
+		glDeleteShader(shader);
+		return(GPU_HANDLE());
+	}
+
+	GPU_HANDLE handle = pResources->CreateProgram(computeFile);
+	GLuint program = pResources->GetName(handle);
+	glAttachShader(program, shader);
+	glLinkProgram(program);
+	glDetachShader(program, shader);
+	glDeleteShader(shader);
+
+	GLint bLinked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &bLinked);
+	if (bLinked != GL_TRUE)
+	{
+		GLint logLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log((size_t)logLength + 1, '\0');
+		glGetProgramInfoLog(program, logLength, NULL, log.data());
+		std::cout << "ERROR: shader program link failed:" << computeFile << std::endl << log.data() << std::endl;
+		pResources->Release(handle);
+		return(handle);
+	}
+
+	return(handle);
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// programbuilder.h
+// ============
+// build shader programs in stages so that compiling can overlap other work
+//
+//	Building a program is split into reading the source files, which can
+//	run on any thread, starting the compile and link, and finishing the
+//	program once the driver is done.  When the parallel shader compile
+//	extension is available the driver compiles on its own threads, and
+//	IsProgramReady() can be polled instead of blocking on the result.
+//
+//	Shader files can share code through #include "file" lines, which are
+//	replaced with the named file from the same folder while reading.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "AssetCache.h"
+#include "GpuResourceManager.h"
+
+#include <GL/glew.h>
+
+#include <string>
+
+/***********************************************************
+ *  ProgramBuilder
+ *
+ *  This class contains the code for building the shader
+ *  programs used by the ShaderManager objects.
+ ***********************************************************/
+class ProgramBuilder
+{
+public:
+	// state of a program while it is being built
+	struct PENDING_PROGRAM
+	{
+		std::string vertexFile;
+		std::string fragmentFile;
+		std::string vertexSource;
+		std::string fragmentSource;
+		GLuint vertexShader = 0;
+		GLuint fragmentShader = 0;
+		// optional tessellation stages, used when their files are set
+		std::string tessControlFile;
+		std::string tessEvaluationFile;
+		std::string tessControlSource;
+		std::string tessEvaluationSource;
+		GLuint tessControlShader = 0;
+		GLuint tessEvaluationShader = 0;
+		GLuint program = 0;
+		bool bSourcesLoaded = false;
+		// asset cache key of the program binary
+		std::string cacheKey;
+		// whether the program was loaded from a cached binary
+		bool bFromCache = false;
+	};
+
+	// ask the driver to compile shaders on its own threads when it can
+	static void EnableParallelCompile();
+	// check whether the driver compiles shaders in parallel
+	static bool IsParallelCompileSupported();
+
+	// read the shader source files and add the passed in defines
+	static bool LoadProgramSources(
+		const char* vertexFile,
+		const char* fragmentFile,
+		const std::string& defines,
+		PENDING_PROGRAM& pending);
+	// read the tessellation shader sources of a program whose vertex
+	// and fragment sources are loaded
+	static bool LoadTessellationSources(
+		const char* controlFile,
+		const char* evaluationFile,
+		const std::string& defines,
+		PENDING_PROGRAM& pending);
+	// start compiling and linking the loaded sources, or load the
+	// program binary from the asset cache when it is there
+	static void CompileProgram(PENDING_PROGRAM& pending, AssetCache* pCache = NULL);
+	// check whether the driver has finished building the program
+	static bool IsProgramReady(const PENDING_PROGRAM& pending);
+	// check the build results and hand the program to a shader manager
+	static bool FinishProgram(PENDING_PROGRAM& pending, ShaderManager* pShaderManager, AssetCache* pCache = NULL);
+	// build a compute program right away in the passed in resource
+	// manager and return its handle, or an empty handle on failure
+	static GPU_HANDLE BuildComputeProgram(GpuResourceManager* pResources, const char* computeFile,
+		const std::string& defines);
+
+private:
+	// read a source file, fill in its included files and add the
+	// defines after its version line
+	static bool ReadShaderSource(const char* filename, const std::string& defines, std::string& source);
+	// read a whole file into a string
+	static bool ReadFile(const std::string& filename, std::string& contents);
+	// create a shader object and start compiling it
+	static GLuint StartShader(GLenum type, const std::string& source);
+	// print the info log of a shader that failed to compile
+	static bool CheckShader(GLuint shader, const std::string& filename);
+	// try to create the program from a cached program binary
+	static bool LoadCachedProgram(PENDING_PROGRAM& pending, AssetCache* pCache);
+	// store the binary of a linked program in the asset cache
+	static void StoreCachedProgram(const PENDING_PROGRAM& pending, AssetCache* pCache);
+};
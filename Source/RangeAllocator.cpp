@@ -0,0 +1,473 @@
+///////////////////////////////////////////////////////////////////////////////
+// rangeallocator.cpp
+// ============
+// hand out ranges of one large buffer with a two-level segregated fit
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RangeAllocator.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// declaration of global functions
+namespace
+{
+	// get the index of the highest set bit of a non-zero value
+	int FindLastSet(uint32_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index = 0;
+		_BitScanReverse(&index, value);
+		return((int)index);
+#else
+		return(31 - __builtin_clz(value));
+#endif
+	}
+
+	// get the index of the lowest set bit of a non-zero value
+	int FindFirstSet(uint32_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index = 0;
+		_BitScanForward(&index, value);
+		return((int)index);
+#else
+		return(__builtin_ctz(value));
+#endif
+	}
+}
+
+/***********************************************************
+ *  RangeAllocator()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RangeAllocator::RangeAllocator()
+{
+	Reset(0);
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for forgetting every range and
+ *  starting over with one free range of the passed in size.
+ ***********************************************************/
+void RangeAllocator::Reset(uint32_t capacity)
+{
+	m_blocks.clear();
+	m_unusedBlocks.clear();
+	for (int fl = 0; fl < FL_COUNT; fl++)
+	{
+		for (int sl = 0; sl < SL_COUNT; sl++)
+		{
+			m_freeHeads[fl][sl] = -1;
+		}
+		m_secondLevelBitmaps[fl] = 0;
+	}
+	m_firstLevelBitmap = 0;
+	m_firstBlock = -1;
+	m_lastBlock = -1;
+	m_capacity = 0;
+	m_usedUnits = 0;
+	Grow(capacity);
+}
+
+/***********************************************************
+ *  Grow()
+ *
+ *  This method is used for adding free space at the end of
+ *  the buffer.  The free range at the end, if there is one,
+ *  is made larger instead of adding another range.
+ ***********************************************************/
+void RangeAllocator::Grow(uint32_t capacity)
+{
+	if (capacity <= m_capacity)
+	{
+		return;
+	}
+
+	uint32_t extraUnits = capacity - m_capacity;
+	if ((m_lastBlock >= 0) && (m_blocks[m_lastBlock].bFree))
+	{
+		RemoveFreeBlock(m_lastBlock);
+		m_blocks[m_lastBlock].size += extraUnits;
+		InsertFreeBlock(m_lastBlock);
+	}
+	else
+	{
+		int block = NewBlock(m_capacity, extraUnits);
+		m_blocks[block].prevPhysical = m_lastBlock;
+		if (m_lastBlock >= 0)
+		{
+			m_blocks[m_lastBlock].nextPhysical = block;
+		}
+		else
+		{
+			m_firstBlock = block;
+		}
+		m_lastBlock = block;
+		InsertFreeBlock(block);
+	}
+	m_capacity = capacity;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for allocating a range of the passed
+ *  in size from the smallest size class that is sure to fit
+ *  it.  The returned ID is used for getting the offset and
+ *  freeing the range, or -1 is returned when nothing fits.
+ ***********************************************************/
+int RangeAllocator::Allocate(uint32_t size)
+{
+	if (size == 0)
+	{
+		return(-1);
+	}
+
+	int block = FindFreeBlock(size);
+	if (block < 0)
+	{
+		return(-1);
+	}
+	UseFreeBlock(block, size);
+	return(block);
+}
+
+/***********************************************************
+ *  AllocateBelow()
+ *
+ *  This method is used for allocating the first free range,
+ *  in buffer order, that fits the passed in size and ends
+ *  by the passed in offset.  It walks the ranges one by one,
+ *  so it is meant for compaction rather than normal use.
+ ***********************************************************/
+int RangeAllocator::AllocateBelow(uint32_t size, uint32_t endOffset)
+{
+	if (size == 0)
+	{
+		return(-1);
+	}
+
+	for (int block = m_firstBlock; block >= 0; block = m_blocks[block].nextPhysical)
+	{
+		if ((uint64_t)m_blocks[block].offset + size > endOffset)
+		{
+			break;
+		}
+		if ((m_blocks[block].bFree) && (m_blocks[block].size >= size))
+		{
+			UseFreeBlock(block, size);
+			return(block);
+		}
+	}
+	return(-1);
+}
+
+/***********************************************************
+ *  Free()
+ *
+ *  This method is used for freeing an allocated range.  The
+ *  range is merged with the free ranges next to it, so that
+ *  free space never sits in pieces side by side.
+ ***********************************************************/
+void RangeAllocator::Free(int rangeID)
+{
+	if ((rangeID < 0) || (rangeID >= (int)m_blocks.size()) ||
+		(m_blocks[rangeID].bUnused) || (m_blocks[rangeID].bFree))
+	{
+		return;
+	}
+
+	int block = rangeID;
+	m_usedUnits -= m_blocks[block].size;
+
+	// absorb the next range when it is free
+	int next = m_blocks[block].nextPhysical;
+	if ((next >= 0) && (m_blocks[next].bFree))
+	{
+		RemoveFreeBlock(next);
+		m_blocks[block].size += m_blocks[next].size;
+		m_blocks[block].nextPhysical = m_blocks[next].nextPhysical;
+		if (m_blocks[next].nextPhysical >= 0)
+		{
+			m_blocks[m_blocks[next].nextPhysical].prevPhysical = block;
+		}
+		else
+		{
+			m_lastBlock = block;
+		}
+		DeleteBlock(next);
+	}
+
+	// let the previous range absorb this one when it is free
+	int prev = m_blocks[block].prevPhysical;
+	if ((prev >= 0) && (m_blocks[prev].bFree))
+	{
+		RemoveFreeBlock(prev);
+		m_blocks[prev].size += m_blocks[block].size;
+		m_blocks[prev].nextPhysical = m_blocks[block].nextPhysical;
+		if (m_blocks[block].nextPhysical >= 0)
+		{
+			m_blocks[m_blocks[block].nextPhysical].prevPhysical = prev;
+		}
+		else
+		{
+			m_lastBlock = prev;
+		}
+		DeleteBlock(block);
+		block = prev;
+	}
+
+	InsertFreeBlock(block);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the used and free space
+ *  of the buffer, and how scattered the free space is.
+ ***********************************************************/
+RangeAllocator::ALLOCATOR_STATS RangeAllocator::GetStats() const
+{
+	ALLOCATOR_STATS stats;
+	stats.capacity = m_capacity;
+	stats.usedUnits = m_usedUnits;
+	stats.freeUnits = m_capacity - m_usedUnits;
+	stats.largestFreeUnits = 0;
+	stats.usedRanges = 0;
+	stats.freeRanges = 0;
+
+	for (int block = m_firstBlock; block >= 0; block = m_blocks[block].nextPhysical)
+	{
+		if (m_blocks[block].bFree)
+		{
+			stats.freeRanges++;
+			if (m_blocks[block].size > stats.largestFreeUnits)
+			{
+				stats.largestFreeUnits = m_blocks[block].size;
+			}
+		}
+		else
+		{
+			stats.usedRanges++;
+		}
+	}
+
+	stats.fragmentation = 0.0f;
+	if (stats.freeUnits > 0)
+	{
+		stats.fragmentation = 1.0f - ((float)stats.largestFreeUnits / (float)stats.freeUnits);
+	}
+	return(stats);
+}
+
+/***********************************************************
+ *  MapSize()
+ *
+ *  This method is used for getting the size class of a size.
+ *  Sizes below sixteen units get a class each, and larger
+ *  sizes are classed by their highest bit and the four bits
+ *  below it.
+ ***********************************************************/
+void RangeAllocator::MapSize(uint32_t size, int& firstLevel, int& secondLevel)
+{
+	if (size < (uint32_t)SL_COUNT)
+	{
+		firstLevel = 0;
+		secondLevel = (int)size;
+	}
+	else
+	{
+		int highestBit = FindLastSet(size);
+		secondLevel = (int)(size >> (highestBit - SL_LOG2)) - SL_COUNT;
+		firstLevel = highestBit - SL_LOG2 + 1;
+	}
+}
+
+/***********************************************************
+ *  FindFreeBlock()
+ *
+ *  This method is used for finding a free range that is at
+ *  least the passed in size.  The size is rounded up to the
+ *  next size class, so that any range in the found class
+ *  fits without walking the list.
+ ***********************************************************/
+int RangeAllocator::FindFreeBlock(uint32_t size) const
+{
+	uint32_t searchSize = size;
+	if (size >= (uint32_t)SL_COUNT)
+	{
+		searchSize = size + (1u << (FindLastSet(size) - SL_LOG2)) - 1;
+		if (searchSize < size)
+		{
+			return(-1);
+		}
+	}
+
+	int fl = 0;
+	int sl = 0;
+	MapSize(searchSize, fl, sl);
+
+	uint32_t secondLevelMap = m_secondLevelBitmaps[fl] & (~0u << sl);
+	if (secondLevelMap == 0)
+	{
+		uint32_t firstLevelMap = (fl + 1 < FL_COUNT) ? (m_firstLevelBitmap & (~0u << (fl + 1))) : 0;
+		if (firstLevelMap == 0)
+		{
+			return(-1);
+		}
+		fl = FindFirstSet(firstLevelMap);
+		secondLevelMap = m_secondLevelBitmaps[fl];
+	}
+	sl = FindFirstSet(secondLevelMap);
+	return(m_freeHeads[fl][sl]);
+}
+
+/***********************************************************
+ *  NewBlock()
+ *
+ *  This method is used for adding a range record, reusing a
+ *  record that is no longer used when there is one.
+ ***********************************************************/
+int RangeAllocator::NewBlock(uint32_t offset, uint32_t size)
+{
+	BLOCK record;
+	record.offset = offset;
+	record.size = size;
+	record.bFree = false;
+	record.bUnused = false;
+	record.prevPhysical = -1;
+	record.nextPhysical = -1;
+	record.prevFree = -1;
+	record.nextFree = -1;
+
+	int block = -1;
+	if (m_unusedBlocks.size() > 0)
+	{
+		block = m_unusedBlocks.back();
+		m_unusedBlocks.pop_back();
+		m_blocks[block] = record;
+	}
+	else
+	{
+		block = (int)m_blocks.size();
+		m_blocks.push_back(record);
+	}
+	return(block);
+}
+
+/***********************************************************
+ *  DeleteBlock()
+ *
+ *  This method is used for keeping a range record that was
+ *  merged away, so that it can be reused.
+ ***********************************************************/
+void RangeAllocator::DeleteBlock(int block)
+{
+	m_blocks[block].bUnused = true;
+	m_blocks[block].bFree = false;
+	m_unusedBlocks.push_back(block);
+}
+
+/***********************************************************
+ *  InsertFreeBlock()
+ *
+ *  This method is used for adding a free range to the front
+ *  of the list of its size class and marking the class in
+ *  the bitmaps.
+ ***********************************************************/
+void RangeAllocator::InsertFreeBlock(int block)
+{
+	int fl = 0;
+	int sl = 0;
+	MapSize(m_blocks[block].size, fl, sl);
+
+	int head = m_freeHeads[fl][sl];
+	m_blocks[block].bFree = true;
+	m_blocks[block].prevFree = -1;
+	m_blocks[block].nextFree = head;
+	if (head >= 0)
+	{
+		m_blocks[head].prevFree = block;
+	}
+	m_freeHeads[fl][sl] = block;
+	m_firstLevelBitmap |= (1u << fl);
+	m_secondLevelBitmaps[fl] |= (1u << sl);
+}
+
+/***********************************************************
+ *  RemoveFreeBlock()
+ *
+ *  This method is used for taking a free range out of the
+ *  list of its size class, clearing the class in the bitmaps
+ *  when the list becomes empty.
+ ***********************************************************/
+void RangeAllocator::RemoveFreeBlock(int block)
+{
+	int fl = 0;
+	int sl = 0;
+	MapSize(m_blocks[block].size, fl, sl);
+
+	int prev = m_blocks[block].prevFree;
+	int next = m_blocks[block].nextFree;
+	if (prev >= 0)
+	{
+		m_blocks[prev].nextFree = next;
+	}
+	if (next >= 0)
+	{
+		m_blocks[next].prevFree = prev;
+	}
+	if (m_freeHeads[fl][sl] == block)
+	{
+		m_freeHeads[fl][sl] = next;
+		if (next < 0)
+		{
+			m_secondLevelBitmaps[fl] &= ~(1u << sl);
+			if (m_secondLevelBitmaps[fl] == 0)
+			{
+				m_firstLevelBitmap &= ~(1u << fl);
+			}
+		}
+	}
+	m_blocks[block].bFree = false;
+	m_blocks[block].prevFree = -1;
+	m_blocks[block].nextFree = -1;
+}
+
+/***********************************************************
+ *  UseFreeBlock()
+ *
+ *  This method is used for marking a free range as used.
+ *  The part beyond the passed in size is split off into a
+ *  new free range.
+ ***********************************************************/
+void RangeAllocator::UseFreeBlock(int block, uint32_t size)
+{
+	RemoveFreeBlock(block);
+
+	if (m_blocks[block].size > size)
+	{
+		int rest = NewBlock(m_blocks[block].offset + size, m_blocks[block].size - size);
+		int next = m_blocks[block].nextPhysical;
+		m_blocks[rest].prevPhysical = block;
+		m_blocks[rest].nextPhysical = next;
+		if (next >= 0)
+		{
+			m_blocks[next].prevPhysical = rest;
+		}
+		else
+		{
+			m_lastBlock = rest;
+		}
+		m_blocks[block].nextPhysical = rest;
+		m_blocks[block].size = size;
+		InsertFreeBlock(rest);
+	}
+
+	m_usedUnits += size;
+}
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// rangeallocator.h
+// ============
+// hand out ranges of one large buffer with a two-level segregated fit
+//
+//	Free ranges are kept in lists picked by two levels of size classes - a
+//	power of two, split into sixteen steps - with a bitmap for each level,
+//	so that finding and freeing a range takes constant time.  Freed ranges
+//	are merged with their free neighbours.  Sizes and offsets are counted
+//	in units chosen by the caller, such as vertices or indices, so that
+//	every range lines up with the elements stored in it.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RangeAllocator
+ *
+ *  This class keeps track of the used and free ranges of a
+ *  buffer.  It only does the bookkeeping - the buffer itself
+ *  belongs to the caller.
+ ***********************************************************/
+class RangeAllocator
+{
+public:
+	// statistics about the used and free space
+	struct ALLOCATOR_STATS
+	{
+		uint32_t capacity;
+		uint32_t usedUnits;
+		uint32_t freeUnits;
+		uint32_t largestFreeUnits;
+		int usedRanges;
+		int freeRanges;
+		// share of the free space that is not in the largest free
+		// range, from zero for none to one
+		float fragmentation;
+	};
+
+	// constructor
+	RangeAllocator();
+
+	// start over with a single free range of the passed in size
+	void Reset(uint32_t capacity);
+	// add free space at the end, after the buffer was made larger
+	void Grow(uint32_t capacity);
+
+	// allocate a range and return its ID, or -1 when no range fits
+	int Allocate(uint32_t size);
+	// allocate the lowest range that fits and ends by the passed in
+	// offset, or return -1 - used for moving ranges down
+	int AllocateBelow(uint32_t size, uint32_t endOffset);
+	// free a range, merging it with free neighbours
+	void Free(int rangeID);
+
+	// get the offset of an allocated range
+	uint32_t GetOffset(int rangeID) const { return(m_blocks[rangeID].offset); }
+	// get the size of an allocated range
+	uint32_t GetSize(int rangeID) const { return(m_blocks[rangeID].size); }
+	// get the total number of units
+	uint32_t GetCapacity() const { return(m_capacity); }
+	// get the used and free space
+	ALLOCATOR_STATS GetStats() const;
+
+private:
+	// size classes - the second level splits each power of two
+	static const int SL_LOG2 = 4;
+	static const int SL_COUNT = 1 << SL_LOG2;
+	static const int FL_COUNT = 32;
+
+	// a used or free range, linked to its neighbours in the buffer
+	// and, when free, to the other free ranges of its size class
+	struct BLOCK
+	{
+		uint32_t offset;
+		uint32_t size;
+		bool bFree;
+		bool bUnused;
+		int prevPhysical;
+		int nextPhysical;
+		int prevFree;
+		int nextFree;
+	};
+
+	// range records, with unused records kept for reuse
+	std::vector<BLOCK> m_blocks;
+	std::vector<int> m_unusedBlocks;
+	// first free range of every size class
+	int m_freeHeads[FL_COUNT][SL_COUNT];
+	// bitmaps of the size classes that have free ranges
+	uint32_t m_firstLevelBitmap;
+	uint32_t m_secondLevelBitmaps[FL_COUNT];
+	// ranges at the start and at the end of the buffer
+	int m_firstBlock;
+	int m_lastBlock;
+	uint32_t m_capacity;
+	uint32_t m_usedUnits;
+
+	// get the size class that a size belongs to
+	static void MapSize(uint32_t size, int& firstLevel, int& secondLevel);
+	// find a free range of at least the passed in size
+	int FindFreeBlock(uint32_t size) const;
+	// add a range record and return its ID
+	int NewBlock(uint32_t offset, uint32_t size);
+	// recycle a range record
+	void DeleteBlock(int block);
+	// add a free range to the list of its size class
+	void InsertFreeBlock(int block);
+	// take a free range out of the list of its size class
+	void RemoveFreeBlock(int block);
+	// mark a free range as used, splitting off what is not needed
+	void UseFreeBlock(int block, uint32_t size);
+};
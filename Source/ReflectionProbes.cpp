@@ -0,0 +1,470 @@
+///////////////////////////////////////////////////////////////////////////////
+// reflectionprobes.cpp
+// ============
+// capture the static scene into cubemaps for metal and glass reflections
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ReflectionProbes.h"
+#include "ProgramBuilder.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// prefiltered mip levels, from mirror-like to fully rough
+	const int g_FilteredLevels = 6;
+	// work group size of the prefilter compute shader
+	const int g_PrefilterGroupSize = 8;
+	// image unit the prefilter writes through
+	const GLuint g_PrefilterImageUnit = 0;
+	// depth range of the captured faces
+	const float g_CaptureNear = 0.1f;
+	const float g_CaptureFar = 100.0f;
+
+	// look directions and up vectors of the cubemap faces, in the
+	// order of GL_TEXTURE_CUBE_MAP_POSITIVE_X onwards
+	const glm::vec3 g_FaceDirections[ReflectionProbes::FACE_COUNT] =
+	{
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 g_FaceUps[ReflectionProbes::FACE_COUNT] =
+	{
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+}
+
+/***********************************************************
+ *  ReflectionProbes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ReflectionProbes::ReflectionProbes(GpuResourceManager* pResources)
+{
+	m_pResources = pResources;
+	m_framebufferHandle = GPU_HANDLE();
+	m_depthHandle = GPU_HANDLE();
+	m_framebuffer = 0;
+	m_depthTexture = 0;
+	m_prefilterHandle = GPU_HANDLE();
+	m_prefilterProgram = 0;
+	m_roughnessLocation = -1;
+	m_sourceLodsLocation = -1;
+	m_faceSizeLocation = -1;
+	m_faceSize = 0;
+	m_captureLevels = 1;
+	m_bReady = false;
+	m_savedViewport[0] = 0;
+	m_savedViewport[1] = 0;
+	m_savedViewport[2] = 0;
+	m_savedViewport[3] = 0;
+	m_savedFramebuffer = 0;
+	m_capturedFaces = 0;
+	m_prefilteredProbes = 0;
+}
+
+/***********************************************************
+ *  ~ReflectionProbes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ReflectionProbes::~ReflectionProbes()
+{
+	m_pResources->Release(m_prefilterHandle);
+	m_prefilterProgram = 0;
+	for (size_t i = 0; i < m_probes.size(); i++)
+	{
+		m_pResources->Release(m_probes[i].captureHandle);
+		m_pResources->Release(m_probes[i].filteredHandle);
+	}
+	m_probes.clear();
+	m_pResources->Release(m_depthHandle);
+	m_pResources->Release(m_framebufferHandle);
+	m_pResources = NULL;
+}
+
+/***********************************************************
+ *  IsPrefilterSupported()
+ *
+ *  This method is used for checking whether the driver has
+ *  compute shaders that can write into cubemap images.
+ ***********************************************************/
+bool ReflectionProbes::IsPrefilterSupported()
+{
+	return((GLEW_ARB_compute_shader) && (GLEW_ARB_shader_image_load_store));
+}
+
+/***********************************************************
+ *  GetShaderDefine()
+ *
+ *  This method is used for getting the define that has the
+ *  scene fragment shader sample the probes.
+ ***********************************************************/
+const char* ReflectionProbes::GetShaderDefine()
+{
+	return("#define USE_REFLECTION_PROBES");
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the framebuffer and the
+ *  depth texture that every face is captured with, and the
+ *  prefilter program.  When the program cannot be built the
+ *  probes are still captured, and their plain mip chain is
+ *  sampled instead.
+ ***********************************************************/
+bool ReflectionProbes::Create(int faceSize, const char* prefilterFile)
+{
+	if (faceSize <= 0)
+	{
+		return(false);
+	}
+
+	m_faceSize = faceSize;
+	m_captureLevels = 1;
+	while ((faceSize >> m_captureLevels) > 0)
+	{
+		m_captureLevels++;
+	}
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, faceSize, faceSize, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	m_depthHandle = m_pResources->AdoptObject(GpuResourceManager::RESOURCE_TEXTURE, m_depthTexture,
+		(size_t)faceSize * faceSize * 4, "reflection probe depth");
+
+	m_framebufferHandle = m_pResources->CreateFramebuffer("reflection probe framebuffer");
+	m_framebuffer = m_pResources->GetName(m_framebufferHandle);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// rough reflections blend across the cube edges
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	if (IsPrefilterSupported())
+	{
+		m_prefilterHandle = ProgramBuilder::BuildComputeProgram(m_pResources, prefilterFile, "");
+		m_prefilterProgram = m_pResources->GetName(m_prefilterHandle);
+	}
+	if (m_prefilterProgram != 0)
+	{
+		m_roughnessLocation = glGetUniformLocation(m_prefilterProgram, "roughness");
+		m_sourceLodsLocation = glGetUniformLocation(m_prefilterProgram, "sourceLods");
+		m_faceSizeLocation = glGetUniformLocation(m_prefilterProgram, "faceSize");
+	}
+	else
+	{
+		std::cout << "Reflection probes are not prefiltered - sampling their mipmaps" << std::endl;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateCubemap()
+ *
+ *  This method is used for creating an empty half float
+ *  cubemap with the passed in number of mip levels.
+ ***********************************************************/
+GLuint ReflectionProbes::CreateCubemap(int levels, GPU_HANDLE& handle, const char* label)
+{
+	GLuint texture = 0;
+	size_t bytes = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	for (int level = 0; level < levels; level++)
+	{
+		int size = m_faceSize >> level;
+		for (int face = 0; face < FACE_COUNT; face++)
+		{
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGBA16F, size, size, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+		}
+		bytes += (size_t)size * size * 8 * FACE_COUNT;
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	handle = m_pResources->AdoptObject(GpuResourceManager::RESOURCE_TEXTURE, texture, bytes, label);
+	return(texture);
+}
+
+/***********************************************************
+ *  AddProbe()
+ *
+ *  This method is used for adding a probe at a position.
+ *  Every face of a new probe has to be captured.  The first
+ *  probe checks that the capture framebuffer is complete.
+ ***********************************************************/
+int ReflectionProbes::AddProbe(const glm::vec3& position, int ownerObject)
+{
+	PROBE probe;
+	probe.position = position;
+	probe.ownerObject = ownerObject;
+	probe.captureTexture = CreateCubemap(m_captureLevels, probe.captureHandle, "reflection probe capture");
+	probe.filteredHandle = GPU_HANDLE();
+	probe.filteredTexture = 0;
+	if (m_prefilterProgram != 0)
+	{
+		probe.filteredTexture = CreateCubemap(g_FilteredLevels, probe.filteredHandle, "reflection probe prefiltered");
+	}
+	for (int face = 0; face < FACE_COUNT; face++)
+	{
+		probe.bFaceDirty[face] = true;
+	}
+	probe.bFiltered = false;
+
+	if (m_probes.size() == 0)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X, probe.captureTexture, 0);
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (status != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "Reflection probe framebuffer is incomplete, status:" << status << std::endl;
+			m_pResources->Release(probe.captureHandle);
+			m_pResources->Release(probe.filteredHandle);
+			return(-1);
+		}
+	}
+
+	m_probes.push_back(probe);
+	return((int)m_probes.size() - 1);
+}
+
+/***********************************************************
+ *  MarkAllDirty()
+ *
+ *  This method is used for capturing every probe again after
+ *  the scene changed.  The old cubemaps are sampled until the
+ *  new faces are done.
+ ***********************************************************/
+void ReflectionProbes::MarkAllDirty()
+{
+	for (size_t i = 0; i < m_probes.size(); i++)
+	{
+		for (int face = 0; face < FACE_COUNT; face++)
+		{
+			m_probes[i].bFaceDirty[face] = true;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetNextDirtyFace()
+ *
+ *  This method is used for finding the next face to capture,
+ *  finishing one probe before starting on the next.
+ ***********************************************************/
+bool ReflectionProbes::GetNextDirtyFace(int& probe, int& face) const
+{
+	for (size_t i = 0; i < m_probes.size(); i++)
+	{
+		for (int f = 0; f < FACE_COUNT; f++)
+		{
+			if (m_probes[i].bFaceDirty[f])
+			{
+				probe = (int)i;
+				face = f;
+				return(true);
+			}
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  BeginCapture()
+ *
+ *  This method is used for switching to the capture
+ *  framebuffer, saving the render target to restore.
+ ***********************************************************/
+void ReflectionProbes::BeginCapture()
+{
+	glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_faceSize, m_faceSize);
+}
+
+/***********************************************************
+ *  BeginFace()
+ *
+ *  This method is used for attaching a face of a probe and
+ *  clearing it, and for getting the 90 degree view of the
+ *  face.  The face counts as captured from here on.
+ ***********************************************************/
+void ReflectionProbes::BeginFace(int probe, int face, glm::mat4& view, glm::mat4& projection)
+{
+	PROBE& target = m_probes[probe];
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+		target.captureTexture, 0);
+
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClearDepth(1.0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	view = glm::lookAt(target.position, target.position + g_FaceDirections[face], g_FaceUps[face]);
+	projection = glm::perspective(glm::radians(90.0f), 1.0f, g_CaptureNear, g_CaptureFar);
+
+	target.bFaceDirty[face] = false;
+	target.bFiltered = false;
+	m_capturedFaces++;
+}
+
+/***********************************************************
+ *  EndCapture()
+ *
+ *  This method is used for restoring the render target and
+ *  prefiltering every probe whose faces are all captured.
+ ***********************************************************/
+void ReflectionProbes::EndCapture()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_savedFramebuffer);
+	glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+
+	// the old cubemaps keep being sampled while the probes are
+	// captured again, so the probes stay ready from then on
+	bool bReady = true;
+	for (size_t i = 0; i < m_probes.size(); i++)
+	{
+		PROBE& probe = m_probes[i];
+		bool bComplete = true;
+		for (int face = 0; face < FACE_COUNT; face++)
+		{
+			bComplete = bComplete && (probe.bFaceDirty[face] == false);
+		}
+		if ((bComplete) && (probe.bFiltered == false))
+		{
+			Prefilter(probe);
+		}
+		bReady = bReady && (probe.bFiltered);
+	}
+	m_bReady = m_bReady || bReady;
+}
+
+/***********************************************************
+ *  Prefilter()
+ *
+ *  This method is used for building the mip chain of the
+ *  captured faces, and then for filtering them into the mip
+ *  levels of the prefiltered cubemap, one dispatch for each
+ *  level.  The mip chain lets the compute shader read wide
+ *  cones of the scene from a few samples.
+ ***********************************************************/
+void ReflectionProbes::Prefilter(PROBE& probe)
+{
+	glBindTexture(GL_TEXTURE_CUBE_MAP, probe.captureTexture);
+	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	probe.bFiltered = true;
+	m_prefilteredProbes++;
+
+	if (m_prefilterProgram == 0)
+	{
+		return;
+	}
+
+	glUseProgram(m_prefilterProgram);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, probe.captureTexture);
+	glUniform1f(m_sourceLodsLocation, (float)(m_captureLevels - 1));
+	for (int level = 0; level < g_FilteredLevels; level++)
+	{
+		int size = m_faceSize >> level;
+		glBindImageTexture(g_PrefilterImageUnit, probe.filteredTexture, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+		glUniform1f(m_roughnessLocation, (float)level / (float)(g_FilteredLevels - 1));
+		glUniform1i(m_faceSizeLocation, size);
+		int groups = (size + g_PrefilterGroupSize - 1) / g_PrefilterGroupSize;
+		glDispatchCompute(groups, groups, FACE_COUNT);
+	}
+	// the scene shader samples the levels that were written
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	glUseProgram(0);
+}
+
+/***********************************************************
+ *  FindNearestProbe()
+ *
+ *  This method is used for finding the probe closest to a
+ *  point.
+ ***********************************************************/
+int ReflectionProbes::FindNearestProbe(const glm::vec3& position) const
+{
+	int nearest = -1;
+	float nearestDistance = 0.0f;
+	for (size_t i = 0; i < m_probes.size(); i++)
+	{
+		glm::vec3 offset = m_probes[i].position - position;
+		float distance = glm::dot(offset, offset);
+		if ((nearest < 0) || (distance < nearestDistance))
+		{
+			nearest = (int)i;
+			nearestDistance = distance;
+		}
+	}
+	return(nearest);
+}
+
+/***********************************************************
+ *  GetTexture()
+ *
+ *  This method is used for getting the cubemap to sample for
+ *  a probe - the prefiltered one when there is one.
+ ***********************************************************/
+GLuint ReflectionProbes::GetTexture(int index) const
+{
+	const PROBE& probe = m_probes[index];
+	if (probe.filteredTexture != 0)
+	{
+		return(probe.filteredTexture);
+	}
+	return(probe.captureTexture);
+}
+
+/***********************************************************
+ *  GetMaxLod()
+ *
+ *  This method is used for getting the mip level that holds
+ *  the roughest reflections.
+ ***********************************************************/
+float ReflectionProbes::GetMaxLod() const
+{
+	if (m_prefilterProgram != 0)
+	{
+		return((float)(g_FilteredLevels - 1));
+	}
+	return((float)(m_captureLevels - 1));
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing how many probe faces
+ *  were captured and how many probes were prefiltered.
+ ***********************************************************/
+void ReflectionProbes::PrintStats() const
+{
+	std::cout << "Reflection probes: " << m_probes.size() << " probes, "
+		<< m_capturedFaces << " faces captured, "
+		<< m_prefilteredProbes << " prefilter passes" << std::endl;
+}
@@ -0,0 +1,130 @@
+///////////////////////////////////////////////////////////////////////////////
+// reflectionprobes.h
+// ============
+// capture the static scene into cubemaps for metal and glass reflections
+//
+//	Every probe renders the scene around it into the six faces of a
+//	cubemap.  Faces are only rendered when the scene changes, and then a
+//	few at a time, so a probe update is spread over several frames instead
+//	of showing up as a slow frame.  Once all six faces of a probe are
+//	fresh, a compute shader prefilters the cubemap into mip levels of
+//	rising roughness, which the fragment shader picks from with the
+//	shininess of the material.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "GpuResourceManager.h"
+
+/***********************************************************
+ *  ReflectionProbes
+ *
+ *  This class owns the probe cubemaps, the framebuffer they
+ *  are captured with and the prefilter compute program.
+ ***********************************************************/
+class ReflectionProbes
+{
+public:
+	// faces of a cubemap
+	static const int FACE_COUNT = 6;
+
+	// one point the scene is captured from
+	struct PROBE
+	{
+		glm::vec3 position;
+		// compound object around the probe, which is left out of
+		// its own capture
+		int ownerObject;
+		// captured faces, with a mip chain the prefilter reads from
+		GPU_HANDLE captureHandle;
+		GLuint captureTexture;
+		// prefiltered mip levels, when compute shaders are supported
+		GPU_HANDLE filteredHandle;
+		GLuint filteredTexture;
+		bool bFaceDirty[FACE_COUNT];
+		bool bFiltered;
+	};
+
+	// constructor - the textures and framebuffer are owned by the
+	// resource manager
+	ReflectionProbes(GpuResourceManager* pResources);
+	// destructor
+	~ReflectionProbes();
+
+	// check whether the driver can prefilter the probes in a compute
+	// shader - without it the captured mip chain is sampled as it is
+	static bool IsPrefilterSupported();
+	// get the shader define that samples the probes for reflections
+	static const char* GetShaderDefine();
+
+	// create the capture framebuffer and the prefilter program
+	bool Create(int faceSize, const char* prefilterFile);
+	// add a probe and get its index
+	int AddProbe(const glm::vec3& position, int ownerObject);
+	// mark every face of every probe to be captured again
+	void MarkAllDirty();
+
+	// find the next face that has to be captured
+	bool GetNextDirtyFace(int& probe, int& face) const;
+	// start capturing faces
+	void BeginCapture();
+	// select a face to capture and get its view and projection
+	void BeginFace(int probe, int face, glm::mat4& view, glm::mat4& projection);
+	// finish capturing, prefilter the probes that are complete and
+	// restore the previous render target
+	void EndCapture();
+
+	// check whether every probe was captured and filtered at least once
+	bool IsReady() const { return(m_bReady); }
+	// get the number of probes
+	int GetProbeCount() const { return((int)m_probes.size()); }
+	// get a probe
+	const PROBE& GetProbe(int index) const { return(m_probes[index]); }
+	// find the probe nearest to a point, or -1 when there are none
+	int FindNearestProbe(const glm::vec3& position) const;
+	// get the cubemap to sample for a probe
+	GLuint GetTexture(int index) const;
+	// get the mip level of the roughest reflections
+	float GetMaxLod() const;
+
+	// print how many faces were captured and probes prefiltered
+	void PrintStats() const;
+
+private:
+	// resource manager that owns the probe objects
+	GpuResourceManager* m_pResources;
+	GPU_HANDLE m_framebufferHandle;
+	GPU_HANDLE m_depthHandle;
+	GLuint m_framebuffer;
+	GLuint m_depthTexture;
+	// prefilter compute program and its uniforms
+	GPU_HANDLE m_prefilterHandle;
+	GLuint m_prefilterProgram;
+	GLint m_roughnessLocation;
+	GLint m_sourceLodsLocation;
+	GLint m_faceSizeLocation;
+
+	std::vector<PROBE> m_probes;
+	int m_faceSize;
+	int m_captureLevels;
+	bool m_bReady;
+
+	// render state saved while capturing
+	GLint m_savedViewport[4];
+	GLint m_savedFramebuffer;
+
+	// work done so far
+	int64_t m_capturedFaces;
+	int64_t m_prefilteredProbes;
+
+	// create an empty cubemap with a mip chain
+	GLuint CreateCubemap(int levels, GPU_HANDLE& handle, const char* label);
+	// prefilter the captured faces of a probe into its mip levels
+	void Prefilter(PROBE& probe);
+};
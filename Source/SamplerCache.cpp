@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+// samplercache.cpp
+// ============
+// share OpenGL sampler objects between the textures that use the same
+// wrapping and filtering
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SamplerCache.h"
+
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	const char* const g_FilterNames[SamplerCache::FILTER_COUNT] = { "linear", "trilinear", "aniso" };
+
+	// anisotropy used by the anisotropic filter, limited by the driver
+	const float g_Anisotropy = 8.0f;
+}
+
+/***********************************************************
+ *  SamplerCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SamplerCache::SamplerCache()
+{
+	for (int wrap = 0; wrap < WRAP_COUNT; wrap++)
+	{
+		for (int filter = 0; filter < FILTER_COUNT; filter++)
+		{
+			m_samplers[wrap][filter] = 0;
+		}
+	}
+}
+
+/***********************************************************
+ *  ~SamplerCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SamplerCache::~SamplerCache()
+{
+	for (int wrap = 0; wrap < WRAP_COUNT; wrap++)
+	{
+		for (int filter = 0; filter < FILTER_COUNT; filter++)
+		{
+			if (m_samplers[wrap][filter] != 0)
+			{
+				glDeleteSamplers(1, &m_samplers[wrap][filter]);
+				m_samplers[wrap][filter] = 0;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GetSampler()
+ *
+ *  This method is used for getting the sampler object for a
+ *  wrapping and filtering combination.  The sampler is made
+ *  the first time it is asked for.
+ ***********************************************************/
+GLuint SamplerCache::GetSampler(int wrap, int filter)
+{
+	if ((wrap < 0) || (wrap >= WRAP_COUNT) || (filter < 0) || (filter >= FILTER_COUNT))
+	{
+		return(0);
+	}
+
+	if (m_samplers[wrap][filter] == 0)
+	{
+		m_samplers[wrap][filter] = CreateSampler(wrap, filter);
+	}
+	return(m_samplers[wrap][filter]);
+}
+
+/***********************************************************
+ *  CreateSampler()
+ *
+ *  This method is used for creating a sampler object.  The
+ *  linear filter matches the original texture settings and
+ *  ignores the mipmaps, the trilinear filter blends between
+ *  mipmap levels, and the anisotropic filter adds anisotropy
+ *  on top of trilinear when the driver supports it.
+ ***********************************************************/
+GLuint SamplerCache::CreateSampler(int wrap, int filter)
+{
+	GLuint sampler = 0;
+	glGenSamplers(1, &sampler);
+
+	GLint wrapMode = (wrap == WRAP_CLAMP) ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+	glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, wrapMode);
+	glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, wrapMode);
+
+	glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (filter == FILTER_LINEAR)
+	{
+		glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	}
+	else
+	{
+		glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	}
+
+	if ((filter == FILTER_ANISOTROPIC) &&
+		((GLEW_ARB_texture_filter_anisotropic) || (GLEW_EXT_texture_filter_anisotropic)))
+	{
+		GLfloat maxAnisotropy = 1.0f;
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAnisotropy);
+		glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY, (g_Anisotropy < maxAnisotropy) ? g_Anisotropy : maxAnisotropy);
+	}
+
+	return(sampler);
+}
+
+/***********************************************************
+ *  GetFilterName()
+ *
+ *  This method is used for getting the display name of a
+ *  filter.
+ ***********************************************************/
+const char* SamplerCache::GetFilterName(int filter)
+{
+	if ((filter < 0) || (filter >= FILTER_COUNT))
+	{
+		return("unknown");
+	}
+	return(g_FilterNames[filter]);
+}
+
+/***********************************************************
+ *  FindFilter()
+ *
+ *  This method is used for finding a filter by its display
+ *  name.  -1 is returned for unknown names.
+ ***********************************************************/
+int SamplerCache::FindFilter(const char* name)
+{
+	for (int filter = 0; filter < FILTER_COUNT; filter++)
+	{
+		if (strcmp(name, g_FilterNames[filter]) == 0)
+		{
+			return(filter);
+		}
+	}
+	return(-1);
+}
@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////
+// samplercache.h
+// ============
+// share OpenGL sampler objects between the textures that use the same
+// wrapping and filtering
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  SamplerCache
+ *
+ *  This class creates one sampler object for every wrapping
+ *  and filtering combination on first use.  Samplers are
+ *  bound to texture units separately from the textures, so
+ *  the filtering of every texture can be switched at once.
+ ***********************************************************/
+class SamplerCache
+{
+public:
+	// how texture coordinates outside of [0,1] are handled
+	enum SAMPLER_WRAP
+	{
+		WRAP_REPEAT = 0,
+		WRAP_CLAMP,
+		WRAP_COUNT
+	};
+
+	// how texels are filtered
+	enum SAMPLER_FILTER
+	{
+		FILTER_LINEAR = 0,
+		FILTER_TRILINEAR,
+		FILTER_ANISOTROPIC,
+		FILTER_COUNT
+	};
+
+	// constructor
+	SamplerCache();
+	// destructor
+	~SamplerCache();
+
+	// get the sampler object for a wrapping and filtering combination
+	GLuint GetSampler(int wrap, int filter);
+
+	// get the display name of a filter
+	static const char* GetFilterName(int filter);
+	// find a filter by its display name, or -1
+	static int FindFilter(const char* name);
+
+private:
+	// sampler objects, created on first use
+	GLuint m_samplers[WRAP_COUNT][FILTER_COUNT];
+
+	// create the sampler object for a combination
+	GLuint CreateSampler(int wrap, int filter);
+};
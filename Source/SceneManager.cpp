@@ -8,22 +8,141 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "WorldStreamer.h"
+#include "ViewManager.h"
+#include "ImpostorAtlas.h"
+#include "JobSystem.h"
+#include "MeshCooker.h"
+#include "AssetCache.h"
+#include "AssetPack.h"
+#include "ImageDecoder.h"
+#include "TextureBudget.h"
+#include "SamplerCache.h"
+#include "BindlessTextures.h"
+#include "DynamicBufferRing.h"
+#include "GpuCulling.h"
+#include "OcclusionQueries.h"
+#include "ProceduralShapes.h"
+#include "TransformSystem.h"
+#include "ViewSet.h"
+#include "ReflectionProbes.h"
+#include "AmbientOcclusion.h"
+#include "LightAnimator.h"
+#include "AnimationSystem.h"
+#include "PhysicsWorld.h"
+#include "SpatialQuery.h"
+#include "GpuTimer.h"
+#include "TraceLog.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #endif
 
+#include <glm/gtc/constants.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <fstream>
+
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
 	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+
+	// uniform block of the per-draw values, and the room for one frame
+	// of them in the dynamic ring buffer
+	const char* g_DrawDataBlockName = "DrawData";
+	const GLuint g_DrawDataBinding = 0;
+	const size_t g_DynamicSectionBytes = 1024 * 1024;
+	// storage block of the per-draw values when they are drawn from
+	// the GPU culling results - binding 0 holds the bindless table
+	const char* g_DrawDataArrayName = "DrawDataArray";
+	const GLuint g_DrawDataArrayBinding = 1;
+	// compute shader that culls the compound object parts
+	const char* g_CullShaderFile = "shaders/cullComputeShader.glsl";
+	// a camera this close to a bounding box may have the box cut by the
+	// near plane, so the object is drawn without a query
+	const float g_OcclusionNearMargin = 0.5f;
+	// room added around every side of an occlusion proxy, and the least
+	// thickness of one, so a flat object or a face that lies on its box
+	// does not hide its own proxy from the depth test
+	const float g_OcclusionProxyMargin = 0.05f;
+	const float g_OcclusionProxyThickness = 0.1f;
+	// switch of the transform benchmark in the scene vertex shader
+	const char* g_PerVertexTransformsName = "bPerVertexTransforms";
+
+	// bytes of mesh data moved per frame while compacting the mesh buffers
+	const size_t g_MeshCompactBytesPerFrame = 256 * 1024;
+
+	// texture unit reserved for binding streamed world textures
+	const int g_WorldTextureUnit = 15;
+
+	// texture units reserved for binding the impostor atlas
+	const int g_ImpostorColorUnit = 13;
+	const int g_ImpostorDepthUnit = 14;
+	// impostor atlas layout - views per side and pixels per view
+	const int g_ImpostorFramesPerSide = 8;
+	const int g_ImpostorFrameSize = 128;
+	// floats per impostor billboard instance (center, radius, layer)
+	const int g_ImpostorInstanceFloats = 5;
+
+	// default texture memory budget
+	const uint64_t g_TextureBudgetBytes = 64ULL * 1024 * 1024;
+
+	// distance between the stereo eyes, and the distance from the
+	// camera that is seen at the depth of the screen
+	const float g_StereoEyeSeparation = 0.25f;
+	const float g_StereoConvergence = 10.0f;
+
+	// reflection probe cubemaps and the shader values that sample them
+	const char* g_PrefilterShaderFile = "shaders/prefilterComputeShader.glsl";
+	const int g_ProbeFaceSize = 128;
+	const int g_ReflectionProbeUnit = 12;
+	const char* g_ReflectionProbeName = "reflectionProbe";
+	const char* g_ReflectionMaxLodName = "reflectionProbeMaxLod";
+	const char* g_UseReflectionsName = "bUseReflections";
+
+	// first of the three texture units the ambient occlusion passes
+	// read from, and the GPU time the occlusion and blur may take
+	const int g_AmbientOcclusionUnit = 16;
+	const float g_AmbientOcclusionBudgetMs = 1.0f;
+
+	// thickness given to the spatial query boxes of planes below their
+	// surface, so the camera does not pass through them - the physics
+	// planes are half-spaces and need none
+	const float g_PlaneColliderThickness = 1.0f;
+	// mass per unit of collider volume, and the speed, lift and height
+	// above the center of a push
+	const float g_PhysicsDensity = 0.1f;
+	const float g_PhysicsPushSpeed = 12.0f;
+	const float g_PhysicsPushLift = 0.3f;
+	const float g_PhysicsPushHeight = 1.0f;
+
+	// texture image files used by the scene and their tags
+	const char* const g_SceneTextures[][2] =
+	{
+		{ "textures/bookcover.jpg", "bookcover_texture" },
+		{ "textures/bookside.jpg", "bookside_texture" },
+		{ "textures/counter.jpg", "counter_texture" },
+		{ "textures/pages.jpg", "pages_texture" },
+		{ "textures/wall.jpg", "wall_texture" },
+		{ "textures/can.jpg", "can_texture" },
+		{ "textures/canlid.jpg", "canlid_texture" },
+		{ "textures/apple.jpg", "apple_texture" },
+		{ "textures/carbonated.jpg", "carbonated_texture" },
+		{ "textures/foam.jpg", "foam_texture" }
+	};
+	const int g_SceneTextureCount = sizeof(g_SceneTextures) / sizeof(g_SceneTextures[0]);
+
+	// names of the basic shapes for the startup trace
+	const char* const g_ShapeNames[SHAPE_COUNT] =
+	{
+		"box", "cone", "cylinder", "plane", "sphere", "tapered cylinder", "torus"
+	};
 }
 
 /***********************************************************
@@ -34,7 +153,95 @@ namespace
 SceneManager::SceneManager(ShaderManager* pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
+	m_pGpuResources = new GpuResourceManager();
+	m_pMeshLibrary = new MeshLibrary(m_pGpuResources);
+	m_bCompactMeshes = false;
+	for (int i = 0; i < SHAPE_COUNT; i++)
+	{
+		m_shapeMeshIDs[i] = -1;
+	}
+	m_loadedTextures = 0;
+	m_pWorldStreamer = NULL;
+	m_pViewManager = NULL;
+	m_pImpostorAtlas = NULL;
+	m_pImpostorShader = NULL;
+	m_impostorVAO = GPU_HANDLE();
+	m_bUseImpostors = true;
+	m_impostorDistanceFactor = 12.0f;
+	m_bImpostorsReady = false;
+	m_pJobSystem = NULL;
+	m_pAssetCache = NULL;
+	m_sceneReadyTask = -1;
+	m_pTexturePack = NULL;
+	m_pSamplerCache = new SamplerCache();
+	m_textureFilter = SamplerCache::FILTER_TRILINEAR;
+	m_pBindlessTextures = NULL;
+
+	// per-draw values until the first object sets its own
+	m_drawData.model = glm::mat4(1.0f);
+	m_drawData.objectColor = glm::vec4(1.0f);
+	m_drawData.materialDiffuseColor = glm::vec4(0.0f);
+	m_drawData.materialSpecularColor = glm::vec4(0.0f);
+	m_drawData.UVscale = glm::vec2(1.0f, 1.0f);
+	m_drawData.bUseTexture = 0;
+	m_drawData.objectTextureIndex = -1;
+	m_drawData.modelViewProjection = glm::mat4(1.0f);
+	m_drawData.normalMatrix = glm::mat4(1.0f);
+	m_viewProjection = glm::mat4(1.0f);
+	m_drawDataProgram = 0;
+	m_bStorageDrawData = false;
+	m_pGpuCulling = NULL;
+	m_gpuCullTextureCount = -1;
+	m_bGpuCullImpostors = false;
+	m_gpuCullMeshLayout = 0;
+	m_pOcclusionQueries = NULL;
+	m_pProceduralShapes = NULL;
+	m_detailViewPosition = glm::vec3(0.0f);
+	m_bTessellatedShapes = false;
+	m_pViewSet = NULL;
+	m_viewLayout = ViewSet::LAYOUT_NONE;
+	m_bSinglePassViews = false;
+	m_bBenchmarkViews = false;
+	for (int i = 0; i < 2; i++)
+	{
+		m_pViewTimers[i] = NULL;
+		m_viewMicroseconds[i] = 0;
+		m_viewFrames[i] = 0;
+	}
+	m_viewKeptObjects = 0;
+	m_viewCulledObjects = 0;
+	m_pReflectionProbes = NULL;
+	m_probeFacesPerFrame = 1;
+	m_probeTextureCount = -1;
+	m_boundProbe = -1;
+	m_pAmbientOcclusion = NULL;
+	m_bAmbientOcclusionActive = false;
+	m_pLightAnimator = NULL;
+	m_lightAnimationTime = 0;
+	m_pAnimationSystem = NULL;
+	m_objectAnimationTime = 0;
+	m_bPhysics = false;
+	m_pPhysicsWorld = NULL;
+	m_physicsTime = 0;
+	m_pSpatialQuery = NULL;
+	m_pSceneTimers[0] = NULL;
+	m_pSceneTimers[1] = NULL;
+	m_bBenchmarkTransforms = false;
+	m_sceneTimedFrames = 0;
+	// the draw data ranges may be bound as uniform or storage buffers
+	GLint uniformAlignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	if (GLEW_ARB_shader_storage_buffer_object)
+	{
+		GLint storageAlignment = 256;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+		uniformAlignment = std::max(uniformAlignment, storageAlignment);
+	}
+	m_pDrawDataRing = new DynamicBufferRing(m_pGpuResources);
+	m_pDrawDataRing->Create(g_DynamicSectionBytes, (size_t)uniformAlignment, "dynamic draw data");
+
+	m_textureQuality = TextureBudget::QUALITY_HIGH;
+	m_textureBudgetBytes = g_TextureBudgetBytes;
 }
 
 /***********************************************************
@@ -45,8 +252,56 @@ SceneManager::SceneManager(ShaderManager* pShaderManager)
 SceneManager::~SceneManager()
 {
 	m_pShaderManager = NULL;
-	delete m_basicMeshes;
-	m_basicMeshes = NULL;
+	m_pWorldStreamer = NULL;
+	m_pViewManager = NULL;
+	m_pGpuResources->Release(m_impostorVAO);
+	delete m_pImpostorAtlas;
+	m_pImpostorAtlas = NULL;
+	delete m_pImpostorShader;
+	m_pImpostorShader = NULL;
+	// pixel buffers are left over when the application closes
+	// while the packed textures are still loading
+	for (size_t i = 0; i < m_textureUploadBuffers.size(); i++)
+	{
+		m_pGpuResources->Release(m_textureUploadBuffers[i]);
+	}
+	delete m_pTexturePack;
+	m_pTexturePack = NULL;
+	delete m_pDrawDataRing;
+	m_pDrawDataRing = NULL;
+	delete m_pGpuCulling;
+	m_pGpuCulling = NULL;
+	delete m_pOcclusionQueries;
+	m_pOcclusionQueries = NULL;
+	delete m_pProceduralShapes;
+	m_pProceduralShapes = NULL;
+	SetMultiView(ViewSet::LAYOUT_NONE, false);
+	delete m_pReflectionProbes;
+	m_pReflectionProbes = NULL;
+	delete m_pAmbientOcclusion;
+	m_pAmbientOcclusion = NULL;
+	delete m_pLightAnimator;
+	m_pLightAnimator = NULL;
+	delete m_pAnimationSystem;
+	m_pAnimationSystem = NULL;
+	delete m_pPhysicsWorld;
+	m_pPhysicsWorld = NULL;
+	delete m_pSpatialQuery;
+	m_pSpatialQuery = NULL;
+	SetSceneTiming(false, false);
+	// the handles have to be released before the samplers go away
+	delete m_pBindlessTextures;
+	m_pBindlessTextures = NULL;
+	delete m_pSamplerCache;
+	m_pSamplerCache = NULL;
+	m_pJobSystem = NULL;
+	m_pAssetCache = NULL;
+	DestroyGLTextures();
+	delete m_pMeshLibrary;
+	m_pMeshLibrary = NULL;
+	// anything still live in the resource manager is reported as a leak
+	delete m_pGpuResources;
+	m_pGpuResources = NULL;
 }
 
 /***********************************************************
@@ -59,66 +314,139 @@ SceneManager::~SceneManager()
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
+	DECODED_TEXTURE texture;
 
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
+	if (DecodeTexture(filename, tag, 1, texture) == false)
+	{
+		return false;
+	}
 
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
+	return(UploadTexture(texture));
+}
 
-	// if the image was successfully read from the image file
-	if (image)
-	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
+/***********************************************************
+ *  DecodeTexture()
+ *
+ *  This method is used for reading and decoding a texture
+ *  image file into memory, reduced by the scale denominator.
+ *  When an asset cache is set, the
+ *  decoded pixels are looked up by the hash of the file bytes
+ *  first, and stored there after decoding.  No OpenGL calls
+ *  are made, so this can be run on a worker thread.
+ ***********************************************************/
+bool SceneManager::DecodeTexture(const char* filename, std::string tag, int scaleDenominator, DECODED_TEXTURE& texture)
+{
+	texture.filename = filename;
+	texture.tag = tag;
+	texture.width = 0;
+	texture.height = 0;
+	texture.colorChannels = 0;
+	texture.pixels.clear();
+
+	// read the whole image file, since its bytes make the cache key
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	std::vector<unsigned char> fileBytes;
+	if (file)
+	{
+		fileBytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	if (fileBytes.size() == 0)
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return false;
+	}
+
+	// decoded pixels depend on the file bytes, the decoder, the scale
+	// and the vertical flip
+	const ImageDecoder* pDecoder = ImageDecoder::FindDecoder(fileBytes.data(), fileBytes.size());
+	std::string cacheKey;
+	if (NULL != m_pAssetCache)
+	{
+		std::vector<unsigned char> cached;
+		std::string parameters = std::string("decoder=") + pDecoder->GetName() +
+			";scale=" + std::to_string(scaleDenominator) + ";flip=1;channels=source";
+		cacheKey = AssetCache::MakeKey("texture", fileBytes.data(), fileBytes.size(), parameters);
+		if (m_pAssetCache->Load(cacheKey, cached))
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
+			ChunkReader reader(cached.data(), cached.size());
+			int32_t values[3] = { 0, 0, 0 };
+			if ((reader.Read(values)) &&
+				(values[0] > 0) && (values[1] > 0) && (values[2] > 0) &&
+				(reader.GetRemaining() == (size_t)values[0] * values[1] * values[2]))
+			{
+				texture.width = values[0];
+				texture.height = values[1];
+				texture.colorChannels = values[2];
+				texture.pixels.assign(cached.begin() + sizeof(values), cached.end());
+				return true;
+			}
 		}
+	}
+
+	// try to parse the image data from the specified image file
+	DECODED_IMAGE image;
+	const ImageDecoder* pUsedDecoder = NULL;
+	if (ImageDecoder::DecodeImage(fileBytes.data(), fileBytes.size(), scaleDenominator, image, &pUsedDecoder) == false)
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return false;
+	}
+
+	texture.width = image.width;
+	texture.height = image.height;
+	texture.colorChannels = image.colorChannels;
+	texture.pixels.swap(image.pixels);
+
+	// images that fell back to another decoder do not match the key
+	if ((NULL != m_pAssetCache) && (pUsedDecoder == pDecoder))
+	{
+		ChunkWriter writer;
+		writer.Write((int32_t)texture.width);
+		writer.Write((int32_t)texture.height);
+		writer.Write((int32_t)texture.colorChannels);
+		writer.WriteBytes(texture.pixels.data(), texture.pixels.size());
+		m_pAssetCache->Store(cacheKey, writer.GetData());
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  UploadTexture()
+ *
+ *  This method is used for configuring the texture mapping
+ *  parameters in OpenGL, generating the mipmaps, and loading
+ *  a decoded texture into the next available texture slot in
+ *  memory.  The decoded image is freed afterwards.
+ ***********************************************************/
+bool SceneManager::UploadTexture(DECODED_TEXTURE& texture)
+{
+	GLuint textureID = 0;
+
+	// if the image was successfully read from the image file
+	if (texture.pixels.size() > 0)
+	{
+		std::cout << "Successfully loaded image:" << texture.filename << ", width:" << texture.width << ", height:" << texture.height << ", channels:" << texture.colorChannels << std::endl;
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		GPU_HANDLE handle = m_pGpuResources->CreateTexture2D(texture.width, texture.height, texture.colorChannels, texture.pixels.data(), texture.tag.c_str());
+		textureID = m_pGpuResources->GetName(handle);
 
 		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+		std::vector<unsigned char>().swap(texture.pixels);
+		if (textureID == 0)
+		{
+			return false;
+		}
 
 		// register the loaded texture and associate it with the special tag string
 		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
+		m_textureIDs[m_loadedTextures].handle = handle;
+		m_textureIDs[m_loadedTextures].tag = texture.tag;
 		m_loadedTextures++;
 
 		return true;
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
-
 	// Error loading the image
 	return false;
 }
@@ -128,29 +456,400 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
  *
  *  This method is used for binding the loaded textures to
  *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  The shared sampler for the texture filter is bound to the
+ *  same slots, and to the slot of the streamed world textures.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
+	GLuint sampler = m_pSamplerCache->GetSampler(SamplerCache::WRAP_REPEAT, m_textureFilter);
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
 		// bind textures on corresponding texture units
 		glActiveTexture(GL_TEXTURE0 + i);
 		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		glBindSampler(i, sampler);
+	}
+	glBindSampler(g_WorldTextureUnit, sampler);
+
+	// the bindless table holds one handle per slot, so a draw only
+	// sets the slot index instead of binding a texture
+	if ((NULL != m_pBindlessTextures) && (NULL != m_pShaderManager))
+	{
+		for (int i = 0; i < m_loadedTextures; i++)
+		{
+			m_pBindlessTextures->SetTexture(i, m_textureIDs[i].ID, sampler);
+		}
+		m_pBindlessTextures->Bind(m_pShaderManager->m_programID);
+	}
+}
+
+/***********************************************************
+ *  SetBindlessTextures()
+ *
+ *  This method is used for switching between sampling the
+ *  scene textures through bindless handles and through the
+ *  bound texture slots.
+ ***********************************************************/
+void SceneManager::SetBindlessTextures(bool bEnabled)
+{
+	if (bEnabled == (NULL != m_pBindlessTextures))
+	{
+		return;
+	}
+
+	if (bEnabled)
+	{
+		if (BindlessTextures::IsSupported() == false)
+		{
+			std::cout << "Bindless textures are not supported - using texture slots" << std::endl;
+			return;
+		}
+		m_pBindlessTextures = new BindlessTextures(m_pGpuResources);
+	}
+	else
+	{
+		delete m_pBindlessTextures;
+		m_pBindlessTextures = NULL;
+	}
+	BindGLTextures();
+}
+
+/***********************************************************
+ *  SetGpuCulling()
+ *
+ *  This method is used for switching the scene shader over
+ *  to reading its per-draw values from a storage buffer,
+ *  and for creating the compute culling of the compound
+ *  objects.  The culled objects are drawn with one call, so
+ *  they cannot bind their own textures and need the
+ *  bindless table.  When the culling cannot be created the
+ *  objects are drawn one by one as before, with the values
+ *  of each draw bound from the dynamic ring buffer.
+ ***********************************************************/
+void SceneManager::SetGpuCulling(bool bEnabled)
+{
+	delete m_pGpuCulling;
+	m_pGpuCulling = NULL;
+	m_gpuCullTextureCount = -1;
+	m_bStorageDrawData = bEnabled;
+	m_drawDataProgram = 0;
+	if (bEnabled == false)
+	{
+		return;
+	}
+
+	// plain draws read the values at draw index 0
+	m_pMeshLibrary->SetDrawIndexCount(1);
+
+	if ((GpuCulling::IsSupported() == false) || (NULL == m_pBindlessTextures))
+	{
+		std::cout << "GPU culling needs compute shaders and bindless textures - culling on the CPU" << std::endl;
+		return;
+	}
+
+	m_pGpuCulling = new GpuCulling(m_pGpuResources);
+	if (m_pGpuCulling->Create(g_CullShaderFile) == false)
+	{
+		std::cout << "Could not create the GPU culling - culling on the CPU" << std::endl;
+		delete m_pGpuCulling;
+		m_pGpuCulling = NULL;
+	}
+}
+
+/***********************************************************
+ *  SetOcclusionQueries()
+ *
+ *  This method is used for switching the occlusion queries
+ *  on the bounding boxes of the compound objects on or off.
+ ***********************************************************/
+void SceneManager::SetOcclusionQueries(bool bEnabled)
+{
+	if (bEnabled == (NULL != m_pOcclusionQueries))
+	{
+		return;
+	}
+
+	delete m_pOcclusionQueries;
+	m_pOcclusionQueries = NULL;
+	if (bEnabled)
+	{
+		m_pOcclusionQueries = new OcclusionQueries();
+	}
+}
+
+/***********************************************************
+ *  SetProceduralShapes()
+ *
+ *  This method is used for switching the drawing of the
+ *  round basic shapes between their meshes and generating
+ *  them in the vertex shader.
+ ***********************************************************/
+void SceneManager::SetProceduralShapes(bool bEnabled)
+{
+	if (bEnabled == (NULL != m_pProceduralShapes))
+	{
+		return;
+	}
+
+	delete m_pProceduralShapes;
+	m_pProceduralShapes = NULL;
+	if (bEnabled)
+	{
+		m_pProceduralShapes = new ProceduralShapes(m_pGpuResources);
+	}
+}
+
+/***********************************************************
+ *  SetTessellatedShapes()
+ *
+ *  This method is used for switching every draw of the
+ *  scene shader between triangles and patches of three
+ *  vertices.  A program with tessellation shaders can only
+ *  draw patches, so the meshes are sent as patches too, and
+ *  pass through the tessellation as single triangles.
+ ***********************************************************/
+void SceneManager::SetTessellatedShapes(bool bEnabled)
+{
+	m_bTessellatedShapes = bEnabled;
+	m_pMeshLibrary->SetDrawPatches(bEnabled);
+	if (NULL != m_pProceduralShapes)
+	{
+		m_pProceduralShapes->SetDrawPatches(bEnabled);
+	}
+	if (bEnabled)
+	{
+		glPatchParameteri(GL_PATCH_VERTICES, 3);
+	}
+}
+
+/***********************************************************
+ *  SetMultiView()
+ *
+ *  This method is used for switching the design review or
+ *  stereo views on or off.  The views are drawn in one pass
+ *  when the vertex shader can pick the viewport, and
+ *  otherwise with a pass for each view.
+ ***********************************************************/
+void SceneManager::SetMultiView(int layout, bool bBenchmark)
+{
+	delete m_pViewSet;
+	m_pViewSet = NULL;
+	for (int i = 0; i < 2; i++)
+	{
+		delete m_pViewTimers[i];
+		m_pViewTimers[i] = NULL;
+	}
+	m_viewLayout = layout;
+	if (layout == ViewSet::LAYOUT_NONE)
+	{
+		return;
+	}
+
+	m_pViewSet = new ViewSet();
+	m_bSinglePassViews = ViewSet::IsSinglePassSupported();
+	m_bBenchmarkViews = (bBenchmark) && (m_bSinglePassViews);
+	if (m_bSinglePassViews == false)
+	{
+		std::cout << "Viewport arrays are not supported - drawing a pass per view" << std::endl;
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		m_pViewTimers[i] = new GpuTimer();
+	}
+}
+
+/***********************************************************
+ *  SetReflectionProbes()
+ *
+ *  This method is used for switching the reflection probes
+ *  on or off.  The probes themselves are placed once the
+ *  scene objects are defined.
+ ***********************************************************/
+void SceneManager::SetReflectionProbes(bool bEnabled, int facesPerFrame)
+{
+	delete m_pReflectionProbes;
+	m_pReflectionProbes = NULL;
+	m_probeFacesPerFrame = std::max(facesPerFrame, 1);
+	m_probeTextureCount = -1;
+	m_boundProbe = -1;
+	if (bEnabled == false)
+	{
+		return;
+	}
+
+	m_pReflectionProbes = new ReflectionProbes(m_pGpuResources);
+	if (m_pReflectionProbes->Create(g_ProbeFaceSize, g_PrefilterShaderFile) == false)
+	{
+		std::cout << "Could not create the reflection probes" << std::endl;
+		delete m_pReflectionProbes;
+		m_pReflectionProbes = NULL;
+	}
+}
+
+/***********************************************************
+ *  SetAmbientOcclusion()
+ *
+ *  This method is used for switching the ambient occlusion
+ *  on or off.  Once it is enabled, it can be switched on and
+ *  off again between frames without building it again.
+ ***********************************************************/
+void SceneManager::SetAmbientOcclusion(bool bEnabled)
+{
+	delete m_pAmbientOcclusion;
+	m_pAmbientOcclusion = NULL;
+	m_bAmbientOcclusionActive = bEnabled;
+	if (bEnabled == false)
+	{
+		return;
+	}
+
+	m_pAmbientOcclusion = new AmbientOcclusion(m_pGpuResources);
+	if (m_pAmbientOcclusion->Create(g_AmbientOcclusionUnit, g_AmbientOcclusionBudgetMs) == false)
+	{
+		std::cout << "Could not create the ambient occlusion passes" << std::endl;
+		delete m_pAmbientOcclusion;
+		m_pAmbientOcclusion = NULL;
+		m_bAmbientOcclusionActive = false;
+	}
+}
+
+/***********************************************************
+ *  SetDayCycle()
+ *
+ *  This method is used for switching the day cycle of the
+ *  lights on or off.  The keyframes are added along with the
+ *  lights once the scene shader is built.
+ ***********************************************************/
+void SceneManager::SetDayCycle(bool bEnabled, float dayLengthSeconds, float startHour)
+{
+	delete m_pLightAnimator;
+	m_pLightAnimator = NULL;
+	m_lightAnimationTime = 0;
+	if (bEnabled == false)
+	{
+		return;
+	}
+
+	m_pLightAnimator = new LightAnimator();
+	m_pLightAnimator->SetDayLength(dayLengthSeconds);
+	m_pLightAnimator->SetTimeOfDay(startHour);
+}
+
+/***********************************************************
+ *  SetObjectAnimation()
+ *
+ *  This method is used for switching the object animations
+ *  on or off.  The tracks are added along with the scene
+ *  objects.
+ ***********************************************************/
+void SceneManager::SetObjectAnimation(bool bEnabled)
+{
+	delete m_pAnimationSystem;
+	m_pAnimationSystem = NULL;
+	m_animatedParts.clear();
+	m_objectAnimationTime = 0;
+	if (bEnabled)
+	{
+		m_pAnimationSystem = new AnimationSystem();
+	}
+}
+
+/***********************************************************
+ *  SetSpatialQuery()
+ *
+ *  This method is used for switching the colliders of the
+ *  scene parts on or off.  The colliders are added along
+ *  with the scene objects.
+ ***********************************************************/
+void SceneManager::SetSpatialQuery(bool bEnabled)
+{
+	delete m_pSpatialQuery;
+	m_pSpatialQuery = NULL;
+	if (bEnabled)
+	{
+		m_pSpatialQuery = new SpatialQuery();
+	}
+}
+
+/***********************************************************
+ *  SetSceneTiming()
+ *
+ *  This method is used for switching the GPU timer of the
+ *  solid scene geometry on or off.  Only the compound
+ *  objects and the world cells are measured, so the probes,
+ *  the proxies and the ambient occlusion passes do not
+ *  blur the cost of the scene shaders.  The benchmark takes
+ *  turns between the two ways of transforming the vertices,
+ *  so both are measured against the same scene in one run.
+ ***********************************************************/
+void SceneManager::SetSceneTiming(bool bEnabled, bool bBenchmarkTransforms)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		delete m_pSceneTimers[i];
+		m_pSceneTimers[i] = NULL;
+	}
+	m_bBenchmarkTransforms = (bEnabled) && (bBenchmarkTransforms);
+	m_sceneTimedFrames = 0;
+	if (bEnabled)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			m_pSceneTimers[i] = new GpuTimer();
+		}
+	}
+}
+
+/***********************************************************
+ *  GetTransformBenchmarkDefine()
+ *
+ *  This method is used for getting the define that lets the
+ *  scene vertex shader multiply the matrices per vertex for
+ *  the transform benchmark.
+ ***********************************************************/
+const char* SceneManager::GetTransformBenchmarkDefine()
+{
+	return("#define USE_TRANSFORM_BENCHMARK");
+}
+
+/***********************************************************
+ *  SetTextureFilter()
+ *
+ *  This method is used for switching the filtering of all
+ *  the scene textures at once, by binding another shared
+ *  sampler to the texture slots.
+ ***********************************************************/
+void SceneManager::SetTextureFilter(int filter)
+{
+	if ((filter < 0) || (filter >= SamplerCache::FILTER_COUNT))
+	{
+		return;
 	}
+
+	m_textureFilter = filter;
+	BindGLTextures();
 }
 
 /***********************************************************
  *  DestroyGLTextures()
  *
  *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  used texture memory slots.  The textures are deleted or
+ *  recycled once the GPU has finished drawing with them.
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
+	// resident handles keep their textures alive
+	if (NULL != m_pBindlessTextures)
+	{
+		m_pBindlessTextures->ReleaseAll();
+	}
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		m_pGpuResources->Release(m_textureIDs[i].handle);
+		m_textureIDs[i].ID = 0;
 	}
+	m_loadedTextures = 0;
 }
 
 /***********************************************************
@@ -228,6 +927,7 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 			material.diffuseColor = m_objectMaterials[index].diffuseColor;
 			material.specularColor = m_objectMaterials[index].specularColor;
 			material.shininess = m_objectMaterials[index].shininess;
+			material.reflectivity = m_objectMaterials[index].reflectivity;
 		}
 		else
 		{
@@ -235,16 +935,16 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 		}
 	}
 
-	return(true);
+	return(bFound);
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  BuildModelMatrix()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for building the model matrix from
+ *  the passed in transformation values.
  ***********************************************************/
-void SceneManager::SetTransformations(
+glm::mat4 SceneManager::BuildModelMatrix(
 	glm::vec3 scaleXYZ,
 	float XrotationDegrees,
 	float YrotationDegrees,
@@ -252,7 +952,6 @@ void SceneManager::SetTransformations(
 	glm::vec3 positionXYZ)
 {
 	// variables for this method
-	glm::mat4 modelView;
 	glm::mat4 scale;
 	glm::mat4 rotationX;
 	glm::mat4 rotationY;
@@ -268,12 +967,28 @@ void SceneManager::SetTransformations(
 	// set the translation value in the transform buffer
 	translation = glm::translate(positionXYZ);
 
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+	return(translation * rotationZ * rotationY * rotationX * scale);
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	// variables for this method
+	glm::mat4 modelView;
+
+	modelView = BuildModelMatrix(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
+	m_drawData.model = modelView;
 }
 
 /***********************************************************
@@ -296,11 +1011,8 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-	}
+	m_drawData.bUseTexture = 0;
+	m_drawData.objectColor = currentColor;
 }
 
 /***********************************************************
@@ -312,12 +1024,17 @@ void SceneManager::SetShaderColor(
 void SceneManager::SetShaderTexture(
 	std::string textureTag)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+	m_drawData.bUseTexture = 1;
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
+	int textureID = -1;
+	textureID = FindTextureSlot(textureTag);
+	if (NULL != m_pBindlessTextures)
+	{
+		m_drawData.objectTextureIndex = textureID;
+	}
+	else if (NULL != m_pShaderManager)
+	{
+		// samplers cannot be kept in a buffer, so the slot stays a uniform
 		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
 	}
 }
@@ -330,10 +1047,7 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
+	m_drawData.UVscale = glm::vec2(u, v);
 }
 
 /***********************************************************
@@ -347,404 +1061,2524 @@ void SceneManager::SetShaderMaterial(
 {
 	if (m_objectMaterials.size() > 0)
 	{
-		OBJECT_MATERIAL material;
+		OBJECT_MATERIAL material = {};
 		bool bReturn = false;
 
 		bReturn = FindMaterial(materialTag, material);
 		if (bReturn == true)
 		{
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+			m_drawData.materialDiffuseColor = glm::vec4(material.diffuseColor, material.shininess);
+			m_drawData.materialSpecularColor = glm::vec4(material.specularColor, material.reflectivity);
 		}
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
+/***********************************************************
+ *  AddObjectPart()
+ *
+ *  This method is used for adding a drawn part, with its
+ *  transformation, color, texture and material settings,
+ *  to a compound object.  An empty texture tag draws the
+ *  part with the passed in color.
+ ***********************************************************/
+void SceneManager::AddObjectPart(
+	COMPOUND_OBJECT& compound,
+	int shape,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ,
+	glm::vec4 color,
+	std::string textureTag,
+	glm::vec2 uvScale,
+	std::string materialTag)
+{
+	SCENE_OBJECT part;
+	part.shape = shape;
+	part.scaleXYZ = scaleXYZ;
+	part.rotationDegrees = rotationDegrees;
+	part.positionXYZ = positionXYZ;
+	part.color = color;
+	part.textureTag = textureTag;
+	part.uvScale = uvScale;
+	part.materialTag = materialTag;
+	part.model = BuildModelMatrix(scaleXYZ, rotationDegrees.x, rotationDegrees.y, rotationDegrees.z, positionXYZ);
+	part.cullRecord = -1;
+	part.collider = -1;
+	compound.parts.push_back(part);
+}
 
 /***********************************************************
- *  LoadSceneTextures()
+ *  GetPartBounds()
  *
- *  This method loads all the textures for the 3D scene into memory.
+ *  This method is used for computing the world space bounding
+ *  box of a drawn part from the transformed corners of its
+ *  shape bounds.
  ***********************************************************/
-void SceneManager::LoadSceneTextures() {
-	// Load textures and assign tags
-	bool bReturn = CreateGLTexture("textures/bookcover.jpg", "bookcover_texture");
-	if (!bReturn) std::cout << "Failed to load bookcover.jpg!" << std::endl;
+void SceneManager::GetPartBounds(const SCENE_OBJECT& part, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+	const glm::mat4& model = part.model;
 
-	bReturn = CreateGLTexture("textures/bookside.jpg", "bookside_texture");
-	if (!bReturn) std::cout << "Failed to load bookside.jpg!" << std::endl;
+	glm::vec3 shapeMin;
+	glm::vec3 shapeMax;
+	MeshLibrary::GetShapeBounds(part.shape, shapeMin, shapeMax);
 
-	bReturn = CreateGLTexture("textures/counter.jpg", "counter_texture");
-	if (!bReturn) std::cout << "Failed to load counter.jpg!" << std::endl;
+	boundsMin = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+	boundsMax = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	// transform the eight corners of the shape bounds
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 point(
+			(corner & 1) ? shapeMax.x : shapeMin.x,
+			(corner & 2) ? shapeMax.y : shapeMin.y,
+			(corner & 4) ? shapeMax.z : shapeMin.z);
+		glm::vec3 transformed = glm::vec3(model * glm::vec4(point, 1.0f));
+		boundsMin = glm::min(boundsMin, transformed);
+		boundsMax = glm::max(boundsMax, transformed);
+	}
+}
 
-	bReturn = CreateGLTexture("textures/pages.jpg", "pages_texture");
-	if (!bReturn) std::cout << "Failed to load pages.jpg!" << std::endl;
+/***********************************************************
+ *  ComputeCompoundBounds()
+ *
+ *  This method is used for computing the bounding sphere of
+ *  a compound object from the transformed bounds of all of
+ *  its parts.
+ ***********************************************************/
+void SceneManager::ComputeCompoundBounds(COMPOUND_OBJECT& compound)
+{
+	UpdateCompoundBounds(compound);
+	compound.impostorLayer = -1;
+	compound.reflectionProbe = -1;
+}
 
-	bReturn = CreateGLTexture("textures/wall.jpg", "wall_texture");
-	if (!bReturn) std::cout << "Failed to load wall.jpg!" << std::endl;
+/***********************************************************
+ *  UpdateCompoundBounds()
+ *
+ *  This method is used for fitting the bounds of a compound
+ *  object around its parts where they are now.  The impostor
+ *  and probe of the object are kept.
+ ***********************************************************/
+void SceneManager::UpdateCompoundBounds(COMPOUND_OBJECT& compound)
+{
+	glm::vec3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 
-	bReturn = CreateGLTexture("textures/can.jpg", "can_texture");
-	if (!bReturn) std::cout << "Failed to load can.jpg!" << std::endl;
+	for (size_t i = 0; i < compound.parts.size(); i++)
+	{
+		glm::vec3 partMin;
+		glm::vec3 partMax;
+		GetPartBounds(compound.parts[i], partMin, partMax);
+		boundsMin = glm::min(boundsMin, partMin);
+		boundsMax = glm::max(boundsMax, partMax);
+	}
 
-	bReturn = CreateGLTexture("textures/canlid.jpg", "canlid_texture");
-	if (!bReturn) std::cout << "Failed to load canlid.jpg!" << std::endl;
+	compound.boundsCenter = (boundsMin + boundsMax) * 0.5f;
+	compound.boundsRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+	compound.boundsExtents = boundsMax - boundsMin;
+}
 
-	bReturn = CreateGLTexture("textures/apple.jpg", "apple_texture");
-	if (!bReturn) std::cout << "Failed to load apple.jpg!" << std::endl;
+/***********************************************************
+ *  SetSceneObjectValues()
+ *
+ *  This method is used for setting the shader values for a
+ *  part of a scene object.  Values the part does not set are
+ *  kept from the part drawn before it.
+ ***********************************************************/
+void SceneManager::SetSceneObjectValues(const SCENE_OBJECT& object)
+{
+	m_drawData.model = object.model;
 
-	bReturn = CreateGLTexture("textures/carbonated.jpg", "carbonated_texture");
-	if (!bReturn) std::cout << "Failed to load carnated.jpg!" << std::endl;
+	SetShaderColor(object.color.r, object.color.g, object.color.b, object.color.a);
+	// textures that are still loading leave the part drawn in its color
+	if ((object.textureTag.size() > 0) && (FindTextureSlot(object.textureTag) >= 0))
+	{
+		SetShaderTexture(object.textureTag);
+		SetTextureUVScale(object.uvScale.x, object.uvScale.y);
+	}
+	if (object.materialTag.size() > 0)
+	{
+		SetShaderMaterial(object.materialTag);
+	}
+}
 
-	bReturn = CreateGLTexture("textures/foam.jpg", "foam_texture");
-	if (!bReturn) std::cout << "Failed to load foam.jpg!" << std::endl;
+/***********************************************************
+ *  DrawSceneObject()
+ *
+ *  This method is used for setting the shader values for a
+ *  part of a scene object and drawing its shape.
+ ***********************************************************/
+void SceneManager::DrawSceneObject(const SCENE_OBJECT& object)
+{
+	SetSceneObjectValues(object);
+	DrawBasicMesh(object.shape);
+}
 
+/***********************************************************
+ *  DrawBasicMesh()
+ *
+ *  This method is used for drawing one of the basic shapes
+ *  that are referenced by scene data.
+ ***********************************************************/
+void SceneManager::DrawBasicMesh(int shape)
+{
+	// round shapes can be generated without any vertex data
+	if ((NULL != m_pProceduralShapes) && (ProceduralShapes::IsProcedural(shape)))
+	{
+		CommitDrawData();
+		DrawShape(shape, GetShapeTessellation(shape));
+		return;
+	}
 
-	// Bind the textures
-	BindGLTextures();
+	if ((shape >= 0) && (shape < SHAPE_COUNT))
+	{
+		CommitDrawData();
+		DrawShape(shape, glm::ivec2(0, 0));
+	}
 }
 
 /***********************************************************
- *  DefineObjectMaterials()
+ *  DrawShape()
  *
- *  This method is used for configuring the various material
- *  settings for all of the objects within the 3D scene.
+ *  This method is used for drawing a basic shape with the
+ *  per-draw values that are already bound.  Shapes that are
+ *  not uploaded yet are skipped.
  ***********************************************************/
-void SceneManager::DefineObjectMaterials()
+void SceneManager::DrawShape(int shape, glm::ivec2 tessellation)
 {
-	OBJECT_MATERIAL canMaterial;
-	canMaterial.diffuseColor = glm::vec3(40.4f, 0.4f, 0.0f);
-	canMaterial.specularColor = glm::vec3(50.7f, 50.7f, 40.6f);
-	canMaterial.shininess = 90.0;
-	canMaterial.tag = "metal";
+	if ((NULL != m_pProceduralShapes) && (ProceduralShapes::IsProcedural(shape)))
+	{
+		m_pProceduralShapes->Draw(m_pShaderManager, shape, tessellation);
+	}
+	else if ((shape >= 0) && (shape < SHAPE_COUNT))
+	{
+		m_pMeshLibrary->DrawMesh(m_shapeMeshIDs[shape]);
+	}
+}
 
-	m_objectMaterials.push_back(canMaterial);
+/***********************************************************
+ *  GetShapeTessellation()
+ *
+ *  This method is used for picking the slices and rows of a
+ *  generated shape from how large it looks.  The size comes
+ *  from the shape bounds and the largest scale of the model
+ *  matrix set for the draw.
+ ***********************************************************/
+glm::ivec2 SceneManager::GetShapeTessellation(int shape)
+{
+	// patches are split on the GPU by their size on screen
+	if (m_bTessellatedShapes)
+	{
+		return(ProceduralShapes::GetPatchTessellation(shape));
+	}
 
-	OBJECT_MATERIAL paperMaterial;
-	paperMaterial.diffuseColor = glm::vec3(0.2f, 0.2f, 0.3f);
-	paperMaterial.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
-	paperMaterial.shininess = 0.1;
-	paperMaterial.tag = "paper";
+	glm::vec3 shapeMin;
+	glm::vec3 shapeMax;
+	MeshLibrary::GetShapeBounds(shape, shapeMin, shapeMax);
 
-	m_objectMaterials.push_back(paperMaterial);
+	const glm::mat4& model = m_drawData.model;
+	float scale = std::max(glm::length(glm::vec3(model[0])),
+		std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	float radius = glm::length(shapeMax - shapeMin) * 0.5f * scale;
+	glm::vec3 center = glm::vec3(model * glm::vec4((shapeMin + shapeMax) * 0.5f, 1.0f));
+	float distance = std::max(glm::length(m_detailViewPosition - center), radius);
 
-	OBJECT_MATERIAL glassMaterial;
-	glassMaterial.diffuseColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	glassMaterial.specularColor = glm::vec3(21.0f, 16.0f, 11.0f);
-	glassMaterial.shininess = 95.0;
-	glassMaterial.tag = "glass";
+	return(ProceduralShapes::GetTessellation(shape, radius / distance));
+}
 
-	m_objectMaterials.push_back(glassMaterial);
+/***********************************************************
+ *  SetTessellationViewport()
+ *
+ *  This method is used for passing the size of the current
+ *  viewport to the tessellation control shader.
+ ***********************************************************/
+void SceneManager::SetTessellationViewport()
+{
+	if (m_bTessellatedShapes == false)
+	{
+		return;
+	}
 
-	OBJECT_MATERIAL CounterMaterial;
-	CounterMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
-	CounterMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	CounterMaterial.shininess = 30.0;
-	CounterMaterial.tag = "plate";
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	m_pShaderManager->setVec2Value("viewportSize", (float)viewport[2], (float)viewport[3]);
+}
 
-	m_objectMaterials.push_back(CounterMaterial);
+/***********************************************************
+ *  CommitDrawData()
+ *
+ *  This method is used for writing the per-draw values into
+ *  the dynamic ring buffer and binding them to the uniform
+ *  block of the scene shader for the next draw command.
+ *  The transform matrices of the draw are worked out here,
+ *  once, rather than for every vertex in the shader.
+ *  When the scene shader reads its values from the storage
+ *  block, the range is bound there and the draw reads it at
+ *  draw index 0.
+ ***********************************************************/
+void SceneManager::CommitDrawData()
+{
+	if ((NULL == m_pShaderManager) || (NULL == m_pDrawDataRing))
+	{
+		return;
+	}
 
-	OBJECT_MATERIAL backdropMaterial;
-	backdropMaterial.diffuseColor = glm::vec3(0.8f, 0.8f, 0.9f);
-	backdropMaterial.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
-	backdropMaterial.shininess = 2.0;
-	backdropMaterial.tag = "backdrop";
+	SetDrawDataBlockBinding();
+	BindDrawData(WriteDrawData());
+}
 
-	m_objectMaterials.push_back(backdropMaterial);
+/***********************************************************
+ *  WriteDrawData()
+ *
+ *  This method is used for working out the transform
+ *  matrices of the per-draw values and writing them into
+ *  the dynamic ring buffer, without binding them.
+ ***********************************************************/
+GLintptr SceneManager::WriteDrawData()
+{
+	TransformSystem::MultiplyMatrices(m_viewProjection, m_drawData.model, m_drawData.modelViewProjection);
+	TransformSystem::ComputeNormalMatrix(m_drawData.model, m_drawData.normalMatrix);
 
-	OBJECT_MATERIAL FruitMaterial;
-	FruitMaterial.diffuseColor = glm::vec3(0.4f, 0.2f, 0.4f);
-	FruitMaterial.specularColor = glm::vec3(0.1f, 0.05f, 0.1f);
-	FruitMaterial.shininess = 0.55;
-	FruitMaterial.tag = "apple";
+	return(m_pDrawDataRing->Write(&m_drawData, sizeof(m_drawData)));
+}
 
-	m_objectMaterials.push_back(FruitMaterial);
+/***********************************************************
+ *  BindDrawData()
+ *
+ *  This method is used for binding per-draw values written
+ *  earlier to the block of the scene shader.
+ ***********************************************************/
+void SceneManager::BindDrawData(GLintptr offset)
+{
+	if (offset >= 0)
+	{
+		glBindBufferRange(m_bStorageDrawData ? GL_SHADER_STORAGE_BUFFER : GL_UNIFORM_BUFFER,
+			m_bStorageDrawData ? g_DrawDataArrayBinding : g_DrawDataBinding,
+			m_pDrawDataRing->GetBuffer(), offset, sizeof(m_drawData));
+	}
 }
 
 /***********************************************************
- *  SetupSceneLights()
+ *  SetDrawDataBlockBinding()
  *
- *  This method is called to add and configure the light
- *  sources for the 3D scene.  There are up to 4 light sources.
+ *  This method is used for setting the binding of the block
+ *  holding the per-draw values.  The binding is set once for
+ *  every program that is used.
  ***********************************************************/
-void SceneManager::SetupSceneLights()
+void SceneManager::SetDrawDataBlockBinding()
 {
-	// This enables custom lighting
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	GLuint programID = m_pShaderManager->m_programID;
+	if ((programID == 0) || (programID == m_drawDataProgram))
+	{
+		return;
+	}
 
-	// Simulated dynamic morning sunlight
-	float lightIntensity = 0.8f; // to make quicker day time changes we can adjust this.. 
-	                             //Start with a moderate value to simulate early morning
+	if (m_bStorageDrawData)
+	{
+		GLuint blockIndex = glGetProgramResourceIndex(programID, GL_SHADER_STORAGE_BLOCK, g_DrawDataArrayName);
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glShaderStorageBlockBinding(programID, blockIndex, g_DrawDataArrayBinding);
+		}
+	}
+	else
+	{
+		GLuint blockIndex = glGetUniformBlockIndex(programID, g_DrawDataBlockName);
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(programID, blockIndex, g_DrawDataBinding);
+		}
+	}
+	m_drawDataProgram = programID;
+}
 
-	// Directional light (sunlight)
-	m_pShaderManager->setVec3Value("directionalLight.direction", -1.0f, -1.0f, -0.3f); // Low angle for morning light
-	m_pShaderManager->setVec3Value("directionalLight.ambient", 0.4f * lightIntensity, 0.4f * lightIntensity, 0.35f * lightIntensity);
-	m_pShaderManager->setVec3Value("directionalLight.diffuse", 1.0f * lightIntensity, 0.85f * lightIntensity, 0.65f * lightIntensity); // Warm morning light
-	m_pShaderManager->setVec3Value("directionalLight.specular", 0.9f * lightIntensity, 0.8f * lightIntensity, 0.6f * lightIntensity);
-	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
+/***********************************************************
+ *  UpdateGpuCullObjects()
+ *
+ *  This method is used for uploading every part of the
+ *  compound objects as a culling record.  The per-draw
+ *  values are set up in the same order the parts are drawn
+ *  on the CPU, so parts that keep values from the part
+ *  before them look the same either way.  The records are
+ *  built again when a texture finishes loading, when the
+ *  impostors become ready and when meshes are compacted.
+ ***********************************************************/
+void SceneManager::UpdateGpuCullObjects()
+{
+	std::vector<GpuCulling::CULL_OBJECT> objects;
+	std::vector<GpuCulling::CULL_GROUP> groups;
+	DRAW_DATA savedDrawData = m_drawData;
+	m_gpuCullDrawData.clear();
 
-	// Point light (soft bounce light inside the room)
-	m_pShaderManager->setVec3Value("pointLights[0].position", -4.0f, 5.0f, 2.0f); // Higher up as ceiling bounce
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.15f, 0.15f, 0.15f);  // Soft bounce
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.25f, 0.25f, 0.3f);   // Soft blue-ish light
-	m_pShaderManager->setVec3Value("pointLights[0].specular", 0.1f, 0.1f, 0.1f);    // Dim specular
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+	for (size_t i = 0; i < m_compoundObjects.size(); i++)
+	{
+		COMPOUND_OBJECT& compound = m_compoundObjects[i];
 
-	// Point light 1 (another indoor light, warm tone from a light source near the window)
-	m_pShaderManager->setVec3Value("pointLights[1].position", 2.0f, 6.0f, -3.0f);
-	m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.2f, 0.18f, 0.15f);
-	m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.45f, 0.4f, 0.35f);
-	m_pShaderManager->setVec3Value("pointLights[1].specular", 0.5f, 0.4f, 0.3f);
-	m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
+		GpuCulling::CULL_GROUP group;
+		group.sphere = glm::vec4(compound.boundsCenter, compound.boundsRadius);
+		group.impostorLayer = m_bImpostorsReady ? compound.impostorLayer : -1;
+		group.firstObject = (uint32_t)objects.size();
+		group.padding[0] = 0;
+		group.padding[1] = 0;
+
+		for (size_t p = 0; p < compound.parts.size(); p++)
+		{
+			SCENE_OBJECT& part = compound.parts[p];
+			part.cullRecord = -1;
+			SetSceneObjectValues(part);
+
+			GpuCulling::CULL_OBJECT object;
+			GLsizei nIndices = 0;
+			if ((part.shape < 0) || (part.shape >= SHAPE_COUNT) ||
+				(m_pMeshLibrary->GetDrawRange(m_shapeMeshIDs[part.shape], nIndices, object.firstIndex, object.baseVertex) == false))
+			{
+				continue;
+			}
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+			GetPartBounds(part, boundsMin, boundsMax);
+			object.sphere = glm::vec4((boundsMin + boundsMax) * 0.5f, glm::length(boundsMax - boundsMin) * 0.5f);
+			object.nIndices = (uint32_t)nIndices;
+			object.group = (uint32_t)groups.size();
+			part.cullRecord = (int)objects.size();
+			objects.push_back(object);
+			TransformSystem::ComputeNormalMatrix(m_drawData.model, m_drawData.normalMatrix);
+			m_gpuCullDrawData.push_back(m_drawData);
+		}
 
-	// Light gradually gets brighter throughout the scene; adjust lightIntensity manually in your render loop to simulate changes
+		groups.push_back(group);
+	}
+	m_drawData = savedDrawData;
+
+	m_pGpuCulling->SetObjects(objects, groups, m_gpuCullDrawData.data(), sizeof(DRAW_DATA));
+	m_pMeshLibrary->SetDrawIndexCount((uint32_t)objects.size());
+	m_gpuCullTextureCount = m_loadedTextures;
+	m_bGpuCullImpostors = m_bImpostorsReady;
+	m_gpuCullMeshLayout = m_pMeshLibrary->GetLayoutVersion();
 }
 
+/***********************************************************
+ *  RenderOcclusionProxies()
+ *
+ *  This method is used for drawing the bounding box of every
+ *  compound object drawn this frame inside its occlusion
+ *  query.  The boxes are drawn after all of the solid
+ *  geometry, so they are tested against the finished depth
+ *  buffer, and they write neither color nor depth.  A box
+ *  the camera is inside of would be cut by the near plane,
+ *  so that object gets no query and is drawn next frame.
+ *  The boxes are grown a little past the bounds, since the
+ *  faces of a box-shaped object lie on its bounds and would
+ *  fail the depth test against themselves.
+ ***********************************************************/
+void SceneManager::RenderOcclusionProxies(const glm::vec3& cameraPosition)
+{
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
 
+	for (size_t i = 0; i < m_drawnCompounds.size(); i++)
+	{
+		const COMPOUND_OBJECT& compound = m_compoundObjects[m_drawnCompounds[i]];
+		glm::vec3 proxyExtents = glm::max(compound.boundsExtents, glm::vec3(g_OcclusionProxyThickness))
+			+ glm::vec3(g_OcclusionProxyMargin * 2.0f);
+		glm::vec3 distance = glm::abs(cameraPosition - compound.boundsCenter);
+		glm::vec3 halfExtents = (proxyExtents * 0.5f) + glm::vec3(g_OcclusionNearMargin);
+		if ((distance.x <= halfExtents.x) && (distance.y <= halfExtents.y) && (distance.z <= halfExtents.z))
+		{
+			continue;
+		}
 
+		SetTransformations(proxyExtents, 0.0f, 0.0f, 0.0f, compound.boundsCenter);
+		m_pOcclusionQueries->BeginQuery(m_drawnCompounds[i]);
+		DrawBasicMesh(SHAPE_BOX);
+		m_pOcclusionQueries->EndQuery();
+	}
 
-	
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
 
 /***********************************************************
- *  PrepareScene()
+ *  RenderCulledObjects()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  This method is used for culling the compound object
+ *  parts against the camera in the compute shader, and
+ *  drawing the parts that pass with one indirect call.  The
+ *  impostor billboards the culling adds are drawn later
+ *  with the other blended geometry.  The model-view-
+ *  projection matrices of all the parts are worked out in
+ *  one pass and streamed through the ring buffer, and when
+ *  the ring is full they are uploaded in place instead.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::RenderCulledObjects()
 {
-	// load the texture image files for the textures applied
-	// to objects in the 3D scene
-	//LoadSceneTextures(); <--Left this here because i loaded this twice and it took me 4 hours to find out why i couldnt add more tha 8 textures :')
-	// define the materials that will be used for the objects
-	// in the 3D scene
-	DefineObjectMaterials();
-	// add and defile the light sources for the 3D scene
-	SetupSceneLights();
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+	if ((m_gpuCullTextureCount != m_loadedTextures) || (m_bGpuCullImpostors != m_bImpostorsReady) ||
+		(m_gpuCullMeshLayout != m_pMeshLibrary->GetLayoutVersion()))
+	{
+		UpdateGpuCullObjects();
+	}
 
-	m_basicMeshes->LoadPlaneMesh();
+	m_pGpuCulling->Cull(
+		m_viewProjection,
+		m_pViewManager->GetCamera()->Position,
+		m_impostorDistanceFactor,
+		(m_bImpostorsReady) && (m_bUseImpostors));
 
-	//Load new shapes for complex image cup and book base
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadConeMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadTaperedCylinderMesh();
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadTorusMesh();
+	TransformSystem::TransformDraws(m_viewProjection, m_gpuCullDrawData.data(), m_gpuCullDrawData.size(),
+		sizeof(DRAW_DATA), offsetof(DRAW_DATA, model), offsetof(DRAW_DATA, modelViewProjection));
+	GLintptr offset = m_pDrawDataRing->Write(m_gpuCullDrawData.data(), m_gpuCullDrawData.size() * sizeof(DRAW_DATA));
+	if (offset < 0)
+	{
+		m_pGpuCulling->UpdateDrawData(m_gpuCullDrawData.data());
+	}
 
-	// Load all the textures into memory
-	LoadSceneTextures();
+	m_pShaderManager->use();
+	SetDrawDataBlockBinding();
+	if (offset >= 0)
+	{
+		m_pGpuCulling->DrawObjects(m_pMeshLibrary, g_DrawDataArrayBinding, m_pDrawDataRing->GetBuffer(), offset);
+	}
+	else
+	{
+		m_pGpuCulling->DrawObjects(m_pMeshLibrary, g_DrawDataArrayBinding);
+	}
 }
 
 /***********************************************************
- *  RenderScene()
+ *  RenderWorldCells()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for rendering the objects of every
+ *  streamed world cell that is resident in memory.  The cell
+ *  textures are not part of the scene texture slots, so they
+ *  are bound to a reserved texture unit as they are used.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::RenderWorldCells()
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	// -----------------------------------------------------
-	// Draw the plane
-	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(50.0f, 1.0f, 20.0f);
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(0.0f, -0.6f, 0.0f);
-
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	//SetShaderColor(0.5, 0, 0, 1);
-	SetShaderTexture("counter_texture");//This texture was from actual photo samples and made seemless by myself using bluring at edges :)
-	SetTextureUVScale(2.0, 2.0); //Tiled texture to help quality look better
-	SetShaderTexture("plate");
-	m_basicMeshes->DrawPlaneMesh();
+	if ((NULL == m_pWorldStreamer) || (NULL == m_pShaderManager))
+	{
+		return;
+	}
 
-	// -----------------------------------------------------
-	// Draw Cylinder Sparkling Bev can (Main shape)
-	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(1.5f, 8.0f, 1.5f);  // Taller cylinder for cup base
-	positionXYZ = glm::vec3(-3.0f, 2.0f, 0.0f);  // Adjust the position
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0);
-	SetShaderTexture("can_texture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderTexture("glass");
-	m_basicMeshes->DrawCylinderMesh();
+	const std::vector<WorldStreamer::WORLD_CELL*>& cells = m_pWorldStreamer->GetResidentCells();
+	for (size_t c = 0; c < cells.size(); c++)
+	{
+		const WorldStreamer::WORLD_CELL* pCell = cells[c];
+		for (size_t i = 0; i < pCell->objects.size(); i++)
+		{
+			const WorldStreamer::WORLD_OBJECT& object = pCell->objects[i];
+
+			SetTransformations(
+				object.scaleXYZ,
+				object.rotationDegrees.x,
+				object.rotationDegrees.y,
+				object.rotationDegrees.z,
+				object.positionXYZ);
+
+			GLuint textureID = 0;
+			if (object.textureIndex >= 0)
+			{
+				textureID = pCell->textures[object.textureIndex].textureID;
+			}
+			if (textureID != 0)
+			{
+				glActiveTexture(GL_TEXTURE0 + g_WorldTextureUnit);
+				glBindTexture(GL_TEXTURE_2D, textureID);
+				m_pShaderManager->setSampler2DValue(g_TextureValueName, g_WorldTextureUnit);
+				// world cell textures are not in the bindless table
+				m_drawData.bUseTexture = 1;
+				m_drawData.objectTextureIndex = -1;
+				SetTextureUVScale(object.uvScale.x, object.uvScale.y);
+			}
+			else
+			{
+				SetShaderColor(object.color.r, object.color.g, object.color.b, object.color.a);
+			}
+
+			if (object.materialIndex >= 0)
+			{
+				const WorldStreamer::WORLD_MATERIAL& material = pCell->materials[object.materialIndex];
+				m_drawData.materialDiffuseColor = glm::vec4(material.diffuseColor, material.shininess);
+				m_drawData.materialSpecularColor = glm::vec4(material.specularColor, 0.0f);
+			}
+
+			if (object.shape == SHAPE_CUSTOM)
+			{
+				CommitDrawData();
+				m_pMeshLibrary->DrawMesh(pCell->meshIDs[object.meshIndex]);
+			}
+			else
+			{
+				DrawBasicMesh(object.shape);
+			}
+		}
+	}
+}
 
-	// -----------------------------------------------------
-	// Draw Cylinder Sparkling Bev can (Top lid)
-	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(1.45f, 0.001f, 1.45f);  // shorter cylinder for cup lid
-	positionXYZ = glm::vec3(-3.0f, 10.0f, 0.0f);  // Adjust the position
-	SetTransformations(scaleXYZ, 0.0f, 75.0f, 0.0f, positionXYZ);
-	//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0);
-	SetShaderTexture("canlid_texture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderTexture("glass");
-	m_basicMeshes->DrawCylinderMesh();
+/***********************************************************
+ *  RenderViews()
+ *
+ *  This method is used for drawing the compound objects into
+ *  the design review or stereo views.  The objects are
+ *  culled and sorted once, and their per-draw values are
+ *  written once, whether the views are drawn in one pass or
+ *  one at a time.
+ ***********************************************************/
+void SceneManager::RenderViews()
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glm::ivec4 windowViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 
-	// -----------------------------------------------------
-	// Draw Cylinder 1 (STEM CUP)
-	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(0.25f, 1.0f, 0.25f);  // Taller cylinder for cup stem
-	positionXYZ = glm::vec3(-6.0f, 3.4f, 3.0f);  // Adjust the position
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 0.3);
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawCylinderMesh();
+	if (m_viewLayout == ViewSet::LAYOUT_STEREO)
+	{
+		m_pViewSet->SetStereoViews(m_pViewManager->GetViewMatrix(), m_pViewManager->GetProjectionMatrix(),
+			g_StereoEyeSeparation, g_StereoConvergence, windowViewport);
+	}
+	else
+	{
+		SetReviewViews(windowViewport);
+	}
 
-	// -----------------------------------------------------
-	// Draw Cylinder 2 (BASE FOR CUP BOTTOM)
-	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(1.3f, 1.0f, 1.3f);  // Base cylinder For cup bottom
-	positionXYZ = glm::vec3(-6.0f, 2.0f, 3.0f);  // Adjust the position
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 0.4);
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawCylinderMesh();
+	BuildViewDrawList();
 
-	// -----------------------------------------------------
-	// Draw tapered Cylinder (Top of cup)
-	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(1.4f, 1.5f, 1.4f);  // cylinder tapered to make top smaller than base of cup
-	positionXYZ = glm::vec3(-6.0f, 6.3f, 3.0f);  // Adjust the position
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 0.7);
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawTaperedCylinderMesh();
+	// the benchmark takes turns so both ways see the same scene
+	int mode = 1;
+	if (m_bSinglePassViews)
+	{
+		mode = 0;
+		if ((m_bBenchmarkViews) && ((m_viewFrames[0] + m_viewFrames[1]) % 2 == 1))
+		{
+			mode = 1;
+		}
+	}
 
-	// -----------------------------------------------------
-	// Draw Cylinder (Top middle of cup)
-	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(1.4f, 0.5f, 1.4f);  // cylinder to make top smaller than base of cup
-	positionXYZ = glm::vec3(-6.0f, 5.80f, 3.0f);  // Adjust the position
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 0.7);
-	//SetShaderTexture("foam_texture");
-	//SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawCylinderMesh();
+	int64_t startTime = TraceLog::GetMicroseconds();
+	m_pViewTimers[mode]->Begin();
+	if (mode == 0)
+	{
+		int viewCount = m_pViewSet->GetViewCount();
+		m_pViewSet->BindAllViews(m_pShaderManager);
+		m_pMeshLibrary->SetViewCount(viewCount);
+		if (NULL != m_pProceduralShapes)
+		{
+			m_pProceduralShapes->SetViewCount(viewCount);
+		}
+		DrawViewDrawList();
+		m_pMeshLibrary->SetViewCount(1);
+		if (NULL != m_pProceduralShapes)
+		{
+			m_pProceduralShapes->SetViewCount(1);
+		}
+	}
+	else
+	{
+		for (int v = 0; v < m_pViewSet->GetViewCount(); v++)
+		{
+			m_pViewSet->BindView(m_pShaderManager, v);
+			DrawViewDrawList();
+		}
+	}
+	m_pViewTimers[mode]->End();
+	m_viewMicroseconds[mode] += TraceLog::GetMicroseconds() - startTime;
+	m_viewFrames[mode]++;
 
-	// -----------------------------------------------------
-	// Draw Sphere (cup round)
-	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(1.4f, 1.5f, 1.4f);  // Sphere size
-	positionXYZ = glm::vec3(-6.0f, 5.90f, 3.0f);  // Center position
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 0.7);
-	//SetShaderTexture("carbonated_texture");
-	//SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawSphereMesh();
+	ViewSet::UnbindViews(m_pShaderManager);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
 
-	// -----------------------------------------------------
-	// Draw Cone 1 (Lower base of cup above cylinder for roundness)
-	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(1.3f, 0.5f, 1.3f);  // lower cup cone
-	positionXYZ = glm::vec3(-6.0f, 3.0f, 3.0f);  // Adjust the position
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 0.3);
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawConeMesh();
+/***********************************************************
+ *  SetReviewViews()
+ *
+ *  This method is used for laying out the design review
+ *  views, with the orthographic views framing every
+ *  compound object.
+ ***********************************************************/
+void SceneManager::SetReviewViews(const glm::ivec4& viewport)
+{
+	glm::vec3 boundsMin(FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX);
+	for (size_t i = 0; i < m_compoundObjects.size(); i++)
+	{
+		const COMPOUND_OBJECT& compound = m_compoundObjects[i];
+		boundsMin = glm::min(boundsMin, compound.boundsCenter - glm::vec3(compound.boundsRadius));
+		boundsMax = glm::max(boundsMax, compound.boundsCenter + glm::vec3(compound.boundsRadius));
+	}
+	glm::vec3 boundsCenter(0.0f);
+	float boundsRadius = 1.0f;
+	if (m_compoundObjects.size() > 0)
+	{
+		boundsCenter = (boundsMin + boundsMax) * 0.5f;
+		boundsRadius = std::max(boundsRadius, glm::length(boundsMax - boundsMin) * 0.5f);
+	}
+	m_pViewSet->SetReviewViews(m_pViewManager->GetViewMatrix(), m_pViewManager->GetProjectionMatrix(),
+		boundsCenter, boundsRadius, viewport);
+}
+
+/***********************************************************
+ *  BuildViewDrawList()
+ *
+ *  This method is used for culling the compound objects
+ *  against all of the views at once and writing the values
+ *  of their parts.  The parts are sorted by shape and then
+ *  by texture, so the same mesh is drawn back to back.  Each
+ *  part is given the texture slot it would have had when
+ *  drawn in order, since values a part does not set are kept
+ *  from the part before it.
+ ***********************************************************/
+void SceneManager::BuildViewDrawList()
+{
+	m_viewDraws.clear();
+
+	int textureSlot = -1;
+	for (size_t i = 0; i < m_compoundObjects.size(); i++)
+	{
+		const COMPOUND_OBJECT& compound = m_compoundObjects[i];
+		if (m_pViewSet->IsSphereVisible(compound.boundsCenter, compound.boundsRadius) == false)
+		{
+			m_viewCulledObjects++;
+			continue;
+		}
+		m_viewKeptObjects++;
+
+		for (size_t p = 0; p < compound.parts.size(); p++)
+		{
+			const SCENE_OBJECT& part = compound.parts[p];
+			SetSceneObjectValues(part);
+			if ((part.textureTag.size() > 0) && (FindTextureSlot(part.textureTag) >= 0))
+			{
+				textureSlot = FindTextureSlot(part.textureTag);
+			}
+
+			VIEW_DRAW draw;
+			draw.shape = part.shape;
+			draw.textureSlot = (NULL != m_pBindlessTextures) ? -1 : textureSlot;
+			draw.tessellation = GetShapeTessellation(part.shape);
+			draw.offset = WriteDrawData();
+			m_viewDraws.push_back(draw);
+		}
+	}
+
+	std::stable_sort(m_viewDraws.begin(), m_viewDraws.end(),
+		[](const VIEW_DRAW& left, const VIEW_DRAW& right)
+		{
+			if (left.shape != right.shape)
+			{
+				return(left.shape < right.shape);
+			}
+			return(left.textureSlot < right.textureSlot);
+		});
+}
+
+/***********************************************************
+ *  DrawViewDrawList()
+ *
+ *  This method is used for drawing the sorted parts with the
+ *  views that are bound.  The sampler is only set when the
+ *  texture slot changes.
+ ***********************************************************/
+void SceneManager::DrawViewDrawList()
+{
+	SetDrawDataBlockBinding();
+
+	int textureSlot = -1;
+	for (size_t i = 0; i < m_viewDraws.size(); i++)
+	{
+		const VIEW_DRAW& draw = m_viewDraws[i];
+		BindDrawData(draw.offset);
+		if ((draw.textureSlot >= 0) && (draw.textureSlot != textureSlot))
+		{
+			m_pShaderManager->setSampler2DValue(g_TextureValueName, draw.textureSlot);
+			textureSlot = draw.textureSlot;
+		}
+		DrawShape(draw.shape, draw.tessellation);
+	}
+}
+
+/***********************************************************
+ *  PrepareReflectionProbes()
+ *
+ *  This method is used for placing a reflection probe at
+ *  the center of every compound object that has a part with
+ *  a reflective material.  The object is left out of its
+ *  own probe, so it does not hide the scene around it.
+ ***********************************************************/
+void SceneManager::PrepareReflectionProbes()
+{
+	for (size_t i = 0; i < m_compoundObjects.size(); i++)
+	{
+		COMPOUND_OBJECT& compound = m_compoundObjects[i];
+		bool bReflective = false;
+		for (size_t p = 0; (p < compound.parts.size()) && (bReflective == false); p++)
+		{
+			OBJECT_MATERIAL material = {};
+			bReflective = (FindMaterial(compound.parts[p].materialTag, material)) && (material.reflectivity > 0.0f);
+		}
+		if (bReflective)
+		{
+			compound.reflectionProbe = m_pReflectionProbes->AddProbe(compound.boundsCenter, (int)i);
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateReflectionProbes()
+ *
+ *  This method is used for capturing the probe faces that
+ *  are out of date, up to the faces allowed per frame.  All
+ *  probes are captured again when a texture finishes
+ *  loading, since the scene looks different from then on.
+ *  The faces are drawn like the impostor frames, with the
+ *  probe as the camera, and the camera state is restored
+ *  for the frame afterwards.
+ ***********************************************************/
+void SceneManager::UpdateReflectionProbes(const glm::vec3& cameraPosition)
+{
+	if (m_pReflectionProbes->GetProbeCount() == 0)
+	{
+		return;
+	}
+	if (m_probeTextureCount != m_loadedTextures)
+	{
+		m_probeTextureCount = m_loadedTextures;
+		m_pReflectionProbes->MarkAllDirty();
+	}
+
+	int probe = -1;
+	int face = -1;
+	if (m_pReflectionProbes->GetNextDirtyFace(probe, face) == false)
+	{
+		return;
+	}
+
+	glm::mat4 savedViewProjection = m_viewProjection;
+	glm::vec3 savedDetailPosition = m_detailViewPosition;
+
+	// the probes do not reflect each other, and the cubemap being
+	// captured must not be bound for sampling
+	m_pShaderManager->setBoolValue(g_UseReflectionsName, false);
+	BindReflectionProbe(-1);
+	m_pReflectionProbes->BeginCapture();
+	for (int captured = 0; captured < m_probeFacesPerFrame; captured++)
+	{
+		if ((captured > 0) && (m_pReflectionProbes->GetNextDirtyFace(probe, face) == false))
+		{
+			break;
+		}
+
+		glm::mat4 view;
+		glm::mat4 projection;
+		m_pReflectionProbes->BeginFace(probe, face, view, projection);
+		const ReflectionProbes::PROBE& target = m_pReflectionProbes->GetProbe(probe);
+		m_viewProjection = projection * view;
+		m_pShaderManager->setVec3Value("viewPosition", target.position);
+		m_detailViewPosition = target.position;
+		SetTessellationViewport();
+
+		for (size_t i = 0; i < m_compoundObjects.size(); i++)
+		{
+			if ((int)i == target.ownerObject)
+			{
+				continue;
+			}
+			const COMPOUND_OBJECT& compound = m_compoundObjects[i];
+			for (size_t p = 0; p < compound.parts.size(); p++)
+			{
+				DrawSceneObject(compound.parts[p]);
+			}
+		}
+	}
+	m_pReflectionProbes->EndCapture();
+
+	// the prefilter program may have been used
+	m_pShaderManager->use();
+	m_pShaderManager->setBoolValue(g_UseReflectionsName, m_pReflectionProbes->IsReady());
+	m_pShaderManager->setVec3Value("viewPosition", cameraPosition);
+	m_viewProjection = savedViewProjection;
+	m_detailViewPosition = savedDetailPosition;
+	SetTessellationViewport();
+}
+
+/***********************************************************
+ *  BindReflectionProbe()
+ *
+ *  This method is used for binding the cubemap of a probe to
+ *  its texture unit, or unbinding it when passed -1.  The
+ *  probe is only bound again when it changes.
+ ***********************************************************/
+void SceneManager::BindReflectionProbe(int probe)
+{
+	if (probe == m_boundProbe)
+	{
+		return;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + g_ReflectionProbeUnit);
+	if (probe >= 0)
+	{
+		glBindTexture(GL_TEXTURE_CUBE_MAP, m_pReflectionProbes->GetTexture(probe));
+		m_pShaderManager->setIntValue(g_ReflectionProbeName, g_ReflectionProbeUnit);
+		m_pShaderManager->setFloatValue(g_ReflectionMaxLodName, m_pReflectionProbes->GetMaxLod());
+	}
+	else
+	{
+		glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	}
+	m_boundProbe = probe;
+}
+
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+/***********************************************************
+ *  LoadSceneTextures()
+ *
+ *  This method loads all the textures for the 3D scene into memory.
+ ***********************************************************/
+void SceneManager::LoadSceneTextures() {
+	// Load textures and assign tags
+	for (int i = 0; i < g_SceneTextureCount; i++)
+	{
+		bool bReturn = CreateGLTexture(g_SceneTextures[i][0], g_SceneTextures[i][1]);
+		if (!bReturn) std::cout << "Failed to load " << g_SceneTextures[i][0] << "!" << std::endl;
+	}
+
+	// Bind the textures
+	BindGLTextures();
+}
+
+/***********************************************************
+ *  DefineObjectMaterials()
+ *
+ *  This method is used for configuring the various material
+ *  settings for all of the objects within the 3D scene.
+ ***********************************************************/
+void SceneManager::DefineObjectMaterials()
+{
+	OBJECT_MATERIAL canMaterial;
+	canMaterial.diffuseColor = glm::vec3(40.4f, 0.4f, 0.0f);
+	canMaterial.specularColor = glm::vec3(50.7f, 50.7f, 40.6f);
+	canMaterial.shininess = 90.0;
+	canMaterial.reflectivity = 0.6f;
+	canMaterial.tag = "metal";
+
+	m_objectMaterials.push_back(canMaterial);
+
+	OBJECT_MATERIAL paperMaterial;
+	paperMaterial.diffuseColor = glm::vec3(0.2f, 0.2f, 0.3f);
+	paperMaterial.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
+	paperMaterial.shininess = 0.1;
+	paperMaterial.reflectivity = 0.0f;
+	paperMaterial.tag = "paper";
+
+	m_objectMaterials.push_back(paperMaterial);
+
+	OBJECT_MATERIAL glassMaterial;
+	glassMaterial.diffuseColor = glm::vec3(0.2f, 0.2f, 0.2f);
+	glassMaterial.specularColor = glm::vec3(21.0f, 16.0f, 11.0f);
+	glassMaterial.shininess = 95.0;
+	glassMaterial.reflectivity = 0.35f;
+	glassMaterial.tag = "glass";
+
+	m_objectMaterials.push_back(glassMaterial);
+
+	OBJECT_MATERIAL CounterMaterial;
+	CounterMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	CounterMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
+	CounterMaterial.shininess = 30.0;
+	CounterMaterial.reflectivity = 0.0f;
+	CounterMaterial.tag = "plate";
+
+	m_objectMaterials.push_back(CounterMaterial);
+
+	OBJECT_MATERIAL backdropMaterial;
+	backdropMaterial.diffuseColor = glm::vec3(0.8f, 0.8f, 0.9f);
+	backdropMaterial.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
+	backdropMaterial.shininess = 2.0;
+	backdropMaterial.reflectivity = 0.0f;
+	backdropMaterial.tag = "backdrop";
+
+	m_objectMaterials.push_back(backdropMaterial);
+
+	OBJECT_MATERIAL FruitMaterial;
+	FruitMaterial.diffuseColor = glm::vec3(0.4f, 0.2f, 0.4f);
+	FruitMaterial.specularColor = glm::vec3(0.1f, 0.05f, 0.1f);
+	FruitMaterial.shininess = 0.55;
+	FruitMaterial.reflectivity = 0.0f;
+	FruitMaterial.tag = "apple";
+
+	m_objectMaterials.push_back(FruitMaterial);
+}
+
+/***********************************************************
+ *  SetupSceneLights()
+ *
+ *  This method is called to add and configure the light
+ *  sources for the 3D scene.  There are up to 4 light sources.
+ ***********************************************************/
+void SceneManager::SetupSceneLights()
+{
+	// This enables custom lighting
+	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+
+	// Simulated dynamic morning sunlight
+	float lightIntensity = 0.8f; // to make quicker day time changes we can adjust this.. 
+	                             //Start with a moderate value to simulate early morning
+
+	// Directional light (sunlight)
+	m_pShaderManager->setVec3Value("directionalLight.direction", -1.0f, -1.0f, -0.3f); // Low angle for morning light
+	m_pShaderManager->setVec3Value("directionalLight.ambient", 0.4f * lightIntensity, 0.4f * lightIntensity, 0.35f * lightIntensity);
+	m_pShaderManager->setVec3Value("directionalLight.diffuse", 1.0f * lightIntensity, 0.85f * lightIntensity, 0.65f * lightIntensity); // Warm morning light
+	m_pShaderManager->setVec3Value("directionalLight.specular", 0.9f * lightIntensity, 0.8f * lightIntensity, 0.6f * lightIntensity);
+	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
+
+	// Point light (soft bounce light inside the room)
+	m_pShaderManager->setVec3Value("pointLights[0].position", -4.0f, 5.0f, 2.0f); // Higher up as ceiling bounce
+	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.15f, 0.15f, 0.15f);  // Soft bounce
+	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.25f, 0.25f, 0.3f);   // Soft blue-ish light
+	m_pShaderManager->setVec3Value("pointLights[0].specular", 0.1f, 0.1f, 0.1f);    // Dim specular
+	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+
+	// Point light 1 (another indoor light, warm tone from a light source near the window)
+	m_pShaderManager->setVec3Value("pointLights[1].position", 2.0f, 6.0f, -3.0f);
+	m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.2f, 0.18f, 0.15f);
+	m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.45f, 0.4f, 0.35f);
+	m_pShaderManager->setVec3Value("pointLights[1].specular", 0.5f, 0.4f, 0.3f);
+	m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
+
+	// Light gradually gets brighter throughout the scene when the day
+	// cycle is on - these values are the morning keyframe of the cycle
+	if (NULL != m_pLightAnimator)
+	{
+		DefineLightAnimation();
+	}
+}
+
+/***********************************************************
+ *  DefineLightAnimation()
+ *
+ *  This method is used for adding the keyframes of the day
+ *  cycle.  The sun rises low in the east, is high and white
+ *  at noon and sets warm in the west, and at night only a
+ *  dim blue moonlight is left.  The room light is turned up
+ *  in the evening, and the window light follows the sun.
+ ***********************************************************/
+void SceneManager::DefineLightAnimation()
+{
+	// Directional light (sunlight, and moonlight at night)
+	int sun = m_pLightAnimator->AddLight(LightAnimator::LIGHT_DIRECTIONAL, "directionalLight");
+	m_pLightAnimator->AddKey(sun, 0.0f, glm::vec3(0.3f, -1.0f, 0.2f),
+		glm::vec3(0.05f, 0.05f, 0.08f), glm::vec3(0.08f, 0.08f, 0.15f), glm::vec3(0.05f, 0.05f, 0.08f));
+	m_pLightAnimator->AddKey(sun, 5.5f, glm::vec3(-1.0f, -0.3f, -0.3f),
+		glm::vec3(0.08f, 0.07f, 0.08f), glm::vec3(0.1f, 0.08f, 0.1f), glm::vec3(0.05f, 0.05f, 0.05f));
+	m_pLightAnimator->AddKey(sun, 7.0f, glm::vec3(-1.0f, -1.0f, -0.3f),
+		glm::vec3(0.32f, 0.32f, 0.28f), glm::vec3(0.8f, 0.68f, 0.52f), glm::vec3(0.72f, 0.64f, 0.48f));
+	m_pLightAnimator->AddKey(sun, 12.0f, glm::vec3(-0.2f, -1.0f, -0.1f),
+		glm::vec3(0.45f, 0.45f, 0.42f), glm::vec3(1.0f, 0.97f, 0.9f), glm::vec3(0.9f, 0.9f, 0.85f));
+	m_pLightAnimator->AddKey(sun, 18.0f, glm::vec3(1.0f, -0.5f, -0.3f),
+		glm::vec3(0.25f, 0.2f, 0.2f), glm::vec3(0.8f, 0.45f, 0.3f), glm::vec3(0.5f, 0.3f, 0.2f));
+	m_pLightAnimator->AddKey(sun, 20.0f, glm::vec3(1.0f, -0.3f, 0.2f),
+		glm::vec3(0.05f, 0.05f, 0.08f), glm::vec3(0.08f, 0.08f, 0.15f), glm::vec3(0.05f, 0.05f, 0.08f));
+
+	// Point light (soft bounce light inside the room, turned up at night)
+	int room = m_pLightAnimator->AddLight(LightAnimator::LIGHT_POINT, "pointLights[0]");
+	m_pLightAnimator->AddKey(room, 6.0f, glm::vec3(-4.0f, 5.0f, 2.0f),
+		glm::vec3(0.2f, 0.18f, 0.15f), glm::vec3(0.45f, 0.4f, 0.35f), glm::vec3(0.2f, 0.18f, 0.15f));
+	m_pLightAnimator->AddKey(room, 7.0f, glm::vec3(-4.0f, 5.0f, 2.0f),
+		glm::vec3(0.15f, 0.15f, 0.15f), glm::vec3(0.25f, 0.25f, 0.3f), glm::vec3(0.1f, 0.1f, 0.1f));
+	m_pLightAnimator->AddKey(room, 18.0f, glm::vec3(-4.0f, 5.0f, 2.0f),
+		glm::vec3(0.15f, 0.15f, 0.15f), glm::vec3(0.25f, 0.25f, 0.3f), glm::vec3(0.1f, 0.1f, 0.1f));
+	m_pLightAnimator->AddKey(room, 19.5f, glm::vec3(-4.0f, 5.0f, 2.0f),
+		glm::vec3(0.2f, 0.18f, 0.15f), glm::vec3(0.45f, 0.4f, 0.35f), glm::vec3(0.2f, 0.18f, 0.15f));
+
+	// Point light 1 (light through the window, following the sun)
+	int window = m_pLightAnimator->AddLight(LightAnimator::LIGHT_POINT, "pointLights[1]");
+	m_pLightAnimator->AddKey(window, 5.5f, glm::vec3(2.0f, 6.0f, -3.0f),
+		glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f));
+	m_pLightAnimator->AddKey(window, 7.0f, glm::vec3(2.0f, 6.0f, -3.0f),
+		glm::vec3(0.2f, 0.18f, 0.15f), glm::vec3(0.45f, 0.4f, 0.35f), glm::vec3(0.5f, 0.4f, 0.3f));
+	m_pLightAnimator->AddKey(window, 12.0f, glm::vec3(2.0f, 6.0f, -3.0f),
+		glm::vec3(0.25f, 0.24f, 0.22f), glm::vec3(0.55f, 0.53f, 0.5f), glm::vec3(0.6f, 0.58f, 0.55f));
+	m_pLightAnimator->AddKey(window, 18.0f, glm::vec3(2.0f, 6.0f, -3.0f),
+		glm::vec3(0.2f, 0.15f, 0.12f), glm::vec3(0.45f, 0.3f, 0.2f), glm::vec3(0.4f, 0.25f, 0.15f));
+	m_pLightAnimator->AddKey(window, 20.0f, glm::vec3(2.0f, 6.0f, -3.0f),
+		glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f));
+}
+
+/***********************************************************
+ *  AnimateLights()
+ *
+ *  This method is used for moving the lights on by the time
+ *  since the last frame.  The reflection probes are only
+ *  captured again when the lighting changed past one of the
+ *  thresholds, and then spread over the frames like any
+ *  other probe update.
+ ***********************************************************/
+void SceneManager::AnimateLights()
+{
+	int64_t now = TraceLog::GetMicroseconds();
+	double elapsedSeconds = 0.0;
+	if (m_lightAnimationTime > 0)
+	{
+		elapsedSeconds = (double)(now - m_lightAnimationTime) / 1000000.0;
+	}
+	m_lightAnimationTime = now;
+
+	m_pLightAnimator->Update(elapsedSeconds, m_pShaderManager);
+	if ((m_pLightAnimator->ConsumeInvalidation()) && (NULL != m_pReflectionProbes))
+	{
+		m_pReflectionProbes->MarkAllDirty();
+	}
+}
 
-	// -----------------------------------------------------
-	// Draw Cone 2 (For top of stem and sphere to smoothen)
-	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(1.0f, -1.0f, 1.0f);  // Smaller cone
-	positionXYZ = glm::vec3(-6.0f, 5.0f, 3.0f);  // Adjust the position
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 0.3);
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawConeMesh();
+
+
+
+	
+
+/***********************************************************
+ *  DefineSceneObjects()
+ *
+ *  This method is used for defining all of the objects in
+ *  the 3D scene.  Objects that are built from several shapes,
+ *  like the cup and the book, are kept together as compound
+ *  objects so that they can be handled as a whole.
+ ***********************************************************/
+void SceneManager::DefineSceneObjects()
+{
+	glm::vec4 white(1.0f, 1.0f, 1.0f, 1.0f);
+	glm::vec2 uvScale(1.0f, 1.0f);
+	glm::vec3 noRotation(0.0f, 0.0f, 0.0f);
 
 	// -----------------------------------------------------
-	// Draw Box (book pages)
+	// Counter top plane
 	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(15.0f, 2.0f, 10.0f);  // Box size
-	positionXYZ = glm::vec3(-2.0f, 1.0f, 2.5f);  // Adjust the position
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	//SetShaderColor(0.9f, 0.7f, 0.1f, 1);
-	SetShaderTexture("pages_texture");
-	SetTextureUVScale(1.0, 1.0);
-	m_basicMeshes->DrawBoxMesh();
-	SetShaderMaterial("paper");
+	COMPOUND_OBJECT counter;
+	counter.tag = "counter";
+	counter.bUseImpostor = false;
+	//This texture was from actual photo samples and made seemless by myself using bluring at edges :)
+	//Tiled texture to help quality look better
+	AddObjectPart(counter, SHAPE_PLANE, glm::vec3(50.0f, 1.0f, 20.0f), noRotation, glm::vec3(0.0f, -0.6f, 0.0f),
+		white, "counter_texture", glm::vec2(2.0f, 2.0f), "plate");
+	m_compoundObjects.push_back(counter);
 
 	// -----------------------------------------------------
-	// Draw Box (book cover)
+	// Sparkling Bev can
 	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(10.5f, 0.25f, 15.5f);  // Box size
-	positionXYZ = glm::vec3(-2.0f, 2.0f, 2.5f);  // Adjust the position
-	SetTransformations(scaleXYZ, 0.0f, 90.0f, ZrotationDegrees, positionXYZ);
-	//SetShaderColor(0.9f, 0.7f, 0.1f, 1);
-	SetShaderTexture("bookcover_texture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("paper");
-	m_basicMeshes->DrawBoxMesh();
+	COMPOUND_OBJECT can;
+	can.tag = "can";
+	can.bUseImpostor = true;
+	// main shape - taller cylinder for the can body
+	AddObjectPart(can, SHAPE_CYLINDER, glm::vec3(1.5f, 8.0f, 1.5f), noRotation, glm::vec3(-3.0f, 2.0f, 0.0f),
+		white, "can_texture", uvScale, "metal");
+	// top lid - flat cylinder
+	AddObjectPart(can, SHAPE_CYLINDER, glm::vec3(1.45f, 0.001f, 1.45f), glm::vec3(0.0f, 75.0f, 0.0f), glm::vec3(-3.0f, 10.0f, 0.0f),
+		white, "canlid_texture", uvScale, "metal");
+	m_compoundObjects.push_back(can);
 
 	// -----------------------------------------------------
-	// Draw Box (book cover bottom)
+	// Glass cup
 	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(10.5f, 0.25f, 15.5f);  // Box size
-	positionXYZ = glm::vec3(-2.0f, -0.25f, 2.5f);  // Adjust the position
-	SetTransformations(scaleXYZ, 0.0f, 90.0f, ZrotationDegrees, positionXYZ);
-	//SetShaderColor(0.9f, 0.7f, 0.1f, 1);
-	SetShaderTexture("bookcover_texture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("paper");
-	m_basicMeshes->DrawBoxMesh();
+	COMPOUND_OBJECT cup;
+	cup.tag = "cup";
+	cup.bUseImpostor = true;
+	// stem of the cup
+	AddObjectPart(cup, SHAPE_CYLINDER, glm::vec3(0.25f, 1.0f, 0.25f), noRotation, glm::vec3(-6.0f, 3.4f, 3.0f),
+		glm::vec4(1.0f, 1.0f, 1.0f, 0.3f), "", uvScale, "glass");
+	// base for the cup bottom
+	AddObjectPart(cup, SHAPE_CYLINDER, glm::vec3(1.3f, 1.0f, 1.3f), noRotation, glm::vec3(-6.0f, 2.0f, 3.0f),
+		glm::vec4(1.0f, 1.0f, 1.0f, 0.4f), "", uvScale, "glass");
+	// tapered cylinder to make the top smaller than the base of the cup
+	AddObjectPart(cup, SHAPE_TAPERED_CYLINDER, glm::vec3(1.4f, 1.5f, 1.4f), noRotation, glm::vec3(-6.0f, 6.3f, 3.0f),
+		glm::vec4(1.0f, 1.0f, 1.0f, 0.7f), "", uvScale, "glass");
+	// top middle of the cup
+	AddObjectPart(cup, SHAPE_CYLINDER, glm::vec3(1.4f, 0.5f, 1.4f), noRotation, glm::vec3(-6.0f, 5.80f, 3.0f),
+		glm::vec4(1.0f, 1.0f, 1.0f, 0.7f), "", uvScale, "glass");
+	// sphere for the round part of the cup
+	AddObjectPart(cup, SHAPE_SPHERE, glm::vec3(1.4f, 1.5f, 1.4f), noRotation, glm::vec3(-6.0f, 5.90f, 3.0f),
+		glm::vec4(1.0f, 1.0f, 1.0f, 0.7f), "", uvScale, "glass");
+	// lower cone above the base cylinder for roundness
+	AddObjectPart(cup, SHAPE_CONE, glm::vec3(1.3f, 0.5f, 1.3f), noRotation, glm::vec3(-6.0f, 3.0f, 3.0f),
+		glm::vec4(1.0f, 1.0f, 1.0f, 0.3f), "", uvScale, "glass");
+	// upside down cone to smoothen the top of the stem into the sphere
+	AddObjectPart(cup, SHAPE_CONE, glm::vec3(1.0f, -1.0f, 1.0f), noRotation, glm::vec3(-6.0f, 5.0f, 3.0f),
+		glm::vec4(1.0f, 1.0f, 1.0f, 0.3f), "", uvScale, "glass");
+	m_compoundObjects.push_back(cup);
 
 	// -----------------------------------------------------
-	// Draw Box (book spine)
+	// Book
 	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(15.5f, 0.25f, 2.5f);  // Box size
-	positionXYZ = glm::vec3(-2.0f, 0.90f, 7.75f);  // Adjust the position
-	SetTransformations(scaleXYZ, 90.0f, 0.0f, 0.0f, positionXYZ);
-	//SetShaderColor(0.9f, 0.7f, 0.1f, 1);
-	SetShaderTexture("bookside_texture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("paper");
-	m_basicMeshes->DrawBoxMesh();
+	COMPOUND_OBJECT book;
+	book.tag = "book";
+	book.bUseImpostor = true;
+	// book pages
+	AddObjectPart(book, SHAPE_BOX, glm::vec3(15.0f, 2.0f, 10.0f), noRotation, glm::vec3(-2.0f, 1.0f, 2.5f),
+		white, "pages_texture", uvScale, "paper");
+	// book cover
+	AddObjectPart(book, SHAPE_BOX, glm::vec3(10.5f, 0.25f, 15.5f), glm::vec3(0.0f, 90.0f, 0.0f), glm::vec3(-2.0f, 2.0f, 2.5f),
+		white, "bookcover_texture", uvScale, "paper");
+	// book cover bottom
+	AddObjectPart(book, SHAPE_BOX, glm::vec3(10.5f, 0.25f, 15.5f), glm::vec3(0.0f, 90.0f, 0.0f), glm::vec3(-2.0f, -0.25f, 2.5f),
+		white, "bookcover_texture", uvScale, "paper");
+	// book spine
+	AddObjectPart(book, SHAPE_BOX, glm::vec3(15.5f, 0.25f, 2.5f), glm::vec3(90.0f, 0.0f, 0.0f), glm::vec3(-2.0f, 0.90f, 7.75f),
+		white, "bookside_texture", uvScale, "paper");
+	m_compoundObjects.push_back(book);
 
 	// -----------------------------------------------------
-	// Draw plane (back drywall)
+	// Back drywall plane
 	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(50.0f, 0.25f, 30.0f);  // Box size
-	positionXYZ = glm::vec3(0.0f, 20.0f, -4.0f);  // Adjust the position
-	SetTransformations(scaleXYZ, 90.0f, 0.0f, 0.0f, positionXYZ);
-	//SetShaderColor(0.9f, 0.7f, 0.1f, 1);
-	SetShaderTexture("wall_texture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("backdrop");
-	m_basicMeshes->DrawPlaneMesh();
+	COMPOUND_OBJECT wall;
+	wall.tag = "wall";
+	wall.bUseImpostor = false;
+	AddObjectPart(wall, SHAPE_PLANE, glm::vec3(50.0f, 0.25f, 30.0f), glm::vec3(90.0f, 0.0f, 0.0f), glm::vec3(0.0f, 20.0f, -4.0f),
+		white, "wall_texture", uvScale, "backdrop");
+	m_compoundObjects.push_back(wall);
 
 	// -----------------------------------------------------
-	// Draw Sphere 2 (Apple)
+	// Apple
 	// -----------------------------------------------------
-	scaleXYZ = glm::vec3(3.0f, 1.6f, 3.0f);  // not perfectly round
-	positionXYZ = glm::vec3(1.7f, 3.4f, 3.0f);  // Adjust the position
-	SetTransformations(scaleXYZ, -1.0f, 90.0f, -10.0f, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0);
-	SetShaderTexture("apple_texture");
-	//SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("apple");
-	m_basicMeshes->DrawSphereMesh();
+	COMPOUND_OBJECT apple;
+	apple.tag = "apple";
+	apple.bUseImpostor = true;
+	// not perfectly round
+	AddObjectPart(apple, SHAPE_SPHERE, glm::vec3(3.0f, 1.6f, 3.0f), glm::vec3(-1.0f, 90.0f, -10.0f), glm::vec3(1.7f, 3.4f, 3.0f),
+		white, "apple_texture", uvScale, "apple");
+	m_compoundObjects.push_back(apple);
+
+	for (size_t i = 0; i < m_compoundObjects.size(); i++)
+	{
+		ComputeCompoundBounds(m_compoundObjects[i]);
+	}
+
+	if (NULL != m_pAnimationSystem)
+	{
+		DefineSceneAnimation();
+	}
+	if (m_bPhysics)
+	{
+		DefinePhysicsBodies();
+	}
+	if (NULL != m_pSpatialQuery)
+	{
+		DefineSpatialColliders();
+	}
+}
+
+/***********************************************************
+ *  DefineSceneAnimation()
+ *
+ *  This method is used for adding the animation tracks of
+ *  the scene objects.  The can turns slowly on the counter,
+ *  with the body and lid turned together around their
+ *  shared axis, and the apple rocks from side to side.
+ *  Animated objects are drawn in full detail, since their
+ *  impostors would only show them at rest.
+ ***********************************************************/
+void SceneManager::DefineSceneAnimation()
+{
+	for (size_t i = 0; i < m_compoundObjects.size(); i++)
+	{
+		COMPOUND_OBJECT& compound = m_compoundObjects[i];
+		if (compound.tag == "can")
+		{
+			compound.bUseImpostor = false;
+			for (size_t p = 0; p < compound.parts.size(); p++)
+			{
+				const SCENE_OBJECT& part = compound.parts[p];
+				int track = AddPartTrack((int)i, (int)p);
+				// a whole turn in thirds, so every blend takes the
+				// short way round in the same direction
+				for (int k = 0; k <= 3; k++)
+				{
+					glm::vec3 rotation = part.rotationDegrees + glm::vec3(0.0f, 120.0f * (float)k, 0.0f);
+					m_pAnimationSystem->AddRotationKey(track, 4.0f * (float)k, AnimationSystem::RotationFromDegrees(rotation));
+				}
+			}
+		}
+		else if (compound.tag == "apple")
+		{
+			compound.bUseImpostor = false;
+			const SCENE_OBJECT& part = compound.parts[0];
+			int track = AddPartTrack((int)i, 0);
+			float rockDegrees[4] = { 0.0f, 8.0f, -8.0f, 0.0f };
+			for (int k = 0; k < 4; k++)
+			{
+				glm::vec3 rotation = part.rotationDegrees + glm::vec3(0.0f, 0.0f, rockDegrees[k]);
+				m_pAnimationSystem->AddRotationKey(track, 1.0f * (float)k, AnimationSystem::RotationFromDegrees(rotation));
+			}
+		}
+	}
+}
 
+/***********************************************************
+ *  AddPartTrack()
+ *
+ *  This method is used for adding a track for a part of a
+ *  compound object.  The channels the track has no keys for
+ *  keep the transform the part was defined with.
+ ***********************************************************/
+int SceneManager::AddPartTrack(int compound, int part)
+{
+	const SCENE_OBJECT& object = m_compoundObjects[compound].parts[part];
+	ANIMATED_PART animated;
+	animated.compound = compound;
+	animated.part = part;
+	m_animatedParts.push_back(animated);
+
+	return(m_pAnimationSystem->AddTrack((int)m_animatedParts.size() - 1, object.positionXYZ,
+		AnimationSystem::RotationFromDegrees(object.rotationDegrees), object.scaleXYZ));
+}
+
+/***********************************************************
+ *  AnimateObjects()
+ *
+ *  This method is used for moving the animated parts on by
+ *  the time since the last frame.  Only the parts whose
+ *  track changed get a new model matrix, and only their
+ *  compound objects get new bounds.  When the objects are
+ *  culled on the GPU, the per-draw values of the moved
+ *  parts are updated in place and their bounding spheres
+ *  are uploaded on their own.
+ ***********************************************************/
+void SceneManager::AnimateObjects()
+{
+	int64_t now = TraceLog::GetMicroseconds();
+	double elapsedSeconds = 0.0;
+	if (m_objectAnimationTime > 0)
+	{
+		elapsedSeconds = (double)(now - m_objectAnimationTime) / 1000000.0;
+	}
+	m_objectAnimationTime = now;
+
+	m_pAnimationSystem->Update(elapsedSeconds);
+	const std::vector<int>& changedTracks = m_pAnimationSystem->GetChangedTracks();
+	if (changedTracks.empty())
+	{
+		return;
+	}
+
+	bool bCullRecords = (NULL != m_pGpuCulling) && (m_gpuCullDrawData.size() > 0);
+	m_movedCompounds.clear();
+	for (size_t i = 0; i < changedTracks.size(); i++)
+	{
+		int track = changedTracks[i];
+		const ANIMATED_PART& animated = m_animatedParts[m_pAnimationSystem->GetTarget(track)];
+		MovePart(animated.compound, animated.part, m_pAnimationSystem->GetModelMatrix(track), bCullRecords);
+	}
+	UpdateMovedCompounds(bCullRecords);
+}
+
+/***********************************************************
+ *  MovePart()
+ *
+ *  This method is used for giving a part of a compound
+ *  object a new model matrix.  When the objects are culled
+ *  on the GPU, the per-draw values of the part are updated
+ *  in place and its bounding sphere is uploaded on its own.
+ *  The compound object is listed as moved, so its bounds
+ *  are fitted again once all of its parts moved.
+ ***********************************************************/
+void SceneManager::MovePart(int compound, int part, const glm::mat4& model, bool bCullRecords)
+{
+	SCENE_OBJECT& object = m_compoundObjects[compound].parts[part];
+	object.model = model;
+
+	if ((bCullRecords) && (object.cullRecord >= 0) && ((size_t)object.cullRecord < m_gpuCullDrawData.size()))
+	{
+		DRAW_DATA& drawData = m_gpuCullDrawData[object.cullRecord];
+		drawData.model = object.model;
+		TransformSystem::ComputeNormalMatrix(drawData.model, drawData.normalMatrix);
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		GetPartBounds(object, boundsMin, boundsMax);
+		m_pGpuCulling->UpdateObjectSphere((uint32_t)object.cullRecord,
+			glm::vec4((boundsMin + boundsMax) * 0.5f, glm::length(boundsMax - boundsMin) * 0.5f));
+	}
+	if ((NULL != m_pSpatialQuery) && (object.collider >= 0))
+	{
+		bool bSphere;
+		glm::vec3 center;
+		glm::vec3 halfSize;
+		glm::mat3 rotation;
+		GetSpatialCollider(object, bSphere, center, halfSize, rotation);
+		m_pSpatialQuery->MoveCollider(object.collider, center, rotation);
+	}
+	if (std::find(m_movedCompounds.begin(), m_movedCompounds.end(), compound) == m_movedCompounds.end())
+	{
+		m_movedCompounds.push_back(compound);
+	}
+}
+
+/***********************************************************
+ *  UpdateMovedCompounds()
+ *
+ *  This method is used for fitting the bounds of the
+ *  compound objects whose parts moved this frame, and for
+ *  uploading their group bounding spheres.
+ ***********************************************************/
+void SceneManager::UpdateMovedCompounds(bool bCullRecords)
+{
+	for (size_t i = 0; i < m_movedCompounds.size(); i++)
+	{
+		COMPOUND_OBJECT& compound = m_compoundObjects[m_movedCompounds[i]];
+		UpdateCompoundBounds(compound);
+		if (bCullRecords)
+		{
+			m_pGpuCulling->UpdateGroupSphere((uint32_t)m_movedCompounds[i], glm::vec4(compound.boundsCenter, compound.boundsRadius));
+		}
+	}
+}
+
+/***********************************************************
+ *  DefinePhysicsBodies()
+ *
+ *  This method is used for adding the rigid bodies of the
+ *  scene objects.  The can and the apple each ride on a
+ *  body shaped like their first part, and their other
+ *  parts keep their place relative to it.  Every part of
+ *  the other objects becomes a static body, so the can and
+ *  the apple rest on the book and the counter and stop at
+ *  the wall.  Objects with animation tracks are left out,
+ *  since the tracks already move them.
+ ***********************************************************/
+void SceneManager::DefinePhysicsBodies()
+{
+	m_pPhysicsWorld = new PhysicsWorld(m_pJobSystem);
+	m_physicsObjects.clear();
+	m_physicsTime = 0;
+
+	for (size_t i = 0; i < m_compoundObjects.size(); i++)
+	{
+		COMPOUND_OBJECT& compound = m_compoundObjects[i];
+		bool bAnimated = false;
+		for (size_t a = 0; a < m_animatedParts.size(); a++)
+		{
+			bAnimated = bAnimated || (m_animatedParts[a].compound == (int)i);
+		}
+		if ((bAnimated) || (compound.parts.empty()))
+		{
+			continue;
+		}
+
+		if ((compound.tag != "can") && (compound.tag != "apple"))
+		{
+			for (size_t p = 0; p < compound.parts.size(); p++)
+			{
+				AddPartBody(compound.parts[p], false);
+			}
+			continue;
+		}
+
+		// a moving object would leave its impostor behind
+		compound.bUseImpostor = false;
+		PHYSICS_OBJECT object;
+		object.compound = (int)i;
+		object.body = AddPartBody(compound.parts[0], true);
+		object.bAwake = true;
+		glm::mat4 toBody = glm::inverse(m_pPhysicsWorld->GetTransform(object.body));
+		for (size_t p = 0; p < compound.parts.size(); p++)
+		{
+			object.partOffsets.push_back(toBody * compound.parts[p].model);
+		}
+		m_physicsObjects.push_back(object);
+	}
+}
+
+/***********************************************************
+ *  GetPartCollider()
+ *
+ *  This method is used for fitting a collider around a part
+ *  from its model matrix, so parts that were moved get a
+ *  collider where they are drawn.  The axes of the matrix
+ *  give the turn and their lengths the scale of the mesh
+ *  bounds.  Spheres become spheres as round as their
+ *  thinnest side, so an unevenly scaled sphere like the
+ *  apple rests where it is drawn and pokes out of its mesh
+ *  nowhere.  Cylinders, tapered ones by their base, become
+ *  cylinders, planes become planes through their face, and
+ *  every other shape becomes a box.
+ ***********************************************************/
+void SceneManager::GetPartCollider(const SCENE_OBJECT& part, int& type, glm::vec3& center, glm::vec3& size, glm::mat3& rotation)
+{
+	glm::vec3 halfSize;
+	glm::vec3 shapeMin;
+	glm::vec3 shapeMax;
+	MeshLibrary::GetShapeBounds(part.shape, shapeMin, shapeMax);
+
+	glm::vec3 axes[3];
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec3 column = glm::vec3(part.model[i]);
+		float length = glm::length(column);
+		halfSize[i] = length * (shapeMax[i] - shapeMin[i]) * 0.5f;
+		axes[i] = glm::vec3(0.0f);
+		axes[i][i] = 1.0f;
+		if (length > 0.000001f)
+		{
+			axes[i] = column / length;
+		}
+	}
+	// a negative scale mirrors the axes, and a shape turned the other
+	// way round one axis is the same shape - a plane keeps its normal
+	if (glm::dot(glm::cross(axes[0], axes[1]), axes[2]) < 0.0f)
+	{
+		int flipped = (part.shape == SHAPE_PLANE) ? 0 : 1;
+		axes[flipped] = -axes[flipped];
+	}
+	rotation = glm::mat3(axes[0], axes[1], axes[2]);
+	center = glm::vec3(part.model * glm::vec4((shapeMin + shapeMax) * 0.5f, 1.0f));
+
+	size = halfSize;
+	if (part.shape == SHAPE_SPHERE)
+	{
+		type = PhysicsWorld::COLLIDER_SPHERE;
+		size = glm::vec3(std::min(halfSize.x, std::min(halfSize.y, halfSize.z)));
+	}
+	else if ((part.shape == SHAPE_CYLINDER) || (part.shape == SHAPE_TAPERED_CYLINDER))
+	{
+		type = PhysicsWorld::COLLIDER_CYLINDER;
+		float radius = (halfSize.x + halfSize.z) * 0.5f;
+		size = glm::vec3(radius, halfSize.y, radius);
+	}
+	else if (part.shape == SHAPE_PLANE)
+	{
+		type = PhysicsWorld::COLLIDER_PLANE;
+	}
+	else
+	{
+		type = PhysicsWorld::COLLIDER_BOX;
+	}
+}
+
+/***********************************************************
+ *  GetSpatialCollider()
+ *
+ *  This method is used for fitting a collider for the
+ *  spatial queries around a part.  It takes the physics
+ *  collider, and since the queries only know spheres and
+ *  boxes, a cylinder becomes the box around it and a plane
+ *  is given a thickness below its face.
+ ***********************************************************/
+void SceneManager::GetSpatialCollider(const SCENE_OBJECT& part, bool& bSphere, glm::vec3& center, glm::vec3& halfSize, glm::mat3& rotation)
+{
+	int type;
+	GetPartCollider(part, type, center, halfSize, rotation);
+	bSphere = (type == PhysicsWorld::COLLIDER_SPHERE);
+	if (type == PhysicsWorld::COLLIDER_PLANE)
+	{
+		halfSize.y = g_PlaneColliderThickness * 0.5f;
+		center -= rotation[1] * halfSize.y;
+	}
+}
+
+/***********************************************************
+ *  AddPartBody()
+ *
+ *  This method is used for adding a body that fits around
+ *  a part.  Spheres and cylinders roll, the other shapes
+ *  slide and tip over as boxes, and the mass follows the
+ *  volume of the collider.
+ ***********************************************************/
+int SceneManager::AddPartBody(const SCENE_OBJECT& part, bool bDynamic)
+{
+	int type;
+	glm::vec3 center;
+	glm::vec3 size;
+	glm::mat3 rotation;
+	GetPartCollider(part, type, center, size, rotation);
+
+	float mass = 0.0f;
+	if (bDynamic)
+	{
+		float volume = 8.0f * size.x * size.y * size.z;
+		if (type == PhysicsWorld::COLLIDER_SPHERE)
+		{
+			volume = (4.0f / 3.0f) * glm::pi<float>() * size.x * size.x * size.x;
+		}
+		else if (type == PhysicsWorld::COLLIDER_CYLINDER)
+		{
+			volume = 2.0f * glm::pi<float>() * size.x * size.x * size.y;
+		}
+		mass = g_PhysicsDensity * volume;
+	}
+	return(m_pPhysicsWorld->AddBody(type, size, center, glm::quat_cast(rotation), mass));
+}
+
+/***********************************************************
+ *  DefineSpatialColliders()
+ *
+ *  This method is used for adding a collider for every part
+ *  of the compound objects and sorting them into the grid.
+ *  Parts that move later take their colliders with them.
+ ***********************************************************/
+void SceneManager::DefineSpatialColliders()
+{
+	for (size_t i = 0; i < m_compoundObjects.size(); i++)
+	{
+		COMPOUND_OBJECT& compound = m_compoundObjects[i];
+		for (size_t p = 0; p < compound.parts.size(); p++)
+		{
+			SCENE_OBJECT& part = compound.parts[p];
+			bool bSphere;
+			glm::vec3 center;
+			glm::vec3 halfSize;
+			glm::mat3 rotation;
+			GetSpatialCollider(part, bSphere, center, halfSize, rotation);
+			part.collider = m_pSpatialQuery->AddCollider(
+				bSphere ? SpatialQuery::COLLIDER_SPHERE : SpatialQuery::COLLIDER_BOX, center, halfSize, rotation);
+		}
+	}
+	m_pSpatialQuery->Build();
+}
+
+/***********************************************************
+ *  SimulatePhysics()
+ *
+ *  This method is used for stepping the rigid bodies by the
+ *  time since the last frame and moving the parts of the
+ *  bodies that are awake.  Sleeping bodies cost nothing
+ *  here, and their objects keep the matrices, culling
+ *  records and bounds they already have.
+ ***********************************************************/
+void SceneManager::SimulatePhysics()
+{
+	int64_t now = TraceLog::GetMicroseconds();
+	double elapsedSeconds = 0.0;
+	if (m_physicsTime > 0)
+	{
+		elapsedSeconds = (double)(now - m_physicsTime) / 1000000.0;
+	}
+	m_physicsTime = now;
+
+	if (m_pPhysicsWorld->Update(elapsedSeconds) == 0)
+	{
+		return;
+	}
+
+	bool bCullRecords = (NULL != m_pGpuCulling) && (m_gpuCullDrawData.size() > 0);
+	m_movedCompounds.clear();
+	for (size_t i = 0; i < m_physicsObjects.size(); i++)
+	{
+		PHYSICS_OBJECT& object = m_physicsObjects[i];
+		bool bAwake = m_pPhysicsWorld->IsAwake(object.body);
+		if ((bAwake == false) && (object.bAwake == false))
+		{
+			continue;
+		}
+		object.bAwake = bAwake;
+
+		glm::mat4 transform = m_pPhysicsWorld->GetTransform(object.body);
+		for (size_t p = 0; p < object.partOffsets.size(); p++)
+		{
+			MovePart(object.compound, (int)p, transform * object.partOffsets[p], bCullRecords);
+		}
+	}
+	UpdateMovedCompounds(bCullRecords);
+}
+
+/***********************************************************
+ *  PushPhysicsObjects()
+ *
+ *  This method is used for pushing the rigid bodies along
+ *  a direction, like the way the camera looks.  The push
+ *  is kept level with a little lift, and lands above the
+ *  center of each body, so tall objects tip over.  It is
+ *  scaled by the mass, so every body starts at the same
+ *  speed.
+ ***********************************************************/
+void SceneManager::PushPhysicsObjects(const glm::vec3& direction)
+{
+	glm::vec3 along(direction.x, 0.0f, direction.z);
+	if ((NULL == m_pPhysicsWorld) || (glm::length(along) < 0.001f))
+	{
+		return;
+	}
+	along = glm::normalize(along) + glm::vec3(0.0f, g_PhysicsPushLift, 0.0f);
+
+	for (size_t i = 0; i < m_physicsObjects.size(); i++)
+	{
+		int body = m_physicsObjects[i].body;
+		glm::vec3 center = glm::vec3(m_pPhysicsWorld->GetTransform(body)[3]);
+		m_pPhysicsWorld->ApplyImpulse(body, along * (g_PhysicsPushSpeed * m_pPhysicsWorld->GetMass(body)),
+			center + glm::vec3(0.0f, g_PhysicsPushHeight, 0.0f));
+	}
+}
+
+/***********************************************************
+ *  PrepareImpostors()
+ *
+ *  This method is used for creating the impostor shader and
+ *  billboard buffers, and then loading the impostor atlas
+ *  from a pre-baked file or baking it from the scene.
+ ***********************************************************/
+void SceneManager::PrepareImpostors()
+{
+	// assign an atlas layer to every compound object using an impostor
+	int layerCount = 0;
+	for (size_t i = 0; i < m_compoundObjects.size(); i++)
+	{
+		m_compoundObjects[i].impostorLayer = -1;
+		if (m_compoundObjects[i].bUseImpostor)
+		{
+			m_compoundObjects[i].impostorLayer = layerCount++;
+		}
+	}
+	// the impostor shader is built by its own startup task
+	if ((layerCount == 0) || (NULL == m_pImpostorShader))
+	{
+		return;
+	}
+
+	// every billboard is one instance with its center, radius and layer -
+	// the instances are pointed at in the dynamic ring buffer every frame
+	m_impostorVAO = m_pGpuResources->CreateVertexArray("impostor billboards");
+	glBindVertexArray(m_pGpuResources->GetName(m_impostorVAO));
+	glEnableVertexAttribArray(0);
+	glVertexAttribDivisor(0, 1);
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+	glBindVertexArray(0);
+
+	m_pImpostorAtlas = new ImpostorAtlas(m_pGpuResources);
+	bool bLoaded = false;
+	if (m_impostorFilename.size() > 0)
+	{
+		bLoaded = m_pImpostorAtlas->LoadFromFile(m_impostorFilename.c_str(), layerCount);
+		if (bLoaded == false)
+		{
+			std::cout << "Could not use impostor atlas:" << m_impostorFilename << ", baking instead" << std::endl;
+		}
+	}
+	if (bLoaded == false)
+	{
+		if (m_pImpostorAtlas->Create(layerCount, g_ImpostorFramesPerSide, g_ImpostorFrameSize))
+		{
+			BakeImpostors();
+		}
+		else
+		{
+			// without an atlas every object is drawn with its full geometry
+			m_bUseImpostors = false;
+		}
+	}
+
+	m_bImpostorsReady = m_bUseImpostors;
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  BakeImpostors()
+ *
+ *  This method is used for rendering every compound object
+ *  that uses an impostor into its atlas layer, once for each
+ *  view direction on the octahedron around the object.
+ ***********************************************************/
+void SceneManager::BakeImpostors()
+{
+	int framesPerSide = m_pImpostorAtlas->GetFramesPerSide();
+
+	m_pShaderManager->use();
+	m_pImpostorAtlas->BeginBake();
+	for (size_t i = 0; i < m_compoundObjects.size(); i++)
+	{
+		const COMPOUND_OBJECT& compound = m_compoundObjects[i];
+		if (compound.impostorLayer < 0)
+		{
+			continue;
+		}
+
+		for (int frameY = 0; frameY < framesPerSide; frameY++)
+		{
+			for (int frameX = 0; frameX < framesPerSide; frameX++)
+			{
+				glm::vec3 direction = ImpostorAtlas::GetFrameDirection(frameX, frameY, framesPerSide);
+				m_pImpostorAtlas->BeginFrame(compound.impostorLayer, frameX, frameY);
+
+				glm::mat4 view = ImpostorAtlas::GetFrameViewMatrix(compound.boundsCenter, compound.boundsRadius, direction);
+				glm::mat4 projection = ImpostorAtlas::GetFrameProjectionMatrix(compound.boundsRadius);
+				m_pShaderManager->setMat4Value("view", view);
+				m_pShaderManager->setMat4Value("projection", projection);
+				m_viewProjection = projection * view;
+				m_pShaderManager->setVec3Value("viewPosition",
+					compound.boundsCenter + (direction * (2.0f * compound.boundsRadius)));
+				m_detailViewPosition = compound.boundsCenter + (direction * (2.0f * compound.boundsRadius));
+				SetTessellationViewport();
+
+				for (size_t p = 0; p < compound.parts.size(); p++)
+				{
+					DrawSceneObject(compound.parts[p]);
+				}
+			}
+		}
+	}
+	m_pImpostorAtlas->EndBake();
+
+	std::cout << "Baked impostors for " << m_pImpostorAtlas->GetLayerCount() << " objects, "
+		<< (framesPerSide * framesPerSide) << " views each" << std::endl;
+}
+
+/***********************************************************
+ *  SaveImpostors()
+ *
+ *  This method is used for saving the impostor atlas into a
+ *  file that can be loaded on later runs.
+ ***********************************************************/
+bool SceneManager::SaveImpostors(const char* filename)
+{
+	if (NULL == m_pImpostorAtlas)
+	{
+		std::cout << "There are no impostors to save" << std::endl;
+		return(false);
+	}
+
+	return(m_pImpostorAtlas->SaveToFile(filename));
+}
+
+/***********************************************************
+ *  RenderImpostors()
+ *
+ *  This method is used for drawing all of the impostor
+ *  billboards collected for this frame with a single
+ *  instanced draw call.  With GPU culling the billboards
+ *  and their number come from the culling results.
+ ***********************************************************/
+void SceneManager::RenderImpostors()
+{
+	bool bGpuCulled = (NULL != m_pGpuCulling) && (m_bImpostorsReady) && (m_bUseImpostors) &&
+		(NULL != m_pViewManager) && (NULL != m_pViewManager->GetCamera());
+	if ((NULL == m_pImpostorAtlas) || (NULL == m_pImpostorShader) ||
+		((m_impostorInstances.size() == 0) && (bGpuCulled == false)))
+	{
+		return;
+	}
+
+	GLsizei instanceCount = (GLsizei)(m_impostorInstances.size() / g_ImpostorInstanceFloats);
+	GLintptr offset = 0;
+	if (bGpuCulled == false)
+	{
+		offset = m_pDrawDataRing->Write(m_impostorInstances.data(), m_impostorInstances.size() * sizeof(float));
+		if (offset < 0)
+		{
+			return;
+		}
+	}
+
+	m_pImpostorShader->use();
+	m_pImpostorShader->setMat4Value("view", m_pViewManager->GetViewMatrix());
+	m_pImpostorShader->setMat4Value("projection", m_pViewManager->GetProjectionMatrix());
+	m_pImpostorShader->setVec3Value("viewPosition", m_pViewManager->GetCamera()->Position);
+	m_pImpostorShader->setIntValue("framesPerSide", m_pImpostorAtlas->GetFramesPerSide());
+
+	glActiveTexture(GL_TEXTURE0 + g_ImpostorColorUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_pImpostorAtlas->GetColorTexture());
+	glActiveTexture(GL_TEXTURE0 + g_ImpostorDepthUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_pImpostorAtlas->GetDepthTexture());
+	m_pImpostorShader->setSampler2DValue("impostorColor", g_ImpostorColorUnit);
+	m_pImpostorShader->setSampler2DValue("impostorDepth", g_ImpostorDepthUnit);
+
+	// the atlas holds premultiplied colors
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	if (bGpuCulled)
+	{
+		m_pGpuCulling->DrawImpostors(m_pGpuResources->GetName(m_impostorVAO));
+	}
+	else
+	{
+		glBindVertexArray(m_pGpuResources->GetName(m_impostorVAO));
+		glBindBuffer(GL_ARRAY_BUFFER, m_pDrawDataRing->GetBuffer());
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, g_ImpostorInstanceFloats * sizeof(float), (void*)offset);
+		glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, g_ImpostorInstanceFloats * sizeof(float), (void*)(offset + 4 * sizeof(float)));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instanceCount);
+		glBindVertexArray(0);
+	}
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene
+ *  rendering.  The work is added to the job system as a task
+ *  graph - shapes are cooked and textures are decoded on the
+ *  worker threads, and uploaded on the main thread as they
+ *  finish.  The scene is ready for drawing once the shapes,
+ *  materials, lights and objects are done, and the textures
+ *  and impostors keep loading after the first frame.
+ ***********************************************************/
+void SceneManager::PrepareScene(JobSystem* pJobSystem, int shaderTask)
+{
+	m_pJobSystem = pJobSystem;
+
+	// define the materials that will be used for the objects
+	// in the 3D scene
+	int materialsTask = pJobSystem->AddTask("define materials",
+		[this]() { DefineObjectMaterials(); });
+	// add and defile the light sources for the 3D scene - the
+	// light values are shader uniforms, so the shader must be built
+	int lightsTask = pJobSystem->AddTask("setup lights",
+		[this]() { SetupSceneLights(); },
+		std::vector<int>(1, shaderTask), true);
+	// define the objects that make up the 3D scene
+	int objectsTask = pJobSystem->AddTask("define scene objects",
+		[this]() { DefineSceneObjects(); });
+
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
+	std::vector<int> readyTasks;
+	readyTasks.push_back(materialsTask);
+	readyTasks.push_back(lightsTask);
+	readyTasks.push_back(objectsTask);
+	m_cookedShapes.resize(SHAPE_COUNT);
+	for (int shape = 0; shape < SHAPE_COUNT; shape++)
+	{
+		std::string shapeName = g_ShapeNames[shape];
+		// generated shapes need no vertex data, unless the GPU culling
+		// draws them from the shared mesh buffers
+		if ((NULL != m_pProceduralShapes) && (NULL == m_pGpuCulling) && (ProceduralShapes::IsProcedural(shape)))
+		{
+			continue;
+		}
+		int cookTask = pJobSystem->AddTask(("cook " + shapeName).c_str(),
+			[this, shape]() { CookBasicShape(shape); });
+		int uploadTask = pJobSystem->AddTask(("upload " + shapeName).c_str(),
+			[this, shape]() {
+				m_shapeMeshIDs[shape] = m_pMeshLibrary->CreateMesh(m_cookedShapes[shape]);
+				m_cookedShapes[shape] = MESH_DATA();
+			},
+			std::vector<int>(1, cookTask), true);
+		readyTasks.push_back(uploadTask);
+	}
+	m_sceneReadyTask = pJobSystem->AddTask("scene ready", std::function<void()>(), readyTasks);
+
+	// Load all the textures into memory - textures that are not
+	// uploaded yet are drawn with the object color.  Their sizes are
+	// planned from the surfaces they are mapped on, so the planning
+	// waits for the scene objects
+	std::vector<int> textureTasks;
+	if (m_texturePackFilename.size() > 0)
+	{
+		m_pTexturePack = new TexturePack();
+		if (m_pTexturePack->Open(m_texturePackFilename.c_str()) == false)
+		{
+			// fall back to decoding the texture image files
+			delete m_pTexturePack;
+			m_pTexturePack = NULL;
+		}
+	}
+	int budgetTask = pJobSystem->AddTask("plan texture budget",
+		[this]() { PlanTextureBudget(); },
+		std::vector<int>(1, objectsTask));
+	if (NULL != m_pTexturePack)
+	{
+		AddTexturePackTasks(pJobSystem, budgetTask, textureTasks);
+	}
+	m_decodedTextures.resize(g_SceneTextureCount);
+	for (int i = 0; (i < g_SceneTextureCount) && (NULL == m_pTexturePack); i++)
+	{
+		std::string textureName = g_SceneTextures[i][1];
+		int decodeTask = pJobSystem->AddTask(("decode " + textureName).c_str(),
+			[this, i]() { DecodeTexture(g_SceneTextures[i][0], g_SceneTextures[i][1], 1 << m_textureStartMips[i], m_decodedTextures[i]); },
+			std::vector<int>(1, budgetTask));
+		int uploadTask = pJobSystem->AddTask(("upload " + textureName).c_str(),
+			[this, i]() {
+				if (UploadTexture(m_decodedTextures[i]) == false)
+				{
+					std::cout << "Failed to load " << g_SceneTextures[i][0] << "!" << std::endl;
+				}
+				// Bind the textures
+				BindGLTextures();
+			},
+			std::vector<int>(1, decodeTask), true);
+		textureTasks.push_back(uploadTask);
+	}
+
+	// the impostor shader is compiled while the rest of the scene loads
+	int readImpostorShaderTask = pJobSystem->AddTask("read impostor shaders",
+		[this]() {
+			ProgramBuilder::LoadProgramSources(
+				"shaders/impostorVertexShader.glsl",
+				"shaders/impostorFragmentShader.glsl",
+				"", m_impostorProgram);
+		});
+	int compileImpostorShaderTask = pJobSystem->AddTask("compile impostor shaders",
+		[this]() { ProgramBuilder::CompileProgram(m_impostorProgram, m_pAssetCache); },
+		std::vector<int>(1, readImpostorShaderTask), true);
+	int impostorShaderTask = pJobSystem->AddPollTask("link impostor shaders",
+		[this]() {
+			if (ProgramBuilder::IsProgramReady(m_impostorProgram) == false)
+			{
+				return(false);
+			}
+			ShaderManager* pShader = new ShaderManager();
+			if (ProgramBuilder::FinishProgram(m_impostorProgram, pShader, m_pAssetCache))
+			{
+				m_pImpostorShader = pShader;
+			}
+			else
+			{
+				delete pShader;
+			}
+			return(true);
+		},
+		std::vector<int>(1, compileImpostorShaderTask));
+
+	// the impostors are baked from the finished scene objects
+	std::vector<int> impostorTasks = textureTasks;
+	impostorTasks.push_back(m_sceneReadyTask);
+	impostorTasks.push_back(impostorShaderTask);
+	pJobSystem->AddTask("prepare impostors",
+		[this]() { PrepareImpostors(); },
+		impostorTasks, true);
+
+	// the probes are placed at the finished reflective objects
+	if (NULL != m_pReflectionProbes)
+	{
+		pJobSystem->AddTask("prepare reflection probes",
+			[this]() { PrepareReflectionProbes(); },
+			std::vector<int>(1, m_sceneReadyTask), true);
+	}
+}
+
+/***********************************************************
+ *  PlanTextureBudget()
+ *
+ *  This method is used for picking the starting mip level of
+ *  every texture from the quality tier and the memory budget.
+ *  The size a texture needs comes from the largest part it is
+ *  mapped on, divided by the UV scale of that part.  Texture
+ *  sizes are read from the pack table or the image headers.
+ ***********************************************************/
+void SceneManager::PlanTextureBudget()
+{
+	TextureBudget budget(m_textureQuality, m_textureBudgetBytes);
+	std::vector<std::string> tags;
+
+	if (NULL != m_pTexturePack)
+	{
+		for (int i = 0; i < m_pTexturePack->GetTextureCount(); i++)
+		{
+			tags.push_back(m_pTexturePack->GetTexture(i).tag);
+		}
+	}
+	else
+	{
+		for (int i = 0; i < g_SceneTextureCount; i++)
+		{
+			tags.push_back(g_SceneTextures[i][1]);
+		}
+	}
+
+	for (size_t i = 0; i < tags.size(); i++)
+	{
+		// the largest world size one repeat of the texture covers
+		float worldSize = 0.0f;
+		for (size_t c = 0; c < m_compoundObjects.size(); c++)
+		{
+			for (size_t p = 0; p < m_compoundObjects[c].parts.size(); p++)
+			{
+				const SCENE_OBJECT& part = m_compoundObjects[c].parts[p];
+				if (part.textureTag != tags[i])
+				{
+					continue;
+				}
+				glm::vec3 boundsMin;
+				glm::vec3 boundsMax;
+				MeshLibrary::GetShapeBounds(part.shape, boundsMin, boundsMax);
+				glm::vec3 extent = glm::abs((boundsMax - boundsMin) * part.scaleXYZ);
+				float repeats = glm::min(part.uvScale.x, part.uvScale.y);
+				float partSize = glm::max(extent.x, glm::max(extent.y, extent.z)) / ((repeats > 0.0f) ? repeats : 1.0f);
+				worldSize = glm::max(worldSize, partSize);
+			}
+		}
+
+		int width = 0;
+		int height = 0;
+		int colorChannels = 0;
+		if (NULL != m_pTexturePack)
+		{
+			width = m_pTexturePack->GetTexture((int)i).width;
+			height = m_pTexturePack->GetTexture((int)i).height;
+			colorChannels = m_pTexturePack->GetTexture((int)i).colorChannels;
+		}
+		else if (ImageDecoder::ReadImageInfo(g_SceneTextures[i][0], width, height, colorChannels) == false)
+		{
+			// the decode task reports the missing file
+			continue;
+		}
+		budget.AddTexture(tags[i], width, height, colorChannels, worldSize);
+	}
+
+	budget.Plan();
+	budget.PrintReport();
+
+	m_textureStartMips.assign(tags.size(), 0);
+	for (size_t i = 0; i < tags.size(); i++)
+	{
+		m_textureStartMips[i] = budget.GetStartMip(tags[i]);
+	}
+}
+
+/***********************************************************
+ *  AddTexturePackTasks()
+ *
+ *  This method is used for adding the tasks that load the
+ *  scene textures from the texture pack.  Every texture gets
+ *  its own pixel buffer, which is mapped on the main thread,
+ *  filled by decompressing the pixel chunk on a worker
+ *  thread, and then unmapped and copied into the texture on
+ *  the main thread.  The textures are decompressed in
+ *  parallel, and each is uploaded as soon as it is done.
+ ***********************************************************/
+void SceneManager::AddTexturePackTasks(JobSystem* pJobSystem, int budgetTask, std::vector<int>& textureTasks)
+{
+	int textureCount = m_pTexturePack->GetTextureCount();
+	m_textureUploadBuffers.assign(textureCount, GPU_HANDLE());
+	m_textureUploadMemory.assign(textureCount, NULL);
+	m_textureUnpacked.assign(textureCount, 0);
+
+	for (int i = 0; i < textureCount; i++)
+	{
+		std::string textureName = m_pTexturePack->GetTexture(i).tag;
+		int mapTask = pJobSystem->AddTask(("map " + textureName).c_str(),
+			[this, i]() { MapTextureUploadBuffer(i); },
+			std::vector<int>(1, budgetTask), true);
+		int decompressTask = pJobSystem->AddTask(("decompress " + textureName).c_str(),
+			[this, i]() {
+				if (NULL == m_textureUploadMemory[i])
+				{
+					return;
+				}
+				if (m_textureStartMips[i] == 0)
+				{
+					m_textureUnpacked[i] = m_pTexturePack->DecompressTexture(i, m_textureUploadMemory[i]) ? 1 : 0;
+					return;
+				}
+				// reduced textures are decompressed at full size first
+				const TexturePack::PACKED_TEXTURE& texture = m_pTexturePack->GetTexture(i);
+				DECODED_IMAGE image;
+				image.width = texture.width;
+				image.height = texture.height;
+				image.colorChannels = texture.colorChannels;
+				image.pixels.resize(texture.pixelBytes);
+				if (m_pTexturePack->DecompressTexture(i, image.pixels.data()))
+				{
+					ImageDecoder::DownscaleImage(image, 1 << m_textureStartMips[i]);
+					memcpy(m_textureUploadMemory[i], image.pixels.data(), image.pixels.size());
+					m_textureUnpacked[i] = 1;
+				}
+			},
+			std::vector<int>(1, mapTask));
+		int uploadTask = pJobSystem->AddTask(("upload " + textureName).c_str(),
+			[this, i]() {
+				if (UploadPackedTexture(i) == false)
+				{
+					std::cout << "Failed to load " << m_pTexturePack->GetTexture(i).tag << " from " << m_texturePackFilename << "!" << std::endl;
+				}
+				// Bind the textures
+				BindGLTextures();
+			},
+			std::vector<int>(1, decompressTask), true);
+		textureTasks.push_back(uploadTask);
+	}
+}
+
+/***********************************************************
+ *  GetPackedTextureSize()
+ *
+ *  This method is used for getting the size a packed texture
+ *  is uploaded at once it is reduced to its starting mip.
+ ***********************************************************/
+void SceneManager::GetPackedTextureSize(int index, int& width, int& height) const
+{
+	const TexturePack::PACKED_TEXTURE& texture = m_pTexturePack->GetTexture(index);
+	int scaleDenominator = 1 << m_textureStartMips[index];
+	width = (texture.width + scaleDenominator - 1) / scaleDenominator;
+	height = (texture.height + scaleDenominator - 1) / scaleDenominator;
+}
+
+/***********************************************************
+ *  MapTextureUploadBuffer()
+ *
+ *  This method is used for creating the pixel buffer for a
+ *  packed texture and mapping it, so that a worker thread can
+ *  decompress the pixels straight into driver memory.  The
+ *  buffer is unbound again, since it stays mapped without
+ *  being bound.
+ ***********************************************************/
+void SceneManager::MapTextureUploadBuffer(int index)
+{
+	int width = 0;
+	int height = 0;
+	GetPackedTextureSize(index, width, height);
+	GLsizeiptr size = (GLsizeiptr)width * height * m_pTexturePack->GetTexture(index).colorChannels;
+
+	// pixel buffers are recycled, so they get new storage every time
+	m_textureUploadBuffers[index] = m_pGpuResources->CreateBuffer("texture upload");
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pGpuResources->GetName(m_textureUploadBuffers[index]));
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	m_pGpuResources->SetBytes(m_textureUploadBuffers[index], (size_t)size);
+	m_textureUploadMemory[index] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UploadPackedTexture()
+ *
+ *  This method is used for unmapping the pixel buffer of a
+ *  decompressed texture, creating the OpenGL texture from it
+ *  and registering the texture with its tag.  The pixel
+ *  buffer is freed afterwards.
+ ***********************************************************/
+bool SceneManager::UploadPackedTexture(int index)
+{
+	const TexturePack::PACKED_TEXTURE& texture = m_pTexturePack->GetTexture(index);
+	GLuint textureID = 0;
+	GPU_HANDLE handle = GPU_HANDLE();
+	int width = 0;
+	int height = 0;
+	GetPackedTextureSize(index, width, height);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pGpuResources->GetName(m_textureUploadBuffers[index]));
+	// the buffer contents are lost when unmapping fails
+	bool bUnmapped = (NULL != m_textureUploadMemory[index]) && (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE);
+	m_textureUploadMemory[index] = NULL;
+	// a pack can hold more textures than there are texture slots
+	bool bSlotFree = (m_loadedTextures < (int)(sizeof(m_textureIDs) / sizeof(m_textureIDs[0])));
+	if ((bUnmapped) && (bSlotFree) && (m_textureUnpacked[index] != 0))
+	{
+		// packed rows are tightly packed
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		handle = m_pGpuResources->CreateTexture2D(width, height, texture.colorChannels, (const void*)0, texture.tag.c_str());
+		textureID = m_pGpuResources->GetName(handle);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	// the copy into the texture may still be reading the buffer
+	m_pGpuResources->Release(m_textureUploadBuffers[index]);
+
+	if (textureID == 0)
+	{
+		return(false);
+	}
+
+	std::cout << "Successfully loaded image:" << texture.tag << " from " << m_texturePackFilename << ", width:" << width << ", height:" << height << ", channels:" << texture.colorChannels << std::endl;
+
+	// register the loaded texture and associate it with the special tag string
+	m_textureIDs[m_loadedTextures].ID = textureID;
+	m_textureIDs[m_loadedTextures].handle = handle;
+	m_textureIDs[m_loadedTextures].tag = texture.tag;
+	m_loadedTextures++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetSceneTextureSources()
+ *
+ *  This method is used for getting the image files of the
+ *  scene textures and the tags they are registered with,
+ *  for writing them into a texture pack.
+ ***********************************************************/
+void SceneManager::GetSceneTextureSources(std::vector<TexturePack::TEXTURE_SOURCE>& sources)
+{
+	sources.clear();
+	for (int i = 0; i < g_SceneTextureCount; i++)
+	{
+		TexturePack::TEXTURE_SOURCE source;
+		source.filename = g_SceneTextures[i][0];
+		source.tag = g_SceneTextures[i][1];
+		sources.push_back(source);
+	}
+}
+
+/***********************************************************
+ *  CookBasicShape()
+ *
+ *  This method is used for generating the mesh data of a
+ *  basic shape, or loading it from the asset cache when it
+ *  was cooked on an earlier run.
+ ***********************************************************/
+void SceneManager::CookBasicShape(int shape)
+{
+	MESH_DATA& meshData = m_cookedShapes[shape];
+	if (NULL == m_pAssetCache)
+	{
+		MeshCooker::CookShape(shape, meshData);
+		return;
+	}
+
+	std::string parameters = MeshCooker::GetShapeParameters(shape);
+	std::string cacheKey = AssetCache::MakeKey("mesh", NULL, 0, parameters);
+	std::vector<unsigned char> data;
+	if ((m_pAssetCache->Load(cacheKey, data)) &&
+		(MeshCooker::DeserializeMesh(data.data(), data.size(), meshData)))
+	{
+		return;
+	}
+
+	if (MeshCooker::CookShape(shape, meshData))
+	{
+		MeshCooker::SerializeMesh(meshData, data);
+		m_pAssetCache->Store(cacheKey, data);
+	}
+}
+
+/***********************************************************
+ *  IsSceneReady()
+ *
+ *  This method is used for checking whether the shapes,
+ *  materials, lights and objects of the scene are prepared,
+ *  so that the scene can be drawn.
+ ***********************************************************/
+bool SceneManager::IsSceneReady() const
+{
+	return((NULL != m_pJobSystem) && (m_pJobSystem->IsTaskComplete(m_sceneReadyTask)));
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  transforming and drawing the basic 3D shapes
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	bool bHaveCamera = (NULL != m_pViewManager) && (NULL != m_pViewManager->GetCamera());
+	glm::vec3 cameraPosition(0.0f);
+	if (bHaveCamera)
+	{
+		cameraPosition = m_pViewManager->GetCamera()->Position;
+	}
+	m_detailViewPosition = cameraPosition;
+	SetTessellationViewport();
+	if (bHaveCamera)
+	{
+		m_viewProjection = m_pViewManager->GetProjectionMatrix() * m_pViewManager->GetViewMatrix();
+	}
+
+	// the CPU writes this frame's values while the GPU draws earlier frames
+	m_pDrawDataRing->BeginFrame();
+
+	// the design review views each have their own projection, which
+	// the single occlusion pass cannot follow, so they are left out
+	bool bAmbientOcclusion = (IsAmbientOcclusionActive()) && (bHaveCamera) && (NULL == m_pViewSet);
+
+	// the lights are moved on first, since the probes are captured
+	// with them
+	if (NULL != m_pLightAnimator)
+	{
+		AnimateLights();
+	}
+	if (NULL != m_pAnimationSystem)
+	{
+		AnimateObjects();
+	}
+	if (NULL != m_pPhysicsWorld)
+	{
+		SimulatePhysics();
+	}
+
+	// a few probe faces are brought up to date before the frame, and
+	// the probe nearest the camera is used for objects without their own
+	if (NULL != m_pReflectionProbes)
+	{
+		UpdateReflectionProbes(cameraPosition);
+		BindReflectionProbe(m_pReflectionProbes->FindNearestProbe(cameraPosition));
+	}
+
+	// the probes are captured first, since they bring their own
+	// render target
+	if (bAmbientOcclusion)
+	{
+		m_pAmbientOcclusion->BeginScene();
+	}
+
+	// the design review views only show the compound objects, drawn
+	// in full detail in every view
+	if ((NULL != m_pViewSet) && (bHaveCamera))
+	{
+		RenderViews();
+		m_pDrawDataRing->EndFrame();
+		m_pGpuResources->Update();
+		return;
+	}
+
+	// the benchmark takes turns so both ways see the same scene
+	int transformMode = 0;
+	if ((m_bBenchmarkTransforms) && (m_sceneTimedFrames % 2 == 1))
+	{
+		transformMode = 1;
+	}
+	if (NULL != m_pSceneTimers[transformMode])
+	{
+		if (m_bBenchmarkTransforms)
+		{
+			m_pShaderManager->setBoolValue(g_PerVertexTransformsName, transformMode == 1);
+		}
+		m_pSceneTimers[transformMode]->Begin();
+	}
+	m_impostorInstances.clear();
+	m_drawnCompounds.clear();
+	if (NULL != m_pOcclusionQueries)
+	{
+		m_pOcclusionQueries->SetObjectCount((int)m_compoundObjects.size());
+		m_pOcclusionQueries->BeginFrame();
+	}
+	bool bGpuCulling = (NULL != m_pGpuCulling) && (bHaveCamera);
+	if (bGpuCulling)
+	{
+		RenderCulledObjects();
+	}
+	for (size_t i = 0; (i < m_compoundObjects.size()) && (bGpuCulling == false); i++)
+	{
+		const COMPOUND_OBJECT& compound = m_compoundObjects[i];
+
+		// far away compound objects are swapped for a single billboard
+		if ((m_bImpostorsReady) && (m_bUseImpostors) && (bHaveCamera) && (compound.impostorLayer >= 0) &&
+			(glm::length(cameraPosition - compound.boundsCenter) > compound.boundsRadius * m_impostorDistanceFactor))
+		{
+			m_impostorInstances.push_back(compound.boundsCenter.x);
+			m_impostorInstances.push_back(compound.boundsCenter.y);
+			m_impostorInstances.push_back(compound.boundsCenter.z);
+			m_impostorInstances.push_back(compound.boundsRadius);
+			m_impostorInstances.push_back((float)compound.impostorLayer);
+			continue;
+		}
+
+		// hidden objects cost one box query instead of all their parts
+		bool bConditional = false;
+		if (NULL != m_pOcclusionQueries)
+		{
+			bConditional = m_pOcclusionQueries->BeginConditionalDraw((int)i);
+			m_drawnCompounds.push_back((int)i);
+		}
+		if (compound.reflectionProbe >= 0)
+		{
+			BindReflectionProbe(compound.reflectionProbe);
+		}
+		for (size_t p = 0; p < compound.parts.size(); p++)
+		{
+			DrawSceneObject(compound.parts[p]);
+		}
+		if (bConditional)
+		{
+			m_pOcclusionQueries->EndConditionalDraw();
+		}
+	}
+
+	// draw the streamed world cells around the camera
+	RenderWorldCells();
+	if (NULL != m_pSceneTimers[transformMode])
+	{
+		m_pSceneTimers[transformMode]->End();
+		m_sceneTimedFrames++;
+		if (m_bBenchmarkTransforms)
+		{
+			m_pShaderManager->setBoolValue(g_PerVertexTransformsName, false);
+		}
+	}
+
+	// query the compound objects against the finished depth buffer
+	if ((NULL != m_pOcclusionQueries) && (m_drawnCompounds.size() > 0))
+	{
+		RenderOcclusionProxies(cameraPosition);
+	}
+
+	// the blended billboards are drawn after the solid geometry
+	RenderImpostors();
+
+	// fill the holes left by streamed out meshes a little at a time
+	if (m_bCompactMeshes)
+	{
+		m_pMeshLibrary->Compact(g_MeshCompactBytesPerFrame);
+	}
+
+	// darken the creases of the finished scene into the window
+	if (bAmbientOcclusion)
+	{
+		m_pAmbientOcclusion->EndScene(m_pViewManager->GetProjectionMatrix());
+		m_pShaderManager->use();
+	}
+
+	// objects released so far are recycled once this frame is done
+	m_pDrawDataRing->EndFrame();
+	m_pGpuResources->Update();
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing how the shared mesh
+ *  buffers are used, how often the dynamic ring buffer had
+ *  to wait for the GPU, how many occlusion queries ran and
+ *  how many shapes were generated.
+ ***********************************************************/
+void SceneManager::PrintStats() const
+{
+	m_pMeshLibrary->PrintStats();
+	m_pDrawDataRing->PrintStats("draw data");
+	if (NULL != m_pOcclusionQueries)
+	{
+		m_pOcclusionQueries->PrintStats();
+	}
+	if (NULL != m_pProceduralShapes)
+	{
+		m_pProceduralShapes->PrintStats();
+	}
+	if (NULL != m_pReflectionProbes)
+	{
+		m_pReflectionProbes->PrintStats();
+	}
+	if (NULL != m_pAmbientOcclusion)
+	{
+		m_pAmbientOcclusion->PrintStats();
+	}
+	if (NULL != m_pLightAnimator)
+	{
+		m_pLightAnimator->PrintStats();
+	}
+	if (NULL != m_pAnimationSystem)
+	{
+		m_pAnimationSystem->PrintStats();
+	}
+	if (NULL != m_pPhysicsWorld)
+	{
+		m_pPhysicsWorld->PrintStats();
+	}
+	if (NULL != m_pSpatialQuery)
+	{
+		m_pSpatialQuery->PrintStats();
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		const char* transformNames[2] = { "matrices per draw", "matrices per vertex" };
+		if ((NULL != m_pSceneTimers[i]) && (m_pSceneTimers[i]->GetSamples() > 0))
+		{
+			std::cout << "Scene geometry with " << transformNames[i] << ": " << m_pSceneTimers[i]->GetSamples()
+				<< " frames, " << m_pSceneTimers[i]->GetAverageMilliseconds() << " ms GPU per frame" << std::endl;
+		}
+	}
+	if (NULL != m_pViewSet)
+	{
+		const char* modeNames[2] = { "one pass", "a pass per view" };
+		std::cout << "Views: " << m_viewKeptObjects << " objects kept and " << m_viewCulledObjects << " culled" << std::endl;
+		for (int i = 0; i < 2; i++)
+		{
+			if (m_viewFrames[i] > 0)
+			{
+				std::cout << "Views with " << modeNames[i] << ": " << m_viewFrames[i] << " frames, "
+					<< m_pViewTimers[i]->GetAverageMilliseconds() << " ms GPU and "
+					<< ((double)m_viewMicroseconds[i] / (double)m_viewFrames[i] / 1000.0) << " ms CPU per frame" << std::endl;
+			}
+		}
+	}
 }
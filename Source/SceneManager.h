@@ -10,11 +10,34 @@
 #pragma once
 
 #include "ShaderManager.h"
-#include "ShapeMeshes.h"
+#include "MeshLibrary.h"
+#include "GpuResourceManager.h"
+#include "ProgramBuilder.h"
+#include "TexturePack.h"
 
 #include <string>
 #include <vector>
 
+class WorldStreamer;
+class JobSystem;
+class AssetCache;
+class ViewManager;
+class ImpostorAtlas;
+class SamplerCache;
+class BindlessTextures;
+class DynamicBufferRing;
+class GpuCulling;
+class OcclusionQueries;
+class ProceduralShapes;
+class ViewSet;
+class ReflectionProbes;
+class AmbientOcclusion;
+class LightAnimator;
+class AnimationSystem;
+class PhysicsWorld;
+class SpatialQuery;
+class GpuTimer;
+
 /***********************************************************
  *  SceneManager
  *
@@ -34,6 +57,18 @@ public:
 	{
 		std::string tag;
 		uint32_t ID;
+		GPU_HANDLE handle;
+	};
+
+	// image data decoded from a texture file before it is uploaded
+	struct DECODED_TEXTURE
+	{
+		std::string filename;
+		std::string tag;
+		int width;
+		int height;
+		int colorChannels;
+		std::vector<unsigned char> pixels;
 	};
 
 	// properties for object materials
@@ -42,23 +77,276 @@ public:
 		glm::vec3 diffuseColor;
 		glm::vec3 specularColor;
 		float shininess;
+		// share of the color reflected from the reflection probes
+		float reflectivity;
+		std::string tag;
+	};
+
+	// properties for one drawn part of a scene object
+	struct SCENE_OBJECT
+	{
+		int shape;
+		glm::vec3 scaleXYZ;
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+		glm::vec4 color;
+		std::string textureTag;
+		glm::vec2 uvScale;
+		std::string materialTag;
+		// model matrix built from the values above, or sampled from an
+		// animation track - only animated parts are built again
+		glm::mat4 model;
+		// index of the part in the GPU culling records, or -1
+		int cullRecord;
+		// index of the part's collider in the spatial queries, or -1
+		int collider;
+	};
+
+	// properties for an object made of one or more drawn parts
+	struct COMPOUND_OBJECT
+	{
 		std::string tag;
+		std::vector<SCENE_OBJECT> parts;
+		glm::vec3 boundsCenter;
+		float boundsRadius;
+		// size of the bounding box around the center
+		glm::vec3 boundsExtents;
+		bool bUseImpostor;
+		int impostorLayer;
+		// reflection probe at the center of the object, or -1
+		int reflectionProbe;
 	};
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
-	// pointer to basic shapes object
-	ShapeMeshes* m_basicMeshes;
+	// owner of the OpenGL buffers, textures and framebuffers
+	GpuResourceManager* m_pGpuResources;
+	// pointer to meshes built from vertex data
+	MeshLibrary* m_pMeshLibrary;
+	// whether the shared mesh buffers are compacted a little every frame
+	bool m_bCompactMeshes;
+	// mesh IDs of the basic shapes in the mesh library
+	int m_shapeMeshIDs[SHAPE_COUNT];
+	// pointer to the streamed world, if one is open
+	WorldStreamer* m_pWorldStreamer;
+	// pointer to the view manager for the camera state
+	ViewManager* m_pViewManager;
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// defined scene objects
+	std::vector<COMPOUND_OBJECT> m_compoundObjects;
+
+	// impostor atlas for drawing distant compound objects
+	ImpostorAtlas* m_pImpostorAtlas;
+	// shader for drawing impostor billboards
+	ShaderManager* m_pImpostorShader;
+	// vertex array for impostor billboards
+	GPU_HANDLE m_impostorVAO;
+	// impostor billboards collected for the current frame
+	std::vector<float> m_impostorInstances;
+	// whether distant compound objects are drawn as impostors
+	bool m_bUseImpostors;
+	// compound objects farther than this many bounding radii use impostors
+	float m_impostorDistanceFactor;
+	// pre-baked impostor atlas file to load instead of baking
+	std::string m_impostorFilename;
+	// whether the impostor atlas is ready for drawing
+	bool m_bImpostorsReady;
+
+	// cache of decoded textures, cooked shapes and program binaries
+	AssetCache* m_pAssetCache;
+	// job system running the scene startup tasks
+	JobSystem* m_pJobSystem;
+	// startup task that completes once the scene can be drawn
+	int m_sceneReadyTask;
+	// basic shapes cooked on worker threads, waiting for upload
+	std::vector<MESH_DATA> m_cookedShapes;
+	// texture images decoded on worker threads, waiting for upload
+	std::vector<DECODED_TEXTURE> m_decodedTextures;
+	// impostor shader program being built during startup
+	ProgramBuilder::PENDING_PROGRAM m_impostorProgram;
+	// shared sampler objects and the filter used for the scene textures
+	SamplerCache* m_pSamplerCache;
+	int m_textureFilter;
+	// resident texture handles, when textures are sampled bindless
+	BindlessTextures* m_pBindlessTextures;
+
+	// per-draw values of the scene shader, laid out like its std140
+	// DrawData uniform block
+	struct DRAW_DATA
+	{
+		glm::mat4 model;
+		// worked out from the model when the values are committed
+		glm::mat4 modelViewProjection;
+		glm::mat4 normalMatrix;
+		glm::vec4 objectColor;
+		// the shininess is kept in the fourth diffuse component
+		glm::vec4 materialDiffuseColor;
+		glm::vec4 materialSpecularColor;
+		glm::vec2 UVscale;
+		int32_t bUseTexture;
+		int32_t objectTextureIndex;
+	};
+	// values for the next draw, kept between draws like uniforms
+	DRAW_DATA m_drawData;
+	// projection * view of the view being drawn
+	glm::mat4 m_viewProjection;
+	// ring buffer the per-draw values and impostor instances go through
+	DynamicBufferRing* m_pDrawDataRing;
+	// program whose draw data block binding has been set
+	GLuint m_drawDataProgram;
+	// whether the scene shader reads the per-draw values from a
+	// storage buffer instead of the uniform block
+	bool m_bStorageDrawData;
+	// compute culling of the compound object parts, when enabled
+	GpuCulling* m_pGpuCulling;
+	// loaded textures, impostor state and mesh layout the culling
+	// records were built with
+	int m_gpuCullTextureCount;
+	bool m_bGpuCullImpostors;
+	uint32_t m_gpuCullMeshLayout;
+	// per-draw values of the culling records, whose model-view-
+	// projection matrices are updated every frame
+	std::vector<DRAW_DATA> m_gpuCullDrawData;
+	// occlusion queries on the bounding boxes of the compound objects,
+	// when enabled
+	OcclusionQueries* m_pOcclusionQueries;
+	// compound objects drawn with their parts this frame
+	std::vector<int> m_drawnCompounds;
+	// round shapes generated in the vertex shader, when enabled
+	ProceduralShapes* m_pProceduralShapes;
+	// position the shapes are drawn for, which picks their tessellation
+	glm::vec3 m_detailViewPosition;
+	// whether the scene is drawn as patches through the tessellation
+	// shaders
+	bool m_bTessellatedShapes;
+
+	// part of the scene objects drawn into every view
+	struct VIEW_DRAW
+	{
+		int shape;
+		// texture slot bound when textures are not bindless
+		int textureSlot;
+		// slices and rows of a generated shape
+		glm::ivec2 tessellation;
+		// per-draw values in the dynamic ring buffer
+		GLintptr offset;
+	};
+	// several views drawn side by side, when enabled
+	ViewSet* m_pViewSet;
+	// layout of the views, from ViewSet::VIEW_LAYOUT
+	int m_viewLayout;
+	// whether the views are drawn in one pass, or take turns with a
+	// pass per view to compare the two
+	bool m_bSinglePassViews;
+	bool m_bBenchmarkViews;
+	// sorted parts that are drawn into the views this frame
+	std::vector<VIEW_DRAW> m_viewDraws;
+	// GPU time, CPU time and frames of one pass and of a pass per view
+	GpuTimer* m_pViewTimers[2];
+	int64_t m_viewMicroseconds[2];
+	int64_t m_viewFrames[2];
+	// compound objects kept and culled by the views
+	int64_t m_viewKeptObjects;
+	int64_t m_viewCulledObjects;
+
+	// cubemaps of the scene around the reflective objects, when enabled
+	ReflectionProbes* m_pReflectionProbes;
+	// most probe faces captured in one frame
+	int m_probeFacesPerFrame;
+	// loaded textures the probes were captured with
+	int m_probeTextureCount;
+	// probe bound for the draws that follow
+	int m_boundProbe;
+
+	// screen-space ambient occlusion passes, when enabled
+	AmbientOcclusion* m_pAmbientOcclusion;
+	// whether the passes run - switched at runtime
+	bool m_bAmbientOcclusionActive;
+
+	// keyframed lights of the day cycle, when enabled
+	LightAnimator* m_pLightAnimator;
+	// time the lights were last moved on, in microseconds
+	int64_t m_lightAnimationTime;
+
+	// part of a compound object moved by an animation track
+	struct ANIMATED_PART
+	{
+		int compound;
+		int part;
+	};
+	// keyframed transforms of the scene objects, when enabled
+	AnimationSystem* m_pAnimationSystem;
+	// parts moved by the tracks, in the order of the track targets
+	std::vector<ANIMATED_PART> m_animatedParts;
+	// compound objects whose bounds moved this frame
+	std::vector<int> m_movedCompounds;
+	// time the objects were last moved on, in microseconds
+	int64_t m_objectAnimationTime;
+
+	// compound object carried by a rigid body, with the transforms of
+	// its parts relative to the body
+	struct PHYSICS_OBJECT
+	{
+		int compound;
+		int body;
+		std::vector<glm::mat4> partOffsets;
+		// whether the body was awake after the last step, so the step
+		// it fell asleep in is still copied to the parts
+		bool bAwake;
+	};
+	// whether the scene objects are simulated as rigid bodies
+	bool m_bPhysics;
+	PhysicsWorld* m_pPhysicsWorld;
+	std::vector<PHYSICS_OBJECT> m_physicsObjects;
+	// time the bodies were last stepped, in microseconds
+	int64_t m_physicsTime;
+	// colliders of the scene parts for the camera queries, when enabled
+	SpatialQuery* m_pSpatialQuery;
+	// GPU time of the solid scene geometry, when it is measured, with
+	// the matrices worked out per draw and multiplied per vertex
+	GpuTimer* m_pSceneTimers[2];
+	// whether the frames take turns between the two ways of transforming
+	// the vertices, and the frames timed so far
+	bool m_bBenchmarkTransforms;
+	int64_t m_sceneTimedFrames;
+	// quality tier and memory budget that pick the texture sizes
+	int m_textureQuality;
+	uint64_t m_textureBudgetBytes;
+	// planned starting mip level of every texture that is loaded
+	std::vector<int> m_textureStartMips;
+	// pack of compressed texture pixels to load instead of image files
+	std::string m_texturePackFilename;
+	TexturePack* m_pTexturePack;
+	// mapped pixel buffers the packed textures are decompressed into
+	std::vector<GPU_HANDLE> m_textureUploadBuffers;
+	std::vector<void*> m_textureUploadMemory;
+	// whether each packed texture was decompressed
+	std::vector<char> m_textureUnpacked;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
+	// read and decode a texture image file without using OpenGL
+	bool DecodeTexture(const char* filename, std::string tag, int scaleDenominator, DECODED_TEXTURE& texture);
+	// convert a decoded texture image to OpenGL texture data
+	bool UploadTexture(DECODED_TEXTURE& texture);
+	// pick the starting mip level of every texture from the budget
+	void PlanTextureBudget();
+	// add the tasks that load the textures from the texture pack
+	void AddTexturePackTasks(JobSystem* pJobSystem, int budgetTask, std::vector<int>& textureTasks);
+	// get the size a packed texture is uploaded at
+	void GetPackedTextureSize(int index, int& width, int& height) const;
+	// map a pixel buffer for decompressing a packed texture into
+	void MapTextureUploadBuffer(int index);
+	// create an OpenGL texture from a decompressed pixel buffer
+	bool UploadPackedTexture(int index);
+	// cook a basic shape, or load it from the asset cache
+	void CookBasicShape(int shape);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
@@ -69,6 +357,14 @@ private:
 	// find a defined material by tag
 	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
 
+	// build the model matrix from the transformation values
+	glm::mat4 BuildModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
 	// set the transformation values 
 	// into the transform buffer
 	void SetTransformations(
@@ -97,10 +393,111 @@ private:
 	void SetShaderMaterial(
 		std::string materialTag);
 
+	// add a drawn part to a compound object
+	void AddObjectPart(
+		COMPOUND_OBJECT& compound,
+		int shape,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ,
+		glm::vec4 color,
+		std::string textureTag,
+		glm::vec2 uvScale,
+		std::string materialTag);
+	// compute the world space bounding box of a drawn part
+	void GetPartBounds(const SCENE_OBJECT& part, glm::vec3& boundsMin, glm::vec3& boundsMax);
+	// compute the bounding sphere of a compound object
+	void ComputeCompoundBounds(COMPOUND_OBJECT& compound);
+	// compute the bounds of a compound object again after its parts moved
+	void UpdateCompoundBounds(COMPOUND_OBJECT& compound);
+	// set the shader values for one part of a scene object
+	void SetSceneObjectValues(const SCENE_OBJECT& object);
+	// draw one part of a scene object
+	void DrawSceneObject(const SCENE_OBJECT& object);
+	// draw one of the basic shapes
+	void DrawBasicMesh(int shape);
+	// pick the tessellation of a generated shape for the next draw
+	glm::ivec2 GetShapeTessellation(int shape);
+	// pass the viewport size to the tessellation shaders, which split
+	// the patches by their length in pixels
+	void SetTessellationViewport();
+	// write the per-draw values and bind them for the next draw
+	void CommitDrawData();
+	// write the per-draw values and return their ring buffer offset
+	GLintptr WriteDrawData();
+	// bind the per-draw values written at a ring buffer offset
+	void BindDrawData(GLintptr offset);
+	// draw a basic shape with the values that are bound
+	void DrawShape(int shape, glm::ivec2 tessellation);
+	// draw the scene objects into all of the views
+	void RenderViews();
+	// lay out the design review views around the compound objects
+	void SetReviewViews(const glm::ivec4& viewport);
+	// cull the compound objects against the views and sort their parts
+	void BuildViewDrawList();
+	// draw the sorted parts with the views that are bound
+	void DrawViewDrawList();
+	// set the binding of the draw data block in the active program
+	void SetDrawDataBlockBinding();
+	// upload the compound object parts for culling on the GPU
+	void UpdateGpuCullObjects();
+	// cull the compound object parts on the GPU and draw them
+	void RenderCulledObjects();
+	// draw the bounding boxes of the drawn compound objects as
+	// occlusion queries for the next frame
+	void RenderOcclusionProxies(const glm::vec3& cameraPosition);
+
+	// bake or load the impostors for the compound objects
+	void PrepareImpostors();
+	// render the impostor atlas for every compound object using one
+	void BakeImpostors();
+	// draw the impostor billboards collected for this frame
+	void RenderImpostors();
+	// render the resident cells of the streamed world
+	void RenderWorldCells();
+	// add a reflection probe to every object with a reflective material
+	void PrepareReflectionProbes();
+	// capture the probe faces that are out of date, within the budget
+	void UpdateReflectionProbes(const glm::vec3& cameraPosition);
+	// bind the cubemap of a probe for the draws that follow
+	void BindReflectionProbe(int probe);
+	// add the keyframes of the day cycle for the scene lights
+	void DefineLightAnimation();
+	// move the lights on to this frame's time of day
+	void AnimateLights();
+	// add the animation tracks of the scene objects
+	void DefineSceneAnimation();
+	// add a track that moves a part of a compound object, starting out
+	// at its defined transform
+	int AddPartTrack(int compound, int part);
+	// move the animated parts on and update what was built from them
+	void AnimateObjects();
+	// give a part a new model matrix and update its culling record
+	void MovePart(int compound, int part, const glm::mat4& model, bool bCullRecords);
+	// fit the bounds of the compound objects moved this frame again
+	void UpdateMovedCompounds(bool bCullRecords);
+	// add the rigid bodies of the scene objects
+	void DefinePhysicsBodies();
+	// fit a physics collider around a part as it is placed now, and
+	// get its type and its size as the physics world takes them
+	void GetPartCollider(const SCENE_OBJECT& part, int& type, glm::vec3& center, glm::vec3& size, glm::mat3& rotation);
+	// fit a sphere or an oriented box for the spatial queries around a
+	// part as it is placed now
+	void GetSpatialCollider(const SCENE_OBJECT& part, bool& bSphere, glm::vec3& center, glm::vec3& halfSize, glm::mat3& rotation);
+	// add a body that collides like a part of a compound object
+	int AddPartBody(const SCENE_OBJECT& part, bool bDynamic);
+	// add a collider for every part to the spatial queries
+	void DefineSpatialColliders();
+	// step the rigid bodies and move the parts they carry
+	void SimulatePhysics();
+
 public:
 
-	// prepare the 3D scene for rendering
-	void PrepareScene();
+	// prepare the 3D scene for rendering - the preparation runs as
+	// tasks on the job system once the scene shader task is done
+	void PrepareScene(JobSystem* pJobSystem, int shaderTask);
+	// check whether enough of the scene is prepared for drawing
+	bool IsSceneReady() const;
 	// render the objects in the 3D scene
 	void RenderScene();
 
@@ -110,7 +507,98 @@ public:
 	void DefineObjectMaterials();
 	// add and define the light sources before rendering
 	void SetupSceneLights();
+	// define all the objects in the 3D scene before rendering
+	void DefineSceneObjects();
+
+	// get the library for meshes built from vertex data
+	MeshLibrary* GetMeshLibrary() { return(m_pMeshLibrary); }
+	// print the mesh buffer, dynamic buffer and query statistics
+	void PrintStats() const;
+	// set the streamed world that is rendered with the scene
+	void SetWorldStreamer(WorldStreamer* pWorldStreamer) { m_pWorldStreamer = pWorldStreamer; }
+	// set the asset cache used while preparing the scene
+	void SetAssetCache(AssetCache* pAssetCache) { m_pAssetCache = pAssetCache; }
+	// set the view manager that provides the camera state
+	void SetViewManager(ViewManager* pViewManager) { m_pViewManager = pViewManager; }
 
-	
-	
+	// enable or disable impostors for distant compound objects
+	void SetImpostorsEnabled(bool bEnabled) { m_bUseImpostors = bEnabled; }
+	// enable or disable compacting the shared mesh buffers over frames
+	void SetMeshCompaction(bool bEnabled) { m_bCompactMeshes = bEnabled; }
+	// use a pre-baked impostor atlas file instead of baking at load time
+	void SetImpostorFile(const char* filename) { m_impostorFilename = filename; }
+	// switch the filtering of all the scene textures
+	void SetTextureFilter(int filter);
+	// sample the scene textures through bindless handles - the scene
+	// shader has to be built with the bindless texture define
+	void SetBindlessTextures(bool bEnabled);
+	// cull and draw the compound objects from a compute shader - the
+	// scene shader has to be built with the GPU draw define, and the
+	// textures have to be sampled bindless
+	void SetGpuCulling(bool bEnabled);
+	// skip the draws of compound objects whose bounding box was hidden
+	// in the last frame
+	void SetOcclusionQueries(bool bEnabled);
+	// generate the round shapes in the vertex shader instead of drawing
+	// their meshes - the scene shader has to be built with the
+	// procedural shape define, and this has to be set before the scene
+	// is prepared
+	void SetProceduralShapes(bool bEnabled);
+	// draw everything as patches, so that the tessellation shaders can
+	// smooth the generated shapes - the scene shader has to be built
+	// with the tessellation stages, and this has to be set after the
+	// procedural shapes
+	void SetTessellatedShapes(bool bEnabled);
+	// draw the scene objects into several views laid out as passed in,
+	// from ViewSet::VIEW_LAYOUT - the scene shader has to be built with
+	// the multi-view define, and the views are drawn in one pass when the
+	// driver allows it.  The benchmark switches between one pass and a
+	// pass per view every frame.
+	void SetMultiView(int layout, bool bBenchmark);
+	// reflect the scene on metal and glass from cubemaps that are
+	// captured at most the passed in number of faces per frame - the
+	// scene shader has to be built with the reflection probe define
+	void SetReflectionProbes(bool bEnabled, int facesPerFrame);
+	// darken the creases of the scene with ambient occlusion worked out
+	// at a reduced resolution from the depth buffer
+	void SetAmbientOcclusion(bool bEnabled);
+	// switch the enabled ambient occlusion on or off between frames
+	void SetAmbientOcclusionActive(bool bActive) { m_bAmbientOcclusionActive = bActive; }
+	// check whether the ambient occlusion passes run
+	bool IsAmbientOcclusionActive() const { return((NULL != m_pAmbientOcclusion) && (m_bAmbientOcclusionActive)); }
+	// move the sun and the room lights through a day that takes the
+	// passed in number of seconds, starting at the passed in hour
+	void SetDayCycle(bool bEnabled, float dayLengthSeconds, float startHour);
+	// move scene objects along keyframed tracks - the animated objects
+	// are drawn in full detail instead of as impostors
+	void SetObjectAnimation(bool bEnabled);
+	// simulate the can and the apple as rigid bodies that rest on the
+	// other objects - this has to be set before the scene is prepared,
+	// and objects that are animated are left out
+	void SetPhysics(bool bEnabled) { m_bPhysics = bEnabled; }
+	// push the rigid bodies along the passed in direction, so they
+	// slide and tip over
+	void PushPhysicsObjects(const glm::vec3& direction);
+	// keep colliders of the scene parts for the camera to collide with -
+	// this has to be set before the scene is prepared
+	void SetSpatialQuery(bool bEnabled);
+	// get the colliders of the scene parts, or NULL
+	SpatialQuery* GetSpatialQuery() const { return(m_pSpatialQuery); }
+	// measure the GPU time of the solid scene geometry every frame - the
+	// benchmark switches between the matrices worked out per draw and the
+	// old projection * view * model product per vertex every frame, and
+	// the scene shader has to be built with the transform benchmark define
+	void SetSceneTiming(bool bEnabled, bool bBenchmarkTransforms);
+	// get the shader define that lets the transform benchmark switch
+	static const char* GetTransformBenchmarkDefine();
+	// set the quality tier that picks the texture sizes
+	void SetTextureQuality(int quality) { m_textureQuality = quality; }
+	// set the texture memory budget - zero bytes means no limit
+	void SetTextureBudget(uint64_t budgetBytes) { m_textureBudgetBytes = budgetBytes; }
+	// load the textures from a texture pack instead of the image files
+	void SetTexturePack(const char* filename) { m_texturePackFilename = filename; }
+	// get the image files and tags of the scene textures
+	static void GetSceneTextureSources(std::vector<TexturePack::TEXTURE_SOURCE>& sources);
+	// save the baked impostor atlas into a file
+	bool SaveImpostors(const char* filename);
 };
\ No newline at end of file
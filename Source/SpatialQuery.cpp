@@ -0,0 +1,612 @@
+///////////////////////////////////////////////////////////////////////////////
+// spatialquery.cpp
+// ============
+// find the scene colliders near a point for camera collision and ground tests
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SpatialQuery.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// declaration of global variables
+namespace
+{
+	// most cells along one side of the grid, and the smallest cell
+	const int g_MaxCellsPerAxis = 64;
+	const float g_MinCellSize = 0.25f;
+	// colliders that cover more cells than this, like the counter top,
+	// are checked by every query instead of being listed in each cell
+	const int g_MaxCellsPerCollider = 64;
+	// passes over the overlapping colliders when a sphere is pushed out,
+	// since a push out of one can push into another
+	const int g_ResolveIterations = 4;
+	// layout of the benchmark field
+	const float g_BenchmarkSpacing = 4.0f;
+	const float g_BenchmarkRadius = 0.5f;
+	const float g_BenchmarkDrop = 20.0f;
+}
+
+/***********************************************************
+ *  SpatialQuery()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SpatialQuery::SpatialQuery()
+{
+	m_gridOrigin = glm::vec3(0.0f);
+	m_cellSize = 1.0f;
+	m_gridCells = glm::ivec3(0, 0, 0);
+	m_queryStamp = 0;
+	m_sphereQueries = 0;
+	m_groundQueries = 0;
+	m_testedColliders = 0;
+}
+
+/***********************************************************
+ *  AddCollider()
+ *
+ *  This method is used for adding a collider.  It is only
+ *  found by the queries once the grid is built.
+ ***********************************************************/
+int SpatialQuery::AddCollider(int type, const glm::vec3& center, const glm::vec3& halfSize, const glm::mat3& rotation)
+{
+	COLLIDER collider;
+	collider.type = type;
+	collider.center = center;
+	collider.halfSize = halfSize;
+	collider.rotation = rotation;
+	collider.bUnlisted = false;
+	collider.queryStamp = 0;
+	UpdateBounds(collider);
+	m_colliders.push_back(collider);
+	return((int)m_colliders.size() - 1);
+}
+
+/***********************************************************
+ *  MoveCollider()
+ *
+ *  This method is used for moving a collider.  A collider
+ *  that moves once is likely to move again, so instead of
+ *  sorting it into other cells it is taken off the grid
+ *  and checked by every query.  The moving scene objects
+ *  are few, so the list stays short.
+ ***********************************************************/
+void SpatialQuery::MoveCollider(int collider, const glm::vec3& center, const glm::mat3& rotation)
+{
+	COLLIDER& target = m_colliders[collider];
+	target.center = center;
+	target.rotation = rotation;
+	UpdateBounds(target);
+	if (target.bUnlisted == false)
+	{
+		target.bUnlisted = true;
+		m_unlisted.push_back(collider);
+	}
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for sorting the colliders that hold
+ *  still into the grid.  The cells are about as large as
+ *  the average collider, so most colliders are listed in a
+ *  few cells, but the grid is kept to a fixed number of
+ *  cells per side for scenes that spread far.  The cells
+ *  are counted first and then filled, so every cell's list
+ *  sits in one array.
+ ***********************************************************/
+void SpatialQuery::Build()
+{
+	glm::vec3 sceneMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	glm::vec3 sceneMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	float sizeSum = 0.0f;
+	int listedCount = 0;
+	for (size_t i = 0; i < m_colliders.size(); i++)
+	{
+		const COLLIDER& collider = m_colliders[i];
+		if (collider.bUnlisted)
+		{
+			continue;
+		}
+		glm::vec3 size = collider.boundsMax - collider.boundsMin;
+		sceneMin = glm::min(sceneMin, collider.boundsMin);
+		sceneMax = glm::max(sceneMax, collider.boundsMax);
+		sizeSum += std::max(size.x, std::max(size.y, size.z));
+		listedCount++;
+	}
+
+	m_cellStarts.clear();
+	m_cellColliders.clear();
+	m_gridCells = glm::ivec3(0, 0, 0);
+	if (listedCount == 0)
+	{
+		return;
+	}
+
+	glm::vec3 extent = sceneMax - sceneMin;
+	float largest = std::max(extent.x, std::max(extent.y, extent.z));
+	m_cellSize = std::max(sizeSum / (float)listedCount, std::max(largest / (float)g_MaxCellsPerAxis, g_MinCellSize));
+	m_gridOrigin = sceneMin;
+	m_gridCells = glm::ivec3(
+		std::min(std::max((int)std::ceil(extent.x / m_cellSize), 1), g_MaxCellsPerAxis),
+		std::min(std::max((int)std::ceil(extent.y / m_cellSize), 1), g_MaxCellsPerAxis),
+		std::min(std::max((int)std::ceil(extent.z / m_cellSize), 1), g_MaxCellsPerAxis));
+	int cellCount = m_gridCells.x * m_gridCells.y * m_gridCells.z;
+
+	// count the entries of every cell, one place ahead so the counts
+	// turn into the starts
+	m_cellStarts.assign(cellCount + 1, 0);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		std::vector<int> cursors;
+		if (pass == 1)
+		{
+			for (int cell = 0; cell < cellCount; cell++)
+			{
+				m_cellStarts[cell + 1] += m_cellStarts[cell];
+			}
+			m_cellColliders.resize(m_cellStarts[cellCount]);
+			cursors.assign(m_cellStarts.begin(), m_cellStarts.end() - 1);
+		}
+
+		for (size_t i = 0; i < m_colliders.size(); i++)
+		{
+			COLLIDER& collider = m_colliders[i];
+			if (collider.bUnlisted)
+			{
+				continue;
+			}
+			glm::ivec3 first;
+			glm::ivec3 last;
+			GetCellRange(collider.boundsMin, collider.boundsMax, first, last);
+			int covered = (last.x - first.x + 1) * (last.y - first.y + 1) * (last.z - first.z + 1);
+			if (covered > g_MaxCellsPerCollider)
+			{
+				collider.bUnlisted = true;
+				m_unlisted.push_back((int)i);
+				continue;
+			}
+
+			for (int z = first.z; z <= last.z; z++)
+			{
+				for (int y = first.y; y <= last.y; y++)
+				{
+					for (int x = first.x; x <= last.x; x++)
+					{
+						int cell = (((z * m_gridCells.y) + y) * m_gridCells.x) + x;
+						if (pass == 0)
+						{
+							m_cellStarts[cell + 1]++;
+						}
+						else
+						{
+							m_cellColliders[cursors[cell]++] = (int)i;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ResolveSphere()
+ *
+ *  This method is used for pushing a sphere out of the
+ *  colliders it overlaps, each along the shortest way out.
+ *  The colliders are gathered once, with a margin for the
+ *  pushes, and the passes repeat while anything moved, so
+ *  a sphere in a corner ends up clear of both sides.
+ ***********************************************************/
+bool SpatialQuery::ResolveSphere(glm::vec3& center, float radius)
+{
+	m_sphereQueries++;
+	glm::vec3 reach(radius * 2.0f);
+	GatherCandidates(center - reach, center + reach);
+
+	bool bMoved = false;
+	for (int iteration = 0; iteration < g_ResolveIterations; iteration++)
+	{
+		bool bPushed = false;
+		for (size_t i = 0; i < m_candidates.size(); i++)
+		{
+			glm::vec3 normal;
+			float depth;
+			if (GetPenetration(m_colliders[m_candidates[i]], center, radius, normal, depth))
+			{
+				center += normal * depth;
+				bPushed = true;
+			}
+		}
+		if (bPushed == false)
+		{
+			break;
+		}
+		bMoved = true;
+	}
+	return(bMoved);
+}
+
+/***********************************************************
+ *  FindGround()
+ *
+ *  This method is used for finding the first surface below
+ *  a point.  Only the cells of the column under the point
+ *  are searched, and the nearest hit wins.  The normal
+ *  tells the caller whether the surface is flat enough to
+ *  stand on.
+ ***********************************************************/
+bool SpatialQuery::FindGround(const glm::vec3& point, float maxDrop, float& height, glm::vec3& normal)
+{
+	m_groundQueries++;
+	GatherCandidates(point - glm::vec3(0.0f, maxDrop, 0.0f), point);
+
+	bool bFound = false;
+	float nearest = maxDrop;
+	for (size_t i = 0; i < m_candidates.size(); i++)
+	{
+		float distance;
+		glm::vec3 hitNormal;
+		if ((CastDown(m_colliders[m_candidates[i]], point, nearest, distance, hitNormal)) && (distance <= nearest))
+		{
+			nearest = distance;
+			normal = hitNormal;
+			bFound = true;
+		}
+	}
+
+	if (bFound)
+	{
+		height = point.y - nearest;
+	}
+	return(bFound);
+}
+
+/***********************************************************
+ *  UpdateBounds()
+ *
+ *  This method is used for fitting the bounding box of a
+ *  collider, which takes the absolute rotation of the half
+ *  size for a box.
+ ***********************************************************/
+void SpatialQuery::UpdateBounds(COLLIDER& collider)
+{
+	glm::vec3 extent;
+	if (collider.type == COLLIDER_SPHERE)
+	{
+		extent = glm::vec3(collider.halfSize.x);
+	}
+	else
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			extent[i] = (std::fabs(collider.rotation[0][i]) * collider.halfSize.x) +
+				(std::fabs(collider.rotation[1][i]) * collider.halfSize.y) +
+				(std::fabs(collider.rotation[2][i]) * collider.halfSize.z);
+		}
+	}
+	collider.boundsMin = collider.center - extent;
+	collider.boundsMax = collider.center + extent;
+}
+
+/***********************************************************
+ *  GetCellRange()
+ *
+ *  This method is used for getting the first and last grid
+ *  cell a box covers on every axis.  Boxes outside of the
+ *  grid are clamped to its edge cells, and their colliders
+ *  are then thrown out by the bounds test.
+ ***********************************************************/
+void SpatialQuery::GetCellRange(const glm::vec3& boundsMin, const glm::vec3& boundsMax, glm::ivec3& first, glm::ivec3& last) const
+{
+	glm::vec3 low = (boundsMin - m_gridOrigin) / m_cellSize;
+	glm::vec3 high = (boundsMax - m_gridOrigin) / m_cellSize;
+	first = glm::ivec3(
+		std::min(std::max((int)std::floor(low.x), 0), m_gridCells.x - 1),
+		std::min(std::max((int)std::floor(low.y), 0), m_gridCells.y - 1),
+		std::min(std::max((int)std::floor(low.z), 0), m_gridCells.z - 1));
+	last = glm::ivec3(
+		std::min(std::max((int)std::floor(high.x), 0), m_gridCells.x - 1),
+		std::min(std::max((int)std::floor(high.y), 0), m_gridCells.y - 1),
+		std::min(std::max((int)std::floor(high.z), 0), m_gridCells.z - 1));
+}
+
+/***********************************************************
+ *  GatherCandidates()
+ *
+ *  This method is used for listing the colliders whose
+ *  bounds overlap a box.  Every collider is stamped with
+ *  the query when it is first seen, so a collider listed in
+ *  several cells, or moved off the grid after it was
+ *  listed, is only tested once.
+ ***********************************************************/
+void SpatialQuery::GatherCandidates(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	m_candidates.clear();
+	m_queryStamp++;
+
+	auto consider = [this, &boundsMin, &boundsMax](int index) {
+		COLLIDER& collider = m_colliders[index];
+		if (collider.queryStamp == m_queryStamp)
+		{
+			return;
+		}
+		collider.queryStamp = m_queryStamp;
+		if ((collider.boundsMin.x <= boundsMax.x) && (collider.boundsMax.x >= boundsMin.x) &&
+			(collider.boundsMin.y <= boundsMax.y) && (collider.boundsMax.y >= boundsMin.y) &&
+			(collider.boundsMin.z <= boundsMax.z) && (collider.boundsMax.z >= boundsMin.z))
+		{
+			m_candidates.push_back(index);
+		}
+	};
+
+	for (size_t i = 0; i < m_unlisted.size(); i++)
+	{
+		consider(m_unlisted[i]);
+	}
+
+	if (m_gridCells.x > 0)
+	{
+		glm::ivec3 first;
+		glm::ivec3 last;
+		GetCellRange(boundsMin, boundsMax, first, last);
+		for (int z = first.z; z <= last.z; z++)
+		{
+			for (int y = first.y; y <= last.y; y++)
+			{
+				for (int x = first.x; x <= last.x; x++)
+				{
+					int cell = (((z * m_gridCells.y) + y) * m_gridCells.x) + x;
+					for (int k = m_cellStarts[cell]; k < m_cellStarts[cell + 1]; k++)
+					{
+						consider(m_cellColliders[k]);
+					}
+				}
+			}
+		}
+	}
+	m_testedColliders += (int64_t)m_candidates.size();
+}
+
+/***********************************************************
+ *  GetPenetration()
+ *
+ *  This method is used for finding how far a sphere reaches
+ *  into a collider.  For a box the sphere center is brought
+ *  into the space of the box and clamped to it, which gives
+ *  the closest point, and a center inside the box is pushed
+ *  out through the nearest face.
+ ***********************************************************/
+bool SpatialQuery::GetPenetration(const COLLIDER& collider, const glm::vec3& center, float radius,
+	glm::vec3& normal, float& depth)
+{
+	if (collider.type == COLLIDER_SPHERE)
+	{
+		glm::vec3 offset = center - collider.center;
+		float reach = radius + collider.halfSize.x;
+		float distanceSquared = glm::dot(offset, offset);
+		if (distanceSquared >= reach * reach)
+		{
+			return(false);
+		}
+		float distance = std::sqrt(distanceSquared);
+		normal = (distance > 0.000001f) ? (offset / distance) : glm::vec3(0.0f, 1.0f, 0.0f);
+		depth = reach - distance;
+		return(true);
+	}
+
+	glm::vec3 local = glm::transpose(collider.rotation) * (center - collider.center);
+	glm::vec3 closest = glm::clamp(local, -collider.halfSize, collider.halfSize);
+	glm::vec3 difference = local - closest;
+	float distanceSquared = glm::dot(difference, difference);
+	if (distanceSquared >= radius * radius)
+	{
+		return(false);
+	}
+
+	glm::vec3 localNormal(0.0f);
+	if (distanceSquared > 0.000001f)
+	{
+		float distance = std::sqrt(distanceSquared);
+		localNormal = difference / distance;
+		depth = radius - distance;
+	}
+	else
+	{
+		int axis = 0;
+		float nearest = collider.halfSize.x - std::fabs(local.x);
+		for (int i = 1; i < 3; i++)
+		{
+			float inside = collider.halfSize[i] - std::fabs(local[i]);
+			if (inside < nearest)
+			{
+				nearest = inside;
+				axis = i;
+			}
+		}
+		localNormal[axis] = (local[axis] >= 0.0f) ? 1.0f : -1.0f;
+		depth = radius + nearest;
+	}
+	normal = collider.rotation * localNormal;
+	return(true);
+}
+
+/***********************************************************
+ *  CastDown()
+ *
+ *  This method is used for finding where a ray going
+ *  straight down first enters a collider.  A box is cut
+ *  with its three pairs of faces in its own space, and the
+ *  face the ray enters last is the one it hits.  A ray that
+ *  starts inside a collider hits nothing.
+ ***********************************************************/
+bool SpatialQuery::CastDown(const COLLIDER& collider, const glm::vec3& origin, float maxDistance,
+	float& distance, glm::vec3& normal)
+{
+	if (collider.type == COLLIDER_SPHERE)
+	{
+		glm::vec3 offset = origin - collider.center;
+		float radius = collider.halfSize.x;
+		// the ray direction is straight down, so its dot product with the
+		// offset is the negated height
+		float half = -offset.y;
+		float discriminant = (half * half) - (glm::dot(offset, offset) - (radius * radius));
+		if (discriminant < 0.0f)
+		{
+			return(false);
+		}
+		distance = -half - std::sqrt(discriminant);
+		if ((distance < 0.0f) || (distance > maxDistance))
+		{
+			return(false);
+		}
+		normal = (offset + glm::vec3(0.0f, -distance, 0.0f)) / radius;
+		return(true);
+	}
+
+	glm::vec3 local = glm::transpose(collider.rotation) * (origin - collider.center);
+	glm::vec3 direction = glm::transpose(collider.rotation) * glm::vec3(0.0f, -1.0f, 0.0f);
+	float enter = -FLT_MAX;
+	float exit = FLT_MAX;
+	int enterAxis = -1;
+	for (int i = 0; i < 3; i++)
+	{
+		if (std::fabs(direction[i]) < 0.000001f)
+		{
+			if (std::fabs(local[i]) > collider.halfSize[i])
+			{
+				return(false);
+			}
+			continue;
+		}
+		float low = (-collider.halfSize[i] - local[i]) / direction[i];
+		float high = (collider.halfSize[i] - local[i]) / direction[i];
+		if (low > high)
+		{
+			std::swap(low, high);
+		}
+		if (low > enter)
+		{
+			enter = low;
+			enterAxis = i;
+		}
+		exit = std::min(exit, high);
+	}
+	if ((enterAxis < 0) || (enter > exit) || (enter < 0.0f) || (enter > maxDistance))
+	{
+		return(false);
+	}
+
+	glm::vec3 localNormal(0.0f);
+	localNormal[enterAxis] = (direction[enterAxis] > 0.0f) ? -1.0f : 1.0f;
+	distance = enter;
+	normal = collider.rotation * localNormal;
+	return(true);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the number of queries
+ *  and how many colliders each one tested on average.
+ ***********************************************************/
+void SpatialQuery::PrintStats() const
+{
+	int64_t queries = m_sphereQueries + m_groundQueries;
+	std::cout << "Spatial queries: " << m_colliders.size() << " colliders, " << m_unlisted.size() << " off the grid, "
+		<< m_gridCells.x << "x" << m_gridCells.y << "x" << m_gridCells.z << " cells, "
+		<< m_sphereQueries << " sphere and " << m_groundQueries << " ground queries, "
+		<< ((double)m_testedColliders / (double)std::max(queries, (int64_t)1)) << " colliders tested per query" << std::endl;
+}
+
+/***********************************************************
+ *  RunBenchmark()
+ *
+ *  This method is used for timing the queries against a
+ *  large field of colliders.  Boxes and spheres of mixed
+ *  sizes and turns are scattered over a square, and the
+ *  same random points are queried through the grid and by
+ *  testing every collider, so the two times can be
+ *  compared.
+ ***********************************************************/
+bool SpatialQuery::RunBenchmark(int colliderCount, int queryCount)
+{
+	if ((colliderCount <= 0) || (queryCount <= 0))
+	{
+		std::cout << "The spatial query benchmark needs at least one collider and query" << std::endl;
+		return(false);
+	}
+
+	// a fixed seed, so every run measures the same field
+	std::mt19937 generator(330);
+	float fieldSize = std::sqrt((float)colliderCount) * g_BenchmarkSpacing;
+	std::uniform_real_distribution<float> across(0.0f, fieldSize);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	SpatialQuery query;
+	for (int i = 0; i < colliderCount; i++)
+	{
+		glm::vec3 halfSize(0.5f + (1.5f * unit(generator)), 0.25f + unit(generator), 0.5f + (1.5f * unit(generator)));
+		glm::vec3 center(across(generator), halfSize.y + (2.0f * unit(generator)), across(generator));
+		glm::mat3 rotation = glm::mat3_cast(glm::angleAxis(6.2831853f * unit(generator), glm::vec3(0.0f, 1.0f, 0.0f)));
+		query.AddCollider(((i % 4) == 0) ? COLLIDER_SPHERE : COLLIDER_BOX, center, halfSize, rotation);
+	}
+
+	std::vector<glm::vec3> points(queryCount);
+	for (int i = 0; i < queryCount; i++)
+	{
+		points[i] = glm::vec3(across(generator), 4.0f * unit(generator), across(generator));
+	}
+
+	double milliseconds[2] = { 0.0, 0.0 };
+	int hits[2] = { 0, 0 };
+	for (int run = 0; run < 2; run++)
+	{
+		// the second run takes every collider off the grid, so each
+		// query tests all of them - that is slow, so only a share of
+		// the points is run
+		if (run == 1)
+		{
+			for (int i = 0; i < colliderCount; i++)
+			{
+				query.MoveCollider(i, query.m_colliders[i].center, query.m_colliders[i].rotation);
+			}
+			queryCount = std::max(queryCount / 100, 1);
+		}
+		query.Build();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < queryCount; i++)
+		{
+			glm::vec3 center = points[i];
+			float height;
+			glm::vec3 normal;
+			if (query.ResolveSphere(center, g_BenchmarkRadius))
+			{
+				hits[run]++;
+			}
+			query.FindGround(points[i] + glm::vec3(0.0f, g_BenchmarkDrop * 0.5f, 0.0f), g_BenchmarkDrop, height, normal);
+		}
+		milliseconds[run] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		milliseconds[run] /= (double)queryCount;
+		if (run == 0)
+		{
+			std::cout << "Spatial query benchmark - " << colliderCount << " colliders" << std::endl;
+			query.PrintStats();
+		}
+	}
+
+	std::cout << "  grid: " << (milliseconds[0] * 1000.0) << " us per sphere and ground query pair, "
+		<< hits[0] << " spheres pushed out" << std::endl;
+	std::cout << "  every collider: " << (milliseconds[1] * 1000.0) << " us per pair, "
+		<< (milliseconds[1] / std::max(milliseconds[0], 0.000001)) << "x slower" << std::endl;
+	return(true);
+}
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// spatialquery.h
+// ============
+// find the scene colliders near a point for camera collision and ground tests
+//
+//	The colliders are spheres and oriented boxes fitted around the scene
+//	parts.  The ones that hold still are sorted into a uniform grid once,
+//	so a query only looks at the colliders listed in the few cells it
+//	touches.  Colliders that move, and colliders too large to list in
+//	every cell they cover, are kept in short lists that every query
+//	checks.  A sphere query pushes the sphere out of everything it
+//	overlaps, and a ground query casts a ray straight down and reports
+//	the first surface it hits.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  SpatialQuery
+ *
+ *  This class contains the colliders, the grid they are
+ *  sorted into and the code for querying them.
+ ***********************************************************/
+class SpatialQuery
+{
+public:
+	// shapes of the colliders
+	enum COLLIDER_TYPE
+	{
+		COLLIDER_SPHERE = 0,
+		COLLIDER_BOX
+	};
+
+	// constructor
+	SpatialQuery();
+
+	// add a collider and get its index - the size is the radius of a
+	// sphere in x, or the half size of a box, and the rotation turns the
+	// box axes into world space
+	int AddCollider(int type, const glm::vec3& center, const glm::vec3& halfSize, const glm::mat3& rotation);
+	// move a collider - it is checked by every query from then on
+	void MoveCollider(int collider, const glm::vec3& center, const glm::mat3& rotation);
+	// sort the colliders that hold still into the grid
+	void Build();
+
+	// push a sphere out of the colliders it overlaps and check whether
+	// it was moved
+	bool ResolveSphere(glm::vec3& center, float radius);
+	// cast a ray straight down from a point and get the height and the
+	// normal of the first surface within the drop
+	bool FindGround(const glm::vec3& point, float maxDrop, float& height, glm::vec3& normal);
+
+	// get the number of colliders
+	int GetColliderCount() const { return((int)m_colliders.size()); }
+	// print how many queries were run and how many colliders they tested
+	void PrintStats() const;
+	// time the queries against a large field of colliders and print the
+	// result
+	static bool RunBenchmark(int colliderCount, int queryCount);
+
+private:
+	// one collider
+	struct COLLIDER
+	{
+		int type;
+		glm::vec3 center;
+		glm::vec3 halfSize;
+		glm::mat3 rotation;
+		// world space bounding box
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		// whether the collider is checked by every query instead of
+		// being listed in the grid
+		bool bUnlisted;
+		// query that last tested the collider, so a collider in several
+		// cells is only tested once
+		uint32_t queryStamp;
+	};
+
+	std::vector<COLLIDER> m_colliders;
+	// colliders that are checked by every query
+	std::vector<int> m_unlisted;
+	// grid origin, cell size and cells per axis
+	glm::vec3 m_gridOrigin;
+	float m_cellSize;
+	glm::ivec3 m_gridCells;
+	// first entry of every cell in the collider list, with one more at
+	// the end, and the colliders listed cell after cell
+	std::vector<int> m_cellStarts;
+	std::vector<int> m_cellColliders;
+	// colliders found by the running query
+	std::vector<int> m_candidates;
+	uint32_t m_queryStamp;
+
+	// work done so far
+	int64_t m_sphereQueries;
+	int64_t m_groundQueries;
+	int64_t m_testedColliders;
+
+	// fit the bounding box of a collider
+	static void UpdateBounds(COLLIDER& collider);
+	// get the grid cells a box covers, clamped to the grid
+	void GetCellRange(const glm::vec3& boundsMin, const glm::vec3& boundsMax, glm::ivec3& first, glm::ivec3& last) const;
+	// list the colliders whose bounds overlap a box
+	void GatherCandidates(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+	// get how far a sphere reaches into a collider and the way out
+	static bool GetPenetration(const COLLIDER& collider, const glm::vec3& center, float radius,
+		glm::vec3& normal, float& depth);
+	// get the distance down to a collider along a ray
+	static bool CastDown(const COLLIDER& collider, const glm::vec3& origin, float maxDistance,
+		float& distance, glm::vec3& normal);
+};
@@ -0,0 +1,255 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturebudget.cpp
+// ============
+// pick the resolution every texture is loaded at from a quality tier and a
+// texture memory budget
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureBudget.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// texel density and largest size of every quality tier - the full
+	// tier keeps the source resolution
+	const char* const g_QualityNames[TextureBudget::QUALITY_COUNT] = { "low", "medium", "high", "full" };
+	const float g_TexelsPerUnit[TextureBudget::QUALITY_COUNT] = { 32.0f, 64.0f, 128.0f, 0.0f };
+	const int g_MaxTextureSize[TextureBudget::QUALITY_COUNT] = { 256, 512, 1024, 0 };
+
+	// textures are not reduced below this size to fit the budget
+	const int g_MinTextureSize = 32;
+
+	// get the size of a mip level
+	int GetMipSize(int size, int mip)
+	{
+		int mipSize = size >> mip;
+		return((mipSize > 0) ? mipSize : 1);
+	}
+}
+
+/***********************************************************
+ *  TextureBudget()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureBudget::TextureBudget(int quality, uint64_t budgetBytes)
+{
+	m_quality = ((quality >= 0) && (quality < QUALITY_COUNT)) ? quality : QUALITY_HIGH;
+	m_budgetBytes = budgetBytes;
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for adding a texture to the plan.
+ *  The world size is the largest distance in world units
+ *  that one repeat of the texture is stretched over.
+ ***********************************************************/
+void TextureBudget::AddTexture(const std::string& tag, int width, int height, int colorChannels, float worldSize)
+{
+	TEXTURE_PLAN plan;
+	plan.tag = tag;
+	plan.sourceWidth = width;
+	plan.sourceHeight = height;
+	plan.colorChannels = colorChannels;
+	plan.worldSize = worldSize;
+	plan.startMip = 0;
+	plan.fullBytes = GetTextureBytes(width, height, colorChannels, 0);
+	plan.plannedBytes = plan.fullBytes;
+	m_textures.push_back(plan);
+}
+
+/***********************************************************
+ *  Plan()
+ *
+ *  This method is used for picking the starting mip level of
+ *  every texture.  A texture starts at the smallest level
+ *  that still covers its world size at the texel density of
+ *  the quality tier, and no larger than the tier allows.
+ *  Then the largest textures are reduced one level at a time
+ *  until all of them fit the memory budget.
+ ***********************************************************/
+void TextureBudget::Plan()
+{
+	uint64_t totalBytes = 0;
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		TEXTURE_PLAN& plan = m_textures[i];
+		int largestSize = (plan.sourceWidth > plan.sourceHeight) ? plan.sourceWidth : plan.sourceHeight;
+		plan.startMip = 0;
+
+		if (m_quality != QUALITY_FULL)
+		{
+			// textures that are not mapped on anything use the tier limit
+			int neededSize = (plan.worldSize > 0.0f) ? (int)(plan.worldSize * g_TexelsPerUnit[m_quality]) : g_MaxTextureSize[m_quality];
+			if (neededSize > g_MaxTextureSize[m_quality])
+			{
+				neededSize = g_MaxTextureSize[m_quality];
+			}
+			while ((GetMipSize(largestSize, plan.startMip + 1) >= neededSize) &&
+				(GetMipSize(largestSize, plan.startMip + 1) >= g_MinTextureSize))
+			{
+				plan.startMip++;
+			}
+			while ((GetMipSize(largestSize, plan.startMip) > g_MaxTextureSize[m_quality]) &&
+				(GetMipSize(largestSize, plan.startMip + 1) >= g_MinTextureSize))
+			{
+				plan.startMip++;
+			}
+		}
+
+		plan.plannedBytes = GetTextureBytes(plan.sourceWidth, plan.sourceHeight, plan.colorChannels, plan.startMip);
+		totalBytes += plan.plannedBytes;
+	}
+
+	// reduce the largest texture until everything fits the budget
+	while ((m_budgetBytes > 0) && (totalBytes > m_budgetBytes))
+	{
+		int largest = -1;
+		for (size_t i = 0; i < m_textures.size(); i++)
+		{
+			const TEXTURE_PLAN& plan = m_textures[i];
+			int largestSize = (plan.sourceWidth > plan.sourceHeight) ? plan.sourceWidth : plan.sourceHeight;
+			if ((GetMipSize(largestSize, plan.startMip + 1) >= g_MinTextureSize) &&
+				((largest < 0) || (plan.plannedBytes > m_textures[largest].plannedBytes)))
+			{
+				largest = (int)i;
+			}
+		}
+		if (largest < 0)
+		{
+			std::cout << "Textures do not fit the texture budget of " << (m_budgetBytes / (1024 * 1024)) << " MB" << std::endl;
+			break;
+		}
+
+		TEXTURE_PLAN& plan = m_textures[largest];
+		totalBytes -= plan.plannedBytes;
+		plan.startMip++;
+		plan.plannedBytes = GetTextureBytes(plan.sourceWidth, plan.sourceHeight, plan.colorChannels, plan.startMip);
+		totalBytes += plan.plannedBytes;
+	}
+}
+
+/***********************************************************
+ *  GetStartMip()
+ *
+ *  This method is used for getting the starting mip level
+ *  that was planned for a texture.
+ ***********************************************************/
+int TextureBudget::GetStartMip(const std::string& tag) const
+{
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		if (m_textures[i].tag == tag)
+		{
+			return(m_textures[i].startMip);
+		}
+	}
+	return(0);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the planned size of
+ *  every texture and the memory that was saved.
+ ***********************************************************/
+void TextureBudget::PrintReport() const
+{
+	size_t fullBytes = 0;
+	size_t plannedBytes = 0;
+	char row[160];
+
+	std::cout << "Texture budget - quality:" << GetQualityName(m_quality) << ", budget:";
+	if (m_budgetBytes > 0)
+	{
+		std::cout << (m_budgetBytes / (1024 * 1024)) << " MB" << std::endl;
+	}
+	else
+	{
+		std::cout << "none" << std::endl;
+	}
+	snprintf(row, sizeof(row), "  %-24s %5s %-11s %3s %-11s %9s %9s %9s",
+		"texture", "world", "source", "mip", "loaded", "full KB", "loaded KB", "saved KB");
+	std::cout << row << std::endl;
+
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		const TEXTURE_PLAN& plan = m_textures[i];
+		snprintf(row, sizeof(row), "  %-24s %5.1f %5dx%-5d %3d %5dx%-5d %9zu %9zu %9zu",
+			plan.tag.c_str(), plan.worldSize,
+			plan.sourceWidth, plan.sourceHeight, plan.startMip,
+			GetMipSize(plan.sourceWidth, plan.startMip), GetMipSize(plan.sourceHeight, plan.startMip),
+			plan.fullBytes / 1024, plan.plannedBytes / 1024, (plan.fullBytes - plan.plannedBytes) / 1024);
+		std::cout << row << std::endl;
+		fullBytes += plan.fullBytes;
+		plannedBytes += plan.plannedBytes;
+	}
+
+	snprintf(row, sizeof(row), "  %-58s %9zu %9zu %9zu", "total", fullBytes / 1024, plannedBytes / 1024, (fullBytes - plannedBytes) / 1024);
+	std::cout << row << std::endl;
+}
+
+/***********************************************************
+ *  GetQualityName()
+ *
+ *  This method is used for getting the display name of a
+ *  quality tier.
+ ***********************************************************/
+const char* TextureBudget::GetQualityName(int quality)
+{
+	if ((quality < 0) || (quality >= QUALITY_COUNT))
+	{
+		return("unknown");
+	}
+	return(g_QualityNames[quality]);
+}
+
+/***********************************************************
+ *  FindQuality()
+ *
+ *  This method is used for finding a quality tier by its
+ *  display name.  -1 is returned for unknown names.
+ ***********************************************************/
+int TextureBudget::FindQuality(const char* name)
+{
+	for (int quality = 0; quality < QUALITY_COUNT; quality++)
+	{
+		if (strcmp(name, g_QualityNames[quality]) == 0)
+		{
+			return(quality);
+		}
+	}
+	return(-1);
+}
+
+/***********************************************************
+ *  GetTextureBytes()
+ *
+ *  This method is used for getting the memory of a texture
+ *  and its whole mipmap chain from a starting level.  RGB
+ *  textures are counted at four bytes per texel, since that
+ *  is how drivers store them.
+ ***********************************************************/
+size_t TextureBudget::GetTextureBytes(int width, int height, int colorChannels, int startMip)
+{
+	size_t texelBytes = (colorChannels == 3) ? 4 : (size_t)colorChannels;
+	size_t bytes = 0;
+	int mip = startMip;
+	while (true)
+	{
+		int mipWidth = GetMipSize(width, mip);
+		int mipHeight = GetMipSize(height, mip);
+		bytes += (size_t)mipWidth * mipHeight * texelBytes;
+		if ((mipWidth == 1) && (mipHeight == 1))
+		{
+			break;
+		}
+		mip++;
+	}
+	return(bytes);
+}
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturebudget.h
+// ============
+// pick the resolution every texture is loaded at from a quality tier and a
+// texture memory budget
+//
+//	Every texture starts at the smallest mip level that still gives the
+//	quality tier's texel density over the largest surface it is mapped on.
+//	When the textures together do not fit the memory budget, the largest
+//	ones are reduced by another level until they do.  The levels above the
+//	starting level are never decoded or uploaded.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureBudget
+ *
+ *  This class plans the starting mip level of the textures
+ *  and reports the memory that was saved.
+ ***********************************************************/
+class TextureBudget
+{
+public:
+	// quality tiers, from the least to the most texture memory
+	enum TEXTURE_QUALITY
+	{
+		QUALITY_LOW = 0,
+		QUALITY_MEDIUM,
+		QUALITY_HIGH,
+		QUALITY_FULL,
+		QUALITY_COUNT
+	};
+
+	// planned resolution of one texture
+	struct TEXTURE_PLAN
+	{
+		std::string tag;
+		int sourceWidth;
+		int sourceHeight;
+		int colorChannels;
+		float worldSize;
+		int startMip;
+		size_t fullBytes;
+		size_t plannedBytes;
+	};
+
+	// constructor - a budget of zero bytes means no limit
+	TextureBudget(int quality, uint64_t budgetBytes);
+
+	// add a texture with the largest world size one repeat of it covers
+	void AddTexture(const std::string& tag, int width, int height, int colorChannels, float worldSize);
+	// pick the starting mip level of every added texture
+	void Plan();
+	// get the starting mip level planned for a texture, or zero
+	int GetStartMip(const std::string& tag) const;
+	// print the planned size and the memory saved for every texture
+	void PrintReport() const;
+
+	// get the display name of a quality tier
+	static const char* GetQualityName(int quality);
+	// find a quality tier by its display name, or -1
+	static int FindQuality(const char* name);
+	// get the memory of a texture and its mipmaps from a starting level
+	static size_t GetTextureBytes(int width, int height, int colorChannels, int startMip);
+
+private:
+	int m_quality;
+	uint64_t m_budgetBytes;
+	std::vector<TEXTURE_PLAN> m_textures;
+};
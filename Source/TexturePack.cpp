@@ -0,0 +1,199 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturepack.cpp
+// ============
+// pack decoded texture pixels into compressed asset pack files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TexturePack.h"
+#include "AssetPack.h"
+#include "ImageDecoder.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+// declaration of global variables
+namespace
+{
+	// chunk types used by texture pack files
+	const uint32_t CHUNK_TEXTURE_TABLE = ASSETPACK_FOURCC('T', 'X', 'T', 'B');
+	const uint32_t CHUNK_TEXTURE_PIXELS = ASSETPACK_FOURCC('T', 'X', 'P', 'X');
+
+	// Zstd level for packs - cooking is slow, but loading is not
+	const int g_ZstdPackLevel = 19;
+}
+
+/***********************************************************
+ *  WritePack()
+ *
+ *  This method is used for decoding texture image files and
+ *  writing their pixels into a pack file, with every pixel
+ *  chunk compressed on its own.  Images are flipped the same
+ *  way as the textures loaded by the scene.
+ ***********************************************************/
+bool TexturePack::WritePack(const char* filename, const std::vector<TEXTURE_SOURCE>& sources, int compression, int level)
+{
+	if (AssetPack::IsCompressionSupported(compression) == false)
+	{
+		std::cout << "Compression is not built in:" << AssetPack::GetCompressionName(compression) << std::endl;
+		return(false);
+	}
+
+	AssetPackWriter pack;
+	ChunkWriter table;
+	table.Write((uint32_t)sources.size());
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		std::ifstream file(sources[i].filename, std::ios::in | std::ios::binary);
+		std::vector<unsigned char> fileBytes(
+			(std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		DECODED_IMAGE image;
+		if ((fileBytes.size() == 0) ||
+			(ImageDecoder::DecodeImage(fileBytes.data(), fileBytes.size(), 1, image) == false))
+		{
+			std::cout << "Could not load image:" << sources[i].filename << std::endl;
+			return(false);
+		}
+
+		// the pixel chunks are added in source order, before the table
+		table.WriteString(sources[i].tag);
+		table.Write((int32_t)image.width);
+		table.Write((int32_t)image.height);
+		table.Write((int32_t)image.colorChannels);
+		table.Write((uint32_t)i);
+
+		pack.AddChunk(CHUNK_TEXTURE_PIXELS, image.pixels.data(), image.pixels.size(), compression, level);
+	}
+
+	pack.AddChunk(CHUNK_TEXTURE_TABLE, table.GetData().data(), table.GetData().size());
+
+	return(pack.WriteToFile(filename));
+}
+
+/***********************************************************
+ *  GetDefaultLevel()
+ *
+ *  This method is used for getting the compression level
+ *  that packs are written with.  LZ4 uses its fast mode,
+ *  and Zstd uses a high level for dense packs.
+ ***********************************************************/
+int TexturePack::GetDefaultLevel(int compression)
+{
+	if (compression == AssetPack::COMPRESSION_ZSTD)
+	{
+		return(g_ZstdPackLevel);
+	}
+	return(0);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for opening a pack file and reading
+ *  its texture table.  The pixel chunks are not read.
+ ***********************************************************/
+bool TexturePack::Open(const char* filename)
+{
+	m_filename = filename;
+	m_textures.clear();
+	m_fileSize = 0;
+
+	AssetPackReader reader;
+	std::vector<unsigned char> payload;
+	if ((reader.Open(filename) == false) ||
+		(reader.ReadChunk(reader.FindChunk(CHUNK_TEXTURE_TABLE), payload) == false))
+	{
+		std::cout << "Could not open texture pack:" << filename << std::endl;
+		return(false);
+	}
+	m_fileSize = reader.GetFileSize();
+
+	ChunkReader table(payload.data(), payload.size());
+	uint32_t textureCount = 0;
+	if (table.Read(textureCount) == false)
+	{
+		std::cout << "Corrupt texture pack table:" << filename << std::endl;
+		return(false);
+	}
+
+	for (uint32_t i = 0; i < textureCount; i++)
+	{
+		PACKED_TEXTURE texture;
+		int32_t values[3] = { 0, 0, 0 };
+		uint32_t chunkIndex = 0;
+		if ((table.ReadString(texture.tag) == false) ||
+			(table.Read(values) == false) ||
+			(table.Read(chunkIndex) == false) ||
+			(values[0] <= 0) || (values[1] <= 0) || (values[2] <= 0) ||
+			(chunkIndex >= (uint32_t)reader.GetChunkCount()) ||
+			(reader.GetChunk(chunkIndex).type != CHUNK_TEXTURE_PIXELS) ||
+			(reader.GetChunk(chunkIndex).rawSize != (uint64_t)values[0] * values[1] * values[2]))
+		{
+			std::cout << "Corrupt texture pack table:" << filename << std::endl;
+			m_textures.clear();
+			return(false);
+		}
+
+		texture.width = values[0];
+		texture.height = values[1];
+		texture.colorChannels = values[2];
+		texture.chunkIndex = (int)chunkIndex;
+		texture.pixelBytes = (size_t)reader.GetChunk(chunkIndex).rawSize;
+		m_textures.push_back(texture);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DecompressTexture()
+ *
+ *  This method is used for reading the pixel chunk of a
+ *  texture and decompressing it straight into the passed in
+ *  memory.  No OpenGL calls are made, and every call uses its
+ *  own reader, so textures can be decompressed in parallel
+ *  on the worker threads.
+ ***********************************************************/
+bool TexturePack::DecompressTexture(int index, void* pPixels) const
+{
+	if ((index < 0) || (index >= (int)m_textures.size()) || (NULL == pPixels))
+	{
+		return(false);
+	}
+
+	const PACKED_TEXTURE& texture = m_textures[index];
+	AssetPackReader reader;
+	std::vector<unsigned char> stored;
+	if ((reader.Open(m_filename.c_str()) == false) ||
+		(texture.chunkIndex >= reader.GetChunkCount()) ||
+		(reader.ReadStoredChunk(texture.chunkIndex, stored) == false))
+	{
+		std::cout << "Could not read texture from pack:" << texture.tag << std::endl;
+		return(false);
+	}
+
+	if (AssetPack::DecompressBytes(reader.GetChunkCompression(texture.chunkIndex),
+		stored.data(), stored.size(), pPixels, texture.pixelBytes) == false)
+	{
+		std::cout << "Could not decompress texture from pack:" << texture.tag << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetPixelBytes()
+ *
+ *  This method is used for getting the total decompressed
+ *  size of all the textures in the pack.
+ ***********************************************************/
+size_t TexturePack::GetPixelBytes() const
+{
+	size_t pixelBytes = 0;
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		pixelBytes += m_textures[i].pixelBytes;
+	}
+	return(pixelBytes);
+}
@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturepack.h
+// ============
+// pack decoded texture pixels into compressed asset pack files
+//
+//	A texture pack holds a table chunk with the size and tag of every
+//	texture, followed by one pixel chunk per texture.  The pixel chunks are
+//	compressed one by one, so they can be decompressed in parallel, each
+//	straight into its own upload buffer.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TexturePack
+ *
+ *  This class writes texture packs, and reads their texture
+ *  table.  Decompressing a texture opens its own reader, so
+ *  several textures can be decompressed at the same time.
+ ***********************************************************/
+class TexturePack
+{
+public:
+	// texture image file and the tag it is registered with
+	struct TEXTURE_SOURCE
+	{
+		std::string filename;
+		std::string tag;
+	};
+
+	// one texture stored in the pack
+	struct PACKED_TEXTURE
+	{
+		std::string tag;
+		int width;
+		int height;
+		int colorChannels;
+		int chunkIndex;
+		size_t pixelBytes;
+	};
+
+	// decode texture image files and write their pixels into a pack file
+	static bool WritePack(const char* filename, const std::vector<TEXTURE_SOURCE>& sources, int compression, int level);
+	// get the compression level used for packs - Zstd packs favor size
+	static int GetDefaultLevel(int compression);
+
+	// open a pack file and read its texture table
+	bool Open(const char* filename);
+	// read and decompress the pixels of a texture into memory that
+	// holds the pixel bytes of the texture, like a mapped upload buffer
+	bool DecompressTexture(int index, void* pPixels) const;
+
+	int GetTextureCount() const { return((int)m_textures.size()); }
+	const PACKED_TEXTURE& GetTexture(int index) const { return(m_textures[index]); }
+	// get the total decompressed size of all the textures
+	size_t GetPixelBytes() const;
+	// get the size of the pack file on disk
+	uint64_t GetFileSize() const { return(m_fileSize); }
+
+private:
+	// pack file the table was read from
+	std::string m_filename;
+	// textures listed in the table
+	std::vector<PACKED_TEXTURE> m_textures;
+	uint64_t m_fileSize = 0;
+};
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestorage.cpp
+// ============
+// create scene textures with immutable storage and a full mipmap chain
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureStorage.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  CreateTexture2D()
+ *
+ *  This method is used for creating a texture with storage
+ *  for the whole mipmap chain, copying the pixels into the
+ *  top level and generating the other levels.  Drivers that
+ *  do not have immutable storage get the same levels through
+ *  glTexImage2D.  Zero is returned for unsupported formats.
+ ***********************************************************/
+GLuint TextureStorage::CreateTexture2D(int width, int height, int colorChannels, const void* pPixels)
+{
+	GLuint textureID = 0;
+
+	if ((colorChannels != 3) && (colorChannels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		return(0);
+	}
+
+	// RGB images are stored as RGB8, RGBA images support transparency
+	GLenum internalFormat = (colorChannels == 3) ? GL_RGB8 : GL_RGBA8;
+	GLenum format = (colorChannels == 3) ? GL_RGB : GL_RGBA;
+	int levelCount = GetMipLevelCount(width, height);
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	if (GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levelCount, internalFormat, width, height);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+
+	UploadTexture2D(textureID, width, height, colorChannels, pPixels);
+
+	return(textureID);
+}
+
+/***********************************************************
+ *  UploadTexture2D()
+ *
+ *  This method is used for copying new pixels into the top
+ *  level of a texture created by CreateTexture2D() with the
+ *  same size and channel count, and generating the other
+ *  levels from it.
+ ***********************************************************/
+void TextureStorage::UploadTexture2D(GLuint textureID, int width, int height, int colorChannels, const void* pPixels)
+{
+	GLenum format = (colorChannels == 3) ? GL_RGB : GL_RGBA;
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, pPixels);
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+}
+
+/***********************************************************
+ *  GetMipLevelCount()
+ *
+ *  This method is used for getting the number of mipmap
+ *  levels from the full size down to one texel.
+ ***********************************************************/
+int TextureStorage::GetMipLevelCount(int width, int height)
+{
+	int largestSize = (width > height) ? width : height;
+	int levelCount = 1;
+	while (largestSize > 1)
+	{
+		largestSize >>= 1;
+		levelCount++;
+	}
+	return(levelCount);
+}
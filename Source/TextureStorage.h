@@ -0,0 +1,30 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestorage.h
+// ============
+// create scene textures with immutable storage and a full mipmap chain
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  TextureStorage
+ *
+ *  This class contains the code for creating 2D textures
+ *  whose storage is allocated once with all of its mipmap
+ *  levels.  Such textures are always complete, so the driver
+ *  can skip the completeness checks when they are bound.
+ *  Filtering and wrapping come from sampler objects.
+ ***********************************************************/
+class TextureStorage
+{
+public:
+	// create a texture from pixels, or from the bound pixel unpack
+	// buffer in which case the pointer is the buffer offset
+	static GLuint CreateTexture2D(int width, int height, int colorChannels, const void* pPixels);
+	// replace the pixels of a texture with the same size and channels
+	static void UploadTexture2D(GLuint textureID, int width, int height, int colorChannels, const void* pPixels);
+	// get the number of mipmap levels down to one texel
+	static int GetMipLevelCount(int width, int height);
+};
@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////
+// tracelog.cpp
+// ============
+// record timed events from any thread and write them as a trace file
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TraceLog.h"
+
+#include <fstream>
+#include <iostream>
+
+std::mutex TraceLog::s_mutex;
+bool TraceLog::s_bRecording = false;
+std::chrono::steady_clock::time_point TraceLog::s_startTime = std::chrono::steady_clock::now();
+std::vector<TraceLog::TRACE_EVENT> TraceLog::s_events;
+std::map<std::thread::id, int> TraceLog::s_threadIndices;
+std::map<int, std::string> TraceLog::s_threadNames;
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  WriteJSONString()
+	 *
+	 *  This function is used for writing a string value into
+	 *  the trace file with the JSON special characters escaped.
+	 ***********************************************************/
+	void WriteJSONString(std::ofstream& file, const std::string& value)
+	{
+		file << '"';
+		for (size_t i = 0; i < value.size(); i++)
+		{
+			char c = value[i];
+			if ((c == '"') || (c == '\\'))
+			{
+				file << '\\' << c;
+			}
+			else if ((unsigned char)c < 0x20)
+			{
+				file << ' ';
+			}
+			else
+			{
+				file << c;
+			}
+		}
+		file << '"';
+	}
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting to record events.  The
+ *  times of all events are relative to this call.
+ ***********************************************************/
+void TraceLog::Start()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_events.clear();
+	s_startTime = std::chrono::steady_clock::now();
+	s_bRecording = true;
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for stopping the recording and
+ *  dropping all of the recorded events.
+ ***********************************************************/
+void TraceLog::Reset()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_events.clear();
+	s_bRecording = false;
+}
+
+/***********************************************************
+ *  IsRecording()
+ *
+ *  This method is used for checking whether events are being
+ *  recorded.
+ ***********************************************************/
+bool TraceLog::IsRecording()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return(s_bRecording);
+}
+
+/***********************************************************
+ *  GetMicroseconds()
+ *
+ *  This method is used for getting the time since recording
+ *  was started in microseconds.
+ ***********************************************************/
+int64_t TraceLog::GetMicroseconds()
+{
+	return(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - s_startTime).count());
+}
+
+/***********************************************************
+ *  AddEvent()
+ *
+ *  This method is used for recording a finished event on the
+ *  calling thread.  Nothing is recorded until Start() has
+ *  been called.
+ ***********************************************************/
+void TraceLog::AddEvent(const char* name, const char* category, int64_t startMicroseconds, int64_t durationMicroseconds)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	if (s_bRecording == false)
+	{
+		return;
+	}
+
+	TRACE_EVENT event;
+	event.name = name;
+	event.category = category;
+	event.start = startMicroseconds;
+	event.duration = durationMicroseconds;
+	event.threadIndex = GetThreadIndex();
+	s_events.push_back(event);
+}
+
+/***********************************************************
+ *  SetThreadName()
+ *
+ *  This method is used for naming the calling thread, so its
+ *  row in the trace timeline can be recognized.
+ ***********************************************************/
+void TraceLog::SetThreadName(const char* name)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_threadNames[GetThreadIndex()] = name;
+}
+
+/***********************************************************
+ *  GetThreadIndex()
+ *
+ *  This method is used for mapping the calling thread to a
+ *  small index for the trace file.  The mutex must already
+ *  be held by the caller.
+ ***********************************************************/
+int TraceLog::GetThreadIndex()
+{
+	std::thread::id threadID = std::this_thread::get_id();
+	std::map<std::thread::id, int>::iterator it = s_threadIndices.find(threadID);
+	if (it != s_threadIndices.end())
+	{
+		return(it->second);
+	}
+
+	int threadIndex = (int)s_threadIndices.size();
+	s_threadIndices[threadID] = threadIndex;
+	return(threadIndex);
+}
+
+/***********************************************************
+ *  WriteToFile()
+ *
+ *  This method is used for writing all of the recorded
+ *  events into a trace file in the Chrome trace event format.
+ ***********************************************************/
+bool TraceLog::WriteToFile(const char* filename)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	std::ofstream file(filename, std::ios::out | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not write trace file:" << filename << std::endl;
+		return(false);
+	}
+
+	file << "{\"traceEvents\":[\n";
+	bool bFirst = true;
+	for (std::map<int, std::string>::const_iterator it = s_threadNames.begin(); it != s_threadNames.end(); ++it)
+	{
+		file << (bFirst ? "" : ",\n");
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << it->first << ",\"args\":{\"name\":";
+		WriteJSONString(file, it->second);
+		file << "}}";
+		bFirst = false;
+	}
+	for (size_t i = 0; i < s_events.size(); i++)
+	{
+		const TRACE_EVENT& event = s_events[i];
+		file << (bFirst ? "" : ",\n");
+		file << "{\"name\":";
+		WriteJSONString(file, event.name);
+		file << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadIndex
+			<< ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+		bFirst = false;
+	}
+	file << "\n]}\n";
+
+	std::cout << "Wrote " << s_events.size() << " trace events to " << filename << std::endl;
+	return(true);
+}
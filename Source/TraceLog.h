@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// tracelog.h
+// ============
+// record timed events from any thread and write them as a trace file
+//
+//	Events are written in the Chrome trace event JSON format, so a trace
+//	can be opened in chrome://tracing or ui.perfetto.dev to see a timeline
+//	of what every thread was doing.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TraceLog
+ *
+ *  This class collects timed events for the trace file.  All
+ *  of the methods are safe to call from any thread.
+ ***********************************************************/
+class TraceLog
+{
+public:
+	// start recording - event times are relative to this call
+	static void Start();
+	// stop recording and drop the recorded events
+	static void Reset();
+	// check whether events are being recorded
+	static bool IsRecording();
+
+	// get the time since recording started in microseconds
+	static int64_t GetMicroseconds();
+	// record an event that started at the passed in time
+	static void AddEvent(const char* name, const char* category, int64_t startMicroseconds, int64_t durationMicroseconds);
+	// name the calling thread in the trace timeline
+	static void SetThreadName(const char* name);
+
+	// write all recorded events into a trace file
+	static bool WriteToFile(const char* filename);
+
+private:
+	// one recorded event
+	struct TRACE_EVENT
+	{
+		std::string name;
+		const char* category;
+		int64_t start;
+		int64_t duration;
+		int threadIndex;
+	};
+
+	// get the small trace index for the calling thread
+	static int GetThreadIndex();
+
+	static std::mutex s_mutex;
+	static bool s_bRecording;
+	static std::chrono::steady_clock::time_point s_startTime;
+	static std::vector<TRACE_EVENT> s_events;
+	static std::map<std::thread::id, int> s_threadIndices;
+	static std::map<int, std::string> s_threadNames;
+};
+
+/***********************************************************
+ *  TraceScope
+ *
+ *  This class records an event covering the lifetime of the
+ *  object, so that a block of code can be traced by
+ *  declaring one at the top of it.
+ ***********************************************************/
+class TraceScope
+{
+public:
+	TraceScope(const char* name, const char* category = "scene")
+		: m_name(name), m_category(category), m_start(TraceLog::GetMicroseconds()) {}
+	~TraceScope()
+	{
+		TraceLog::AddEvent(m_name.c_str(), m_category, m_start, TraceLog::GetMicroseconds() - m_start);
+	}
+
+private:
+	std::string m_name;
+	const char* m_category;
+	int64_t m_start;
+};
@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformsystem.cpp
+// ============
+// work out the per-draw transform matrices on the CPU with SIMD math
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformSystem.h"
+
+#include <cstdint>
+
+// x64 builds always have SSE, and 32-bit builds have it when it is
+// switched on with /arch or -msse
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#include <xmmintrin.h>
+#define TRANSFORM_SIMD 1
+#endif
+
+/***********************************************************
+ *  IsSimdEnabled()
+ *
+ *  This method is used for checking whether the matrix
+ *  products were built with SSE instructions.
+ ***********************************************************/
+bool TransformSystem::IsSimdEnabled()
+{
+#ifdef TRANSFORM_SIMD
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  MultiplyMatrices()
+ *
+ *  This method is used for multiplying two column major
+ *  matrices.  Every column of the result is the sum of the
+ *  left columns scaled by the values of the right column,
+ *  which is four multiplies and adds of whole columns.  The
+ *  result may be the same matrix as one of the inputs.
+ ***********************************************************/
+void TransformSystem::MultiplyMatrices(const glm::mat4& left, const glm::mat4& right, glm::mat4& result)
+{
+#ifdef TRANSFORM_SIMD
+	const float* pLeft = &left[0][0];
+	const float* pRight = &right[0][0];
+	__m128 leftColumns[4];
+	for (int i = 0; i < 4; i++)
+	{
+		leftColumns[i] = _mm_loadu_ps(pLeft + (i * 4));
+	}
+
+	__m128 columns[4];
+	for (int column = 0; column < 4; column++)
+	{
+		const float* pColumn = pRight + (column * 4);
+		__m128 sum = _mm_mul_ps(leftColumns[0], _mm_set1_ps(pColumn[0]));
+		sum = _mm_add_ps(sum, _mm_mul_ps(leftColumns[1], _mm_set1_ps(pColumn[1])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(leftColumns[2], _mm_set1_ps(pColumn[2])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(leftColumns[3], _mm_set1_ps(pColumn[3])));
+		columns[column] = sum;
+	}
+
+	// the inputs are all read before the result is written
+	float* pResult = &result[0][0];
+	for (int i = 0; i < 4; i++)
+	{
+		_mm_storeu_ps(pResult + (i * 4), columns[i]);
+	}
+#else
+	result = left * right;
+#endif
+}
+
+/***********************************************************
+ *  ComputeNormalMatrix()
+ *
+ *  This method is used for working out the matrix that
+ *  turns the normals of a model.  The inverse transpose of
+ *  a 3x3 matrix has the cross products of its column pairs
+ *  as columns, divided by the determinant, so scaled
+ *  objects keep their normals at right angles to their
+ *  surfaces.  The fourth row and column are left at zero,
+ *  since the shader only reads the 3x3 part.
+ ***********************************************************/
+void TransformSystem::ComputeNormalMatrix(const glm::mat4& model, glm::mat4& normalMatrix)
+{
+	glm::vec3 columnX = glm::vec3(model[0]);
+	glm::vec3 columnY = glm::vec3(model[1]);
+	glm::vec3 columnZ = glm::vec3(model[2]);
+	glm::vec3 crossYZ = glm::cross(columnY, columnZ);
+	glm::vec3 crossZX = glm::cross(columnZ, columnX);
+	glm::vec3 crossXY = glm::cross(columnX, columnY);
+
+	// a flattened object has no normal matrix, so keep its rotation
+	float determinant = glm::dot(columnX, crossYZ);
+	float scale = (determinant != 0.0f) ? (1.0f / determinant) : 1.0f;
+
+	normalMatrix = glm::mat4(0.0f);
+	normalMatrix[0] = glm::vec4(crossYZ * scale, 0.0f);
+	normalMatrix[1] = glm::vec4(crossZX * scale, 0.0f);
+	normalMatrix[2] = glm::vec4(crossXY * scale, 0.0f);
+}
+
+/***********************************************************
+ *  TransformDraws()
+ *
+ *  This method is used for working out the model-view-
+ *  projection matrix of every draw in an array, after the
+ *  camera has moved.  The normal matrices only depend on
+ *  the models, so they are not touched here.
+ ***********************************************************/
+void TransformSystem::TransformDraws(
+	const glm::mat4& viewProjection,
+	void* pDraws,
+	size_t drawCount,
+	size_t drawBytes,
+	size_t modelOffset,
+	size_t resultOffset)
+{
+	uint8_t* pDraw = (uint8_t*)pDraws;
+	for (size_t i = 0; i < drawCount; i++, pDraw += drawBytes)
+	{
+		const glm::mat4* pModel = (const glm::mat4*)(pDraw + modelOffset);
+		glm::mat4* pResult = (glm::mat4*)(pDraw + resultOffset);
+		MultiplyMatrices(viewProjection, *pModel, *pResult);
+	}
+}
@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformsystem.h
+// ============
+// work out the per-draw transform matrices on the CPU with SIMD math
+//
+//	The vertex shader used to multiply the projection, view and model
+//	matrices for every vertex, and passed the normals on without rotating
+//	them.  The model-view-projection matrix and the normal matrix are now
+//	worked out once per draw here and written into the per-draw values, so
+//	the vertex shader only does one matrix-vector multiply for the clip
+//	position.  The matrix products use SSE when the compiler targets it.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+/***********************************************************
+ *  TransformSystem
+ *
+ *  This class contains the code for working out the
+ *  transform matrices of the draws.
+ ***********************************************************/
+class TransformSystem
+{
+public:
+	// check whether the matrix products use SIMD instructions
+	static bool IsSimdEnabled();
+
+	// multiply two matrices, result = left * right
+	static void MultiplyMatrices(const glm::mat4& left, const glm::mat4& right, glm::mat4& result);
+	// work out the inverse transpose of the upper 3x3 of a model matrix,
+	// in the first three columns of a 4x4 matrix
+	static void ComputeNormalMatrix(const glm::mat4& model, glm::mat4& normalMatrix);
+	// work out the model-view-projection matrices of an array of draws,
+	// with the model and result matrices found at the passed in byte
+	// offsets of every draw
+	static void TransformDraws(
+		const glm::mat4& viewProjection,
+		void* pDraws,
+		size_t drawCount,
+		size_t drawBytes,
+		size_t modelOffset,
+		size_t resultOffset);
+};
@@ -8,12 +8,16 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "SpatialQuery.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <algorithm>
+#include <cmath>
+
 // declaration of the global variables and defines
 namespace
 {
@@ -32,6 +36,17 @@ namespace
 	float gLastFrame = 0.0f;
 
 	bool bOrthographicProjection = false;
+
+	// radius of the sphere the camera collides as, and the most steps
+	// a frame of camera movement is split into
+	const float g_CameraRadius = 0.5f;
+	const int g_MaxCollisionSteps = 32;
+	// height the walking camera climbs onto in one go, how far down it
+	// looks for the ground, and the smallest up part of a normal it
+	// can stand on
+	const float g_WalkStepHeight = 3.0f;
+	const float g_WalkMaxDrop = 50.0f;
+	const float g_WalkableNormalY = 0.7f;
 }
 
 /***********************************************************
@@ -41,6 +56,11 @@ ViewManager::ViewManager(ShaderManager* pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_pSpatialQuery = NULL;
+	m_bWalk = false;
+	m_walkHeight = -1.0f;
 	g_pCamera = new Camera();
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
 	g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
@@ -56,6 +76,7 @@ ViewManager::~ViewManager()
 {
 	m_pShaderManager = NULL;
 	m_pWindow = NULL;
+	m_pSpatialQuery = NULL;
 	if (g_pCamera)
 	{
 		delete g_pCamera;
@@ -63,6 +84,28 @@ ViewManager::~ViewManager()
 	}
 }
 
+/***********************************************************
+ *  GetCamera()
+ ***********************************************************/
+Camera* ViewManager::GetCamera() const
+{
+	return(g_pCamera);
+}
+
+/***********************************************************
+ *  SetCameraCollision()
+ *
+ *  This method is used for setting the colliders that the
+ *  camera is kept out of.  The walking height is measured
+ *  again on the next frame.
+ ***********************************************************/
+void ViewManager::SetCameraCollision(SpatialQuery* pSpatialQuery, bool bWalk)
+{
+	m_pSpatialQuery = pSpatialQuery;
+	m_bWalk = bWalk;
+	m_walkHeight = -1.0f;
+}
+
 /***********************************************************
  *  CreateDisplayWindow()
  ***********************************************************/
@@ -150,11 +193,21 @@ void ViewManager::ProcessKeyboardEvents()
 	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
 		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime * g_pCamera->MovementSpeed);
 
-	// Up and Down
+	// Up and Down - a walking camera changes its height above the ground
 	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime * g_pCamera->MovementSpeed);
+	{
+		if ((m_bWalk) && (m_walkHeight >= 0.0f))
+			m_walkHeight += gDeltaTime * g_pCamera->MovementSpeed;
+		else
+			g_pCamera->ProcessKeyboard(UP, gDeltaTime * g_pCamera->MovementSpeed);
+	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime * g_pCamera->MovementSpeed);
+	{
+		if ((m_bWalk) && (m_walkHeight >= 0.0f))
+			m_walkHeight = std::max(m_walkHeight - (gDeltaTime * g_pCamera->MovementSpeed), g_CameraRadius);
+		else
+			g_pCamera->ProcessKeyboard(DOWN, gDeltaTime * g_pCamera->MovementSpeed);
+	}
 
 	// Check for perspective and orthographic projection switching
 	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
@@ -179,7 +232,14 @@ void ViewManager::PrepareSceneView()
 	gDeltaTime = currentFrame - gLastFrame;
 	gLastFrame = currentFrame;
 
+	// the collisions are resolved before the view is built, so the
+	// frame is drawn from where the camera ends up
+	glm::vec3 previousPosition = g_pCamera->Position;
 	ProcessKeyboardEvents();
+	if (NULL != m_pSpatialQuery)
+	{
+		ResolveCameraCollision(previousPosition);
+	}
 
 	view = g_pCamera->GetViewMatrix();
 
@@ -191,6 +251,10 @@ void ViewManager::PrepareSceneView()
 		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
 	}
 
+	// keep the matrices for passes that use other shaders
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+
 	if (m_pShaderManager)
 	{
 		m_pShaderManager->setMat4Value(g_ViewName, view);
@@ -198,3 +262,49 @@ void ViewManager::PrepareSceneView()
 		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
 	}
 }
+
+/***********************************************************
+ *  ResolveCameraCollision()
+ *
+ *  This method is used for keeping the camera out of the
+ *  scene colliders.  The movement of the frame is split
+ *  into steps no longer than the camera radius, and the
+ *  camera is pushed out after each one, so a fast camera
+ *  cannot pass through the thin cover of the book between
+ *  two frames.  A walking camera is then set at its height
+ *  above the ground under it, which it can step up onto
+ *  when the rise is small enough.
+ ***********************************************************/
+void ViewManager::ResolveCameraCollision(const glm::vec3& previousPosition)
+{
+	glm::vec3 motion = g_pCamera->Position - previousPosition;
+	int steps = (int)std::ceil(glm::length(motion) / g_CameraRadius);
+	steps = std::min(std::max(steps, 1), g_MaxCollisionSteps);
+
+	glm::vec3 position = previousPosition;
+	for (int step = 0; step < steps; step++)
+	{
+		position += motion / (float)steps;
+		m_pSpatialQuery->ResolveSphere(position, g_CameraRadius);
+	}
+
+	if (m_bWalk)
+	{
+		float feet = (m_walkHeight >= 0.0f) ? (position.y - m_walkHeight) : position.y;
+		glm::vec3 probe(position.x, feet + g_WalkStepHeight, position.z);
+		float ground = 0.0f;
+		glm::vec3 normal;
+		if ((m_pSpatialQuery->FindGround(probe, g_WalkStepHeight + g_WalkMaxDrop, ground, normal)) &&
+			(normal.y >= g_WalkableNormalY))
+		{
+			// the first frame keeps the height the camera starts at
+			if (m_walkHeight < 0.0f)
+			{
+				m_walkHeight = std::max(position.y - ground, g_CameraRadius);
+			}
+			position.y = ground + m_walkHeight;
+		}
+	}
+
+	g_pCamera->Position = position;
+}
@@ -12,9 +12,13 @@
 #include "ShaderManager.h"
 #include "camera.h"
 
+#include <glm/glm.hpp>
+
 // GLFW library
 #include "GLFW/glfw3.h"
 
+class SpatialQuery;
+
 class ViewManager
 {
 public:
@@ -39,10 +43,37 @@ public:
 	// mouse scroll callback for zoom and speed adjustment (this is the new part)
 	static void Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset);
 
+	// get the camera used for viewing the 3D scene
+	Camera* GetCamera() const;
+
+	// keep the camera out of the scene colliders - when walking, the
+	// camera also stays at its height above the ground under it, and
+	// Q and E raise and lower that height
+	void SetCameraCollision(SpatialQuery* pSpatialQuery, bool bWalk);
+
+	// get the view and projection matrices used for the current frame
+	const glm::mat4& GetViewMatrix() const { return(m_viewMatrix); }
+	const glm::mat4& GetProjectionMatrix() const { return(m_projectionMatrix); }
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+
+	// matrices calculated for the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+
+	// colliders the camera is kept out of, or NULL
+	SpatialQuery* m_pSpatialQuery;
+	// whether the camera walks over the ground, and its height above
+	// the ground - measured on the first frame
+	bool m_bWalk;
+	float m_walkHeight;
+
+	// move the camera from where it was in steps, pushing it out of the
+	// colliders, and set it on the ground when walking
+	void ResolveCameraCollision(const glm::vec3& previousPosition);
 };
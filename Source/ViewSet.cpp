@@ -0,0 +1,215 @@
+///////////////////////////////////////////////////////////////////////////////
+// viewset.cpp
+// ============
+// several views of the scene drawn side by side in one window
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ViewSet.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// uniforms of the scene vertex shader
+	const char* g_ViewProjectionsName = "viewProjections";
+	const char* g_ViewCountName = "viewCount";
+	// distance of the orthographic views from the bounds, in radii
+	const float g_OrthoDistance = 2.0f;
+}
+
+/***********************************************************
+ *  ViewSet()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ViewSet::ViewSet()
+{
+	m_viewCount = 0;
+}
+
+/***********************************************************
+ *  IsSinglePassSupported()
+ *
+ *  This method is used for checking whether the driver has
+ *  viewport arrays and lets the vertex shader write the
+ *  viewport index.
+ ***********************************************************/
+bool ViewSet::IsSinglePassSupported()
+{
+	return((GLEW_ARB_viewport_array) &&
+		(GLEW_ARB_shader_viewport_layer_array || GLEW_AMD_vertex_shader_viewport_index));
+}
+
+/***********************************************************
+ *  GetShaderDefine()
+ *
+ *  This method is used for getting the define that has the
+ *  scene vertex shader pick its view from the instance.
+ ***********************************************************/
+const char* ViewSet::GetShaderDefine()
+{
+	return("#define USE_MULTI_VIEW");
+}
+
+/***********************************************************
+ *  SetReviewViews()
+ *
+ *  This method is used for laying out the design review
+ *  views.  The camera view takes the top left quarter, and
+ *  the top, front and side views look at the bounds from
+ *  outside them.  The orthographic views keep the aspect of
+ *  their quarter, so nothing is stretched.
+ ***********************************************************/
+void ViewSet::SetReviewViews(const glm::mat4& cameraView, const glm::mat4& cameraProjection,
+	const glm::vec3& boundsCenter, float boundsRadius, const glm::ivec4& viewport)
+{
+	int width = viewport.z / 2;
+	int height = viewport.w / 2;
+	float aspect = (height > 0) ? ((float)width / (float)height) : 1.0f;
+	float distance = boundsRadius * g_OrthoDistance;
+	glm::mat4 orthoProjection = glm::ortho(-boundsRadius * aspect, boundsRadius * aspect,
+		-boundsRadius, boundsRadius, 0.1f, distance + boundsRadius);
+
+	m_viewCount = 4;
+	SetView(0, cameraView, cameraProjection,
+		glm::ivec4(viewport.x, viewport.y + height, width, height));
+	SetView(1, glm::lookAt(boundsCenter + glm::vec3(0.0f, distance, 0.0f), boundsCenter, glm::vec3(0.0f, 0.0f, -1.0f)),
+		orthoProjection, glm::ivec4(viewport.x + width, viewport.y + height, width, height));
+	SetView(2, glm::lookAt(boundsCenter + glm::vec3(0.0f, 0.0f, distance), boundsCenter, glm::vec3(0.0f, 1.0f, 0.0f)),
+		orthoProjection, glm::ivec4(viewport.x, viewport.y, width, height));
+	SetView(3, glm::lookAt(boundsCenter + glm::vec3(distance, 0.0f, 0.0f), boundsCenter, glm::vec3(0.0f, 1.0f, 0.0f)),
+		orthoProjection, glm::ivec4(viewport.x + width, viewport.y, width, height));
+}
+
+/***********************************************************
+ *  SetStereoViews()
+ *
+ *  This method is used for laying out the two eye views.
+ *  Each eye is moved half the separation to its side, and
+ *  its frustum is sheared back towards the middle, so the
+ *  two frusta line up at the convergence distance without
+ *  turning the eyes inwards.  Orthographic cameras have no
+ *  depth cue, so their views are only moved.
+ ***********************************************************/
+void ViewSet::SetStereoViews(const glm::mat4& cameraView, const glm::mat4& cameraProjection,
+	float eyeSeparation, float convergence, const glm::ivec4& viewport)
+{
+	int width = viewport.z / 2;
+	bool bPerspective = (cameraProjection[2][3] != 0.0f);
+
+	m_viewCount = 2;
+	for (int eye = 0; eye < 2; eye++)
+	{
+		// the left eye is to the left of the camera
+		float offset = (eye == 0) ? (-0.5f * eyeSeparation) : (0.5f * eyeSeparation);
+		glm::mat4 eyeView = glm::translate(glm::mat4(1.0f), glm::vec3(-offset, 0.0f, 0.0f)) * cameraView;
+		glm::mat4 eyeProjection = cameraProjection;
+		if ((bPerspective) && (convergence > 0.0f))
+		{
+			eyeProjection[2][0] -= cameraProjection[0][0] * offset / convergence;
+		}
+		SetView(eye, eyeView, eyeProjection,
+			glm::ivec4(viewport.x + (eye * width), viewport.y, width, viewport.w));
+	}
+}
+
+/***********************************************************
+ *  SetView()
+ *
+ *  This method is used for setting the matrices of a view
+ *  and working out its frustum planes.
+ ***********************************************************/
+void ViewSet::SetView(int index, const glm::mat4& view, const glm::mat4& projection, const glm::ivec4& viewport)
+{
+	VIEW& target = m_views[index];
+	target.view = view;
+	target.projection = projection;
+	target.viewProjection = projection * view;
+	target.viewport = viewport;
+
+	glm::mat4 rows = glm::transpose(target.viewProjection);
+	target.planes[0] = rows[3] + rows[0];
+	target.planes[1] = rows[3] - rows[0];
+	target.planes[2] = rows[3] + rows[1];
+	target.planes[3] = rows[3] - rows[1];
+	target.planes[4] = rows[3] + rows[2];
+	target.planes[5] = rows[3] - rows[2];
+	for (int i = 0; i < 6; i++)
+	{
+		target.planes[i] = target.planes[i] * (1.0f / glm::length(glm::vec3(target.planes[i])));
+	}
+}
+
+/***********************************************************
+ *  IsSphereVisible()
+ *
+ *  This method is used for testing a sphere against the
+ *  union of the view frusta.  The sphere is kept when it is
+ *  not wholly outside any plane of at least one view, so an
+ *  object is tested once however many views there are.
+ ***********************************************************/
+bool ViewSet::IsSphereVisible(const glm::vec3& center, float radius) const
+{
+	for (int v = 0; v < m_viewCount; v++)
+	{
+		bool bInside = true;
+		for (int i = 0; (i < 6) && (bInside); i++)
+		{
+			const glm::vec4& plane = m_views[v].planes[i];
+			bInside = (glm::dot(glm::vec3(plane), center) + plane.w) >= -radius;
+		}
+		if (bInside)
+		{
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  BindAllViews()
+ *
+ *  This method is used for setting every view's viewport
+ *  and matrix, so that the draws that follow are instanced
+ *  once per view.
+ ***********************************************************/
+void ViewSet::BindAllViews(ShaderManager* pShaderManager) const
+{
+	for (int v = 0; v < m_viewCount; v++)
+	{
+		const glm::ivec4& viewport = m_views[v].viewport;
+		glViewportIndexedf((GLuint)v, (float)viewport.x, (float)viewport.y, (float)viewport.z, (float)viewport.w);
+		pShaderManager->setMat4Value(std::string(g_ViewProjectionsName) + "[" + std::to_string(v) + "]",
+			m_views[v].viewProjection);
+	}
+	pShaderManager->setIntValue(g_ViewCountName, m_viewCount);
+}
+
+/***********************************************************
+ *  BindView()
+ *
+ *  This method is used for setting the viewport and matrix
+ *  of one view, for drawing the views one pass at a time.
+ ***********************************************************/
+void ViewSet::BindView(ShaderManager* pShaderManager, int index) const
+{
+	const glm::ivec4& viewport = m_views[index].viewport;
+	glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+	pShaderManager->setMat4Value(std::string(g_ViewProjectionsName) + "[0]", m_views[index].viewProjection);
+	pShaderManager->setIntValue(g_ViewCountName, 1);
+}
+
+/***********************************************************
+ *  UnbindViews()
+ *
+ *  This method is used for switching the scene shader back
+ *  to the model-view-projection matrix of each draw, which
+ *  is what every other pass draws with.
+ ***********************************************************/
+void ViewSet::UnbindViews(ShaderManager* pShaderManager)
+{
+	pShaderManager->setIntValue(g_ViewCountName, 0);
+}
@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// viewset.h
+// ============
+// several views of the scene drawn side by side in one window
+//
+//	The design review layout splits the window into four quarters - the
+//	camera view next to top, front and side orthographic views.  Objects
+//	are culled once against all of the views together, and when the
+//	driver can pick the viewport in the vertex shader the views are drawn
+//	in one pass, with every draw instanced once per view and each
+//	instance sent to its own viewport.
+//
+//	The stereo layout puts the left and right eye views side by side, each
+//	squeezed into half of the window as stereo displays expect, so both
+//	eyes are drawn with the draw calls of one.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "ShaderManager.h"
+
+/***********************************************************
+ *  ViewSet
+ *
+ *  This class holds the matrices, frustum planes and
+ *  viewports of the views that are drawn together.
+ ***********************************************************/
+class ViewSet
+{
+public:
+	// most views that are drawn in one pass
+	static const int MAX_VIEWS = 4;
+
+	// ways of laying out the views in the window
+	enum VIEW_LAYOUT
+	{
+		LAYOUT_NONE = -1,
+		// camera, top, front and side views in the window quarters
+		LAYOUT_REVIEW,
+		// left and right eye views side by side
+		LAYOUT_STEREO
+	};
+
+	// one view of the scene
+	struct VIEW
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 viewProjection;
+		// frustum planes, facing inwards
+		glm::vec4 planes[6];
+		// window area as x, y, width and height
+		glm::ivec4 viewport;
+	};
+
+	// constructor
+	ViewSet();
+
+	// check whether the vertex shader can pick the viewport, so that
+	// all views are drawn in one pass
+	static bool IsSinglePassSupported();
+	// get the shader define that draws every instance into its view
+	static const char* GetShaderDefine();
+
+	// set up the camera view and the top, front and side views of the
+	// passed in bounds, each in a quarter of the passed in viewport
+	void SetReviewViews(const glm::mat4& cameraView, const glm::mat4& cameraProjection,
+		const glm::vec3& boundsCenter, float boundsRadius, const glm::ivec4& viewport);
+	// set up the left and right eye views of the camera in the two halves
+	// of the passed in viewport - objects at the convergence distance
+	// are seen at the depth of the screen
+	void SetStereoViews(const glm::mat4& cameraView, const glm::mat4& cameraProjection,
+		float eyeSeparation, float convergence, const glm::ivec4& viewport);
+	// get the number of views
+	int GetViewCount() const { return(m_viewCount); }
+	// get one of the views
+	const VIEW& GetView(int index) const { return(m_views[index]); }
+
+	// check whether a sphere can be seen in any of the views
+	bool IsSphereVisible(const glm::vec3& center, float radius) const;
+
+	// set the viewports and matrices of all views for one pass
+	void BindAllViews(ShaderManager* pShaderManager) const;
+	// set the viewport and matrix of a single view for its own pass
+	void BindView(ShaderManager* pShaderManager, int index) const;
+	// go back to drawing with the matrices of each draw
+	static void UnbindViews(ShaderManager* pShaderManager);
+
+private:
+	VIEW m_views[MAX_VIEWS];
+	int m_viewCount;
+
+	// set one view and work out its frustum planes
+	void SetView(int index, const glm::mat4& view, const glm::mat4& projection, const glm::ivec4& viewport);
+};
@@ -0,0 +1,1059 @@
+///////////////////////////////////////////////////////////////////////////////
+// worldstreamer.cpp
+// ============
+// stream the spatial cells of large scenes in and out around the camera
+///////////////////////////////////////////////////////////////////////////////
+
+#include "WorldStreamer.h"
+#include "AssetPack.h"
+#include "ImageDecoder.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// chunk types used by world and cell pack files
+	const uint32_t CHUNK_WORLD = ASSETPACK_FOURCC('W', 'R', 'L', 'D');
+	const uint32_t CHUNK_CELL = ASSETPACK_FOURCC('C', 'E', 'L', 'L');
+	const uint32_t CHUNK_MATERIALS = ASSETPACK_FOURCC('M', 'A', 'T', 'L');
+	const uint32_t CHUNK_TEXTURE = ASSETPACK_FOURCC('T', 'E', 'X', 'R');
+	const uint32_t CHUNK_MESH = ASSETPACK_FOURCC('M', 'E', 'S', 'H');
+	const uint32_t CHUNK_OBJECTS = ASSETPACK_FOURCC('O', 'B', 'J', 'S');
+
+	const char* g_WorldIndexName = "world.apak";
+
+	// get the elapsed milliseconds since a time point
+	double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	// read a whole file into memory
+	bool ReadWholeFile(const char* filename, std::vector<unsigned char>& data)
+	{
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			return(false);
+		}
+		data.resize((size_t)file.tellg());
+		file.seekg(0, std::ios::beg);
+		file.read((char*)data.data(), data.size());
+		return((bool)file);
+	}
+
+	// add one face of a box to the mesh data
+	void AddBoxFace(MESH_DATA& mesh, glm::vec3 normal, glm::vec3 uAxis, glm::vec3 vAxis)
+	{
+		uint32_t base = (uint32_t)mesh.vertices.size();
+		glm::vec3 center = normal * 0.5f;
+		glm::vec2 corners[4] = { glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f) };
+
+		for (int i = 0; i < 4; i++)
+		{
+			MESH_VERTEX vertex;
+			vertex.position = center + (uAxis * (corners[i].x - 0.5f)) + (vAxis * (corners[i].y - 0.5f));
+			vertex.normal = normal;
+			vertex.textureCoordinate = corners[i];
+			mesh.vertices.push_back(vertex);
+		}
+
+		uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+		for (int i = 0; i < 6; i++)
+		{
+			mesh.indices.push_back(base + indices[i]);
+		}
+	}
+}
+
+/***********************************************************
+ *  WorldStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+WorldStreamer::WorldStreamer(MeshLibrary* pMeshLibrary)
+{
+	m_pMeshLibrary = pMeshLibrary;
+	m_cellSize = 1.0f;
+	m_settings = DefaultSettings();
+	m_stats = STREAMING_STATS();
+	m_stats.minLatencyMs = DBL_MAX;
+	m_committedBytes = 0;
+	m_lastCameraPosition = glm::vec3(0.0f);
+	m_cameraVelocity = glm::vec3(0.0f);
+	m_lastUpdateTime = 0.0;
+	m_bFirstUpdate = true;
+	m_bStopThreads = false;
+	m_ioWindowBytes = 0;
+	m_ioBytesRead = 0;
+}
+
+/***********************************************************
+ *  ~WorldStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+WorldStreamer::~WorldStreamer()
+{
+	CloseWorld();
+	m_pMeshLibrary = NULL;
+}
+
+/***********************************************************
+ *  DefaultSettings()
+ *
+ *  This method is used for getting the default streaming
+ *  settings.
+ ***********************************************************/
+WorldStreamer::STREAMING_SETTINGS WorldStreamer::DefaultSettings()
+{
+	STREAMING_SETTINGS settings;
+	settings.loadRadius = 60.0f;
+	settings.evictRadius = 80.0f;
+	settings.prefetchSeconds = 1.0f;
+	settings.memoryBudgetBytes = 512ull * 1024 * 1024;
+	settings.ioBytesPerSecond = 64ull * 1024 * 1024;
+	settings.uploadBytesPerFrame = 8ull * 1024 * 1024;
+	settings.ioThreadCount = 2;
+	return(settings);
+}
+
+/***********************************************************
+ *  OpenWorld()
+ *
+ *  This method is used for reading the world index from the
+ *  passed in directory and starting the I/O threads.
+ ***********************************************************/
+bool WorldStreamer::OpenWorld(const char* directory, const STREAMING_SETTINGS& settings)
+{
+	CloseWorld();
+
+	m_directory = directory;
+	m_settings = settings;
+	if (m_settings.evictRadius < m_settings.loadRadius)
+	{
+		m_settings.evictRadius = m_settings.loadRadius;
+	}
+
+	std::string indexFilename = m_directory + "/" + g_WorldIndexName;
+	AssetPackReader reader;
+	std::vector<unsigned char> payload;
+	if ((reader.Open(indexFilename.c_str()) == false) ||
+		(reader.ReadChunk(reader.FindChunk(CHUNK_WORLD), payload) == false))
+	{
+		std::cout << "Could not open world index:" << indexFilename << std::endl;
+		return(false);
+	}
+
+	ChunkReader chunk(payload.data(), payload.size());
+	uint32_t cellCount = 0;
+	if ((chunk.Read(m_cellSize) == false) || (chunk.Read(cellCount) == false) || (m_cellSize <= 0.0f))
+	{
+		std::cout << "Corrupt world index:" << indexFilename << std::endl;
+		return(false);
+	}
+
+	for (uint32_t i = 0; i < cellCount; i++)
+	{
+		CELL_INDEX_ENTRY entry;
+		if (chunk.Read(entry) == false)
+		{
+			std::cout << "Corrupt world index:" << indexFilename << std::endl;
+			m_cellIndex.clear();
+			return(false);
+		}
+		m_cellIndex[GetCellKey(entry.x, entry.z)] = entry;
+	}
+
+	std::cout << "Opened streamed world:" << m_directory << ", cells:" << m_cellIndex.size() << ", cell size:" << m_cellSize << std::endl;
+
+	m_stats = STREAMING_STATS();
+	m_stats.minLatencyMs = DBL_MAX;
+	m_bFirstUpdate = true;
+	m_bStopThreads = false;
+	m_ioWindowStart = std::chrono::steady_clock::now();
+	m_ioWindowBytes = 0;
+	m_ioBytesRead = 0;
+
+	int threadCount = std::max(1, m_settings.ioThreadCount);
+	for (int i = 0; i < threadCount; i++)
+	{
+		m_ioThreads.push_back(std::thread(&WorldStreamer::IoThreadMain, this));
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CloseWorld()
+ *
+ *  This method is used for stopping the I/O threads and
+ *  freeing every cell that is still in memory.
+ ***********************************************************/
+void WorldStreamer::CloseWorld()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_bStopThreads = true;
+	}
+	m_queueCondition.notify_all();
+	for (size_t i = 0; i < m_ioThreads.size(); i++)
+	{
+		m_ioThreads[i].join();
+	}
+	m_ioThreads.clear();
+
+	// the threads are stopped, so every cell can be freed from here
+	std::vector<WORLD_CELL*> cells;
+	for (std::map<uint64_t, WORLD_CELL*>::iterator it = m_cells.begin(); it != m_cells.end(); ++it)
+	{
+		cells.push_back(it->second);
+	}
+	for (size_t i = 0; i < m_completedCells.size(); i++)
+	{
+		if (m_completedCells[i]->bCancelled)
+		{
+			cells.push_back(m_completedCells[i]);
+		}
+	}
+	for (size_t i = 0; i < cells.size(); i++)
+	{
+		EvictCell(cells[i]);
+	}
+
+	m_cells.clear();
+	m_cellIndex.clear();
+	m_residentCells.clear();
+	m_pendingUploads.clear();
+	m_requestQueue.clear();
+	m_completedCells.clear();
+	m_committedBytes = 0;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for requesting the cells around the
+ *  camera and along its direction of travel, uploading the
+ *  cells finished by the I/O threads, and evicting the cells
+ *  that are out of range or over the memory budget.
+ ***********************************************************/
+void WorldStreamer::Update(const glm::vec3& cameraPosition, double currentTime)
+{
+	if (m_cellIndex.size() == 0)
+	{
+		return;
+	}
+
+	// track a smoothed camera velocity for prefetching
+	if (m_bFirstUpdate)
+	{
+		m_cameraVelocity = glm::vec3(0.0f);
+		m_bFirstUpdate = false;
+	}
+	else
+	{
+		double deltaTime = currentTime - m_lastUpdateTime;
+		if (deltaTime > 0.0)
+		{
+			glm::vec3 velocity = (cameraPosition - m_lastCameraPosition) / (float)deltaTime;
+			m_cameraVelocity += (velocity - m_cameraVelocity) * 0.25f;
+		}
+	}
+	m_lastCameraPosition = cameraPosition;
+	m_lastUpdateTime = currentTime;
+
+	glm::vec3 predictedPosition = cameraPosition + (m_cameraVelocity * m_settings.prefetchSeconds);
+
+	// collect the cells handed back by the I/O threads
+	std::vector<WORLD_CELL*> completedCells;
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		completedCells.swap(m_completedCells);
+		m_stats.bytesRead = m_ioBytesRead;
+	}
+	for (size_t i = 0; i < completedCells.size(); i++)
+	{
+		WORLD_CELL* pCell = completedCells[i];
+		if (pCell->bCancelled)
+		{
+			// the cell left the streaming range while it was loading
+			m_stats.cellsCancelled++;
+			EvictCell(pCell);
+		}
+		else if (pCell->bLoadSucceeded == false)
+		{
+			// keep failed cells in the map so they are not requested again
+			pCell->state = CELL_FAILED;
+			m_stats.cellsFailed++;
+			m_committedBytes -= std::min(m_committedBytes, pCell->memoryBytes);
+			pCell->memoryBytes = 0;
+		}
+		else
+		{
+			// charge the budget with the decoded size instead of the
+			// estimate from the index
+			m_committedBytes -= std::min(m_committedBytes, pCell->memoryBytes);
+			m_committedBytes += pCell->decodedBytes;
+			pCell->memoryBytes = pCell->decodedBytes;
+			pCell->state = CELL_LOADED;
+			m_pendingUploads.push_back(pCell);
+		}
+	}
+
+	// request the cells within range of the camera and the predicted position
+	float minX = std::min(cameraPosition.x, predictedPosition.x) - m_settings.loadRadius;
+	float maxX = std::max(cameraPosition.x, predictedPosition.x) + m_settings.loadRadius;
+	float minZ = std::min(cameraPosition.z, predictedPosition.z) - m_settings.loadRadius;
+	float maxZ = std::max(cameraPosition.z, predictedPosition.z) + m_settings.loadRadius;
+	int firstX = (int)std::floor(minX / m_cellSize);
+	int lastX = (int)std::floor(maxX / m_cellSize);
+	int firstZ = (int)std::floor(minZ / m_cellSize);
+	int lastZ = (int)std::floor(maxZ / m_cellSize);
+
+	std::vector<WORLD_CELL*> newRequests;
+	for (int z = firstZ; z <= lastZ; z++)
+	{
+		for (int x = firstX; x <= lastX; x++)
+		{
+			uint64_t key = GetCellKey(x, z);
+			std::map<uint64_t, CELL_INDEX_ENTRY>::iterator entry = m_cellIndex.find(key);
+			if ((entry == m_cellIndex.end()) || (m_cells.find(key) != m_cells.end()))
+			{
+				continue;
+			}
+
+			float distance = GetCellDistance(x, z, cameraPosition);
+			float predictedDistance = GetCellDistance(x, z, predictedPosition);
+			if ((distance > m_settings.loadRadius) && (predictedDistance > m_settings.loadRadius))
+			{
+				continue;
+			}
+
+			// stay inside the memory budget with the pending requests
+			if (m_committedBytes + entry->second.memoryBytes > m_settings.memoryBudgetBytes)
+			{
+				continue;
+			}
+
+			WORLD_CELL* pCell = new WORLD_CELL();
+			pCell->x = x;
+			pCell->z = z;
+			pCell->state = CELL_QUEUED;
+			pCell->bCancelled = false;
+			pCell->bLoadSucceeded = false;
+			pCell->priority = 0.0f;
+			pCell->fileBytes = entry->second.fileBytes;
+			pCell->memoryBytes = entry->second.memoryBytes;
+			pCell->decodedBytes = 0;
+			pCell->requestTime = std::chrono::steady_clock::now();
+			pCell->ioMilliseconds = 0.0;
+
+			m_cells[key] = pCell;
+			m_committedBytes += pCell->memoryBytes;
+			m_stats.cellsRequested++;
+			newRequests.push_back(pCell);
+		}
+	}
+
+	// find the cells that are no longer in range
+	std::vector<WORLD_CELL*> outOfRange;
+	for (std::map<uint64_t, WORLD_CELL*>::iterator it = m_cells.begin(); it != m_cells.end(); ++it)
+	{
+		WORLD_CELL* pCell = it->second;
+		float distance = std::min(
+			GetCellDistance(pCell->x, pCell->z, cameraPosition),
+			GetCellDistance(pCell->x, pCell->z, predictedPosition));
+		if (distance > m_settings.evictRadius)
+		{
+			outOfRange.push_back(pCell);
+		}
+	}
+
+	std::vector<WORLD_CELL*> cellsToFree;
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+
+		for (size_t i = 0; i < newRequests.size(); i++)
+		{
+			m_requestQueue.push_back(newRequests[i]);
+		}
+
+		for (size_t i = 0; i < outOfRange.size(); i++)
+		{
+			WORLD_CELL* pCell = outOfRange[i];
+			m_cells.erase(GetCellKey(pCell->x, pCell->z));
+			m_committedBytes -= std::min(m_committedBytes, pCell->memoryBytes);
+			pCell->memoryBytes = 0;
+
+			if (pCell->state == CELL_LOADING)
+			{
+				// the I/O thread hands the cell back when it is done with it
+				pCell->bCancelled = true;
+				continue;
+			}
+
+			if (pCell->state == CELL_QUEUED)
+			{
+				m_requestQueue.erase(std::remove(m_requestQueue.begin(), m_requestQueue.end(), pCell), m_requestQueue.end());
+				m_stats.cellsCancelled++;
+			}
+			else if (pCell->state == CELL_RESIDENT)
+			{
+				m_stats.cellsEvicted++;
+			}
+			cellsToFree.push_back(pCell);
+		}
+
+		// refresh the priorities - the cells around the camera come first,
+		// followed by the cells that are only needed for prefetching
+		for (size_t i = 0; i < m_requestQueue.size(); i++)
+		{
+			WORLD_CELL* pCell = m_requestQueue[i];
+			float distance = GetCellDistance(pCell->x, pCell->z, cameraPosition);
+			float predictedDistance = GetCellDistance(pCell->x, pCell->z, predictedPosition);
+			if (distance <= m_settings.loadRadius)
+			{
+				pCell->priority = distance;
+			}
+			else
+			{
+				pCell->priority = m_settings.loadRadius + predictedDistance;
+			}
+		}
+	}
+	if (newRequests.size() > 0)
+	{
+		m_queueCondition.notify_all();
+	}
+
+	// none of these cells are referenced by the I/O threads any more
+	for (size_t i = 0; i < cellsToFree.size(); i++)
+	{
+		EvictCell(cellsToFree[i]);
+	}
+
+	// evict the farthest resident cells while over the memory budget,
+	// but never the cell that the camera is in
+	if (m_committedBytes > m_settings.memoryBudgetBytes)
+	{
+		std::vector<WORLD_CELL*> residentCells = m_residentCells;
+		std::sort(residentCells.begin(), residentCells.end(),
+			[this, &cameraPosition](WORLD_CELL* a, WORLD_CELL* b)
+			{
+				return(GetCellDistance(a->x, a->z, cameraPosition) > GetCellDistance(b->x, b->z, cameraPosition));
+			});
+
+		for (size_t i = 0; (i < residentCells.size()) && (m_committedBytes > m_settings.memoryBudgetBytes); i++)
+		{
+			WORLD_CELL* pCell = residentCells[i];
+			if (GetCellDistance(pCell->x, pCell->z, cameraPosition) <= m_cellSize)
+			{
+				break;
+			}
+			m_cells.erase(GetCellKey(pCell->x, pCell->z));
+			m_committedBytes -= std::min(m_committedBytes, pCell->memoryBytes);
+			m_stats.cellsEvicted++;
+			EvictCell(pCell);
+		}
+	}
+
+	// upload the loaded cells, closest first, within the per frame budget
+	std::vector<WORLD_CELL*> loadedCells = m_pendingUploads;
+	std::sort(loadedCells.begin(), loadedCells.end(),
+		[this, &cameraPosition](WORLD_CELL* a, WORLD_CELL* b)
+		{
+			return(GetCellDistance(a->x, a->z, cameraPosition) < GetCellDistance(b->x, b->z, cameraPosition));
+		});
+
+	uint64_t uploadedBytes = 0;
+	for (size_t i = 0; i < loadedCells.size(); i++)
+	{
+		// always upload at least one cell so that streaming keeps moving
+		if ((i > 0) && (uploadedBytes + loadedCells[i]->memoryBytes > m_settings.uploadBytesPerFrame))
+		{
+			break;
+		}
+		uploadedBytes += loadedCells[i]->memoryBytes;
+		UploadCell(loadedCells[i]);
+	}
+
+	m_stats.cellsResident = (int)m_residentCells.size();
+	m_stats.residentBytes = m_committedBytes;
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the streaming statistics
+ *  to the console.
+ ***********************************************************/
+void WorldStreamer::PrintStats() const
+{
+	double averageLatency = 0.0;
+	double averageIo = 0.0;
+	if (m_stats.cellsStreamedIn > 0)
+	{
+		averageLatency = m_stats.totalLatencyMs / m_stats.cellsStreamedIn;
+		averageIo = m_stats.totalIoMs / m_stats.cellsStreamedIn;
+	}
+
+	std::cout << "World streaming stats:" << std::endl;
+	std::cout << "  cells requested:" << m_stats.cellsRequested
+		<< ", streamed in:" << m_stats.cellsStreamedIn
+		<< ", evicted:" << m_stats.cellsEvicted
+		<< ", cancelled:" << m_stats.cellsCancelled
+		<< ", failed:" << m_stats.cellsFailed << std::endl;
+	std::cout << "  resident cells:" << m_stats.cellsResident
+		<< ", resident MB:" << (m_stats.residentBytes / (1024.0 * 1024.0))
+		<< ", MB read:" << (m_stats.bytesRead / (1024.0 * 1024.0)) << std::endl;
+	if (m_stats.cellsStreamedIn > 0)
+	{
+		std::cout << "  stream-in latency ms min:" << m_stats.minLatencyMs
+			<< ", avg:" << averageLatency
+			<< ", max:" << m_stats.maxLatencyMs
+			<< ", avg I/O and decode:" << averageIo << std::endl;
+	}
+}
+
+/***********************************************************
+ *  IoThreadMain()
+ *
+ *  This method is run by every I/O thread.  It takes the
+ *  queued cell with the best priority, reads and decodes it,
+ *  and hands it back to the main thread for uploading.
+ ***********************************************************/
+void WorldStreamer::IoThreadMain()
+{
+	while (true)
+	{
+		WORLD_CELL* pCell = NULL;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueCondition.wait(lock, [this]() { return(m_bStopThreads || (m_requestQueue.size() > 0)); });
+			if (m_bStopThreads)
+			{
+				return;
+			}
+
+			std::vector<WORLD_CELL*>::iterator best = std::min_element(m_requestQueue.begin(), m_requestQueue.end(),
+				[](WORLD_CELL* a, WORLD_CELL* b) { return(a->priority < b->priority); });
+			pCell = *best;
+			m_requestQueue.erase(best);
+			pCell->state = CELL_LOADING;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		ThrottleIo(pCell->fileBytes);
+		uint64_t decodedBytes = 0;
+		bool bLoaded = LoadCellFile(pCell, decodedBytes);
+		double ioMilliseconds = ElapsedMilliseconds(start);
+
+		// the main thread owns the cell again once it is handed back
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			pCell->ioMilliseconds = ioMilliseconds;
+			pCell->decodedBytes = decodedBytes;
+			pCell->bLoadSucceeded = bLoaded;
+			m_ioBytesRead += pCell->fileBytes;
+			m_completedCells.push_back(pCell);
+		}
+	}
+}
+
+/***********************************************************
+ *  ThrottleIo()
+ *
+ *  This method is used for keeping the disk reads of all the
+ *  I/O threads within the configured bytes per second.
+ ***********************************************************/
+void WorldStreamer::ThrottleIo(uint64_t bytes)
+{
+	if (m_settings.ioBytesPerSecond == 0)
+	{
+		return;
+	}
+
+	while (true)
+	{
+		std::chrono::steady_clock::duration wait;
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now - m_ioWindowStart >= std::chrono::seconds(1))
+			{
+				m_ioWindowStart = now;
+				m_ioWindowBytes = 0;
+			}
+
+			// a read larger than the whole budget is let through on an empty window
+			if ((m_ioWindowBytes == 0) || (m_ioWindowBytes + bytes <= m_settings.ioBytesPerSecond))
+			{
+				m_ioWindowBytes += bytes;
+				return;
+			}
+			if (m_bStopThreads)
+			{
+				return;
+			}
+			wait = (m_ioWindowStart + std::chrono::seconds(1)) - now;
+		}
+		std::this_thread::sleep_for(wait);
+	}
+}
+
+/***********************************************************
+ *  LoadCellFile()
+ *
+ *  This method is used for reading a cell pack file and
+ *  decoding its textures.  It runs on an I/O thread, so it
+ *  must not make any OpenGL calls, and it leaves the memory
+ *  charged to the budget to the main thread.
+ ***********************************************************/
+bool WorldStreamer::LoadCellFile(WORLD_CELL* pCell, uint64_t& decodedBytes)
+{
+	std::string filename = GetCellFilename(pCell->x, pCell->z);
+	AssetPackReader reader;
+	if (reader.Open(filename.c_str()) == false)
+	{
+		std::cout << "Could not open world cell:" << filename << std::endl;
+		return(false);
+	}
+
+	uint64_t memoryBytes = 0;
+	std::vector<unsigned char> payload;
+	for (int i = 0; i < reader.GetChunkCount(); i++)
+	{
+		uint32_t type = reader.GetChunk(i).type;
+		if ((type != CHUNK_MATERIALS) && (type != CHUNK_TEXTURE) &&
+			(type != CHUNK_MESH) && (type != CHUNK_OBJECTS))
+		{
+			continue;
+		}
+		if (reader.ReadChunk(i, payload) == false)
+		{
+			std::cout << "Could not read world cell chunk:" << filename << std::endl;
+			return(false);
+		}
+
+		ChunkReader chunk(payload.data(), payload.size());
+		bool bValid = true;
+		uint32_t count = 0;
+
+		if (type == CHUNK_MATERIALS)
+		{
+			bValid = chunk.Read(count);
+			for (uint32_t m = 0; bValid && (m < count); m++)
+			{
+				WORLD_MATERIAL material;
+				bValid = chunk.Read(material.diffuseColor) && chunk.Read(material.specularColor) && chunk.Read(material.shininess);
+				pCell->materials.push_back(material);
+			}
+		}
+		else if (type == CHUNK_TEXTURE)
+		{
+			WORLD_TEXTURE texture;
+			texture.width = 0;
+			texture.height = 0;
+			texture.colorChannels = 0;
+			texture.textureID = 0;
+			texture.handle = GPU_HANDLE();
+			bValid = chunk.ReadString(texture.tag) && chunk.Read(count) && (count <= chunk.GetRemaining());
+			if (bValid)
+			{
+				// cell textures are decoded with the same orientation as the scene textures
+				const unsigned char* pEncoded = payload.data() + (payload.size() - chunk.GetRemaining());
+				DECODED_IMAGE image;
+				if (ImageDecoder::DecodeImage(pEncoded, count, 1, image))
+				{
+					texture.width = image.width;
+					texture.height = image.height;
+					texture.colorChannels = image.colorChannels;
+					texture.pixels.swap(image.pixels);
+					// account for the mipmap chain that is generated on upload
+					memoryBytes += (texture.pixels.size() * 4) / 3;
+				}
+				else
+				{
+					std::cout << "Could not decode world cell texture:" << texture.tag << " in " << filename << std::endl;
+				}
+			}
+			pCell->textures.push_back(texture);
+		}
+		else if (type == CHUNK_MESH)
+		{
+			MESH_DATA mesh;
+			uint32_t indexCount = 0;
+			bValid = chunk.Read(count) && chunk.Read(indexCount) &&
+				((uint64_t)count * sizeof(MESH_VERTEX) + (uint64_t)indexCount * sizeof(uint32_t) <= chunk.GetRemaining());
+			if (bValid)
+			{
+				mesh.vertices.resize(count);
+				mesh.indices.resize(indexCount);
+				bValid = chunk.ReadBytes(mesh.vertices.data(), count * sizeof(MESH_VERTEX)) &&
+					chunk.ReadBytes(mesh.indices.data(), indexCount * sizeof(uint32_t));
+				for (uint32_t v = 0; bValid && (v < indexCount); v++)
+				{
+					bValid = (mesh.indices[v] < count);
+				}
+			}
+			memoryBytes += MeshLibrary::GetDataBytes(mesh);
+			pCell->meshData.push_back(mesh);
+		}
+		else if (type == CHUNK_OBJECTS)
+		{
+			bValid = chunk.Read(count);
+			for (uint32_t o = 0; bValid && (o < count); o++)
+			{
+				WORLD_OBJECT object;
+				int32_t shape = 0;
+				int32_t meshIndex = 0;
+				int32_t textureIndex = 0;
+				int32_t materialIndex = 0;
+				bValid = chunk.Read(shape) && chunk.Read(meshIndex) &&
+					chunk.Read(object.scaleXYZ) && chunk.Read(object.rotationDegrees) && chunk.Read(object.positionXYZ) &&
+					chunk.Read(object.color) && chunk.Read(textureIndex) && chunk.Read(materialIndex) &&
+					chunk.Read(object.uvScale);
+				object.shape = shape;
+				object.meshIndex = meshIndex;
+				object.textureIndex = textureIndex;
+				object.materialIndex = materialIndex;
+				pCell->objects.push_back(object);
+			}
+		}
+
+		if (bValid == false)
+		{
+			std::cout << "Corrupt world cell chunk:" << filename << std::endl;
+			return(false);
+		}
+	}
+
+	// drop references that point outside of the cell data
+	for (size_t i = 0; i < pCell->objects.size(); i++)
+	{
+		WORLD_OBJECT& object = pCell->objects[i];
+		if ((object.textureIndex >= (int)pCell->textures.size()) || (object.textureIndex < 0))
+		{
+			object.textureIndex = -1;
+		}
+		if ((object.materialIndex >= (int)pCell->materials.size()) || (object.materialIndex < 0))
+		{
+			object.materialIndex = -1;
+		}
+		if ((object.shape == SHAPE_CUSTOM) &&
+			((object.meshIndex < 0) || (object.meshIndex >= (int)pCell->meshData.size())))
+		{
+			object.shape = SHAPE_BOX;
+		}
+	}
+
+	decodedBytes = memoryBytes;
+	return(true);
+}
+
+/***********************************************************
+ *  UploadCell()
+ *
+ *  This method is used for creating the OpenGL textures and
+ *  meshes for a cell that was loaded by an I/O thread, and
+ *  making the cell available for rendering.
+ ***********************************************************/
+void WorldStreamer::UploadCell(WORLD_CELL* pCell)
+{
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t i = 0; i < pCell->textures.size(); i++)
+	{
+		WORLD_TEXTURE& texture = pCell->textures[i];
+		if ((texture.pixels.size() == 0) || ((texture.colorChannels != 3) && (texture.colorChannels != 4)))
+		{
+			continue;
+		}
+
+		// filtering comes from the sampler bound to the world texture unit,
+		// and evicted cells leave textures of the usual sizes to recycle
+		texture.handle = m_pMeshLibrary->GetResources()->CreateTexture2D(texture.width, texture.height, texture.colorChannels, texture.pixels.data(), texture.tag.c_str());
+		texture.textureID = m_pMeshLibrary->GetResources()->GetName(texture.handle);
+
+		// the decoded pixels are not needed once they are in OpenGL
+		std::vector<unsigned char>().swap(texture.pixels);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	for (size_t i = 0; i < pCell->meshData.size(); i++)
+	{
+		pCell->meshIDs.push_back(m_pMeshLibrary->CreateMesh(pCell->meshData[i]));
+	}
+	std::vector<MESH_DATA>().swap(pCell->meshData);
+
+	pCell->state = CELL_RESIDENT;
+	m_pendingUploads.erase(std::remove(m_pendingUploads.begin(), m_pendingUploads.end(), pCell), m_pendingUploads.end());
+	m_residentCells.push_back(pCell);
+
+	double latency = ElapsedMilliseconds(pCell->requestTime);
+	m_stats.cellsStreamedIn++;
+	m_stats.totalLatencyMs += latency;
+	m_stats.totalIoMs += pCell->ioMilliseconds;
+	m_stats.minLatencyMs = std::min(m_stats.minLatencyMs, latency);
+	m_stats.maxLatencyMs = std::max(m_stats.maxLatencyMs, latency);
+}
+
+/***********************************************************
+ *  EvictCell()
+ *
+ *  This method is used for freeing a cell along with any of
+ *  its OpenGL textures and meshes.
+ ***********************************************************/
+void WorldStreamer::EvictCell(WORLD_CELL* pCell)
+{
+	RemoveCellReferences(pCell);
+	if (pCell->state == CELL_RESIDENT)
+	{
+		for (size_t i = 0; i < pCell->textures.size(); i++)
+		{
+			m_pMeshLibrary->GetResources()->Release(pCell->textures[i].handle);
+			pCell->textures[i].textureID = 0;
+		}
+		for (size_t i = 0; i < pCell->meshIDs.size(); i++)
+		{
+			m_pMeshLibrary->DestroyMesh(pCell->meshIDs[i]);
+		}
+	}
+
+	delete pCell;
+}
+
+/***********************************************************
+ *  RemoveCellReferences()
+ *
+ *  This method is used for removing a cell from the lists
+ *  of resident cells and cells waiting for upload.
+ ***********************************************************/
+void WorldStreamer::RemoveCellReferences(WORLD_CELL* pCell)
+{
+	m_residentCells.erase(std::remove(m_residentCells.begin(), m_residentCells.end(), pCell), m_residentCells.end());
+	m_pendingUploads.erase(std::remove(m_pendingUploads.begin(), m_pendingUploads.end(), pCell), m_pendingUploads.end());
+}
+
+/***********************************************************
+ *  GetCellKey()
+ *
+ *  This method is used for packing a cell coordinate into a
+ *  single map key.
+ ***********************************************************/
+uint64_t WorldStreamer::GetCellKey(int x, int z)
+{
+	return(((uint64_t)(uint32_t)x << 32) | (uint64_t)(uint32_t)z);
+}
+
+/***********************************************************
+ *  GetCellFilename()
+ *
+ *  This method is used for getting the path of the pack file
+ *  for a cell coordinate.
+ ***********************************************************/
+std::string WorldStreamer::GetCellFilename(int x, int z) const
+{
+	return(m_directory + "/cell_" + std::to_string(x) + "_" + std::to_string(z) + ".apak");
+}
+
+/***********************************************************
+ *  GetCellDistance()
+ *
+ *  This method is used for getting the distance on the XZ
+ *  plane from a position to the center of a cell.
+ ***********************************************************/
+float WorldStreamer::GetCellDistance(int x, int z, const glm::vec3& position) const
+{
+	float centerX = (x + 0.5f) * m_cellSize;
+	float centerZ = (z + 0.5f) * m_cellSize;
+	float dx = position.x - centerX;
+	float dz = position.z - centerZ;
+	return(std::sqrt((dx * dx) + (dz * dz)));
+}
+
+/***********************************************************
+ *  CookDemoWorld()
+ *
+ *  This method is used for writing a demo world into the
+ *  passed in directory.  Every cell holds a floor and four
+ *  display tables with a can and an apple, and carries its
+ *  own copy of the textures and materials it uses.
+ ***********************************************************/
+bool WorldStreamer::CookDemoWorld(const char* directory, int cellsX, int cellsZ, float cellSize)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	// the encoded texture files embedded into every cell
+	const char* textureFiles[3] = { "textures/counter.jpg", "textures/can.jpg", "textures/apple.jpg" };
+	const char* textureTags[3] = { "counter_texture", "can_texture", "apple_texture" };
+	std::vector<unsigned char> encodedTextures[3];
+	uint64_t textureMemoryBytes = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		int width = 0;
+		int height = 0;
+		int colorChannels = 0;
+		if ((ReadWholeFile(textureFiles[i], encodedTextures[i]) == false) ||
+			(stbi_info_from_memory(encodedTextures[i].data(), (int)encodedTextures[i].size(), &width, &height, &colorChannels) == 0))
+		{
+			std::cout << "Could not read texture for demo world:" << textureFiles[i] << std::endl;
+			return(false);
+		}
+		textureMemoryBytes += ((uint64_t)width * height * colorChannels * 4) / 3;
+	}
+
+	// a display table mesh shared by all the tables in a cell
+	MESH_DATA tableMesh;
+	AddBoxFace(tableMesh, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+	AddBoxFace(tableMesh, glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	AddBoxFace(tableMesh, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	AddBoxFace(tableMesh, glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	AddBoxFace(tableMesh, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	AddBoxFace(tableMesh, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	ChunkWriter worldChunk;
+	worldChunk.Write(cellSize);
+	worldChunk.Write((uint32_t)(cellsX * cellsZ));
+
+	for (int cz = 0; cz < cellsZ; cz++)
+	{
+		for (int cx = 0; cx < cellsX; cx++)
+		{
+			int x = cx - (cellsX / 2);
+			int z = cz - (cellsZ / 2);
+			glm::vec3 center((x + 0.5f) * cellSize, 0.0f, (z + 0.5f) * cellSize);
+
+			AssetPackWriter pack;
+
+			ChunkWriter cellChunk;
+			cellChunk.Write((int32_t)x);
+			cellChunk.Write((int32_t)z);
+			cellChunk.Write(cellSize);
+			pack.AddChunk(CHUNK_CELL, cellChunk.GetData().data(), cellChunk.GetData().size());
+
+			// materials - plate, metal and apple from the table scene
+			ChunkWriter materialChunk;
+			materialChunk.Write((uint32_t)3);
+			materialChunk.Write(glm::vec3(0.4f, 0.4f, 0.4f));
+			materialChunk.Write(glm::vec3(0.2f, 0.2f, 0.2f));
+			materialChunk.Write(30.0f);
+			materialChunk.Write(glm::vec3(0.6f, 0.6f, 0.6f));
+			materialChunk.Write(glm::vec3(0.7f, 0.7f, 0.6f));
+			materialChunk.Write(90.0f);
+			materialChunk.Write(glm::vec3(0.4f, 0.2f, 0.4f));
+			materialChunk.Write(glm::vec3(0.1f, 0.05f, 0.1f));
+			materialChunk.Write(0.55f);
+			pack.AddChunk(CHUNK_MATERIALS, materialChunk.GetData().data(), materialChunk.GetData().size());
+
+			for (int i = 0; i < 3; i++)
+			{
+				ChunkWriter textureChunk;
+				textureChunk.WriteString(textureTags[i]);
+				textureChunk.Write((uint32_t)encodedTextures[i].size());
+				textureChunk.WriteBytes(encodedTextures[i].data(), encodedTextures[i].size());
+				pack.AddChunk(CHUNK_TEXTURE, textureChunk.GetData().data(), textureChunk.GetData().size());
+			}
+
+			ChunkWriter meshChunk;
+			meshChunk.Write((uint32_t)tableMesh.vertices.size());
+			meshChunk.Write((uint32_t)tableMesh.indices.size());
+			meshChunk.WriteBytes(tableMesh.vertices.data(), tableMesh.vertices.size() * sizeof(MESH_VERTEX));
+			meshChunk.WriteBytes(tableMesh.indices.data(), tableMesh.indices.size() * sizeof(uint32_t));
+			pack.AddChunk(CHUNK_MESH, meshChunk.GetData().data(), meshChunk.GetData().size(), AssetPack::COMPRESSION_LZ4);
+
+			// the floor plane followed by four tables with a can and an apple
+			std::vector<WORLD_OBJECT> objects;
+			WORLD_OBJECT object;
+			object.shape = SHAPE_PLANE;
+			object.meshIndex = -1;
+			object.scaleXYZ = glm::vec3(cellSize * 0.5f, 1.0f, cellSize * 0.5f);
+			object.rotationDegrees = glm::vec3(0.0f);
+			object.positionXYZ = center + glm::vec3(0.0f, -0.6f, 0.0f);
+			object.color = glm::vec4(1.0f);
+			object.textureIndex = 0;
+			object.materialIndex = 0;
+			object.uvScale = glm::vec2(2.0f, 2.0f);
+			objects.push_back(object);
+
+			for (int t = 0; t < 4; t++)
+			{
+				glm::vec3 tablePosition = center + glm::vec3(
+					((t % 2) - 0.5f) * cellSize * 0.5f, 0.0f, ((t / 2) - 0.5f) * cellSize * 0.5f);
+
+				object.shape = SHAPE_CUSTOM;
+				object.meshIndex = 0;
+				object.scaleXYZ = glm::vec3(6.0f, 3.0f, 4.0f);
+				object.positionXYZ = tablePosition + glm::vec3(0.0f, 0.9f, 0.0f);
+				object.textureIndex = 0;
+				object.materialIndex = 0;
+				object.uvScale = glm::vec2(1.0f, 1.0f);
+				objects.push_back(object);
+
+				object.shape = SHAPE_CYLINDER;
+				object.meshIndex = -1;
+				object.scaleXYZ = glm::vec3(0.6f, 2.4f, 0.6f);
+				object.positionXYZ = tablePosition + glm::vec3(-1.5f, 2.4f, 0.0f);
+				object.textureIndex = 1;
+				object.materialIndex = 1;
+				objects.push_back(object);
+
+				object.shape = SHAPE_SPHERE;
+				object.scaleXYZ = glm::vec3(0.9f, 0.8f, 0.9f);
+				object.positionXYZ = tablePosition + glm::vec3(1.5f, 3.2f, 0.0f);
+				object.textureIndex = 2;
+				object.materialIndex = 2;
+				objects.push_back(object);
+			}
+
+			ChunkWriter objectChunk;
+			objectChunk.Write((uint32_t)objects.size());
+			for (size_t i = 0; i < objects.size(); i++)
+			{
+				objectChunk.Write((int32_t)objects[i].shape);
+				objectChunk.Write((int32_t)objects[i].meshIndex);
+				objectChunk.Write(objects[i].scaleXYZ);
+				objectChunk.Write(objects[i].rotationDegrees);
+				objectChunk.Write(objects[i].positionXYZ);
+				objectChunk.Write(objects[i].color);
+				objectChunk.Write((int32_t)objects[i].textureIndex);
+				objectChunk.Write((int32_t)objects[i].materialIndex);
+				objectChunk.Write(objects[i].uvScale);
+			}
+			pack.AddChunk(CHUNK_OBJECTS, objectChunk.GetData().data(), objectChunk.GetData().size());
+
+			std::string filename = std::string(directory) + "/cell_" + std::to_string(x) + "_" + std::to_string(z) + ".apak";
+			if (pack.WriteToFile(filename.c_str()) == false)
+			{
+				return(false);
+			}
+
+			CELL_INDEX_ENTRY entry;
+			entry.x = x;
+			entry.z = z;
+			entry.fileBytes = (uint64_t)std::filesystem::file_size(filename, error);
+			entry.memoryBytes = textureMemoryBytes + MeshLibrary::GetDataBytes(tableMesh);
+			worldChunk.Write(entry);
+		}
+	}
+
+	AssetPackWriter worldPack;
+	worldPack.AddChunk(CHUNK_WORLD, worldChunk.GetData().data(), worldChunk.GetData().size());
+	std::string indexFilename = std::string(directory) + "/" + g_WorldIndexName;
+	if (worldPack.WriteToFile(indexFilename.c_str()) == false)
+	{
+		return(false);
+	}
+
+	std::cout << "Cooked demo world:" << directory << ", cells:" << (cellsX * cellsZ) << std::endl;
+	return(true);
+}
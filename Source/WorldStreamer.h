@@ -0,0 +1,235 @@
+///////////////////////////////////////////////////////////////////////////////
+// worldstreamer.h
+// ============
+// stream the spatial cells of large scenes in and out around the camera
+//
+//	The world is divided into square cells on the XZ plane.  Every cell is
+//	stored in its own asset pack file, and a world index pack lists which
+//	cells exist.  Cells near the camera are read and decoded on background
+//	I/O threads, uploaded to OpenGL on the main thread, and evicted again
+//	once the camera moves away.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshLibrary.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  WorldStreamer
+ *
+ *  This class contains the code for streaming world cells
+ *  between disk and memory based on the camera position.
+ ***********************************************************/
+class WorldStreamer
+{
+public:
+	// constructor
+	WorldStreamer(MeshLibrary* pMeshLibrary);
+	// destructor
+	~WorldStreamer();
+
+	// material values stored in a cell
+	struct WORLD_MATERIAL
+	{
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	// texture stored in a cell
+	struct WORLD_TEXTURE
+	{
+		std::string tag;
+		int width;
+		int height;
+		int colorChannels;
+		std::vector<unsigned char> pixels;
+		GLuint textureID;
+		GPU_HANDLE handle;
+	};
+
+	// placement of a shape inside a cell
+	struct WORLD_OBJECT
+	{
+		int shape;
+		int meshIndex;
+		glm::vec3 scaleXYZ;
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+		glm::vec4 color;
+		int textureIndex;
+		int materialIndex;
+		glm::vec2 uvScale;
+	};
+
+	// streaming state of a cell
+	enum CELL_STATE
+	{
+		CELL_QUEUED,
+		CELL_LOADING,
+		CELL_LOADED,
+		CELL_RESIDENT,
+		CELL_FAILED
+	};
+
+	// one streamed world cell
+	struct WORLD_CELL
+	{
+		int x;
+		int z;
+		CELL_STATE state;
+		bool bCancelled;
+		bool bLoadSucceeded;
+		float priority;
+		uint64_t fileBytes;
+		// memory charged to the budget, the index estimate until the
+		// cell is handed back by its I/O thread
+		uint64_t memoryBytes;
+		// memory of the decoded cell, set by the I/O thread
+		uint64_t decodedBytes;
+		std::chrono::steady_clock::time_point requestTime;
+		double ioMilliseconds;
+		std::vector<WORLD_TEXTURE> textures;
+		std::vector<WORLD_MATERIAL> materials;
+		std::vector<MESH_DATA> meshData;
+		std::vector<int> meshIDs;
+		std::vector<WORLD_OBJECT> objects;
+	};
+
+	// settings that control the streaming behavior
+	struct STREAMING_SETTINGS
+	{
+		// cells closer than this are loaded
+		float loadRadius;
+		// cells farther than this are evicted
+		float evictRadius;
+		// how far ahead along the camera velocity to prefetch
+		float prefetchSeconds;
+		// maximum memory used by resident and pending cells
+		uint64_t memoryBudgetBytes;
+		// maximum bytes read from disk per second
+		uint64_t ioBytesPerSecond;
+		// maximum bytes uploaded to OpenGL per frame
+		uint64_t uploadBytesPerFrame;
+		// number of background I/O threads
+		int ioThreadCount;
+	};
+
+	// streaming statistics
+	struct STREAMING_STATS
+	{
+		int cellsRequested;
+		int cellsStreamedIn;
+		int cellsEvicted;
+		int cellsCancelled;
+		int cellsFailed;
+		int cellsResident;
+		uint64_t bytesRead;
+		uint64_t residentBytes;
+		double minLatencyMs;
+		double maxLatencyMs;
+		double totalLatencyMs;
+		double totalIoMs;
+	};
+
+	// get the default streaming settings
+	static STREAMING_SETTINGS DefaultSettings();
+
+	// open a streamed world from its directory
+	bool OpenWorld(const char* directory, const STREAMING_SETTINGS& settings);
+	// close the world and free all the resident cells
+	void CloseWorld();
+	// update the resident cells around the camera
+	void Update(const glm::vec3& cameraPosition, double currentTime);
+
+	// get the cells that are ready for rendering
+	const std::vector<WORLD_CELL*>& GetResidentCells() const { return(m_residentCells); }
+	// get the streaming statistics
+	const STREAMING_STATS& GetStats() const { return(m_stats); }
+	// print the streaming statistics
+	void PrintStats() const;
+
+	// write a demo world made of repeated table scenes
+	static bool CookDemoWorld(const char* directory, int cellsX, int cellsZ, float cellSize);
+
+private:
+	// entry from the world index
+	struct CELL_INDEX_ENTRY
+	{
+		int32_t x;
+		int32_t z;
+		uint64_t fileBytes;
+		uint64_t memoryBytes;
+	};
+
+	// pointer to the mesh library for custom cell meshes
+	MeshLibrary* m_pMeshLibrary;
+	// directory holding the world pack files
+	std::string m_directory;
+	// size of each cell along X and Z
+	float m_cellSize;
+	// active streaming settings
+	STREAMING_SETTINGS m_settings;
+	// streaming statistics
+	STREAMING_STATS m_stats;
+
+	// cells that exist on disk
+	std::map<uint64_t, CELL_INDEX_ENTRY> m_cellIndex;
+	// cells that are queued, loading, loaded or resident
+	std::map<uint64_t, WORLD_CELL*> m_cells;
+	// cells that are ready for rendering
+	std::vector<WORLD_CELL*> m_residentCells;
+	// cells handed back by the I/O threads that are waiting for upload
+	std::vector<WORLD_CELL*> m_pendingUploads;
+	// memory used by resident and pending cells
+	uint64_t m_committedBytes;
+
+	// camera tracking for velocity based prefetching
+	glm::vec3 m_lastCameraPosition;
+	glm::vec3 m_cameraVelocity;
+	double m_lastUpdateTime;
+	bool m_bFirstUpdate;
+
+	// I/O thread state, guarded by m_queueMutex
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueCondition;
+	std::vector<WORLD_CELL*> m_requestQueue;
+	std::vector<WORLD_CELL*> m_completedCells;
+	std::vector<std::thread> m_ioThreads;
+	bool m_bStopThreads;
+	std::chrono::steady_clock::time_point m_ioWindowStart;
+	uint64_t m_ioWindowBytes;
+	uint64_t m_ioBytesRead;
+
+	// background I/O thread entry point
+	void IoThreadMain();
+	// wait until the I/O budget allows reading more bytes
+	void ThrottleIo(uint64_t bytes);
+	// read and decode a cell pack file and get the memory it takes
+	bool LoadCellFile(WORLD_CELL* pCell, uint64_t& decodedBytes);
+	// upload a loaded cell into OpenGL
+	void UploadCell(WORLD_CELL* pCell);
+	// free a cell and its OpenGL resources
+	void EvictCell(WORLD_CELL* pCell);
+	// remove a cell from the resident and pending upload lists
+	void RemoveCellReferences(WORLD_CELL* pCell);
+
+	// get the map key for a cell coordinate
+	static uint64_t GetCellKey(int x, int z);
+	// get the file path for a cell coordinate
+	std::string GetCellFilename(int x, int z) const;
+	// get the distance from a point to the center of a cell
+	float GetCellDistance(int x, int z, const glm::vec3& position) const;
+};
@@ -0,0 +1,120 @@
+#version 430 core
+layout(local_size_x = 64) in;
+
+// bounding sphere and mesh range of one drawn object
+struct CullObject {
+    vec4 sphere;
+    uint indexCount;
+    uint firstIndex;
+    int baseVertex;
+    uint group;
+};
+
+// objects that are swapped for one impostor billboard together
+struct CullGroup {
+    vec4 sphere;
+    int impostorLayer;
+    uint firstObject;
+    uint padding0;
+    uint padding1;
+};
+
+// command read by glMultiDrawElementsIndirect
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 2) readonly buffer CullObjects
+{
+    CullObject objects[];
+};
+layout(std430, binding = 3) readonly buffer CullGroups
+{
+    CullGroup groups[];
+};
+layout(std430, binding = 4) writeonly buffer DrawCommands
+{
+    DrawCommand commands[];
+};
+// billboard instances laid out like the impostor vertex attributes
+layout(std430, binding = 5) writeonly buffer ImpostorInstances
+{
+    float impostorValues[];
+};
+
+// the draw count, and the instance count of the impostor draw command
+layout(binding = 0, offset = 0) uniform atomic_uint drawCount;
+layout(binding = 0, offset = 8) uniform atomic_uint impostorCount;
+
+uniform vec4 frustumPlanes[6];
+uniform vec3 cameraPosition;
+uniform float impostorDistanceFactor;
+uniform bool bUseImpostors;
+// append visible draws, or keep every command and hide culled ones
+uniform bool bCompactDraws;
+uniform uint objectCount;
+
+// function prototypes
+bool IsSphereVisible(vec4 sphere);
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if(index >= objectCount)
+    {
+        return;
+    }
+
+    CullObject object = objects[index];
+    CullGroup group = groups[object.group];
+    bool bVisible = IsSphereVisible(object.sphere);
+
+    // level of detail - far away groups are drawn as one billboard,
+    // which the first object of the group adds
+    if((bUseImpostors == true) && (group.impostorLayer >= 0) &&
+       (distance(cameraPosition, group.sphere.xyz) > group.sphere.w * impostorDistanceFactor))
+    {
+        bVisible = false;
+        if((group.firstObject == index) && (IsSphereVisible(group.sphere) == true))
+        {
+            uint instance = atomicCounterIncrement(impostorCount) * 5u;
+            impostorValues[instance + 0u] = group.sphere.x;
+            impostorValues[instance + 1u] = group.sphere.y;
+            impostorValues[instance + 2u] = group.sphere.z;
+            impostorValues[instance + 3u] = group.sphere.w;
+            impostorValues[instance + 4u] = float(group.impostorLayer);
+        }
+    }
+
+    // the base instance selects the per-draw values of the object
+    DrawCommand command = DrawCommand(object.indexCount, 1u, object.firstIndex, object.baseVertex, index);
+    if(bCompactDraws == true)
+    {
+        if(bVisible == true)
+        {
+            commands[atomicCounterIncrement(drawCount)] = command;
+        }
+    }
+    else
+    {
+        command.instanceCount = (bVisible == true) ? 1u : 0u;
+        commands[index] = command;
+    }
+}
+
+// tests a bounding sphere against the planes of the view frustum
+bool IsSphereVisible(vec4 sphere)
+{
+    for(int i = 0; i < 6; i++)
+    {
+        if(dot(frustumPlanes[i].xyz, sphere.xyz) + frustumPlanes[i].w < -sphere.w)
+        {
+            return false;
+        }
+    }
+    return true;
+}
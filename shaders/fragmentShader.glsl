@@ -1,4 +1,11 @@
 #version 330 core
+// scene textures sampled through a table of bindless handles
+#ifdef USE_BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#endif
+#if defined(USE_BINDLESS_TEXTURES) || defined(USE_GPU_DRAWS)
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
 out vec4 fragmentColor;
 
 in vec3 fragmentPosition;
@@ -50,24 +57,98 @@ struct SpotLight {
 
 #define TOTAL_POINT_LIGHTS 5
 
-uniform bool bUseTexture=false;
+#ifdef USE_GPU_DRAWS
+struct DrawValues {
+    mat4 model;
+    // projection * view * model, and the inverse transpose of the model
+    // in the upper 3x3 - both worked out on the CPU once per draw
+    mat4 modelViewProjection;
+    mat4 normalMatrix;
+    vec4 objectColor;
+    vec4 materialDiffuseColor;
+    vec4 materialSpecularColor;
+    vec2 UVscale;
+    bool bUseTexture;
+    int objectTextureIndex;
+};
+// per-draw values of every object, or of a single draw from the ring buffer
+layout(std430) readonly buffer DrawDataArray
+{
+    DrawValues drawValues[];
+};
+flat in uint fragmentDrawIndex;
+
+// per-draw values of this fragment, copied out of the storage buffer
+vec4 objectColor;
+vec4 materialDiffuseColor;
+vec4 materialSpecularColor;
+vec2 UVscale;
+bool bUseTexture;
+int objectTextureIndex;
+#else
+// per-draw values, written into a ring buffer for every draw
+layout(std140) uniform DrawData
+{
+    mat4 model;
+    // projection * view * model, and the inverse transpose of the model
+    // in the upper 3x3 - both worked out on the CPU once per draw
+    mat4 modelViewProjection;
+    mat4 normalMatrix;
+    vec4 objectColor;
+    vec4 materialDiffuseColor;
+    vec4 materialSpecularColor;
+    vec2 UVscale;
+    bool bUseTexture;
+    // handle table slot of the object texture, or -1 for objectTexture
+    int objectTextureIndex;
+};
+#endif
+
 uniform bool bUseLighting=false;
-uniform vec4 objectColor = vec4(1.0f);
 uniform vec3 viewPosition;
 uniform DirectionalLight directionalLight;
 uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
 uniform SpotLight spotLight;
-uniform Material material;
 uniform sampler2D objectTexture;
-uniform vec2 UVscale = vec2(1.0f, 1.0f);
+#ifdef USE_REFLECTION_PROBES
+// prefiltered cubemap of the nearest reflection probe - rougher
+// reflections are kept in the smaller mip levels
+uniform samplerCube reflectionProbe;
+uniform float reflectionProbeMaxLod = 0.0;
+// off until the probes are captured, and while they are captured
+uniform bool bUseReflections = false;
+#endif
+#ifdef USE_BINDLESS_TEXTURES
+readonly buffer MaterialTextures
+{
+    uvec2 textureHandles[];
+};
+#endif
+
+// material of the object, unpacked from the draw data
+Material material;
 
 // function prototypes
 vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec4 SampleObjectTexture(vec2 uv);
+#ifdef USE_REFLECTION_PROBES
+vec3 AddReflection(vec3 phongResult, vec3 normal, vec3 viewDir);
+#endif
 
 void main()
 {    
+#ifdef USE_GPU_DRAWS
+    objectColor = drawValues[fragmentDrawIndex].objectColor;
+    materialDiffuseColor = drawValues[fragmentDrawIndex].materialDiffuseColor;
+    materialSpecularColor = drawValues[fragmentDrawIndex].materialSpecularColor;
+    UVscale = drawValues[fragmentDrawIndex].UVscale;
+    bUseTexture = drawValues[fragmentDrawIndex].bUseTexture;
+    objectTextureIndex = drawValues[fragmentDrawIndex].objectTextureIndex;
+#endif
+    material = Material(materialDiffuseColor.rgb, materialSpecularColor.rgb, materialDiffuseColor.w);
+
     if(bUseLighting == true)
     {
         vec3 phongResult = vec3(0.0f);
@@ -99,10 +180,14 @@ void main()
         {
             phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
         }
+#ifdef USE_REFLECTION_PROBES
+        // phase 4: the scene reflected on metal and glass
+        phongResult = AddReflection(phongResult, norm, viewDir);
+#endif
     
         if(bUseTexture == true)
         {
-            fragmentColor = vec4(phongResult, (texture(objectTexture, fragmentTextureCoordinate)).a);
+            fragmentColor = vec4(phongResult, (SampleObjectTexture(fragmentTextureCoordinate)).a);
         }
         else
         {
@@ -113,7 +198,7 @@ void main()
     {
         if(bUseTexture == true)
         {
-            fragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+            fragmentColor = SampleObjectTexture(fragmentTextureCoordinate * UVscale);
         }
         else
         {
@@ -138,9 +223,9 @@ vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
     // combine results
     if(bUseTexture == true)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
+        ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        specular = light.specular * spec * material.specularColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
     }
     else
     {
@@ -170,8 +255,8 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // combine results
     if(bUseTexture == true)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
+        ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
         specular = light.specular * specularComponent * material.specularColor;
     }
     else
@@ -207,9 +292,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // combine results
     if(bUseTexture == true)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
+        ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        specular = light.specular * spec * material.specularColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
     }
     else
     {
@@ -223,3 +308,39 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     specular *= attenuation * intensity;
     return (ambient + diffuse + specular);
 }
+
+#ifdef USE_REFLECTION_PROBES
+// blends the reflection from the probe over the lit color, by the
+// reflectivity kept in the material specular alpha
+vec3 AddReflection(vec3 phongResult, vec3 normal, vec3 viewDir)
+{
+    float reflectivity = materialSpecularColor.w;
+    if((bUseReflections == false) || (reflectivity <= 0.0))
+    {
+        return phongResult;
+    }
+
+    // shinier materials read the sharper mip levels
+    float roughness = sqrt(2.0 / (max(material.shininess, 0.0) + 2.0));
+    vec3 reflectDir = reflect(-viewDir, normal);
+    vec3 reflection = textureLod(reflectionProbe, reflectDir, roughness * reflectionProbeMaxLod).rgb;
+    vec3 baseColor = vec3(objectColor);
+    if(bUseTexture == true)
+    {
+        baseColor = vec3(SampleObjectTexture(fragmentTextureCoordinate));
+    }
+    return mix(phongResult, reflection * baseColor, reflectivity);
+}
+#endif
+
+// sample the object texture through its bindless handle, or the bound slot
+vec4 SampleObjectTexture(vec2 uv)
+{
+#ifdef USE_BINDLESS_TEXTURES
+    if(objectTextureIndex >= 0)
+    {
+        return texture(sampler2D(textureHandles[objectTextureIndex]), uv);
+    }
+#endif
+    return texture(objectTexture, uv);
+}
@@ -0,0 +1,32 @@
+#version 330 core
+out vec4 fragmentColor;
+
+in vec2 atlasCoordinate;
+in vec3 billboardPosition;
+flat in vec3 frameDirection;
+flat in float frameRadius;
+flat in float atlasLayer;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform sampler2DArray impostorColor;
+uniform sampler2DArray impostorDepth;
+
+void main()
+{
+    // colors are stored premultiplied by alpha
+    vec4 color = texture(impostorColor, vec3(atlasCoordinate, atlasLayer));
+    if (color.a < 0.02)
+    {
+        discard;
+    }
+
+    // the captured depth is linear across the bounding sphere, so it moves
+    // the billboard point back onto the surface of the baked object
+    float depth = texture(impostorDepth, vec3(atlasCoordinate, atlasLayer)).r;
+    vec3 surfacePosition = billboardPosition + frameDirection * (frameRadius - 2.0 * frameRadius * depth);
+    vec4 clipPosition = projection * view * vec4(surfacePosition, 1.0);
+    gl_FragDepth = (clipPosition.z / clipPosition.w) * 0.5 + 0.5;
+
+    fragmentColor = color;
+}
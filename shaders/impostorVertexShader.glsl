@@ -0,0 +1,72 @@
+#version 330 core
+layout (location = 0) in vec4 inCenterRadius;
+layout (location = 1) in float inLayer;
+
+out vec2 atlasCoordinate;
+out vec3 billboardPosition;
+flat out vec3 frameDirection;
+flat out float frameRadius;
+flat out float atlasLayer;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPosition;
+uniform int framesPerSide;
+
+// sign function that never returns zero, for octahedral folding
+vec2 SignNotZero(vec2 value)
+{
+    return vec2((value.x >= 0.0) ? 1.0 : -1.0, (value.y >= 0.0) ? 1.0 : -1.0);
+}
+
+// map a unit direction onto the octahedral square
+vec2 EncodeOctahedral(vec3 direction)
+{
+    vec3 n = direction / (abs(direction.x) + abs(direction.y) + abs(direction.z));
+    vec2 p = n.xz;
+    if (n.y < 0.0)
+    {
+        p = (1.0 - abs(n.zx)) * SignNotZero(n.xz);
+    }
+    return p * 0.5 + 0.5;
+}
+
+// map a point of the octahedral square back to a direction
+vec3 DecodeOctahedral(vec2 uv)
+{
+    vec2 p = uv * 2.0 - 1.0;
+    vec3 n = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+    if (n.y < 0.0)
+    {
+        n.xz = (1.0 - abs(n.zx)) * SignNotZero(n.xz);
+    }
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 center = inCenterRadius.xyz;
+    float radius = inCenterRadius.w;
+
+    // pick the baked frame that was captured closest to the view direction
+    vec2 octahedral = EncodeOctahedral(normalize(viewPosition - center));
+    vec2 frame = clamp(floor(octahedral * float(framesPerSide)), vec2(0.0), vec2(float(framesPerSide - 1)));
+    vec3 direction = DecodeOctahedral((frame + 0.5) / float(framesPerSide));
+
+    // build the billboard from the same axes as the capture camera
+    vec3 up = (abs(direction.y) > 0.99) ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 forward = -direction;
+    vec3 right = normalize(cross(forward, up));
+    up = cross(right, forward);
+
+    // triangle strip corners generated from the vertex index
+    vec2 corner = vec2(((gl_VertexID & 1) == 0) ? -1.0 : 1.0, ((gl_VertexID & 2) == 0) ? -1.0 : 1.0);
+
+    billboardPosition = center + (right * corner.x + up * corner.y) * radius;
+    atlasCoordinate = (frame + (corner * 0.5 + 0.5)) / float(framesPerSide);
+    frameDirection = direction;
+    frameRadius = radius;
+    atlasLayer = inLayer;
+
+    gl_Position = projection * view * vec4(billboardPosition, 1.0);
+}
@@ -0,0 +1,119 @@
+#version 430 core
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+#define PI 3.14159265359
+#define SAMPLE_COUNT 64u
+
+// captured faces of the probe, with their full mip chain
+layout(binding = 0) uniform samplerCube sourceCube;
+// mip level of the prefiltered cubemap being written
+layout(rgba16f, binding = 0) writeonly uniform imageCube targetLevel;
+
+// roughness of this level, from 0 for a mirror up to 1
+uniform float roughness;
+// last mip level of the source cubemap
+uniform float sourceLods;
+// width and height of a face at this level
+uniform int faceSize;
+
+// function prototypes
+vec3 GetTexelDirection(ivec3 texel);
+vec2 Hammersley(uint i, uint count);
+vec3 ImportanceSampleGGX(vec2 xi, vec3 normal, float alpha);
+
+void main()
+{
+    ivec3 texel = ivec3(gl_GlobalInvocationID);
+    if((texel.x >= faceSize) || (texel.y >= faceSize))
+    {
+        return;
+    }
+
+    vec3 normal = GetTexelDirection(texel);
+    if(roughness <= 0.0)
+    {
+        imageStore(targetLevel, texel, vec4(textureLod(sourceCube, normal, 0.0).rgb, 1.0));
+        return;
+    }
+
+    // the view is taken to look straight along the normal, so the
+    // filtered result only depends on the direction
+    float alpha = roughness * roughness;
+    float sourceSize = float(textureSize(sourceCube, 0).x);
+    float texelSolidAngle = 4.0 * PI / (6.0 * sourceSize * sourceSize);
+    vec3 color = vec3(0.0);
+    float totalWeight = 0.0;
+    for(uint i = 0u; i < SAMPLE_COUNT; i++)
+    {
+        vec3 halfway = ImportanceSampleGGX(Hammersley(i, SAMPLE_COUNT), normal, alpha);
+        vec3 light = normalize(2.0 * dot(normal, halfway) * halfway - normal);
+        float NdotL = dot(normal, light);
+        if(NdotL > 0.0)
+        {
+            // samples that stand for a wide cone read a smaller mip level,
+            // so a few samples do not alias
+            float NdotH = max(dot(normal, halfway), 0.0);
+            float alpha2 = alpha * alpha;
+            float denominator = NdotH * NdotH * (alpha2 - 1.0) + 1.0;
+            float pdf = (alpha2 / (PI * denominator * denominator)) * 0.25;
+            float sampleSolidAngle = 1.0 / (float(SAMPLE_COUNT) * pdf + 0.0001);
+            float lod = clamp(0.5 * log2(sampleSolidAngle / texelSolidAngle) + 1.0, 0.0, sourceLods);
+
+            color += textureLod(sourceCube, light, lod).rgb * NdotL;
+            totalWeight += NdotL;
+        }
+    }
+    imageStore(targetLevel, texel, vec4(color / max(totalWeight, 0.0001), 1.0));
+}
+
+// gets the direction through the center of a texel of a cubemap face
+vec3 GetTexelDirection(ivec3 texel)
+{
+    vec2 uv = ((vec2(texel.xy) + 0.5) / float(faceSize)) * 2.0 - 1.0;
+    vec3 direction;
+    if(texel.z == 0)
+    {
+        direction = vec3(1.0, -uv.y, -uv.x);
+    }
+    else if(texel.z == 1)
+    {
+        direction = vec3(-1.0, -uv.y, uv.x);
+    }
+    else if(texel.z == 2)
+    {
+        direction = vec3(uv.x, 1.0, uv.y);
+    }
+    else if(texel.z == 3)
+    {
+        direction = vec3(uv.x, -1.0, -uv.y);
+    }
+    else if(texel.z == 4)
+    {
+        direction = vec3(uv.x, -uv.y, 1.0);
+    }
+    else
+    {
+        direction = vec3(-uv.x, -uv.y, -1.0);
+    }
+    return normalize(direction);
+}
+
+// gets an evenly spread point of a low discrepancy sequence
+vec2 Hammersley(uint i, uint count)
+{
+    return vec2(float(i) / float(count), float(bitfieldReverse(i)) * 2.3283064365386963e-10);
+}
+
+// gets a halfway vector around the normal, spread like the GGX lobe
+vec3 ImportanceSampleGGX(vec2 xi, vec3 normal, float alpha)
+{
+    float phi = 2.0 * PI * xi.x;
+    float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (alpha * alpha - 1.0) * xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    vec3 tangentHalfway = vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+
+    vec3 up = (abs(normal.z) < 0.999) ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, normal));
+    vec3 bitangent = cross(normal, tangent);
+    return normalize(tangent * tangentHalfway.x + bitangent * tangentHalfway.y + normal * tangentHalfway.z);
+}
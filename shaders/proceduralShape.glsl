@@ -0,0 +1,79 @@
+// evaluates the round basic shapes from their position on a grid of slices
+// and rows, laid out like the cooked shapes - shared by the vertex shader
+// and the tessellation evaluation shader through #include
+
+#define PI 3.14159265358979
+// basic shape numbers, matching the MESH_SHAPE values
+#define SHAPE_CONE 1
+#define SHAPE_CYLINDER 2
+#define SHAPE_SPHERE 4
+#define SHAPE_TAPERED_CYLINDER 5
+#define SHAPE_TORUS 6
+
+// computes the surface at a grid position, which may fall between the grid
+// lines - cylinders and cones use their first and last rows for the caps,
+// so the row of the cell the position lies in is passed in as well
+void EvaluateShape(int shape, ivec2 tessellation, int cellRow, vec2 gridPosition, out vec3 position, out vec3 normal, out vec2 uv)
+{
+    float u = gridPosition.x / float(tessellation.x);
+    float angle = 2.0 * PI * u;
+
+    if(shape == SHAPE_SPHERE)
+    {
+        float v = gridPosition.y / float(tessellation.y);
+        float theta = PI * v;
+        normal = vec3(sin(theta) * cos(angle), cos(theta), sin(theta) * sin(angle));
+        position = normal;
+        uv = vec2(u, 1.0 - v);
+    }
+    else if(shape == SHAPE_TORUS)
+    {
+        float tubeAngle = 2.0 * PI * gridPosition.y / float(tessellation.y);
+        vec3 ringDirection = vec3(cos(angle), sin(angle), 0.0);
+        normal = (ringDirection * cos(tubeAngle)) + vec3(0.0, 0.0, sin(tubeAngle));
+        position = ringDirection + (normal * 0.2);
+        uv = vec2(u, gridPosition.y / float(tessellation.y));
+    }
+    else
+    {
+        float topRadius = 1.0;
+        if(shape == SHAPE_CONE)
+        {
+            topRadius = 0.0;
+        }
+        else if(shape == SHAPE_TAPERED_CYLINDER)
+        {
+            topRadius = 0.5;
+        }
+        vec2 direction = vec2(cos(angle), sin(angle));
+        int sideRows = tessellation.y - 2;
+        // how far across its row the position is
+        float rowFraction = gridPosition.y - float(cellRow);
+
+        if(cellRow == 0)
+        {
+            // bottom cap, from the center out to the rim
+            float radius = rowFraction;
+            position = vec3(direction.x * radius, 0.0, direction.y * radius);
+            normal = vec3(0.0, -1.0, 0.0);
+            uv = vec2(0.5) + (0.5 * radius * direction);
+        }
+        else if(cellRow == tessellation.y - 1)
+        {
+            // top cap, from the rim in to the center
+            float radius = topRadius * (1.0 - rowFraction);
+            position = vec3(direction.x * radius, 1.0, direction.y * radius);
+            normal = vec3(0.0, 1.0, 0.0);
+            uv = vec2(0.5) + (0.5 * (1.0 - rowFraction) * direction);
+        }
+        else
+        {
+            // the side normals lean up as the side narrows
+            float v = (gridPosition.y - 1.0) / float(sideRows);
+            float radius = mix(1.0, topRadius, v);
+            position = vec3(direction.x * radius, v, direction.y * radius);
+            normal = normalize(vec3(direction.x, 1.0 - topRadius, direction.y));
+            uv = vec2(u, v);
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#version 330 core
+// one direction of the separable blur that keeps depth edges sharp
+layout (location = 0) out vec2 occlusionDepth;
+
+in vec2 screenCoordinate;
+
+#define BLUR_RADIUS 4
+
+uniform sampler2D occlusion;
+// size of one texel along the blur direction
+uniform vec2 blurStep;
+// how quickly the weight falls off with the relative depth difference
+uniform float depthSharpness = 16.0;
+
+void main()
+{
+    vec2 center = texture(occlusion, screenCoordinate).rg;
+    float total = 0.0;
+    float totalWeight = 0.0;
+    for(int i = -BLUR_RADIUS; i <= BLUR_RADIUS; i++)
+    {
+        vec2 value = texture(occlusion, screenCoordinate + blurStep * float(i)).rg;
+        float spatial = exp(-float(i * i) / (2.0 * 2.5 * 2.5));
+        float range = exp(-abs(value.g - center.g) * depthSharpness / max(center.g, 0.001));
+        total += value.r * spatial * range;
+        totalWeight += spatial * range;
+    }
+    occlusionDepth = vec2(total / totalWeight, center.g);
+}
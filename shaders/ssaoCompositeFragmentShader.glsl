@@ -0,0 +1,45 @@
+#version 330 core
+// upsample the occlusion with depth weights and darken the scene with it
+out vec4 fragmentColor;
+
+in vec2 screenCoordinate;
+
+uniform sampler2D sceneDepth;
+uniform sampler2D sceneColor;
+uniform sampler2D occlusion;
+uniform mat4 inverseProjection;
+// texels of the occlusion target
+uniform vec2 occlusionSize;
+uniform float depthSharpness = 16.0;
+
+void main()
+{
+    vec4 color = texture(sceneColor, screenCoordinate);
+    float depth = texture(sceneDepth, screenCoordinate).r;
+    if(depth >= 1.0)
+    {
+        fragmentColor = color;
+        return;
+    }
+    vec4 position = inverseProjection * vec4(vec3(screenCoordinate, depth) * 2.0 - 1.0, 1.0);
+    float linearDepth = -position.z / position.w;
+
+    // the four occlusion texels around this pixel, weighted like a
+    // bilinear filter and by how close their depth is to this pixel's
+    vec2 texelPosition = screenCoordinate * occlusionSize - 0.5;
+    vec2 base = floor(texelPosition);
+    vec2 blend = texelPosition - base;
+    float total = 0.0;
+    float totalWeight = 0.0;
+    for(int i = 0; i < 4; i++)
+    {
+        vec2 offset = vec2(float(i & 1), float(i >> 1));
+        vec2 value = texture(occlusion, (base + offset + 0.5) / occlusionSize).rg;
+        vec2 bilinear = mix(1.0 - blend, blend, offset);
+        float weight = bilinear.x * bilinear.y *
+            exp(-abs(value.g - linearDepth) * depthSharpness / max(linearDepth, 0.001)) + 0.0001;
+        total += value.r * weight;
+        totalWeight += weight;
+    }
+    fragmentColor = vec4(color.rgb * (total / totalWeight), color.a);
+}
@@ -0,0 +1,92 @@
+#version 330 core
+// occlusion at the reduced resolution, with the linear depth kept next to it
+layout (location = 0) out vec2 occlusionDepth;
+
+in vec2 screenCoordinate;
+
+#define SAMPLE_COUNT 12
+
+uniform sampler2D sceneDepth;
+uniform mat4 projection;
+uniform mat4 inverseProjection;
+// size of one texel of the full resolution depth
+uniform vec2 depthTexelSize;
+// distance around a point that can occlude it, in scene units
+uniform float occlusionRadius = 1.5;
+uniform float occlusionBias = 0.05;
+uniform float occlusionStrength = 1.2;
+
+// directions in the hemisphere around +z, closer ones more often
+const vec3 g_Kernel[SAMPLE_COUNT] = vec3[](
+    vec3( 0.52,  0.11, 0.32), vec3(-0.31,  0.42, 0.18), vec3( 0.08, -0.55, 0.27),
+    vec3(-0.46, -0.22, 0.41), vec3( 0.21,  0.63, 0.52), vec3( 0.71, -0.34, 0.23),
+    vec3(-0.63,  0.51, 0.36), vec3(-0.12, -0.78, 0.44), vec3( 0.38,  0.29, 0.83),
+    vec3(-0.84, -0.09, 0.52), vec3( 0.57, -0.72, 0.39), vec3(-0.21,  0.33, 0.92));
+
+// function prototypes
+vec3 GetViewPosition(vec2 uv);
+vec3 GetViewNormal(vec2 uv, vec3 center);
+
+void main()
+{
+    float depth = texture(sceneDepth, screenCoordinate).r;
+    if(depth >= 1.0)
+    {
+        // nothing was drawn here, so nothing is occluded
+        occlusionDepth = vec2(1.0, 1.0e6);
+        return;
+    }
+
+    vec3 center = GetViewPosition(screenCoordinate);
+    vec3 normal = GetViewNormal(screenCoordinate, center);
+
+    // turn the kernel by a different angle in every pixel, which the
+    // blur smooths out
+    float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    vec3 randomVector = vec3(cos(angle), sin(angle), 0.0);
+    vec3 tangent = normalize(randomVector - normal * dot(randomVector, normal));
+    vec3 bitangent = cross(normal, tangent);
+    mat3 tbn = mat3(tangent, bitangent, normal);
+
+    float occlusion = 0.0;
+    for(int i = 0; i < SAMPLE_COUNT; i++)
+    {
+        vec3 samplePosition = center + (tbn * g_Kernel[i]) * occlusionRadius;
+        vec4 clip = projection * vec4(samplePosition, 1.0);
+        vec2 sampleUV = (clip.xy / clip.w) * 0.5 + 0.5;
+        if((sampleUV.x < 0.0) || (sampleUV.x > 1.0) || (sampleUV.y < 0.0) || (sampleUV.y > 1.0))
+        {
+            continue;
+        }
+
+        float sceneZ = GetViewPosition(sampleUV).z;
+        // surfaces far in front of the point do not darken it
+        float range = smoothstep(0.0, 1.0, occlusionRadius / abs(center.z - sceneZ));
+        occlusion += ((sceneZ >= samplePosition.z + occlusionBias) ? 1.0 : 0.0) * range;
+    }
+
+    float ambient = pow(clamp(1.0 - occlusion / float(SAMPLE_COUNT), 0.0, 1.0), occlusionStrength);
+    occlusionDepth = vec2(ambient, -center.z);
+}
+
+// rebuilds the view space position of the depth at a screen position
+vec3 GetViewPosition(vec2 uv)
+{
+    float depth = texture(sceneDepth, uv).r;
+    vec4 position = inverseProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
+
+// rebuilds the normal from the neighboring depths, using the neighbor
+// on the side that is closer in depth so that edges stay sharp
+vec3 GetViewNormal(vec2 uv, vec3 center)
+{
+    vec3 left = GetViewPosition(uv - vec2(depthTexelSize.x, 0.0));
+    vec3 right = GetViewPosition(uv + vec2(depthTexelSize.x, 0.0));
+    vec3 down = GetViewPosition(uv - vec2(0.0, depthTexelSize.y));
+    vec3 up = GetViewPosition(uv + vec2(0.0, depthTexelSize.y));
+
+    vec3 acrossX = (abs(right.z - center.z) < abs(center.z - left.z)) ? (right - center) : (center - left);
+    vec3 acrossY = (abs(up.z - center.z) < abs(center.z - down.z)) ? (up - center) : (center - down);
+    return normalize(cross(acrossX, acrossY));
+}
@@ -0,0 +1,90 @@
+#version 400 core
+// every triangle of the scene is a patch of three control points
+layout (vertices = 3) out;
+
+in vec3 controlPosition[];
+in vec3 controlNormal[];
+in vec2 controlTextureCoordinate[];
+flat in mat4 controlModel[];
+flat in mat4 controlModelViewProjection[];
+flat in mat3 controlNormalMatrix[];
+in vec4 controlClipPosition[];
+in vec2 controlGridPosition[];
+flat in int controlGridRow[];
+flat in ivec2 controlTessellation[];
+#ifdef USE_GPU_DRAWS
+flat in uint controlDrawIndex[];
+#endif
+
+out vec3 evaluationPosition[];
+out vec3 evaluationNormal[];
+out vec2 evaluationTextureCoordinate[];
+out vec2 evaluationGridPosition[];
+// values that are the same for the whole patch
+patch out mat4 evaluationModel;
+patch out mat4 evaluationModelViewProjection;
+patch out mat3 evaluationNormalMatrix;
+patch out int evaluationGridRow;
+patch out ivec2 evaluationTessellation;
+#ifdef USE_GPU_DRAWS
+patch out uint evaluationDrawIndex;
+#endif
+
+// size of the viewport in pixels
+uniform vec2 viewportSize;
+// length in pixels that each tessellated edge is aimed at
+uniform float tessellationEdgePixels = 12.0;
+
+// function prototypes
+float GetEdgeLevel(vec4 clipStart, vec4 clipEnd);
+
+void main()
+{
+   evaluationPosition[gl_InvocationID] = controlPosition[gl_InvocationID];
+   evaluationNormal[gl_InvocationID] = controlNormal[gl_InvocationID];
+   evaluationTextureCoordinate[gl_InvocationID] = controlTextureCoordinate[gl_InvocationID];
+   evaluationGridPosition[gl_InvocationID] = controlGridPosition[gl_InvocationID];
+
+   if(gl_InvocationID == 0)
+   {
+      evaluationModel = controlModel[0];
+      evaluationModelViewProjection = controlModelViewProjection[0];
+      evaluationNormalMatrix = controlNormalMatrix[0];
+      evaluationGridRow = controlGridRow[0];
+      evaluationTessellation = controlTessellation[0];
+#ifdef USE_GPU_DRAWS
+      evaluationDrawIndex = controlDrawIndex[0];
+#endif
+
+      // meshes are flat already and pass through as single triangles,
+      // while generated shapes are split as finely as they look on screen
+      vec3 levels = vec3(1.0);
+      if(controlGridRow[0] >= 0)
+      {
+         levels = vec3(GetEdgeLevel(controlClipPosition[1], controlClipPosition[2]),
+            GetEdgeLevel(controlClipPosition[2], controlClipPosition[0]),
+            GetEdgeLevel(controlClipPosition[0], controlClipPosition[1]));
+      }
+      // each outer level is for the edge opposite the control point, and
+      // neighbor patches work it out from the same two points, so their
+      // shared edges split the same way without cracks
+      gl_TessLevelOuter[0] = levels.x;
+      gl_TessLevelOuter[1] = levels.y;
+      gl_TessLevelOuter[2] = levels.z;
+      gl_TessLevelInner[0] = max(levels.x, max(levels.y, levels.z));
+   }
+}
+
+// picks the level of an edge from its projected length in pixels - edges
+// that cross behind the viewer cannot be projected and get the most detail
+float GetEdgeLevel(vec4 clipStart, vec4 clipEnd)
+{
+   if((clipStart.w <= 0.0) || (clipEnd.w <= 0.0))
+   {
+      return 64.0;
+   }
+
+   vec2 screenStart = (clipStart.xy / clipStart.w) * 0.5 * viewportSize;
+   vec2 screenEnd = (clipEnd.xy / clipEnd.w) * 0.5 * viewportSize;
+   return clamp(length(screenEnd - screenStart) / tessellationEdgePixels, 1.0, 64.0);
+}
@@ -0,0 +1,50 @@
+#version 400 core
+// the odd fractional spacing lets the detail change smoothly with distance
+layout (triangles, fractional_odd_spacing, ccw) in;
+
+in vec3 evaluationPosition[];
+in vec3 evaluationNormal[];
+in vec2 evaluationTextureCoordinate[];
+in vec2 evaluationGridPosition[];
+patch in mat4 evaluationModel;
+patch in mat4 evaluationModelViewProjection;
+patch in mat3 evaluationNormalMatrix;
+patch in int evaluationGridRow;
+patch in ivec2 evaluationTessellation;
+#ifdef USE_GPU_DRAWS
+patch in uint evaluationDrawIndex;
+flat out uint fragmentDrawIndex;
+#endif
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+
+// basic shape of the patch, or -1 for meshes
+uniform int proceduralShape = -1;
+
+#include "proceduralShape.glsl"
+
+void main()
+{
+   vec3 weights = gl_TessCoord;
+   vec3 position = (weights.x * evaluationPosition[0]) + (weights.y * evaluationPosition[1]) + (weights.z * evaluationPosition[2]);
+   vec3 normal = (weights.x * evaluationNormal[0]) + (weights.y * evaluationNormal[1]) + (weights.z * evaluationNormal[2]);
+   vec2 uv = (weights.x * evaluationTextureCoordinate[0]) + (weights.y * evaluationTextureCoordinate[1]) + (weights.z * evaluationTextureCoordinate[2]);
+
+   // generated shapes put the new points on the true surface, rather than
+   // on the flat triangle between the control points
+   if((proceduralShape >= 0) && (evaluationGridRow >= 0))
+   {
+      vec2 gridPosition = (weights.x * evaluationGridPosition[0]) + (weights.y * evaluationGridPosition[1]) + (weights.z * evaluationGridPosition[2]);
+      EvaluateShape(proceduralShape, evaluationTessellation, evaluationGridRow, gridPosition, position, normal, uv);
+   }
+
+   fragmentPosition = vec3(evaluationModel * vec4(position, 1.0));
+   gl_Position = evaluationModelViewProjection * vec4(position, 1.0f);
+   fragmentVertexNormal = evaluationNormalMatrix * normal;
+   fragmentTextureCoordinate = uv;
+#ifdef USE_GPU_DRAWS
+   fragmentDrawIndex = evaluationDrawIndex;
+#endif
+}
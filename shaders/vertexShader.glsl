@@ -1,20 +1,210 @@
 #version 330 core
+// per-draw values read from a storage buffer at the draw index
+#ifdef USE_GPU_DRAWS
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
+// the viewport of each view is picked here when the driver allows it
+#ifdef USE_MULTI_VIEW
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_viewport_index : enable
+#endif
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+#ifdef USE_GPU_DRAWS
+// read once per instance, so the base instance of a draw selects it
+layout (location = 3) in uint inDrawIndex;
+#endif
+#ifdef USE_PROCEDURAL_SHAPES
+// slices and rows of the generated shape, and its transform inside the
+// model matrix - per instance, or the current values for single draws
+layout (location = 4) in vec2 inTessellation;
+layout (location = 5) in mat4 inInstanceTransform;
+#endif
 
+#ifdef USE_TESSELLATION
+// object space values for the tessellation stages, which do the transforms
+out vec3 controlPosition;
+out vec3 controlNormal;
+out vec2 controlTextureCoordinate;
+// transform matrices, and the clip position that sets the tessellation
+// levels
+flat out mat4 controlModel;
+flat out mat4 controlModelViewProjection;
+flat out mat3 controlNormalMatrix;
+out vec4 controlClipPosition;
+// grid position of generated shapes, and the row of their cell, which is
+// -1 for meshes and collapsed cells
+out vec2 controlGridPosition;
+flat out int controlGridRow;
+flat out ivec2 controlTessellation;
+#else
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+#endif
 
-uniform mat4 model;
+#ifdef USE_GPU_DRAWS
+struct DrawValues {
+    mat4 model;
+    // projection * view * model, and the inverse transpose of the model
+    // in the upper 3x3 - both worked out on the CPU once per draw
+    mat4 modelViewProjection;
+    mat4 normalMatrix;
+    vec4 objectColor;
+    vec4 materialDiffuseColor;
+    vec4 materialSpecularColor;
+    vec2 UVscale;
+    bool bUseTexture;
+    int objectTextureIndex;
+};
+// per-draw values of every object, or of a single draw from the ring buffer
+layout(std430) readonly buffer DrawDataArray
+{
+    DrawValues drawValues[];
+};
+#ifdef USE_TESSELLATION
+flat out uint controlDrawIndex;
+#else
+flat out uint fragmentDrawIndex;
+#endif
+#else
+// per-draw values, written into a ring buffer for every draw
+layout(std140) uniform DrawData
+{
+    mat4 model;
+    // projection * view * model, and the inverse transpose of the model
+    // in the upper 3x3 - both worked out on the CPU once per draw
+    mat4 modelViewProjection;
+    mat4 normalMatrix;
+    vec4 objectColor;
+    vec4 materialDiffuseColor;
+    vec4 materialSpecularColor;
+    vec2 UVscale;
+    bool bUseTexture;
+    int objectTextureIndex;
+};
+#endif
+
+#ifdef USE_TRANSFORM_BENCHMARK
+// the view and projection set every frame, and whether this frame
+// multiplies them with the model per vertex, as the shader did before the
+// matrices were worked out once per draw
 uniform mat4 view;
 uniform mat4 projection;
+uniform bool bPerVertexTransforms = false;
+#endif
+
+#ifdef USE_MULTI_VIEW
+// views drawn together - every draw is instanced once per view, or the
+// views are drawn one at a time with a count of 1, and a count of 0 draws
+// with the model-view-projection matrix as usual
+uniform mat4 viewProjections[4];
+uniform int viewCount = 0;
+#endif
+
+#ifdef USE_PROCEDURAL_SHAPES
+// basic shape generated from gl_VertexID, or -1 to read the vertex attributes
+uniform int proceduralShape = -1;
+// quads per row and rows of the grid that the vertex IDs cover
+uniform vec2 proceduralGrid;
+
+#include "proceduralShape.glsl"
+
+// corners of the two triangles of a grid quad
+const ivec2 quadCorners[6] = ivec2[6](ivec2(0, 1), ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(1, 0), ivec2(1, 1));
+#endif
 
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
-   fragmentVertexNormal = inVertexNormal;
-   fragmentTextureCoordinate = inTextureCoordinate;
-}
\ No newline at end of file
+#ifdef USE_GPU_DRAWS
+   mat4 model = drawValues[inDrawIndex].model;
+   mat4 modelViewProjection = drawValues[inDrawIndex].modelViewProjection;
+   mat4 normalMatrix = drawValues[inDrawIndex].normalMatrix;
+#ifdef USE_TESSELLATION
+   controlDrawIndex = inDrawIndex;
+#else
+   fragmentDrawIndex = inDrawIndex;
+#endif
+#endif
+   vec3 vertexPosition = inVertexPosition;
+   vec3 vertexNormal = inVertexNormal;
+   vec2 textureCoordinate = inTextureCoordinate;
+   vec2 gridPosition = vec2(0.0);
+   int gridRow = -1;
+   ivec2 tessellation = ivec2(0);
+#ifdef USE_TESSELLATION
+   mat4 instanceTransform = mat4(1.0);
+#endif
+#ifdef USE_PROCEDURAL_SHAPES
+   if(proceduralShape >= 0)
+   {
+      int gridSlices = int(proceduralGrid.x);
+      int quad = gl_VertexID / 6;
+      ivec2 cell = ivec2(quad % gridSlices, quad / gridSlices);
+      tessellation = ivec2(inTessellation);
+      if((cell.x < tessellation.x) && (cell.y < tessellation.y))
+      {
+         gridPosition = vec2(cell + quadCorners[gl_VertexID % 6]);
+         gridRow = cell.y;
+         EvaluateShape(proceduralShape, tessellation, gridRow, gridPosition,
+            vertexPosition, vertexNormal, textureCoordinate);
+      }
+      else
+      {
+         // cells beyond the tessellation of this instance collapse to a point
+         vertexPosition = vec3(0.0);
+      }
+#ifdef USE_TESSELLATION
+      // the evaluation shader works in the space of the shape
+      instanceTransform = inInstanceTransform;
+#else
+      // instance transforms have no uneven scale, so they turn normals too
+      vertexPosition = vec3(inInstanceTransform * vec4(vertexPosition, 1.0));
+      vertexNormal = mat3(inInstanceTransform) * vertexNormal;
+#endif
+   }
+#endif
+#ifdef USE_TESSELLATION
+   controlPosition = vertexPosition;
+   controlNormal = vertexNormal;
+   controlTextureCoordinate = textureCoordinate;
+   controlModel = model * instanceTransform;
+   controlModelViewProjection = modelViewProjection * instanceTransform;
+   controlNormalMatrix = mat3(normalMatrix) * mat3(instanceTransform);
+   controlClipPosition = controlModelViewProjection * vec4(vertexPosition, 1.0f);
+   controlGridPosition = gridPosition;
+   controlGridRow = gridRow;
+   controlTessellation = tessellation;
+#else
+   fragmentPosition = vec3(model * vec4(vertexPosition, 1.0));
+#ifdef USE_MULTI_VIEW
+   int view = 0;
+   if(viewCount > 0)
+   {
+      view = gl_InstanceID % viewCount;
+      gl_Position = viewProjections[view] * vec4(fragmentPosition, 1.0f);
+   }
+   else
+   {
+      gl_Position = modelViewProjection * vec4(vertexPosition, 1.0f);
+   }
+#if defined(GL_ARB_shader_viewport_layer_array) || defined(GL_AMD_vertex_shader_viewport_index)
+   gl_ViewportIndex = view;
+#endif
+#elif defined(USE_TRANSFORM_BENCHMARK)
+   if(bPerVertexTransforms)
+   {
+      gl_Position = projection * view * model * vec4(vertexPosition, 1.0f);
+   }
+   else
+   {
+      gl_Position = modelViewProjection * vec4(vertexPosition, 1.0f);
+   }
+#else
+   gl_Position = modelViewProjection * vec4(vertexPosition, 1.0f);
+#endif
+   fragmentVertexNormal = mat3(normalMatrix) * vertexNormal;
+   fragmentTextureCoordinate = textureCoordinate;
+#endif
+}